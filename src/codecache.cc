@@ -0,0 +1,148 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "codecache.h"
+
+#include <sstream>
+#include <stdexcept>
+
+const CodeBlock & CodeCache :: translate (uint64_t address, Memory & memory)
+{
+    std::unordered_map <uint64_t, CodeBlock> :: iterator it;
+
+    // blocks are never removed, and unordered_map never moves them, so a
+    // block found under the lock can be used once it's let go
+    lock.lock_shared();
+    it = blocks.find(address);
+    CodeBlock * found = it != blocks.end() ? &(it->second) : NULL;
+    lock.unlock_shared();
+
+    if (found) {
+        hits++;
+        // only the lookup that makes the block hot compiles it
+        if (jit && (++(found->runs) == JIT_HOT_THRESHOLD))
+            compile(*found);
+        return *found;
+    }
+
+    std::lock_guard <ReadWriteLock> guard(lock);
+
+    // another thread may have translated the block since we looked
+    it = blocks.find(address);
+    if (it != blocks.end()) {
+        hits++;
+        return it->second;
+    }
+
+    misses++;
+    // translate before inserting so a failed translation doesn't leave an
+    // empty entry behind
+    std::list <Instruction *> instructions;
+    size_t block_size;
+
+    // a block may run on into the next frame, which is not next to this one
+    // in our memory, so near the end of a frame we fetch through a copy
+    if (memory.g_page(address) == NULL)
+        throw MemoryFault(address, FAULT_FETCH);
+
+    uint8_t   fetch[CODE_FETCH_SIZE];
+    uint8_t * data = memory.g_data(address);
+    size_t    size = memory.g_data_size(address);
+    if (size < CODE_FETCH_SIZE) {
+        size = memory.g_data(address, fetch, CODE_FETCH_SIZE);
+        data = fetch;
+    }
+
+    if (block_mode)
+        instructions = translator.translate_block(address, data, size, block_size);
+    else {
+        instructions = translator.translate(address, data, size);
+        block_size = instructions.front()->g_size();
+    }
+    size_t ir_removed = 0;
+    if (optimize)
+        ir_removed = passes.run(instructions, translator.g_arena());
+    // the VM relies on this to leave scratch uncleared between blocks
+    if (not temporaries_defined(instructions)) {
+        std::stringstream ss;
+        ss << "block at " << std::hex << address
+           << " reads a temporary before writing it";
+        throw std::runtime_error(ss.str());
+    }
+
+    CodeBlock & block = blocks[address];
+    block.instructions = instructions;
+    block.size         = block_size;
+    block.guest_count  = translator.g_guest_count();
+    block.tmp_count    = translator.g_tmp_count();
+    block.ir_removed   = ir_removed;
+    block.runs         = 1;
+    if (concrete) {
+        block.concrete = JitBlock::decode(block.instructions);
+        if (block.concrete != NULL)
+            decoded++;
+    }
+    return block;
+}
+
+
+CodeCache :: ~CodeCache ()
+{
+    std::unordered_map <uint64_t, CodeBlock> :: iterator it;
+    for (it = blocks.begin(); it != blocks.end(); it++) {
+        delete it->second.concrete;
+        delete it->second.native.load();
+    }
+}
+
+
+void CodeCache :: compile (CodeBlock & block)
+{
+    JitBlock * native = JitBlock::compile(block.instructions);
+    if (native == NULL) {
+        refused++;
+        return;
+    }
+    compiled++;
+    block.native = native;
+}
+
+
+std::string CodeCache :: stats ()
+{
+    std::lock_guard <ReadWriteLock> guard(lock);
+    std::stringstream ss;
+
+    uint64_t lookups = hits + misses;
+    double   rate    = lookups ? (100.0 * hits) / lookups : 0.0;
+
+    ss << "code cache: " << std::dec << blocks.size() << " entries, "
+       << hits << " hits, " << misses << " misses, "
+       << rate << "% hit rate" << std::endl;
+
+    ss << passes.stats() << std::endl;
+
+    ss << "concrete: " << decoded << " of " << blocks.size()
+       << " entries decoded" << std::endl;
+
+    ss << "jit: " << compiled << " blocks compiled, "
+       << refused << " left to the interpreter";
+
+    return ss.str();
+}
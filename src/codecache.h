@@ -0,0 +1,163 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef codecache_HEADER
+#define codecache_HEADER
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "instruction.h"
+#include "jit.h"
+#include "memory.h"
+#include "optimizer.h"
+#include "translator.h"
+
+// the most bytes a block can span, as no x86 instruction is over 15 bytes
+#define CODE_FETCH_SIZE (MAX_BLOCK_INSTRUCTIONS * 15)
+
+/*
+ * The IR for a run of guest instructions starting at one address. size is the
+ * number of guest bytes covered, so a VM that falls through the block sets
+ * RIP to its start address + size. guest_count is the number of guest
+ * instructions covered. tmp_count is the number of scratch slots the block's
+ * temporaries need. ir_removed is the number of IR instructions the passes
+ * took out of the block.
+ *
+ * concrete is the block decoded for the concrete interpreter, or NULL if it
+ * can't be. runs counts lookups of the block, and the lookup which brings it
+ * to JIT_HOT_THRESHOLD compiles the block. native is the compiled block, or
+ * NULL if it has not been compiled or can't be. It may be set by another
+ * thread at any time.
+ */
+struct CodeBlock {
+    std::list <Instruction *> instructions;
+    size_t size;
+    size_t guest_count;
+    size_t tmp_count;
+    size_t ir_removed;
+    JitBlock * concrete;
+    std::atomic <uint64_t> runs;
+    std::atomic <JitBlock *> native;
+
+    CodeBlock () : size(0), guest_count(0), tmp_count(0), ir_removed(0),
+                   concrete(NULL), runs(0), native(NULL) {}
+};
+
+// a pthread read-write lock, as c++0x has no shared mutex
+class ReadWriteLock {
+    private :
+        pthread_rwlock_t rwlock;
+
+        ReadWriteLock (const ReadWriteLock &);
+        void operator = (const ReadWriteLock &);
+    public :
+        ReadWriteLock  () { pthread_rwlock_init(&rwlock, NULL); }
+        ~ReadWriteLock () { pthread_rwlock_destroy(&rwlock); }
+
+        void lock          () { pthread_rwlock_wrlock(&rwlock); }
+        void unlock        () { pthread_rwlock_unlock(&rwlock); }
+        void lock_shared   () { pthread_rwlock_rdlock(&rwlock); }
+        void unlock_shared () { pthread_rwlock_unlock(&rwlock); }
+};
+
+/*
+ * Holds the lifted IR for every guest address we have translated. One
+ * CodeCache is shared by every VM spawned from the same loader, and VMs only
+ * ever read the blocks it hands out. The instructions live in the
+ * translator's arena and are freed together when the cache is destroyed.
+ *
+ * In block mode each entry holds a whole basic block, otherwise it holds a
+ * single instruction. Both kinds of entry are valid at once, so the mode can
+ * be changed at any time.
+ *
+ * Unless optimize is turned off, every entry is run through the PassManager
+ * once, when it is translated. Unless concrete is turned off, each entry is
+ * decoded for the concrete interpreter too, and unless jit is turned off, hot
+ * entries are compiled to native code.
+ *
+ * Code is assumed not to be modified once it has been translated.
+ *
+ * VMs on different threads may share one CodeCache. Lookups of blocks we
+ * have take the lock shared, so they run side by side, and translations take
+ * it alone. Hot blocks are compiled outside the lock. A returned block stays
+ * valid for the life of the cache.
+ */
+class CodeCache {
+    private :
+        Translator translator;
+        PassManager passes;
+        std::unordered_map <uint64_t, CodeBlock> blocks;
+        bool block_mode;
+        bool optimize;
+        bool concrete;
+        bool jit;
+        ReadWriteLock lock;
+
+        std::atomic <uint64_t> hits;
+        std::atomic <uint64_t> misses;
+        std::atomic <uint64_t> decoded;
+        std::atomic <uint64_t> compiled;
+        std::atomic <uint64_t> refused; // hot blocks the JIT can't compile
+
+        CodeCache (const CodeCache &);
+        void operator = (const CodeCache &);
+
+        void compile (CodeBlock & block);
+
+    public :
+        CodeCache () : block_mode(false), optimize(true), concrete(true),
+                       jit(true), hits(0), misses(0), decoded(0), compiled(0),
+                       refused(0) {}
+        ~CodeCache ();
+
+        // returns the block starting at address, translating it from memory
+        // if we have not seen this address before
+        const CodeBlock & translate (uint64_t address, Memory & memory);
+
+        Translator &  g_translator () { return translator; }
+        PassManager & g_passes     () { return passes; }
+
+        bool g_block_mode ()                { return block_mode; }
+        void s_block_mode (bool block_mode) { this->block_mode = block_mode; }
+
+        bool g_optimize ()              { return optimize; }
+        void s_optimize (bool optimize) { this->optimize = optimize; }
+
+        bool g_concrete ()              { return concrete; }
+        void s_concrete (bool concrete) { this->concrete = concrete; }
+
+        bool g_jit ()         { return jit; }
+        void s_jit (bool jit) { this->jit = jit; }
+
+        uint64_t g_hits   () { return hits;   }
+        uint64_t g_misses () { return misses; }
+        uint64_t g_compiled () { return compiled; }
+        size_t   g_size   () { return blocks.size(); }
+
+        std::string stats ();
+};
+
+#endif
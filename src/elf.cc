@@ -679,36 +679,35 @@ Memory Elf64 :: g_memory ()
 }
 
 
-std::map <uint64_t, SymbolicValue> Elf64 :: g_variables ()
+RegisterFile Elf64 :: g_registers ()
 {
-    std::map <uint64_t, SymbolicValue> variables;
-
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_RBX")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_RCX")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_RDX")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_RSI")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_RDI")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R8")]  = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R9")]  = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R10")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R11")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R12")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R13")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R14")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_R15")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_RBP")] = SymbolicValue(64, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM0")] = SymbolicValue(128, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM1")] = SymbolicValue(128, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM2")] = SymbolicValue(128, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM3")] = SymbolicValue(128, 0);
-
-    variables[InstructionOperand::str_to_id("DF")] = SymbolicValue(1, 0);
+    RegisterFile registers;
+
+    registers[SLOT_RAX] = SymbolicValue(64, 0);
+    registers[SLOT_RBX] = SymbolicValue(64, 0);
+    registers[SLOT_RCX] = SymbolicValue(64, 0);
+    registers[SLOT_RDX] = SymbolicValue(64, 0);
+    registers[SLOT_RSI] = SymbolicValue(64, 0);
+    registers[SLOT_RDI] = SymbolicValue(64, 0);
+    registers[SLOT_R8]  = SymbolicValue(64, 0);
+    registers[SLOT_R9]  = SymbolicValue(64, 0);
+    registers[SLOT_R10] = SymbolicValue(64, 0);
+    registers[SLOT_R11] = SymbolicValue(64, 0);
+    registers[SLOT_R12] = SymbolicValue(64, 0);
+    registers[SLOT_R13] = SymbolicValue(64, 0);
+    registers[SLOT_R14] = SymbolicValue(64, 0);
+    registers[SLOT_R15] = SymbolicValue(64, 0);
+    registers[SLOT_RBP] = SymbolicValue(64, 0);
+    registers[SLOT_XMM0] = SymbolicValue(128, 0);
+    registers[SLOT_XMM1] = SymbolicValue(128, 0);
+    registers[SLOT_XMM2] = SymbolicValue(128, 0);
+    registers[SLOT_XMM3] = SymbolicValue(128, 0);
+
+    registers[SLOT_DF] = SymbolicValue(1, 0);
     
-    variables[InstructionOperand::str_to_id("UD_R_FS")]  = SymbolicValue(64, ELF64_FS_INIT);
-    variables[InstructionOperand::str_to_id("UD_R_RSP")] = SymbolicValue(64, ELF64_RSP_INIT);
-    variables[InstructionOperand::str_to_id("UD_R_RIP")] = SymbolicValue(64, ehdr->e_entry);
-    return variables;
+    registers[SLOT_FS]  = SymbolicValue(64, ELF64_FS_INIT);
+    registers[SLOT_RSP] = SymbolicValue(64, ELF64_RSP_INIT);
+    registers[SLOT_RIP] = SymbolicValue(64, ehdr->e_entry);
+    return registers;
 }
 
-uint64_t Elf64 :: g_ip_id () { return InstructionOperand::str_to_id("UD_R_RIP"); }
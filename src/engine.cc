@@ -1,47 +1,450 @@
 #include "engine.h"
 
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
 #define DEBUG
 
+/************
+* Searchers *
+************/
+
+VM * RoundRobinSearcher :: select ()
+{
+	if (vms.empty())
+		return NULL;
+	VM * vm = vms.front();
+	vms.pop_front();
+	return vm;
+}
+
+VM * DepthFirstSearcher :: select ()
+{
+	if (vms.empty())
+		return NULL;
+	VM * vm = vms.back();
+	vms.pop_back();
+	return vm;
+}
+
+void BreadthFirstSearcher :: add (VM * vm)
+{
+	layers[vm->g_depth()].push_back(vm);
+	size++;
+}
+
+VM * BreadthFirstSearcher :: select ()
+{
+	if (layers.empty())
+		return NULL;
+
+	std::map <size_t, std::deque <VM *>> :: iterator layer = layers.begin();
+	VM * vm = layer->second.front();
+	layer->second.pop_front();
+	if (layer->second.empty())
+		layers.erase(layer);
+	size--;
+	return vm;
+}
+
+VM * RandomPathSearcher :: select ()
+{
+	if (vms.empty())
+		return NULL;
+
+	// weigh relative to the shallowest VM, so deep VMs don't all underflow
+	size_t shallowest = vms[0]->g_depth();
+	for (size_t i = 1; i < vms.size(); i++) {
+		if (vms[i]->g_depth() < shallowest)
+			shallowest = vms[i]->g_depth();
+	}
+
+	std::vector <double> weights;
+	weights.reserve(vms.size());
+	for (size_t i = 0; i < vms.size(); i++)
+		weights.push_back(ldexp(1.0, -(int) (vms[i]->g_depth() - shallowest)));
+
+	std::discrete_distribution <size_t> pick(weights.begin(), weights.end());
+	size_t i = pick(random);
+
+	VM * vm = vms[i];
+	vms[i] = vms.back();
+	vms.pop_back();
+	return vm;
+}
+
+VM * CoverageSearcher :: select ()
+{
+	if (vms.empty())
+		return NULL;
+
+	std::deque <VM *> :: reverse_iterator it;
+	for (it = vms.rbegin(); it != vms.rend(); it++) {
+		if (covered.count((*it)->g_rip()) == 0) {
+			VM * vm = *it;
+			vms.erase(--(it.base()));
+			return vm;
+		}
+	}
+
+	VM * vm = vms.front();
+	vms.pop_front();
+	return vm;
+}
+
+/*********
+* Engine *
+*********/
+
+thread_local Engine::Worker * Engine::current = NULL;
+
 Engine :: Engine (Loader * loader)
+	: running(NULL), running_halted(false), running_forked(false), last(NULL),
+	  quantum_unit(QUANTUM_BLOCKS), quantum_count(0),
+	  slices(0), switches(0), instructions(0), seconds(0.0),
+	  merge_mode(false), merges(0), live(0), queued(0),
+	  sleeping(0), failed(false)
 {
 	this->loader = loader;
-	vms.push_back(new VM(loader, this));
+	searcher = new RoundRobinSearcher();
+	searcher->add(new VM(loader, this));
 }
 
 Engine :: ~Engine ()
 {
-	std::list <VM *> :: iterator it;
-	for (it = vms.begin(); it != vms.end(); it++) {
-		delete *it;
+	VM * vm;
+	while ((vm = searcher->select()) != NULL)
+		delete vm;
+	delete searcher;
+
+	std::vector <Worker *> :: iterator wit;
+	for (wit = workers.begin(); wit != workers.end(); wit++) {
+		std::deque <VM *> :: iterator vit;
+		for (vit = (*wit)->vms.begin(); vit != (*wit)->vms.end(); vit++)
+			delete *vit;
+		delete *wit;
+	}
+}
+
+uint64_t Engine :: slice (VM * vm, size_t count, Searcher * searcher,
+                          const bool & halted, const bool & forked)
+{
+	uint64_t instructions = vm->g_instructions();
+	uint64_t branches     = vm->g_symbolic_branches();
+
+	for (size_t steps = 1; ; steps++) {
+		if (searcher)
+			searcher->stepping(vm, vm->g_rip());
+		vm->step();
+		if (halted || forked)
+			break;
+
+		if (quantum_unit == QUANTUM_INSTRUCTIONS) {
+			if (vm->g_instructions() - instructions >= count)
+				break;
+		}
+		else if (quantum_unit == QUANTUM_BRANCHES) {
+			if (vm->g_symbolic_branches() - branches >= count)
+				break;
+		}
+		else if (steps >= count)
+			break;
 	}
+
+	return vm->g_instructions() - instructions;
 }
 
 void Engine :: step ()
 {
-	std::list <VM *> :: iterator it;
+	VM * vm = searcher->select();
+	if (vm == NULL)
+		return;
+	unwait(vm);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	running        = vm;
+	running_halted = false;
+	running_forked = false;
+
+	slices++;
+	if (vm != last)
+		switches++;
+
+	size_t count = quantum_count ? quantum_count : searcher->g_quantum();
+	try {
+		instructions += slice(vm, count, searcher, running_halted, running_forked);
+	}
+	catch (...) {
+		running = NULL;
+		last    = NULL;
+		delete vm;
+		throw;
+	}
+
+	running = NULL;
+	if (running_halted) {
+		last = NULL;
+		delete vm;
+	}
+	else {
+		last = vm;
+		requeue(vm);
+	}
+
+	std::chrono::duration <double> elapsed = std::chrono::steady_clock::now() - start;
+	seconds += elapsed.count();
+}
+
+void Engine :: wait (VM * vm)
+{
+	if (merge_mode)
+		waiting.insert(std::pair <uint64_t, VM *> (vm->g_rip(), vm));
+}
+
+void Engine :: unwait (VM * vm)
+{
+	if (waiting.empty())
+		return;
+
+	// a VM doesn't move while it waits, so it is still under this address
+	std::pair <std::unordered_multimap <uint64_t, VM *> :: iterator,
+	           std::unordered_multimap <uint64_t, VM *> :: iterator> range;
+	range = waiting.equal_range(vm->g_rip());
+	std::unordered_multimap <uint64_t, VM *> :: iterator it;
+	for (it = range.first; it != range.second; it++) {
+		if (it->second == vm) {
+			waiting.erase(it);
+			return;
+		}
+	}
+}
+
+void Engine :: requeue (VM * vm)
+{
+	if (merge_mode) {
+		std::pair <std::unordered_multimap <uint64_t, VM *> :: iterator,
+		           std::unordered_multimap <uint64_t, VM *> :: iterator> range;
+		range = waiting.equal_range(vm->g_rip());
+		std::unordered_multimap <uint64_t, VM *> :: iterator it;
+		for (it = range.first; it != range.second; it++) {
+			if (it->second->merge(*vm)) {
+				merges++;
+				if (last == vm)
+					last = NULL;
+				delete vm;
+				return;
+			}
+		}
+	}
+
+	wait(vm);
+	searcher->add(vm);
+}
+
+void Engine :: s_quantum (int unit, size_t count)
+{
+	quantum_unit  = unit;
+	quantum_count = count;
+}
+
+void Engine :: s_searcher (Searcher * searcher)
+{
+	VM * vm;
+	while ((vm = this->searcher->select()) != NULL)
+		searcher->add(vm);
+	delete this->searcher;
+	this->searcher = searcher;
+}
+
+VM * Engine :: next (size_t id)
+{
+	Worker * worker = workers[id];
+	VM * vm = NULL;
+
+	worker->lock.lock();
+	if (not worker->vms.empty()) {
+		vm = worker->vms.back();
+		worker->vms.pop_back();
+	}
+	worker->lock.unlock();
+	if (vm) {
+		queued--;
+		return vm;
+	}
+
+	// steal the oldest VM of the first worker we find with one to spare
+	for (size_t i = 1; i < workers.size(); i++) {
+		Worker * victim = workers[(id + i) % workers.size()];
+		victim->lock.lock();
+		if (not victim->vms.empty()) {
+			vm = victim->vms.front();
+			victim->vms.pop_front();
+		}
+		victim->lock.unlock();
+		if (vm) {
+			queued--;
+			worker->steals++;
+			return vm;
+		}
+	}
+
+	return NULL;
+}
+
+void Engine :: enqueue (Worker * worker, VM * vm)
+{
+	worker->lock.lock();
+	worker->vms.push_back(vm);
+	worker->lock.unlock();
+	queued++;
+
+	// a worker going to sleep counts itself before it checks queued, so one
+	// of us sees the other. taking idle_lock means it is either waiting or
+	// yet to check
+	if (sleeping > 0) {
+		idle_lock.lock();
+		idle_lock.unlock();
+		idle.notify_one();
+	}
+}
+
+void Engine :: work (size_t id, size_t count)
+{
+	Worker * worker = workers[id];
+	current = worker;
+
+	while ((live > 0) && (not failed)) {
+		VM * vm = next(id);
+		if (vm == NULL) {
+			// every live VM is running on another worker
+			std::unique_lock <std::mutex> guard(idle_lock);
+			sleeping++;
+			while ((queued == 0) && (live > 0) && (not failed))
+				idle.wait(guard);
+			sleeping--;
+			continue;
+		}
+
+		worker->halted = false;
+		worker->forked = false;
+		worker->slices++;
+		if (vm != worker->last)
+			worker->switches++;
+
+		try {
+			worker->instructions += slice(vm, count, NULL, worker->halted, worker->forked);
+		}
+		catch (...) {
+			std::lock_guard <std::mutex> guard(idle_lock);
+			if (not failed)
+				error = std::current_exception();
+			failed = true;
+			idle.notify_all();
+			worker->halted = true;
+		}
+
+		if (worker->halted) {
+			worker->last = NULL;
+			delete vm;
+			if (--live == 0) {
+				std::lock_guard <std::mutex> guard(idle_lock);
+				idle.notify_all();
+			}
+			continue;
+		}
+		worker->last = vm;
+
+		enqueue(worker, vm);
+	}
+
+	current = NULL;
+}
+
+void Engine :: run (size_t threads)
+{
+	if (threads == 0)
+		throw std::runtime_error("Engine::run needs at least one thread");
 
-	for (it = vms.begin(); it != vms.end(); it++) {
-		(*it)->step();
+	while (workers.size() < threads)
+		workers.push_back(new Worker());
+
+	// deal the VMs we have out between the workers
+	size_t id = 0;
+	VM * vm;
+	while ((vm = searcher->select()) != NULL) {
+		unwait(vm);
+		workers[id]->vms.push_back(vm);
+		id = (id + 1) % threads;
+		live++;
+		queued++;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	size_t count = quantum_count ? quantum_count : searcher->g_quantum();
+	std::vector <std::thread> pool;
+	for (size_t i = 0; i < threads; i++)
+		pool.push_back(std::thread(&Engine::work, this, i, count));
+	for (size_t i = 0; i < threads; i++)
+		pool[i].join();
+
+	std::chrono::duration <double> elapsed = std::chrono::steady_clock::now() - start;
+	seconds += elapsed.count();
+
+	if (failed) {
+		// hand back what the workers didn't get to, so step or another run
+		// can carry on with it
+		std::vector <Worker *> :: iterator it;
+		for (it = workers.begin(); it != workers.end(); it++) {
+			while (not (*it)->vms.empty()) {
+				wait((*it)->vms.front());
+				searcher->add((*it)->vms.front());
+				(*it)->vms.pop_front();
+			}
+			(*it)->last = NULL;
+		}
+		live   = 0;
+		queued = 0;
+
+		std::exception_ptr error = this->error;
+		this->error = NULL;
+		failed      = false;
+		std::rethrow_exception(error);
 	}
 }
 
 void Engine :: push_vm (VM * vm)
 {
+	if (current) {
+		live++;
+		enqueue(current, vm);
+		current->forked = true;
+		return;
+	}
+
 	#ifdef DEBUG
-	std::cout << "push_vm, vm count = " << vms.size() << std::endl;
+	std::cout << "push_vm, vm count = " << g_size() << std::endl;
 	#endif
-	vms.push_back(vm);
+	requeue(vm);
+	running_forked = true;
 }
 
 bool Engine :: remove_vm (VM * vm)
 {
-	std::list <VM *> :: iterator it;
+	// the worker deletes it once its step is over
+	if (current) {
+		current->halted = true;
+		return true;
+	}
 
-	for (it = vms.begin(); it != vms.end(); it++) {
-		if (*it == vm) {
-			vms.erase(it);
-			return true;
-		}
+	// step deletes it once its run is over
+	if (vm == running) {
+		running_halted = true;
+		return true;
 	}
 
 	return false;
@@ -49,5 +452,47 @@ bool Engine :: remove_vm (VM * vm)
 
 size_t Engine :: g_size ()
 {
-	return vms.size();
+	return searcher->g_size() + (running ? 1 : 0) + live;
+}
+
+std::string Engine :: stats ()
+{
+	std::stringstream ss;
+
+	uint64_t slices       = this->slices;
+	uint64_t switches     = this->switches;
+	uint64_t instructions = this->instructions;
+	uint64_t steals       = 0;
+
+	std::vector <Worker *> :: iterator it;
+	for (it = workers.begin(); it != workers.end(); it++) {
+		slices       += (*it)->slices;
+		switches     += (*it)->switches;
+		instructions += (*it)->instructions;
+		steals       += (*it)->steals;
+	}
+
+	double per_second = seconds > 0.0 ? switches / seconds : 0.0;
+	double per_slice  = slices ? (double) instructions / slices : 0.0;
+
+	ss << "engine: " << std::dec << slices << " slices, "
+	   << switches << " switches, " << per_second << " switches/s, "
+	   << per_slice << " instructions/slice" << std::endl;
+	ss << "merges: " << merges << std::endl;
+	ss << "workers: " << workers.size() << " workers, "
+	   << steals << " steals";
+
+	return ss.str();
+}
+
+std::string Engine :: solver_stats ()
+{
+	std::vector <Solver *> solvers;
+	solvers.push_back(&solver);
+
+	std::vector <Worker *> :: iterator it;
+	for (it = workers.begin(); it != workers.end(); it++)
+		solvers.push_back(&((*it)->solver));
+
+	return Solver::stats(solvers);
 }
\ No newline at end of file
@@ -3,25 +3,243 @@
 
 class Engine;
 
+#include "codecache.h"
 #include "loader.h"
+#include "solver.h"
 #include "vm.h"
 
-#include <list>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// how many steps a searcher lets a VM run before choosing again, when it
+// would otherwise run it until it forks
+#define SEARCH_QUANTUM 4096
+
+// what an Engine time slice is counted in
+enum {
+	QUANTUM_BLOCKS,       // VM steps, a basic block each in block mode
+	QUANTUM_INSTRUCTIONS, // guest instructions
+	QUANTUM_BRANCHES      // branches on a wild condition
+};
+
+/*
+ * Decides which VM the Engine runs next, and for how long. The Engine takes
+ * a VM out of the searcher with select, runs it for up to g_quantum steps,
+ * and hands it back with add unless it halted. A fork ends the run early,
+ * and the forked VM is added before the VM which forked it.
+ */
+class Searcher {
+	public :
+		virtual ~Searcher () {}
+
+		virtual void   add    (VM * vm) = 0;
+		// takes the next VM to run out of the searcher, NULL if there is none
+		virtual VM *   select () = 0;
+		virtual size_t g_size () = 0;
+
+		virtual size_t g_quantum () { return SEARCH_QUANTUM; }
+		// called before every step with the address the VM is about to run
+		virtual void   stepping  (VM * vm, uint64_t address) {}
+};
+
+// one step of every VM in turn
+class RoundRobinSearcher : public Searcher {
+	private :
+		std::deque <VM *> vms;
+	public :
+		void   add       (VM * vm) { vms.push_back(vm); }
+		VM *   select    ();
+		size_t g_size    () { return vms.size(); }
+		size_t g_quantum () { return 1; }
+};
+
+// runs the newest VM until it halts, so paths finish and few VMs are live
+class DepthFirstSearcher : public Searcher {
+	private :
+		std::vector <VM *> vms;
+	public :
+		void   add    (VM * vm) { vms.push_back(vm); }
+		VM *   select ();
+		size_t g_size () { return vms.size(); }
+};
+
+// runs the VMs a fork layer at a time: every VM n forks deep runs up to its
+// next fork before any VM n + 1 forks deep runs
+class BreadthFirstSearcher : public Searcher {
+	private :
+		// VMs by how many forks deep they are, oldest first
+		std::map <size_t, std::deque <VM *>> layers;
+		size_t size;
+	public :
+		BreadthFirstSearcher () : size(0) {}
+		void   add    (VM * vm);
+		VM *   select ();
+		size_t g_size () { return size; }
+};
+
+/*
+ * An approximation of KLEE's random path selection, which walks the fork tree
+ * from its root taking a random side at every fork, so VMs near the root are
+ * favoured and one deep loop can't starve the rest. We don't keep the tree,
+ * and weight each VM by 2^-depth instead. This is not the same once some VMs
+ * have halted: with A live at depth 1, B1 halted at depth 2, and B21 and B22
+ * live at depth 3, the tree walk picks A half the time and B21 and B22 a
+ * quarter each, where the weights give A 2/3 and B21 and B22 1/6 each.
+ */
+class RandomPathSearcher : public Searcher {
+	private :
+		std::vector <VM *> vms;
+		std::mt19937       random;
+	public :
+		RandomPathSearcher () : random(0) {}
+		void   add    (VM * vm) { vms.push_back(vm); }
+		VM *   select ();
+		size_t g_size () { return vms.size(); }
+};
+
+// prefers the newest VM about to run code no VM has run yet, and falls back
+// to the oldest VM when every VM is in covered code
+class CoverageSearcher : public Searcher {
+	private :
+		std::deque <VM *>              vms;
+		std::unordered_set <uint64_t> covered;
+	public :
+		void   add      (VM * vm) { vms.push_back(vm); }
+		VM *   select   ();
+		size_t g_size   () { return vms.size(); }
+		void   stepping (VM * vm, uint64_t address) { covered.insert(address); }
+
+		size_t g_covered () { return covered.size(); }
+};
 
 class Engine {
 	private :
+		// one thread of a parallel run. a worker runs VMs from the back of its
+		// own deque, and when that is empty steals from the front of another's.
+		// z3 contexts can't be shared between threads, so each worker has its
+		// own Solver
+		struct Worker {
+			std::mutex        lock;
+			std::deque <VM *> vms;
+			Solver            solver;
+			// what happened to the running VM during its slice
+			bool              halted;
+			bool              forked;
+			VM *              last;
+			uint64_t          steals;
+			uint64_t          slices;
+			uint64_t          switches;
+			uint64_t          instructions;
+
+			Worker () : halted(false), forked(false), last(NULL), steals(0),
+			            slices(0), switches(0), instructions(0) {}
+		};
+
+		// the worker running on this thread, NULL outside a parallel run
+		static thread_local Worker * current;
+
 		Loader * loader;
-		std::list <VM *> vms;
+		CodeCache code_cache;
+		Solver solver;
+		Searcher * searcher;
+
+		// the VM step is running, and what happened to it during its slice
+		VM * running;
+		bool running_halted;
+		bool running_forked;
+		VM * last;
+
+		int    quantum_unit;
+		size_t quantum_count;
+
+		uint64_t slices;
+		uint64_t switches;
+		uint64_t instructions;
+		double   seconds;
+
+		// in merge mode, the VMs waiting in the searcher by the address they
+		// will run next
+		bool merge_mode;
+		std::unordered_multimap <uint64_t, VM *> waiting;
+		uint64_t merges;
+
+		void wait   (VM * vm);
+		void unwait (VM * vm);
+		// hands vm back to the searcher, unless it merges into a waiting VM,
+		// in which case it is deleted
+		void requeue (VM * vm);
+
+		// runs vm for one time slice, or until halted or forked is set by
+		// remove_vm or push_vm. returns the guest instructions run
+		uint64_t slice (VM * vm, size_t count, Searcher * searcher,
+		                const bool & halted, const bool & forked);
+
+		std::vector <Worker *> workers;
+		// VMs which have not yet halted in a parallel run, and how many of
+		// them are waiting in a worker's deque
+		std::atomic <size_t> live;
+		std::atomic <size_t> queued;
+		// a worker with nothing to run or steal sleeps on idle until a VM is
+		// queued or the last VM halts
+		std::mutex              idle_lock;
+		std::condition_variable idle;
+		std::atomic <size_t>    sleeping;
+		// the first exception a worker's VM threw, which ends the run. taken
+		// under idle_lock
+		std::exception_ptr      error;
+		std::atomic <bool>      failed;
+
+		// puts vm on worker's deque, waking a sleeping worker to steal it
+		void enqueue (Worker * worker, VM * vm);
+
+		VM * next (size_t id);
+		void work (size_t id, size_t count);
 	public :
 		Engine  (Loader * loader);
 		~Engine ();
 
+		// runs the VM the searcher selects for one time slice
 		void step ();
 
+		// sets the time slice to count units. a count of 0 uses the
+		// searcher's own quantum, in blocks
+		void s_quantum (int unit, size_t count);
+
+		// takes ownership of searcher, and moves every VM into it
+		void s_searcher (Searcher * searcher);
+
+		// in merge mode, a VM coming back from its slice to the same address
+		// and stack frame as a waiting VM is merged into it. parallel runs
+		// don't merge
+		void s_merge_mode (bool merge_mode) { this->merge_mode = merge_mode; }
+
+		// runs every VM until it halts, spread over threads workers. VMs
+		// forked during the run go onto the forking worker's deque. as with
+		// step, a VM which throws is deleted and the exception rethrown, once
+		// every worker has stopped and the other VMs are back in the searcher
+		void run (size_t threads);
+
 		void push_vm   (VM * vm);
 		bool remove_vm (VM * vm);
 
 		size_t g_size ();
+
+		CodeCache * g_code_cache () { return &code_cache; }
+		// the solver for the calling thread
+		Solver    * g_solver     () { return current ? &(current->solver) : &solver; }
+
+		std::string stats ();
+		// the totals of the solver of every thread which ran VMs
+		std::string solver_stats ();
 };
 
 #endif
\ No newline at end of file
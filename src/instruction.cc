@@ -25,9 +25,49 @@
 #include <sstream>
 #include <stdexcept>
 
+InstructionArena :: ~InstructionArena ()
+{
+    std::vector <Instruction *> :: iterator it;
+    for (it = instructions.begin(); it != instructions.end(); it++)
+        (*it)->~Instruction();
+
+    std::list <uint8_t *> :: iterator cit;
+    for (cit = chunks.begin(); cit != chunks.end(); cit++)
+        delete[] *cit;
+}
+
+void * InstructionArena :: allocate (size_t size)
+{
+    // keep every allocation aligned for the largest member an instruction has
+    size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+    if (chunk_used + size > chunk_size) {
+        chunk_size = size > INSTRUCTION_ARENA_CHUNK_SIZE ? size : INSTRUCTION_ARENA_CHUNK_SIZE;
+        chunks.push_back(new uint8_t[chunk_size]);
+        chunk_used = 0;
+    }
+
+    void * p = chunks.back() + chunk_used;
+    chunk_used += size;
+
+    // every class allocated here derives only from Instruction, so the
+    // Instruction lives at the start of the allocation
+    instructions.push_back((Instruction *) p);
+
+    return p;
+}
+
+void InstructionArena :: release (void * p)
+{
+    // the memory itself is not reused, we just make sure we don't run a
+    // destructor for an object that was never constructed
+    if ((instructions.size() > 0) && (instructions.back() == p))
+        instructions.pop_back();
+}
+
 InstructionOperandTmpVar :: InstructionOperandTmpVar ()
 {
-    this->next_id = 0x1000;
+    this->next_id = SLOT_COUNT;
 }
 
 uint64_t InstructionOperandTmpVar :: next ()
@@ -51,13 +91,20 @@ void InstructionOperand :: sign ()
 
 void InstructionOperand :: setid ()
 {
-    // variables with names get an identifier based on their name
-    // with some special sauce to prevent identifical identifiers
-    if ((type == OPTYPE_VAR) && (name != "")) {
-        id = str_to_id(name);
+    // constants are never looked up by id
+    if (! (type & OPTYPE_VAR))
+        id = 0;
+
+    // variables with names are architectural registers and get that
+    // register's slot
+    else if (name != "") {
+        int slot = register_slot(name);
+        if (slot < 0)
+            throw std::runtime_error("unknown register: " + name);
+        id = slot;
     }
 
-    // otherwise the variable gets a unique identifier
+    // otherwise the variable is a temporary and gets the next free id
     else {
         InstructionOperandTmpVar & tmpvar = InstructionOperandTmpVar :: get();
         id = tmpvar.next();
@@ -114,18 +161,6 @@ std::string InstructionOperand :: str ()
 }
 
 
-uint64_t InstructionOperand :: str_to_id (std::string str)
-{
-    uint64_t id = 1 << 31;
-    id <<= 32;
-    id |= 0xfcedba98;
-    for (size_t i = 0; i < str.length(); i++) {
-        id += (int) str[i] << (8 * (i % 8));
-    }
-    return id;
-}
-
-
 bool InstructionOperand :: operator == (const InstructionOperand & rhs)
 {
     if (id == rhs.id)
@@ -201,6 +236,23 @@ std::string InstructionHlt :: str()
     return str_formatter("hlt", "");
 }
 
+std::string InstructionFlags :: str()
+{
+    const char * kinds[] = {"add", "sub", "sbb", "cmp", "logic", "incdec"};
+
+    return str_formatter("flags", std::string(kinds[kind]) + " " + lhs.str() + ", "
+                                  + rhs.str() + " = " + result.str());
+}
+
+std::string InstructionRep :: str()
+{
+    const char * kinds[] = {"rep stos", "rep movs", "repne scas"};
+    std::stringstream ss;
+
+    ss << kinds[kind] << " " << bits;
+    return str_formatter("rep", ss.str());
+}
+
 std::string InstructionBinOp :: binop_str (std::string mnemonic, std::string op, std::string dst, std::string lhs, std::string rhs)
 {
     return Instruction::str_formatter(mnemonic, dst + " = " + lhs + " " + op + " " + rhs);
@@ -26,11 +26,16 @@
 #ifndef instruction_HEADER
 #define instruction_HEADER
 
+#include <atomic>
+#include <cstddef>
 #include <iostream>
+#include <list>
 #include <string>
+#include <vector>
 
 #include <inttypes.h>
 
+#include "registers.h"
 #include "symbolicvalue.h"
 
 #define OPTYPE_INVALID  0
@@ -38,15 +43,62 @@
 #define OPTYPE_CONSTANT 2
 #define OPTYPE_SIGNED   8
 
-
+// every concrete Instruction carries one of these so the VM can dispatch on
+// it with a switch instead of testing each type with dynamic_cast
+#define IOP_ADD         0
+#define IOP_AND         1
+#define IOP_ASSIGN      2
+#define IOP_BRC         3
+#define IOP_CMPEQ       4
+#define IOP_CMPLES      5
+#define IOP_CMPLEU      6
+#define IOP_CMPLTS      7
+#define IOP_CMPLTU      8
+#define IOP_DIV         9
+#define IOP_HLT         10
+#define IOP_LOAD        11
+#define IOP_MOD         12
+#define IOP_MUL         13
+#define IOP_NOT         14
+#define IOP_OR          15
+#define IOP_SHL         16
+#define IOP_SHR         17
+#define IOP_SIGNEXTEND  18
+#define IOP_STORE       19
+#define IOP_SUB         20
+#define IOP_SYSCALL     21
+#define IOP_XOR         22
+#define IOP_FLAGS       23
+#define IOP_REP         24
+
+// the operations an InstructionFlags can record. each sets ZF, SF, CF and OF
+// the way the translator computes them for those instructions
+#define FLAGS_ADD       0 // add, adc
+#define FLAGS_SUB       1
+#define FLAGS_SBB       2
+#define FLAGS_CMP       3
+#define FLAGS_LOGIC     4 // and, test, xor
+#define FLAGS_INCDEC    5 // inc, dec. these leave CF alone
+
+// the rep prefixed string instructions an InstructionRep can run in bulk
+#define REP_STOS        0 // rep stos
+#define REP_MOVS        1 // rep movs
+#define REPNE_SCAS      2 // repne scas
+
+
+// hands out ids for temporaries. The translator resets it for every block it
+// lifts, so temporaries index a small per-block scratch array in the VM. Each
+// thread has its own, so concurrent translations don't share a count.
 class InstructionOperandTmpVar {
     public :
         static InstructionOperandTmpVar & get()
         {
-            static InstructionOperandTmpVar instance;
+            static thread_local InstructionOperandTmpVar instance;
             return instance;
         }
-        uint64_t next ();
+        uint64_t next  ();
+        void     reset ()       { next_id = SLOT_COUNT; }
+        size_t   g_count ()     { return next_id - SLOT_COUNT; }
     private :
         uint64_t next_id;
         InstructionOperandTmpVar ();
@@ -73,12 +125,12 @@ class InstructionOperand {
         
         void        sign    ();
         int         g_type  () { return type; }
+        // only used to read a variable at a different width
+        void        s_bits  (int bits) { this->bits = bits; }
         uint64_t    g_value () { return value; }
         int         g_bits  () { return bits; }
         std::string g_name  () { return name; }
         uint64_t    g_id    () { return id; }
-
-        static uint64_t str_to_id (std::string);
         
         std::string str ();
         
@@ -99,26 +151,68 @@ class InstructionTmpVar {
         }
         uint64_t next() { return next_id++; }
     private :
-        uint64_t next_id;
+        std::atomic <uint64_t> next_id;
         InstructionTmpVar () { next_id = 0; }
         InstructionTmpVar (InstructionTmpVar &);
         void operator = (InstructionTmpVar &);
 };
 
+/*
+ * Bump allocator for IR. Instructions created with new (arena) are carved out
+ * of large chunks and live until the arena is destroyed, at which point their
+ * destructors are run and the chunks freed in one go. Individual instructions
+ * allocated from an arena must never be deleted.
+ */
+
+#define INSTRUCTION_ARENA_CHUNK_SIZE (64 * 1024)
+
+class Instruction;
+
+class InstructionArena {
+    private :
+        std::list <uint8_t *> chunks;
+        size_t chunk_used;
+        size_t chunk_size;
+
+        std::vector <Instruction *> instructions;
+
+        InstructionArena (const InstructionArena &);
+        void operator = (const InstructionArena &);
+    public :
+        InstructionArena () : chunk_used(0), chunk_size(0) {}
+        ~InstructionArena ();
+
+        void * allocate (size_t size);
+        // undoes the most recent allocate, for a constructor that threw
+        void   release  (void * p);
+
+        size_t g_size   () { return instructions.size(); }
+};
+
 class Instruction {
     private :
         uint64_t id;
         uint64_t address;
         uint32_t size;
+        uint8_t  opcode;
     
     public :
         
-        Instruction (uint64_t address, uint32_t size) : address(address), size(size)
+        Instruction (uint8_t opcode, uint64_t address, uint32_t size)
+            : address(address), size(size), opcode(opcode)
         {
             InstructionTmpVar & tmp = InstructionTmpVar :: get();
             id = tmp.next();
         }
         virtual ~Instruction() {}
+
+        static void * operator new    (size_t size) { return ::operator new(size); }
+        static void   operator delete (void * p)    { ::operator delete(p); }
+
+        static void * operator new    (size_t size, InstructionArena & arena)
+            { return arena.allocate(size); }
+        static void   operator delete (void * p, InstructionArena & arena)
+            { arena.release(p); }
         
         virtual std::string str ();
         std::string str_formatter (std::string mnemonic, std::string args);
@@ -126,6 +220,7 @@ class Instruction {
         uint64_t g_address () { return address; }
         uint32_t g_size    () { return size; }
         uint64_t g_id      () { return id; }
+        uint8_t  g_opcode  () { return opcode; }
 };
 
 /*********************
@@ -135,7 +230,7 @@ class Instruction {
 class InstructionSyscall : public Instruction {
     public :
         InstructionSyscall (uint64_t address, uint32_t size)
-            : Instruction(address, size) {}
+            : Instruction(IOP_SYSCALL, address, size) {}
         std::string str();
 };
 
@@ -146,7 +241,7 @@ class InstructionLoad : public Instruction {
         InstructionOperand src;
     public :
         InstructionLoad (uint64_t address, uint32_t size, int bits, InstructionOperand & dst, InstructionOperand & src)
-            : Instruction(address, size), bits(bits), dst(dst), src(src) {}
+            : Instruction(IOP_LOAD, address, size), bits(bits), dst(dst), src(src) {}
         std::string str();
         int                g_bits () { return bits; }
         InstructionOperand g_dst ()  { return dst; }
@@ -160,7 +255,7 @@ class InstructionStore : public Instruction {
         InstructionOperand src;
     public :
         InstructionStore (uint64_t address, uint32_t size, int bits, InstructionOperand & dst, InstructionOperand & src)
-            : Instruction(address, size), bits(bits), dst(dst), src(src) {}
+            : Instruction(IOP_STORE, address, size), bits(bits), dst(dst), src(src) {}
         std::string str();
         int                g_bits () { return bits; }
         InstructionOperand g_dst  () { return dst; }
@@ -173,7 +268,7 @@ class InstructionBrc : public Instruction {
         InstructionOperand dst;
     public :
         InstructionBrc (uint64_t address, uint32_t size, InstructionOperand & cond, InstructionOperand & dst)
-            : Instruction(address, size), cond(cond), dst(dst) {}
+            : Instruction(IOP_BRC, address, size), cond(cond), dst(dst) {}
         std::string str();
         InstructionOperand g_cond () { return cond; }
         InstructionOperand g_dst  () { return dst; }
@@ -185,7 +280,7 @@ class InstructionAssign : public Instruction {
         InstructionOperand src;
     public :
         InstructionAssign (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & src)
-            : Instruction(address, size), dst(dst), src(src) {}
+            : Instruction(IOP_ASSIGN, address, size), dst(dst), src(src) {}
         std::string str();
         InstructionOperand g_dst () { return dst; }
         InstructionOperand g_src () { return src; }
@@ -197,7 +292,7 @@ class InstructionNot : public Instruction {
         InstructionOperand src;
     public :
         InstructionNot (uint64_t address, uint32_t size, InstructionOperand dst, InstructionOperand src)
-            : Instruction(address, size), dst(dst), src(src) {}
+            : Instruction(IOP_NOT, address, size), dst(dst), src(src) {}
         std::string str ();
         InstructionOperand g_dst () { return dst; }
         InstructionOperand g_src () { return src; }
@@ -209,7 +304,7 @@ class InstructionSignExtend : public Instruction {
         InstructionOperand src;
     public :
         InstructionSignExtend (uint64_t address, uint32_t size, InstructionOperand dst, InstructionOperand src)
-            : Instruction(address, size), dst(dst), src(src) {}
+            : Instruction(IOP_SIGNEXTEND, address, size), dst(dst), src(src) {}
         std::string str ();
         InstructionOperand g_dst () { return dst; }
         InstructionOperand g_src () { return src; }
@@ -218,8 +313,57 @@ class InstructionSignExtend : public Instruction {
 class InstructionHlt : public Instruction {
     public :
         InstructionHlt (uint64_t address, uint32_t size)
-            : Instruction(address, size) {}
+            : Instruction(IOP_HLT, address, size) {}
+        std::string str ();
+};
+
+/*
+ * Sets the flags from an operation on lhs and rhs which gave result. The VM
+ * only records the operands, and works out each flag if and when it is read.
+ */
+class InstructionFlags : public Instruction {
+    private :
+        int kind;
+        InstructionOperand lhs;
+        InstructionOperand rhs;
+        InstructionOperand result;
+    public :
+        InstructionFlags (uint64_t address, uint32_t size, int kind,
+                          InstructionOperand lhs, InstructionOperand rhs,
+                          InstructionOperand result)
+            : Instruction(IOP_FLAGS, address, size), kind(kind),
+              lhs(lhs), rhs(rhs), result(result) {}
+        std::string str ();
+        int                g_kind   () { return kind;   }
+        InstructionOperand g_lhs    () { return lhs;    }
+        InstructionOperand g_rhs    () { return rhs;    }
+        InstructionOperand g_result () { return result; }
+
+        // the flags kind sets, bit i standing for slot SLOT_ZF + i
+        static int defines (int kind)
+        {
+            if (kind == FLAGS_INCDEC)
+                return 0xf & ~(1 << (SLOT_CF - SLOT_ZF));
+            return 0xf;
+        }
+};
+
+/*
+ * Runs every iteration of the rep prefixed string instruction it is lifted
+ * with at once, a bits wide element at a time, when RCX, the registers and
+ * the memory it works on are concrete. The translator follows it with the
+ * IR for a single iteration, which the VM skips when it could do them all.
+ */
+class InstructionRep : public Instruction {
+    private :
+        int kind;
+        int bits;
+    public :
+        InstructionRep (uint64_t address, uint32_t size, int kind, int bits)
+            : Instruction(IOP_REP, address, size), kind(kind), bits(bits) {}
         std::string str ();
+        int g_kind () { return kind; }
+        int g_bits () { return bits; }
 };
 
 /********************
@@ -228,8 +372,8 @@ class InstructionHlt : public Instruction {
 
 class InstructionBaseStmt : public Instruction {
     public :
-        InstructionBaseStmt (uint64_t address, uint32_t size)
-            : Instruction(address, size) {}
+        InstructionBaseStmt (uint8_t opcode, uint64_t address, uint32_t size)
+            : Instruction(opcode, address, size) {}
 };
 
 /***********
@@ -243,19 +387,20 @@ class InstructionBinOp : public InstructionBaseStmt {
         InstructionOperand rhs;
     public :
         
-        InstructionBinOp (uint64_t address,
+        InstructionBinOp (uint8_t  opcode,
+                          uint64_t address,
                           uint32_t size,
                           InstructionOperand dst,
                           InstructionOperand lhs,
                           InstructionOperand rhs)
-            : InstructionBaseStmt(address, size), dst(dst), lhs(lhs), rhs(rhs) {}
+            : InstructionBaseStmt(opcode, address, size), dst(dst), lhs(lhs), rhs(rhs) {}
         InstructionOperand g_dst () { return dst; }
         InstructionOperand g_lhs () { return lhs; }
         InstructionOperand g_rhs () { return rhs; }
         std::string binop_str (std::string mnemonic, std::string op, std::string dst, std::string lhs, std::string rhs);
 };
 
-#define INSTRUCTIONBINOPCLASS(OPERATION) \
+#define INSTRUCTIONBINOPCLASS(OPERATION, OPCODE) \
 class Instruction##OPERATION : public InstructionBinOp { \
     public :                                             \
         Instruction##OPERATION (uint64_t address,        \
@@ -263,20 +408,20 @@ class Instruction##OPERATION : public InstructionBinOp { \
                                 InstructionOperand dst,  \
                                 InstructionOperand lhs,  \
                                 InstructionOperand rhs)  \
-            : InstructionBinOp(address, size, dst, lhs, rhs) {} \
+            : InstructionBinOp(OPCODE, address, size, dst, lhs, rhs) {} \
         std::string str();                               \
 };
 
-INSTRUCTIONBINOPCLASS(Add)
-INSTRUCTIONBINOPCLASS(Sub)
-INSTRUCTIONBINOPCLASS(Mul)
-INSTRUCTIONBINOPCLASS(Div)
-INSTRUCTIONBINOPCLASS(Mod)
-INSTRUCTIONBINOPCLASS(Shl)
-INSTRUCTIONBINOPCLASS(Shr)
-INSTRUCTIONBINOPCLASS(And)
-INSTRUCTIONBINOPCLASS(Or)
-INSTRUCTIONBINOPCLASS(Xor)
+INSTRUCTIONBINOPCLASS(Add, IOP_ADD)
+INSTRUCTIONBINOPCLASS(Sub, IOP_SUB)
+INSTRUCTIONBINOPCLASS(Mul, IOP_MUL)
+INSTRUCTIONBINOPCLASS(Div, IOP_DIV)
+INSTRUCTIONBINOPCLASS(Mod, IOP_MOD)
+INSTRUCTIONBINOPCLASS(Shl, IOP_SHL)
+INSTRUCTIONBINOPCLASS(Shr, IOP_SHR)
+INSTRUCTIONBINOPCLASS(And, IOP_AND)
+INSTRUCTIONBINOPCLASS(Or, IOP_OR)
+INSTRUCTIONBINOPCLASS(Xor, IOP_XOR)
 
 /***********
  * CMPOPS  *
@@ -289,8 +434,8 @@ class InstructionCmpOp  : public InstructionBaseStmt {
         InstructionOperand rhs;
     public :
         
-        InstructionCmpOp (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
-            : InstructionBaseStmt(address, size), dst(dst), lhs(lhs), rhs(rhs) {}
+        InstructionCmpOp (uint8_t opcode, uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
+            : InstructionBaseStmt(opcode, address, size), dst(dst), lhs(lhs), rhs(rhs) {}
         InstructionOperand g_dst () { return dst; }
         InstructionOperand g_lhs () { return lhs; }
         InstructionOperand g_rhs () { return rhs; }
@@ -300,35 +445,35 @@ class InstructionCmpOp  : public InstructionBaseStmt {
 class InstructionCmpEq  : public InstructionCmpOp {
     public :
         InstructionCmpEq (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
-            : InstructionCmpOp(address, size, dst, lhs, rhs) {}
+            : InstructionCmpOp(IOP_CMPEQ, address, size, dst, lhs, rhs) {}
         std::string str();
 
 };
 class InstructionCmpLeu : public InstructionCmpOp {
     public :
         InstructionCmpLeu (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
-            : InstructionCmpOp(address, size, dst, lhs, rhs) {}
+            : InstructionCmpOp(IOP_CMPLEU, address, size, dst, lhs, rhs) {}
         std::string str();
 };
 
 class InstructionCmpLes : public InstructionCmpOp {
     public :
         InstructionCmpLes (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
-            : InstructionCmpOp(address, size, dst, lhs, rhs) {}
+            : InstructionCmpOp(IOP_CMPLES, address, size, dst, lhs, rhs) {}
         std::string str();
 };
 
 class InstructionCmpLtu : public InstructionCmpOp {
     public :
         InstructionCmpLtu (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
-            : InstructionCmpOp(address, size, dst, lhs, rhs) {}
+            : InstructionCmpOp(IOP_CMPLTU, address, size, dst, lhs, rhs) {}
         std::string str();
 };
 
 class InstructionCmpLts : public InstructionCmpOp {
     public :
         InstructionCmpLts (uint64_t address, uint32_t size, InstructionOperand & dst, InstructionOperand & lhs, InstructionOperand & rhs)
-            : InstructionCmpOp(address, size, dst, lhs, rhs) {}
+            : InstructionCmpOp(IOP_CMPLTS, address, size, dst, lhs, rhs) {}
         std::string str();
 };
 
@@ -0,0 +1,1014 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jit.h"
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memory.h"
+#include "registers.h"
+#include "symbolicvalue.h"
+
+// the registers compiled code uses. rbx holds the variables array, r12 the
+// Memory, and [rsp] is where jit_load leaves the value it loaded
+#define RAX 0
+#define RCX 1
+#define RDX 2
+
+// condition codes, for setcc and jcc
+#define CC_B  0x2
+#define CC_E  0x4
+#define CC_BE 0x6
+#define CC_A  0x7
+#define CC_L  0xc
+#define CC_LE 0xe
+
+typedef uint32_t (* JitFunction) (uint64_t * variables, Memory * memory);
+
+
+static uint64_t mask (int bits)
+{
+    if (bits >= 64)
+        return 0xffffffffffffffffULL;
+    return (1ULL << bits) - 1;
+}
+
+
+// called from compiled code, return 0 to leave the access to the interpreter.
+// nothing may be thrown back through compiled code, which has no unwind info,
+// so an access to an unmapped or symbolic byte is left to the interpreter
+static uint32_t jit_load (Memory * memory, uint64_t address, int bits, uint64_t * value)
+{
+    size_t bytes = bits / 8;
+    if ((not memory->mapped(address, bytes)) || (not memory->concrete(address, bytes)))
+        return 0;
+
+    switch (bits) {
+    case 8  : *value = memory->g_byte(address);  break;
+    case 16 : *value = memory->g_word(address);  break;
+    case 32 : *value = memory->g_dword(address); break;
+    case 64 : *value = memory->g_qword(address); break;
+    }
+    return 1;
+}
+
+
+static uint32_t jit_store (Memory * memory, uint64_t address, int bits,
+                           int value_bits, uint64_t value)
+{
+    if (not memory->mapped(address, bits / 8))
+        return 0;
+
+    value &= mask(value_bits);
+    switch (bits) {
+    case 8  : memory->s_byte(address, value);  break;
+    case 16 : memory->s_word(address, value);  break;
+    case 32 : memory->s_dword(address, value); break;
+    case 64 : memory->s_qword(address, value); break;
+    }
+    return 1;
+}
+
+
+/*
+ * Emits x86-64 for one block. Operands are worked on in rax and rcx, and rdx
+ * is free to be clobbered by any helper here.
+ */
+class Assembler {
+    private :
+        // jumps to an exit stub not yet placed
+        struct Patch {
+            size_t   at;   // the rel32 to fill in
+            uint32_t exit;
+        };
+
+        std::vector <Patch> patches;
+        std::vector <size_t> epilogue_jumps;
+
+        void dword (uint32_t d)
+        {
+            for (int i = 0; i < 4; i++)
+                code.push_back(d >> (i * 8));
+        }
+
+        void qword (uint64_t q)
+        {
+            for (int i = 0; i < 8; i++)
+                code.push_back(q >> (i * 8));
+        }
+
+        void patch (size_t at, size_t target)
+        {
+            uint32_t rel = target - (at + 4);
+            for (int i = 0; i < 4; i++)
+                code[at + i] = rel >> (i * 8);
+        }
+
+    public :
+        std::vector <uint8_t> code;
+
+        void bytes (std::initializer_list <uint8_t> b)
+        {
+            code.insert(code.end(), b.begin(), b.end());
+        }
+
+        // push rbx; push r12; sub rsp, 8; mov rbx, rdi; mov r12, rsi
+        void prologue ()
+        {
+            bytes({0x53, 0x41, 0x54, 0x48, 0x83, 0xec, 0x08,
+                   0x48, 0x89, 0xfb, 0x49, 0x89, 0xf4});
+        }
+
+        // mov reg, imm64
+        void mov_imm (int reg, uint64_t imm)
+        {
+            bytes({0x48, (uint8_t) (0xb8 + reg)});
+            qword(imm);
+        }
+
+        // mov r32, imm32, which clears the top half of reg
+        void mov_imm32 (int reg, uint32_t imm)
+        {
+            bytes({(uint8_t) (0xb8 + reg)});
+            dword(imm);
+        }
+
+        // mov reg, [rbx + 8 * id]
+        void load_var (int reg, uint64_t id)
+        {
+            bytes({0x48, 0x8b, (uint8_t) (0x83 | (reg << 3))});
+            dword(id * 8);
+        }
+
+        // mov [rbx + 8 * id], reg
+        void store_var (uint64_t id, int reg)
+        {
+            bytes({0x48, 0x89, (uint8_t) (0x83 | (reg << 3))});
+            dword(id * 8);
+        }
+
+        // clears the bits of reg above bits
+        void mask_reg (int reg, int bits)
+        {
+            if (bits >= 64)
+                return;
+            if (bits == 32) {
+                // mov r32, r32 clears the top half
+                bytes({0x89, (uint8_t) (0xc0 | (reg << 3) | reg)});
+                return;
+            }
+            // mov rdx, mask; and reg, rdx
+            mov_imm(RDX, mask(bits));
+            bytes({0x48, 0x21, (uint8_t) (0xc0 | (RDX << 3) | reg)});
+        }
+
+        // reg = operand, masked to its bits
+        void load (int reg, InstructionOperand operand)
+        {
+            if (operand.g_type() == OPTYPE_CONSTANT)
+                mov_imm(reg, operand.g_value() & mask(operand.g_bits()));
+            else {
+                load_var(reg, operand.g_id());
+                mask_reg(reg, operand.g_bits());
+            }
+        }
+
+        // reg = operand, sign extended the way UInt :: g_svalue128 does it,
+        // so one bit values are not extended
+        void load_signed (int reg, InstructionOperand operand)
+        {
+            load(reg, operand);
+            uint8_t modrm = 0xc0 | (reg << 3) | reg;
+            switch (operand.g_bits()) {
+            case 8  : bytes({0x48, 0x0f, 0xbe, modrm}); break;
+            case 16 : bytes({0x48, 0x0f, 0xbf, modrm}); break;
+            case 32 : bytes({0x48, 0x63, modrm});       break;
+            }
+        }
+
+        // op rax, rcx, for an ALU opcode taking r/m64, r64
+        void alu (uint8_t opcode)
+        {
+            bytes({0x48, opcode, 0xc8});
+        }
+
+        // cmp rax, rcx; setcc al; movzx eax, al
+        void compare (int cc)
+        {
+            bytes({0x48, 0x39, 0xc8,
+                   0x0f, (uint8_t) (0x90 | cc), 0xc0,
+                   0x0f, 0xb6, 0xc0});
+        }
+
+        // rax ^= the flag in slot
+        void xor_flag (uint64_t slot)
+        {
+            load_var(RCX, slot);
+            alu(0x31);
+        }
+
+        // jcc rel32 to the stub for exit
+        void exit_if (int cc, uint32_t exit)
+        {
+            bytes({0x0f, (uint8_t) (0x80 | cc)});
+            Patch p = {code.size(), exit};
+            patches.push_back(p);
+            dword(0);
+        }
+
+        // mov eax, exit; jmp epilogue
+        void exit (uint32_t exit)
+        {
+            mov_imm32(RAX, exit);
+            bytes({0xe9});
+            epilogue_jumps.push_back(code.size());
+            dword(0);
+        }
+
+        // a forward jcc rel32, returning where to patch it
+        size_t jump_if (int cc)
+        {
+            bytes({0x0f, (uint8_t) (0x80 | cc)});
+            size_t at = code.size();
+            dword(0);
+            return at;
+        }
+
+        void land (size_t at)
+        {
+            patch(at, code.size());
+        }
+
+        // calls function, whose arguments are already in place
+        void call (const void * function)
+        {
+            mov_imm(RAX, (uint64_t) function);
+            bytes({0xff, 0xd0});
+        }
+
+        // the epilogue, then the exit stubs it is jumped to from
+        void finish ()
+        {
+            size_t epilogue = code.size();
+            // add rsp, 8; pop r12; pop rbx; ret
+            bytes({0x48, 0x83, 0xc4, 0x08, 0x41, 0x5c, 0x5b, 0xc3});
+
+            for (size_t i = 0; i < patches.size(); i++) {
+                patch(patches[i].at, code.size());
+                mov_imm32(RAX, patches[i].exit);
+                bytes({0xe9});
+                dword(0);
+                patch(code.size() - 4, epilogue);
+            }
+            for (size_t i = 0; i < epilogue_jumps.size(); i++)
+                patch(epilogue_jumps[i], epilogue);
+        }
+};
+
+
+// the operands ins reads, and its destination if it has one
+static bool operands (Instruction * ins,
+                      std::vector <InstructionOperand> & src,
+                      std::vector <InstructionOperand> & dst)
+{
+    switch (ins->g_opcode()) {
+    case IOP_ADD :
+    case IOP_AND :
+    case IOP_DIV :
+    case IOP_MOD :
+    case IOP_MUL :
+    case IOP_OR  :
+    case IOP_SHL :
+    case IOP_SHR :
+    case IOP_SUB :
+    case IOP_XOR : {
+        InstructionBinOp * binop = static_cast<InstructionBinOp *>(ins);
+        src.push_back(binop->g_lhs());
+        src.push_back(binop->g_rhs());
+        dst.push_back(binop->g_dst());
+        return true;
+    }
+    case IOP_CMPEQ  :
+    case IOP_CMPLES :
+    case IOP_CMPLEU :
+    case IOP_CMPLTS :
+    case IOP_CMPLTU : {
+        InstructionCmpOp * cmpop = static_cast<InstructionCmpOp *>(ins);
+        src.push_back(cmpop->g_lhs());
+        src.push_back(cmpop->g_rhs());
+        dst.push_back(cmpop->g_dst());
+        return true;
+    }
+    case IOP_ASSIGN :
+        src.push_back(static_cast<InstructionAssign *>(ins)->g_src());
+        dst.push_back(static_cast<InstructionAssign *>(ins)->g_dst());
+        return true;
+    case IOP_NOT :
+        src.push_back(static_cast<InstructionNot *>(ins)->g_src());
+        dst.push_back(static_cast<InstructionNot *>(ins)->g_dst());
+        return true;
+    case IOP_SIGNEXTEND :
+        src.push_back(static_cast<InstructionSignExtend *>(ins)->g_src());
+        dst.push_back(static_cast<InstructionSignExtend *>(ins)->g_dst());
+        return true;
+    case IOP_LOAD :
+        src.push_back(static_cast<InstructionLoad *>(ins)->g_src());
+        dst.push_back(static_cast<InstructionLoad *>(ins)->g_dst());
+        return true;
+    case IOP_STORE :
+        src.push_back(static_cast<InstructionStore *>(ins)->g_dst());
+        src.push_back(static_cast<InstructionStore *>(ins)->g_src());
+        return true;
+    case IOP_BRC :
+        src.push_back(static_cast<InstructionBrc *>(ins)->g_cond());
+        src.push_back(static_cast<InstructionBrc *>(ins)->g_dst());
+        return true;
+    case IOP_FLAGS : {
+        InstructionFlags * flags = static_cast<InstructionFlags *>(ins);
+        src.push_back(flags->g_lhs());
+        src.push_back(flags->g_rhs());
+        src.push_back(flags->g_result());
+        return true;
+    }
+    case IOP_SYSCALL :
+    case IOP_HLT :
+    case IOP_REP :
+        return true;
+    }
+    return false;
+}
+
+
+// true if bits is a width UInt :: g_svalue128 can sign extend
+static bool signable (int bits)
+{
+    return (bits == 1) || (bits == 8) || (bits == 16) || (bits == 32) || (bits == 64);
+}
+
+
+// true if we can compile ins. anything over 64 bits is left to the interpreter
+static bool compilable (Instruction * ins)
+{
+    std::vector <InstructionOperand> src;
+    std::vector <InstructionOperand> dst;
+    if (not operands(ins, src, dst))
+        return false;
+
+    for (size_t i = 0; i < src.size(); i++) {
+        if (    (src[i].g_type() != OPTYPE_VAR)
+             && (src[i].g_type() != OPTYPE_CONSTANT))
+            return false;
+        if ((src[i].g_bits() < 1) || (src[i].g_bits() > 64))
+            return false;
+    }
+    for (size_t i = 0; i < dst.size(); i++) {
+        if (dst[i].g_type() != OPTYPE_VAR)
+            return false;
+        if ((dst[i].g_bits() < 1) || (dst[i].g_bits() > 64))
+            return false;
+    }
+
+    switch (ins->g_opcode()) {
+    case IOP_CMPLES :
+    case IOP_CMPLTS :
+    case IOP_SIGNEXTEND :
+        for (size_t i = 0; i < src.size(); i++) {
+            if (not signable(src[i].g_bits()))
+                return false;
+        }
+        return true;
+    case IOP_FLAGS :
+        // every kind reads lhs, rhs and result signed for OF or SF
+        for (size_t i = 0; i < src.size(); i++) {
+            if (not signable(src[i].g_bits()))
+                return false;
+        }
+        return true;
+    case IOP_LOAD :
+    case IOP_STORE : {
+        int bits = ins->g_opcode() == IOP_LOAD
+                   ? static_cast<InstructionLoad *>(ins)->g_bits()
+                   : static_cast<InstructionStore *>(ins)->g_bits();
+        return (bits == 8) || (bits == 16) || (bits == 32) || (bits == 64);
+    }
+    }
+    return true;
+}
+
+
+static void emit_flags (Assembler & a, InstructionFlags * ins)
+{
+    InstructionOperand lhs    = ins->g_lhs();
+    InstructionOperand rhs    = ins->g_rhs();
+    InstructionOperand result = ins->g_result();
+    int kind = ins->g_kind();
+
+    // SF = result <s 0
+    a.load_signed(RAX, result);
+    a.bytes({0x48, 0xc1, 0xe8, 0x3f}); // shr rax, 63
+    a.store_var(SLOT_SF, RAX);
+
+    // ZF
+    if (kind == FLAGS_CMP) {
+        a.load(RAX, lhs);
+        a.load(RCX, rhs);
+    }
+    else {
+        a.load(RAX, result);
+        a.bytes({0x31, 0xc9}); // xor ecx, ecx
+    }
+    a.compare(CC_E);
+    a.store_var(SLOT_ZF, RAX);
+
+    // CF
+    switch (kind) {
+    case FLAGS_ADD :
+        a.load(RAX, result); a.load(RCX, lhs); a.compare(CC_B); break;
+    case FLAGS_SUB :
+    case FLAGS_SBB :
+        a.load(RAX, lhs); a.load(RCX, result); a.compare(CC_B); break;
+    case FLAGS_CMP :
+        a.load(RAX, lhs); a.load(RCX, rhs); a.compare(CC_B); break;
+    case FLAGS_LOGIC :
+        a.bytes({0x31, 0xc0}); break; // xor eax, eax
+    }
+    if (InstructionFlags::defines(kind) & (1 << (SLOT_CF - SLOT_ZF)))
+        a.store_var(SLOT_CF, RAX);
+
+    // OF
+    switch (kind) {
+    case FLAGS_ADD :
+    case FLAGS_CMP :
+        a.load_signed(RAX, lhs); a.load_signed(RCX, rhs);
+        a.compare(CC_L); a.xor_flag(SLOT_SF);
+        break;
+    case FLAGS_SBB :
+        a.load_signed(RAX, result); a.load_signed(RCX, rhs);
+        a.compare(CC_L); a.xor_flag(SLOT_SF);
+        break;
+    case FLAGS_INCDEC :
+        a.load_signed(RAX, result); a.load_signed(RCX, lhs);
+        a.compare(CC_L); a.xor_flag(SLOT_SF);
+        break;
+    case FLAGS_SUB : {
+        int bits = lhs.g_bits();
+        a.load(RAX, result);
+        a.load(RCX, lhs);
+        a.alu(0x31);
+        a.mask_reg(RAX, result.g_bits() < bits ? result.g_bits() : bits);
+        a.bytes({0x48, 0xc1, 0xe8, (uint8_t) (bits - 1)}); // shr rax, bits - 1
+        a.bytes({0x83, 0xe0, 0x01});                      // and eax, 1
+        break;
+    }
+    case FLAGS_LOGIC :
+        a.bytes({0x31, 0xc0});
+        break;
+    }
+    a.store_var(SLOT_OF, RAX);
+}
+
+
+// emits ins, which exits to the interpreter as exit if it can't finish
+static void emit (Assembler & a, Instruction * ins, uint32_t exit)
+{
+    std::vector <InstructionOperand> src;
+    std::vector <InstructionOperand> dst;
+    operands(ins, src, dst);
+
+    // the bits of a result written to dst, which is masked to its lhs first
+    int bits = 64;
+    if (dst.size()) {
+        bits = dst[0].g_bits();
+        if (src[0].g_bits() < bits)
+            bits = src[0].g_bits();
+    }
+
+    #define ALU(OPCODE, ...) \
+    case OPCODE : \
+        a.load(RAX, src[0]); \
+        a.load(RCX, src[1]); \
+        a.bytes({__VA_ARGS__}); \
+        a.mask_reg(RAX, bits); \
+        a.store_var(dst[0].g_id(), RAX); \
+        break;
+
+    #define CMP(OPCODE, CC, LOAD) \
+    case OPCODE : \
+        a.LOAD(RAX, src[0]); \
+        a.LOAD(RCX, src[1]); \
+        a.compare(CC); \
+        a.store_var(dst[0].g_id(), RAX); \
+        break;
+
+    switch (ins->g_opcode()) {
+    ALU(IOP_ADD, 0x48, 0x01, 0xc8)
+    ALU(IOP_AND, 0x48, 0x21, 0xc8)
+    ALU(IOP_OR,  0x48, 0x09, 0xc8)
+    ALU(IOP_SUB, 0x48, 0x29, 0xc8)
+    ALU(IOP_XOR, 0x48, 0x31, 0xc8)
+    ALU(IOP_MUL, 0x48, 0x0f, 0xaf, 0xc1)
+
+    CMP(IOP_CMPEQ,  CC_E,  load)
+    CMP(IOP_CMPLEU, CC_BE, load)
+    CMP(IOP_CMPLTU, CC_B,  load)
+    CMP(IOP_CMPLES, CC_LE, load_signed)
+    CMP(IOP_CMPLTS, CC_L,  load_signed)
+
+    case IOP_SHL :
+    case IOP_SHR :
+        // a 128 bit shift by 64 or more is left to the interpreter
+        a.load(RCX, src[1]);
+        a.bytes({0x48, 0x83, 0xf9, 0x3f}); // cmp rcx, 63
+        a.exit_if(CC_A, exit);
+        a.load(RAX, src[0]);
+        if (ins->g_opcode() == IOP_SHL)
+            a.bytes({0x48, 0xd3, 0xe0}); // shl rax, cl
+        else
+            a.bytes({0x48, 0xd3, 0xe8}); // shr rax, cl
+        a.mask_reg(RAX, bits);
+        a.store_var(dst[0].g_id(), RAX);
+        break;
+
+    case IOP_DIV :
+    case IOP_MOD :
+        a.load(RCX, src[1]);
+        a.bytes({0x48, 0x85, 0xc9}); // test rcx, rcx
+        a.exit_if(CC_E, exit);
+        a.load(RAX, src[0]);
+        a.bytes({0x31, 0xd2, 0x48, 0xf7, 0xf1}); // xor edx, edx; div rcx
+        if (ins->g_opcode() == IOP_MOD)
+            a.bytes({0x48, 0x89, 0xd0}); // mov rax, rdx
+        a.mask_reg(RAX, bits);
+        a.store_var(dst[0].g_id(), RAX);
+        break;
+
+    case IOP_ASSIGN :
+        a.load(RAX, src[0]);
+        a.mask_reg(RAX, bits);
+        a.store_var(dst[0].g_id(), RAX);
+        break;
+
+    case IOP_NOT :
+        a.load(RAX, src[0]);
+        a.bytes({0x48, 0xf7, 0xd0}); // not rax
+        a.mask_reg(RAX, bits);
+        a.store_var(dst[0].g_id(), RAX);
+        break;
+
+    case IOP_SIGNEXTEND :
+        a.load_signed(RAX, src[0]);
+        a.mask_reg(RAX, dst[0].g_bits());
+        a.store_var(dst[0].g_id(), RAX);
+        break;
+
+    case IOP_LOAD :
+        a.load(RAX, src[0]);
+        a.bytes({0x48, 0x89, 0xc6, 0x4c, 0x89, 0xe7}); // mov rsi, rax; mov rdi, r12
+        a.mov_imm32(RDX, static_cast<InstructionLoad *>(ins)->g_bits());
+        a.bytes({0x48, 0x89, 0xe1});                   // mov rcx, rsp
+        a.call((const void *) jit_load);
+        a.bytes({0x85, 0xc0});                         // test eax, eax
+        a.exit_if(CC_E, exit);
+        a.bytes({0x48, 0x8b, 0x04, 0x24});             // mov rax, [rsp]
+        a.store_var(dst[0].g_id(), RAX);
+        break;
+
+    case IOP_STORE :
+        a.load(RAX, src[1]);
+        a.bytes({0x49, 0x89, 0xc0});                   // mov r8, rax
+        a.load(RAX, src[0]);
+        a.bytes({0x48, 0x89, 0xc6, 0x4c, 0x89, 0xe7}); // mov rsi, rax; mov rdi, r12
+        a.mov_imm32(RDX, static_cast<InstructionStore *>(ins)->g_bits());
+        a.mov_imm32(RCX, src[1].g_bits());
+        a.call((const void *) jit_store);
+        a.bytes({0x85, 0xc0});
+        a.exit_if(CC_E, exit);
+        break;
+
+    case IOP_BRC : {
+        a.load(RAX, src[0]);
+        a.bytes({0x48, 0x85, 0xc0}); // test rax, rax
+        size_t skip = a.jump_if(CC_E);
+        a.load(RAX, src[1]);
+        a.store_var(SLOT_RIP, RAX);
+        a.land(skip);
+        break;
+    }
+
+    case IOP_FLAGS :
+        emit_flags(a, static_cast<InstructionFlags *>(ins));
+        break;
+    }
+
+    #undef ALU
+    #undef CMP
+}
+
+
+// the bits of the value ins leaves in each variable it writes
+static void writes (Instruction * ins, std::map <uint64_t, int> & written)
+{
+    std::vector <InstructionOperand> src;
+    std::vector <InstructionOperand> dst;
+    operands(ins, src, dst);
+
+    switch (ins->g_opcode()) {
+    case IOP_LOAD :
+        // loads keep the width of the load
+        written[dst[0].g_id()] = static_cast<InstructionLoad *>(ins)->g_bits();
+        return;
+    case IOP_BRC :
+        written[SLOT_RIP] = 64;
+        return;
+    case IOP_FLAGS : {
+        int defines = InstructionFlags::defines(static_cast<InstructionFlags *>(ins)->g_kind());
+        for (uint64_t slot = SLOT_ZF; slot <= SLOT_OF; slot++) {
+            if (defines & (1 << (slot - SLOT_ZF)))
+                written[slot] = 1;
+        }
+        return;
+    }
+    }
+    if (dst.size())
+        written[dst[0].g_id()] = dst[0].g_bits();
+}
+
+
+// true if ins may hand the block back to the interpreter
+static bool may_exit (Instruction * ins)
+{
+    switch (ins->g_opcode()) {
+    case IOP_DIV :
+    case IOP_HLT :
+    case IOP_LOAD :
+    case IOP_MOD :
+    case IOP_SHL :
+    case IOP_SHR :
+    case IOP_STORE :
+    case IOP_SYSCALL :
+    case IOP_REP :
+        return true;
+    }
+    return false;
+}
+
+
+static JitExit make_exit (size_t index, const std::map <uint64_t, int> & written,
+                          bool temporaries)
+{
+    JitExit exit;
+    exit.index = index;
+    std::map <uint64_t, int> :: const_iterator it;
+    for (it = written.begin(); it != written.end(); it++) {
+        if ((it->first < SLOT_COUNT) || temporaries)
+            exit.writes.push_back(*it);
+    }
+    return exit;
+}
+
+
+static ConcreteOperand decode_operand (InstructionOperand operand)
+{
+    ConcreteOperand result;
+    result.constant = operand.g_type() == OPTYPE_CONSTANT;
+    result.bits     = operand.g_bits();
+    result.id       = operand.g_id();
+    result.mask     = mask(operand.g_bits());
+    result.value    = operand.g_value() & result.mask;
+    return result;
+}
+
+
+// ins for the concrete interpreter, with the same results as emit
+static ConcreteOp decode_op (Instruction * ins, uint32_t exit)
+{
+    std::vector <InstructionOperand> src;
+    std::vector <InstructionOperand> dst;
+    operands(ins, src, dst);
+
+    ConcreteOp op;
+    op.opcode = ins->g_opcode();
+    op.kind   = 0;
+    op.width  = 0;
+    op.mask   = 0;
+    op.exit   = exit;
+    if (dst.size()) {
+        int bits = dst[0].g_bits();
+        if ((op.opcode != IOP_SIGNEXTEND) && (src[0].g_bits() < bits))
+            bits = src[0].g_bits();
+        op.dst  = decode_operand(dst[0]);
+        op.mask = mask(bits);
+    }
+    if (src.size() > 0) op.lhs    = decode_operand(src[0]);
+    if (src.size() > 1) op.rhs    = decode_operand(src[1]);
+    if (src.size() > 2) op.result = decode_operand(src[2]);
+
+    switch (op.opcode) {
+    case IOP_LOAD  : op.width = static_cast<InstructionLoad *>(ins)->g_bits();  break;
+    case IOP_STORE : op.width = static_cast<InstructionStore *>(ins)->g_bits(); break;
+    case IOP_FLAGS : op.kind  = static_cast<InstructionFlags *>(ins)->g_kind(); break;
+    }
+    return op;
+}
+
+
+JitBlock * JitBlock :: build (const std::list <Instruction *> & instructions,
+                              bool native)
+{
+    std::list <Instruction *> :: const_iterator it;
+    for (it = instructions.begin(); it != instructions.end(); it++) {
+        if (not compilable(*it))
+            return NULL;
+    }
+
+    JitBlock * block = new JitBlock();
+    std::set <uint64_t>      inputs;
+    std::map <uint64_t, int> written;
+    Assembler a;
+    bool ended = false;
+
+    if (native)
+        a.prologue();
+
+    size_t index = 0;
+    for (it = instructions.begin(); it != instructions.end(); it++, index++) {
+        Instruction * ins = *it;
+        std::vector <InstructionOperand> src;
+        std::vector <InstructionOperand> dst;
+        operands(ins, src, dst);
+
+        uint32_t exit = block->exits.size();
+        if (may_exit(ins))
+            block->exits.push_back(make_exit(index, written, true));
+
+        if (    (ins->g_opcode() == IOP_SYSCALL)
+             || (ins->g_opcode() == IOP_HLT)
+             || (ins->g_opcode() == IOP_REP)) {
+            if (native)
+                a.exit(exit);
+            else
+                block->ops.push_back(decode_op(ins, exit));
+            ended = true;
+            break;
+        }
+
+        for (size_t i = 0; i < src.size(); i++) {
+            if (src[i].g_type() != OPTYPE_VAR)
+                continue;
+            uint64_t id = src[i].g_id();
+            if (written.count(id) == 0)
+                inputs.insert(id);
+            if (id + 1 > block->variable_count)
+                block->variable_count = id + 1;
+        }
+        // a branch not taken leaves RIP as it was
+        if ((ins->g_opcode() == IOP_BRC) && (written.count(SLOT_RIP) == 0))
+            inputs.insert(SLOT_RIP);
+        for (size_t i = 0; i < dst.size(); i++) {
+            if (dst[i].g_id() + 1 > block->variable_count)
+                block->variable_count = dst[i].g_id() + 1;
+        }
+
+        if (native)
+            emit(a, ins, exit);
+        else
+            block->ops.push_back(decode_op(ins, exit));
+        writes(ins, written);
+    }
+
+    // falls through to the epilogue
+    if (not ended) {
+        if (native)
+            a.mov_imm32(RAX, block->exits.size());
+        block->exits.push_back(make_exit(instructions.size(), written, false));
+    }
+
+    // temporaries are written before they are read, so a temporary input
+    // means the block is not what we expect
+    std::set <uint64_t> :: iterator input;
+    for (input = inputs.begin(); input != inputs.end(); input++) {
+        if (*input >= SLOT_COUNT) {
+            delete block;
+            return NULL;
+        }
+        block->inputs.push_back(*input);
+    }
+    if (block->variable_count < SLOT_COUNT)
+        block->variable_count = SLOT_COUNT;
+
+    if (not native)
+        return block;
+    a.finish();
+
+    // the code is written, then made executable and never written again
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = ((a.code.size() + page - 1) / page) * page;
+    void * code = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        delete block;
+        return NULL;
+    }
+    memcpy(code, &(a.code[0]), a.code.size());
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, size);
+        delete block;
+        return NULL;
+    }
+    block->code      = (uint8_t *) code;
+    block->code_size = size;
+
+    return block;
+}
+
+
+JitBlock * JitBlock :: compile (const std::list <Instruction *> & instructions)
+{
+    #if defined(__x86_64__)
+    return build(instructions, true);
+    #else
+    return NULL;
+    #endif
+}
+
+
+JitBlock * JitBlock :: decode (const std::list <Instruction *> & instructions)
+{
+    return build(instructions, false);
+}
+
+
+JitBlock :: ~JitBlock ()
+{
+    if (code != NULL)
+        munmap(code, code_size);
+}
+
+
+static inline uint64_t read (const uint64_t * variables, const ConcreteOperand & operand)
+{
+    if (operand.constant)
+        return operand.value;
+    return variables[operand.id] & operand.mask;
+}
+
+
+// sign extended the way UInt :: g_svalue128 does it
+static inline int64_t read_signed (const uint64_t * variables, const ConcreteOperand & operand)
+{
+    uint64_t value = read(variables, operand);
+    switch (operand.bits) {
+    case 8  : return (int8_t)  value;
+    case 16 : return (int16_t) value;
+    case 32 : return (int32_t) value;
+    }
+    return value;
+}
+
+
+uint32_t JitBlock :: interpret (uint64_t * variables, Memory * memory) const
+{
+    #define BINOP(OPCODE, EXPR) \
+    case OPCODE : \
+        variables[op.dst.id] = (EXPR) & op.mask; \
+        break;
+
+    #define CMPOP(OPCODE, EXPR) \
+    case OPCODE : \
+        variables[op.dst.id] = (EXPR) ? 1 : 0; \
+        break;
+
+    for (size_t i = 0; i < ops.size(); i++) {
+        const ConcreteOp & op = ops[i];
+        switch (op.opcode) {
+        BINOP(IOP_ADD, read(variables, op.lhs) + read(variables, op.rhs))
+        BINOP(IOP_AND, read(variables, op.lhs) & read(variables, op.rhs))
+        BINOP(IOP_MUL, read(variables, op.lhs) * read(variables, op.rhs))
+        BINOP(IOP_OR,  read(variables, op.lhs) | read(variables, op.rhs))
+        BINOP(IOP_SUB, read(variables, op.lhs) - read(variables, op.rhs))
+        BINOP(IOP_XOR, read(variables, op.lhs) ^ read(variables, op.rhs))
+        BINOP(IOP_ASSIGN, read(variables, op.lhs))
+        BINOP(IOP_NOT, ~ read(variables, op.lhs))
+        BINOP(IOP_SIGNEXTEND, read_signed(variables, op.lhs))
+
+        CMPOP(IOP_CMPEQ,  read(variables, op.lhs) == read(variables, op.rhs))
+        CMPOP(IOP_CMPLEU, read(variables, op.lhs) <= read(variables, op.rhs))
+        CMPOP(IOP_CMPLTU, read(variables, op.lhs) <  read(variables, op.rhs))
+        CMPOP(IOP_CMPLES, read_signed(variables, op.lhs) <= read_signed(variables, op.rhs))
+        CMPOP(IOP_CMPLTS, read_signed(variables, op.lhs) <  read_signed(variables, op.rhs))
+
+        case IOP_SHL :
+        case IOP_SHR : {
+            uint64_t count = read(variables, op.rhs);
+            if (count > 63)
+                return op.exit;
+            uint64_t lhs = read(variables, op.lhs);
+            lhs = op.opcode == IOP_SHL ? lhs << count : lhs >> count;
+            variables[op.dst.id] = lhs & op.mask;
+            break;
+        }
+
+        case IOP_DIV :
+        case IOP_MOD : {
+            uint64_t rhs = read(variables, op.rhs);
+            if (rhs == 0)
+                return op.exit;
+            uint64_t lhs = read(variables, op.lhs);
+            lhs = op.opcode == IOP_DIV ? lhs / rhs : lhs % rhs;
+            variables[op.dst.id] = lhs & op.mask;
+            break;
+        }
+
+        case IOP_LOAD :
+            if (not jit_load(memory, read(variables, op.lhs), op.width,
+                             &(variables[op.dst.id])))
+                return op.exit;
+            break;
+
+        case IOP_STORE :
+            if (not jit_store(memory, read(variables, op.lhs), op.width,
+                              op.rhs.bits, read(variables, op.rhs)))
+                return op.exit;
+            break;
+
+        case IOP_BRC :
+            if (read(variables, op.lhs))
+                variables[SLOT_RIP] = read(variables, op.rhs);
+            break;
+
+        case IOP_FLAGS : {
+            uint64_t lhs    = read(variables, op.lhs);
+            uint64_t rhs    = read(variables, op.rhs);
+            uint64_t result = read(variables, op.result);
+            int64_t  slhs    = read_signed(variables, op.lhs);
+            int64_t  srhs    = read_signed(variables, op.rhs);
+            int64_t  sresult = read_signed(variables, op.result);
+            uint64_t sf = sresult < 0 ? 1 : 0;
+
+            variables[SLOT_SF] = sf;
+            variables[SLOT_ZF] = (op.kind == FLAGS_CMP ? lhs == rhs : result == 0) ? 1 : 0;
+            switch (op.kind) {
+            case FLAGS_ADD   : variables[SLOT_CF] = result < lhs ? 1 : 0; break;
+            case FLAGS_SUB   :
+            case FLAGS_SBB   : variables[SLOT_CF] = lhs < result ? 1 : 0; break;
+            case FLAGS_CMP   : variables[SLOT_CF] = lhs < rhs    ? 1 : 0; break;
+            case FLAGS_LOGIC : variables[SLOT_CF] = 0; break;
+            }
+            switch (op.kind) {
+            case FLAGS_ADD    :
+            case FLAGS_CMP    : variables[SLOT_OF] = (slhs < srhs ? 1 : 0) ^ sf;       break;
+            case FLAGS_SBB    : variables[SLOT_OF] = (sresult < srhs ? 1 : 0) ^ sf;    break;
+            case FLAGS_INCDEC : variables[SLOT_OF] = (sresult < slhs ? 1 : 0) ^ sf;    break;
+            case FLAGS_SUB    :
+                variables[SLOT_OF] = (((result ^ lhs) & op.lhs.mask & op.result.mask)
+                                      >> (op.lhs.bits - 1)) & 1;
+                break;
+            case FLAGS_LOGIC  : variables[SLOT_OF] = 0; break;
+            }
+            break;
+        }
+
+        case IOP_SYSCALL :
+        case IOP_HLT :
+        case IOP_REP :
+            return op.exit;
+        }
+    }
+
+    #undef BINOP
+    #undef CMPOP
+
+    return exits.size() - 1;
+}
+
+
+const JitExit & JitBlock :: run (uint64_t * variables, Memory * memory) const
+{
+    if (code == NULL)
+        return exits[interpret(variables, memory)];
+
+    JitFunction function = (JitFunction) code;
+    return exits[function(variables, memory)];
+}
@@ -0,0 +1,133 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef jit_HEADER
+#define jit_HEADER
+
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <inttypes.h>
+
+#include "instruction.h"
+
+class Memory;
+
+// the number of times a block is run by the interpreter before it is compiled
+#define JIT_HOT_THRESHOLD 8
+
+/*
+ * Where compiled code hands a block back to the interpreter. index is the IR
+ * instruction to carry on from, which is the end of the block if the whole
+ * block ran. writes holds every variable written before index, with the bits
+ * its value should have, so the interpreter can pick the values up.
+ */
+struct JitExit {
+    size_t index;
+    std::vector <std::pair <uint64_t, int> > writes;
+};
+
+/*
+ * An IR operand decoded for the concrete interpreter. A constant's value is
+ * masked to its bits ahead of time, and a variable is masked with mask once
+ * it is read.
+ */
+struct ConcreteOperand {
+    bool     constant;
+    int      bits;
+    uint64_t id;
+    uint64_t value;
+    uint64_t mask;
+};
+
+/*
+ * An IR instruction decoded for the concrete interpreter. mask is applied to
+ * the result before it is written to dst, width is a load or store's bits,
+ * and exit is the JitExit taken if the instruction can't be finished.
+ */
+struct ConcreteOp {
+    int             opcode;
+    int             kind;
+    int             width;
+    uint64_t        mask;
+    uint32_t        exit;
+    ConcreteOperand dst;
+    ConcreteOperand lhs;
+    ConcreteOperand rhs;
+    ConcreteOperand result;
+};
+
+/*
+ * A block of IR which runs on concrete values only, either compiled to x86-64
+ * or decoded for a concrete interpreter, which works on plain uint64_t without
+ * building a SymbolicValue for every result. Both hold values in an array of
+ * uint64_t indexed by variable id, and go through the Memory for loads and
+ * stores. Values in the array are always masked to the bits they were written
+ * with.
+ *
+ * The caller fills in every variable in g_inputs(), all of which must be
+ * concrete, and runs the block. It stops short of any instruction it can't
+ * finish concretely: a load of a wild or unmapped byte, a store to an
+ * unmapped byte, a division by zero, a shift of 64 or more bits, a syscall, a
+ * hlt or a rep string instruction. The VM's own interpreter runs that
+ * instruction and the rest of the block, and raises any fault exactly as it
+ * would have on its own.
+ *
+ * A JitBlock never changes once built, so one may be run by many threads at
+ * once.
+ */
+class JitBlock {
+    private :
+        uint8_t * code;
+        size_t    code_size;
+        std::vector <ConcreteOp> ops;
+
+        std::vector <uint64_t> inputs;
+        std::vector <JitExit>  exits;
+        size_t                 variable_count;
+
+        JitBlock () : code(NULL), code_size(0), variable_count(0) {}
+        JitBlock (const JitBlock &);
+        void operator = (const JitBlock &);
+
+        static JitBlock * build (const std::list <Instruction *> & instructions,
+                                 bool native);
+        uint32_t interpret (uint64_t * variables, Memory * memory) const;
+    public :
+        ~JitBlock ();
+
+        // compiles instructions, or returns NULL if they use something we
+        // can't compile
+        static JitBlock * compile (const std::list <Instruction *> & instructions);
+        // decodes instructions for the concrete interpreter, or returns NULL
+        // if they use something it can't run
+        static JitBlock * decode (const std::list <Instruction *> & instructions);
+
+        // the registers the block reads before writing them
+        const std::vector <uint64_t> & g_inputs () const { return inputs; }
+        // the size of the variables array run needs
+        size_t g_variable_count () const { return variable_count; }
+        size_t g_code_size      () const { return code_size; }
+        bool   g_compiled       () const { return code != NULL; }
+
+        const JitExit & run (uint64_t * variables, Memory * memory) const;
+};
+
+#endif
@@ -25,6 +25,7 @@
 #include <cstdio>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -36,22 +37,33 @@
 // order of arguments by register
 // %rdi, %rsi, %rdx, %r10, %r8 and %r9
 
-void Kernel :: syscall (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+// raises a MemoryFault at the first of size bytes at address which is not
+// mapped, before a syscall has touched any of them
+static void check_mapped (Memory & memory, uint64_t address, uint64_t size, int access)
 {
-    SymbolicValue rax = variables[InstructionOperand::str_to_id("UD_R_RAX")];
+    if (memory.mapped(address, size))
+        return;
+    while (memory.g_page(address) != NULL)
+        address = (address | FRAME_MASK) + 1;
+    throw MemoryFault(address, access);
+}
+
+void Kernel :: syscall (RegisterFile & registers, Memory & memory)
+{
+    SymbolicValue rax = registers[SLOT_RAX];
 
     if (rax.g_wild())
         throw std::runtime_error("syscall called with wild rax");
 
     switch (rax.g_uint64()) {
-        case 0x0  : sys_read   (variables, memory); break;
-        case 0x1  : sys_write  (variables, memory); break;
-        case 0x5  : sys_fstat  (variables, memory); break;
-        case 0x9  : sys_mmap   (variables, memory); break;
-        case 0x14 : sys_writev (variables, memory); break;
-        case 0x27 : sys_getpid (variables, memory); break;
-        case 0x3c : sys_exit   (variables, memory); break;
-        case 0xe7 : sys_exit_group(variables, memory); break;
+        case 0x0  : sys_read   (registers, memory); break;
+        case 0x1  : sys_write  (registers, memory); break;
+        case 0x5  : sys_fstat  (registers, memory); break;
+        case 0x9  : sys_mmap   (registers, memory); break;
+        case 0x14 : sys_writev (registers, memory); break;
+        case 0x27 : sys_getpid (registers, memory); break;
+        case 0x3c : sys_exit   (registers, memory); break;
+        case 0xe7 : sys_exit_group(registers, memory); break;
         default :
             std::stringstream ss;
             ss << "unhandled syscall: " << rax.str();
@@ -60,11 +72,11 @@ void Kernel :: syscall (std::map <uint64_t, SymbolicValue> & variables, Memory &
 }
 
 
-void Kernel :: sys_read (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_read (RegisterFile & registers, Memory & memory)
 {
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
-    SymbolicValue rsi = variables[InstructionOperand::str_to_id("UD_R_RSI")];
-    SymbolicValue rdx = variables[InstructionOperand::str_to_id("UD_R_RDX")];
+    SymbolicValue rdi = registers[SLOT_RDI];
+    SymbolicValue rsi = registers[SLOT_RSI];
+    SymbolicValue rdx = registers[SLOT_RDX];
 
     if (rsi.g_wild())
         throw std::runtime_error("SYS_READ with symbolic destination");
@@ -77,7 +89,7 @@ void Kernel :: sys_read (std::map <uint64_t, SymbolicValue> & variables, Memory
     if (rdi.g_uint64() == 0) {
         // return 1 wild symbolic byte
         memory.s_sym8(rsi.g_uint64(), SymbolicValue(8));
-        variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, 1);
+        registers[SLOT_RAX] = SymbolicValue(64, 1);
     }
     else
         throw std::runtime_error("SYS_READ currently only supports stdin");
@@ -86,15 +98,15 @@ void Kernel :: sys_read (std::map <uint64_t, SymbolicValue> & variables, Memory
     std::cerr << "SYS_READ rdi=" << rdi.str() << ", "
               << "rsi=" << rsi.str() << ", "
               << "rdx=" << rdx.str() << ", "
-              << "result_rax=" << variables[InstructionOperand::str_to_id("UD_R_RAX")].str()
+              << "result_rax=" << registers[SLOT_RAX].str()
               << std::endl;
     #endif
 }
 
 
-void Kernel :: sys_exit (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_exit (RegisterFile & registers, Memory & memory)
 {
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
+    SymbolicValue rdi = registers[SLOT_RDI];
 
     #ifdef DEBUG
     std::cerr << "SYS_EXIT rdi=" << rdi.str()
@@ -103,9 +115,9 @@ void Kernel :: sys_exit (std::map <uint64_t, SymbolicValue> & variables, Memory
 }
 
 
-void Kernel :: sys_exit_group (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_exit_group (RegisterFile & registers, Memory & memory)
 {
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
+    SymbolicValue rdi = registers[SLOT_RDI];
 
     #ifdef DEBUG
     std::cerr << "SYS_EXIT_GROUP rdi=" << rdi.str()
@@ -114,22 +126,24 @@ void Kernel :: sys_exit_group (std::map <uint64_t, SymbolicValue> & variables, M
 }
 
 
-void Kernel :: sys_fstat (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_fstat (RegisterFile & registers, Memory & memory)
 {
     struct stat buf;
     
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
-    SymbolicValue rsi = variables[InstructionOperand::str_to_id("UD_R_RSI")];
+    SymbolicValue rdi = registers[SLOT_RDI];
+    SymbolicValue rsi = registers[SLOT_RSI];
 
     if ((rdi.g_wild()) || (rsi.g_wild())) {
         throw std::runtime_error("sys_fstat called with wild variable");
     }
 
+    check_mapped(memory, rsi.g_uint64(), sizeof(struct stat), FAULT_WRITE);
+
     int result = fstat(rdi.g_uint64(), &buf);
 
     memory.s_data(rsi.g_uint64(), (const uint8_t *) &buf, sizeof(struct stat));
 
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, result);
+    registers[SLOT_RAX] = SymbolicValue(64, result);
 
     #ifdef DEBUG
     std::cerr << "SYS_FSTAT rdi=" << rdi.str() << ", "
@@ -138,38 +152,38 @@ void Kernel :: sys_fstat (std::map <uint64_t, SymbolicValue> & variables, Memory
               << "stat.st_rdev=" << std::hex << buf.st_rdev << ", "
               << "stat.st_ino=" << std::hex << buf.st_ino << ", "
               << "stat.st_mode=" << std::hex << buf.st_mode << ", "
-              << "result_rax=" << variables[InstructionOperand::str_to_id("UD_R_RAX")].str()
+              << "result_rax=" << registers[SLOT_RAX].str()
               << std::endl;
     #endif
 
     // some registers are not callee saved, and this call will trash it.
-    variables[InstructionOperand::str_to_id("UD_R_RCX")] = SymbolicValue(64, -1);
-    variables[InstructionOperand::str_to_id("UD_R_R11")] = SymbolicValue(64, 0x346);
+    registers[SLOT_RCX] = SymbolicValue(64, -1);
+    registers[SLOT_R11] = SymbolicValue(64, 0x346);
 }
 
 
-void Kernel :: sys_getpid (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_getpid (RegisterFile & registers, Memory & memory)
 {
     //SymbolicValueCmpLtu pid(SymbolicValue(64), SymbolicValue(64, 1 << 16));
     const SymbolicValue pid(64, 5000);
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = pid;
+    registers[SLOT_RAX] = pid;
 
     #ifdef DEBUG
     std::cerr << "SYS_GETPID "
-              << "result_rax=" << variables[InstructionOperand::str_to_id("UD_R_RAX")].str()
+              << "result_rax=" << registers[SLOT_RAX].str()
               << std::endl;
     #endif
 }
 
 
-void Kernel :: sys_mmap (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_mmap (RegisterFile & registers, Memory & memory)
 {
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
-    SymbolicValue rsi = variables[InstructionOperand::str_to_id("UD_R_RSI")];
-    SymbolicValue rdx = variables[InstructionOperand::str_to_id("UD_R_RDX")];
-    SymbolicValue r10 = variables[InstructionOperand::str_to_id("UD_R_R10")];
-    SymbolicValue r8  = variables[InstructionOperand::str_to_id("UD_R_R8")];
-    SymbolicValue r9  = variables[InstructionOperand::str_to_id("UD_R_R9")];
+    SymbolicValue rdi = registers[SLOT_RDI];
+    SymbolicValue rsi = registers[SLOT_RSI];
+    SymbolicValue rdx = registers[SLOT_RDX];
+    SymbolicValue r10 = registers[SLOT_R10];
+    SymbolicValue r8  = registers[SLOT_R8];
+    SymbolicValue r9  = registers[SLOT_R9];
 
     // no wild symbolic values
     if (    (rdi.g_wild())
@@ -178,7 +192,7 @@ void Kernel :: sys_mmap (std::map <uint64_t, SymbolicValue> & variables, Memory
          || (r10.g_wild())
          || (r8.g_wild())
          || (r9.g_wild()))
-        throw std::runtime_error("sys_mmap called with wild variables. unsupported.");
+        throw std::runtime_error("sys_mmap called with wild registers. unsupported.");
 
     // rdi must == 0 (rdi == addr requested)
     if (rdi.g_uint64() != 0)
@@ -189,11 +203,9 @@ void Kernel :: sys_mmap (std::map <uint64_t, SymbolicValue> & variables, Memory
 
     size_t mmap_size = rsi.g_uint64();
 
-    // create new page for this mmap area
-    Page * page = new Page (mmap_size);
-    // insert this page at the next available mmap address and set result to its address
-    memory.s_page(next_mmap, page);
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, next_mmap);
+    // map this area at the next available mmap address and set result to its address
+    memory.map(next_mmap, mmap_size);
+    registers[SLOT_RAX] = SymbolicValue(64, next_mmap);
 
     #ifdef DEBUG
     std::cerr << "SYS_MMAP rdi=" << rdi.str() << ", "
@@ -202,45 +214,39 @@ void Kernel :: sys_mmap (std::map <uint64_t, SymbolicValue> & variables, Memory
               << "r10=" << r10.str() << ", "
               << "r8="  << r8.str() << ", "
               << "r9="  << r9.str() << ", "
-              << "result_rax=" << variables[InstructionOperand::str_to_id("UD_R_RAX")].str()
+              << "result_rax=" << registers[SLOT_RAX].str()
               << std::endl;
     #endif
 
     // some registers are not callee saved, and this call will trash it.
-    variables[InstructionOperand::str_to_id("UD_R_RCX")] = SymbolicValue(64, -1);
+    registers[SLOT_RCX] = SymbolicValue(64, -1);
 
     // increase next_mmap
-    next_mmap += (mmap_size + 4095) % 4096;
+    next_mmap += (mmap_size + FRAME_MASK) & ~((uint64_t) FRAME_MASK);
 }
 
 
-void Kernel :: sys_write (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_write (RegisterFile & registers, Memory & memory)
 {
     FILE * fh;
     std::stringstream filename;
 
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
-    SymbolicValue rsi = variables[InstructionOperand::str_to_id("UD_R_RSI")];
-    SymbolicValue rdx = variables[InstructionOperand::str_to_id("UD_R_RDX")];
+    SymbolicValue rdi = registers[SLOT_RDI];
+    SymbolicValue rsi = registers[SLOT_RSI];
+    SymbolicValue rdx = registers[SLOT_RDX];
 
     if (    (rdi.g_wild())
          || (rsi.g_wild())
          || (rdx.g_wild()))
         throw std::runtime_error("sys_write called with wild register argument");
 
+    check_mapped(memory, rsi.g_uint64(), rdx.g_uint64(), FAULT_READ);
+
     filename << "fh_" << rdi.g_uint64();
     fh = fopen(filename.str().c_str(), "ab");
     if (fh == NULL)
         throw std::runtime_error(std::string("error opening ")
                                  + filename.str() + " in Kernel::sys_write");
-    if (rdx.g_uint64() > memory.g_data_size(rsi.g_uint64())){
-        std::stringstream ss;
-        ss << "count beyond memory limits in Kernel::sys_write. "
-           << "rdi=" << rdi.str() << ", "
-           << "memory.g_data_size()=" << memory.g_data_size(rsi.g_uint64()) << ", "
-           << "rsi=" << rsi.str() << ", rdx=" << rdx.str();
-        throw std::runtime_error(ss.str());
-    }
 
     std::stringstream output;
     for (uint64_t i = 0; i < rdx.g_uint64(); i++) {
@@ -250,44 +256,57 @@ void Kernel :: sys_write (std::map <uint64_t, SymbolicValue> & variables, Memory
 
     fclose(fh);
 
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, rdx.g_uint64());
+    registers[SLOT_RAX] = SymbolicValue(64, rdx.g_uint64());
 
     #ifdef DEBUG
     std::cerr << "SYS_WRITE rdi=" << rdi.str() << ", "
               << "rsi=" << rsi.str() << ", "
               << "rdx=" << rdx.str() << ", "
-              << "result_rax=" << variables[InstructionOperand::str_to_id("UD_R_RAX")].str()
+              << "result_rax=" << registers[SLOT_RAX].str()
               << std::endl;
     #endif
 
     // some registers are not callee saved, and this call will trash it.
-    variables[InstructionOperand::str_to_id("UD_R_RCX")] = SymbolicValue(64, -1);
+    registers[SLOT_RCX] = SymbolicValue(64, -1);
 }
 
 
-void Kernel :: sys_writev (std::map <uint64_t, SymbolicValue> & variables, Memory & memory)
+void Kernel :: sys_writev (RegisterFile & registers, Memory & memory)
 {
     FILE * fh;
     std::stringstream filename;
     size_t bytes_written = 0;
 
-    SymbolicValue rdi = variables[InstructionOperand::str_to_id("UD_R_RDI")];
-    SymbolicValue rsi = variables[InstructionOperand::str_to_id("UD_R_RSI")];
-    SymbolicValue rdx = variables[InstructionOperand::str_to_id("UD_R_RDX")];
+    SymbolicValue rdi = registers[SLOT_RDI];
+    SymbolicValue rsi = registers[SLOT_RSI];
+    SymbolicValue rdx = registers[SLOT_RDX];
 
     int buf_n = rdx.g_uint64();
 
-    struct iovec * vec = (struct iovec *) memory.g_data(rsi.g_uint64());
+    // iovecs and their buffers may straddle frames, so both are copied out,
+    // all of them before the file is opened
+    check_mapped(memory, rsi.g_uint64(), buf_n * sizeof(struct iovec), FAULT_READ);
+    std::vector <uint8_t> output;
+    for (int i = 0; i < buf_n; i++) {
+        struct iovec vec;
+        memory.g_data(rsi.g_uint64() + i * sizeof(struct iovec),
+                      (uint8_t *) &vec, sizeof(struct iovec));
+        if (vec.iov_len == 0)
+            continue;
+
+        check_mapped(memory, (uint64_t) vec.iov_base, vec.iov_len, FAULT_READ);
+        size_t offset = output.size();
+        output.resize(offset + vec.iov_len);
+        memory.g_data((uint64_t) vec.iov_base, &(output[offset]), vec.iov_len);
+        bytes_written += vec.iov_len;
+    }
 
     filename << "fh_" << rdi.g_uint64();
     fh = fopen(filename.str().c_str(), "wb");
-
-    for (int i = 0; i < buf_n; i++) {
-        bytes_written += vec->iov_len;
-        fwrite(memory.g_data((uint64_t) vec->iov_base), 1, vec->iov_len, fh);
-    }
+    if (output.size() > 0)
+        fwrite(&(output[0]), 1, output.size(), fh);
 
     fclose(fh);
 
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, bytes_written);
+    registers[SLOT_RAX] = SymbolicValue(64, bytes_written);
 }
\ No newline at end of file
@@ -26,10 +26,11 @@
 #include <map>
 
 #include "memory.h"
+#include "registers.h"
 #include "symbolicvalue.h"
 
 #define SYS_FUNC(SYSCALLNAME) void sys_##SYSCALLNAME \
-    (std::map <uint64_t, SymbolicValue> & variables, Memory & memory);
+    (RegisterFile & registers, Memory & memory);
 
 static uint64_t NEXT_MMAP_INIT = 0x77ff000000000000ULL;
 
@@ -39,7 +40,17 @@ class Kernel {
     public :
     	Kernel () : next_mmap(NEXT_MMAP_INIT) {}
 
-        void syscall (std::map <uint64_t, SymbolicValue> & variables, Memory & memory);
+        uint64_t g_next_mmap () const { return next_mmap; }
+
+        // true if rhs holds the same state. anything added to Kernel must be
+        // compared here, or VMs which differ in it will be merged
+        bool operator == (const Kernel & rhs) const
+        {
+            return next_mmap == rhs.next_mmap;
+        }
+        bool operator != (const Kernel & rhs) const { return not (*this == rhs); }
+
+        void syscall (RegisterFile & registers, Memory & memory);
 
         SYS_FUNC(exit)
         SYS_FUNC(exit_group)
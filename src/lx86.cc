@@ -176,44 +176,39 @@ Memory Lx86 :: g_memory ()
     return Memory(pages);
 }
 
-std::map <uint64_t, SymbolicValue> Lx86 :: g_variables ()
+RegisterFile Lx86 :: g_registers ()
 {
     struct user_regs_struct regs;
     ptrace(PTRACE_GETREGS, pid, NULL, &regs);
 
-    std::map <uint64_t, SymbolicValue> variables;
-    variables[InstructionOperand::str_to_id("UD_R_RAX")] = SymbolicValue(64, regs.rax);
-    variables[InstructionOperand::str_to_id("UD_R_RBX")] = SymbolicValue(64, regs.rbx);
-    variables[InstructionOperand::str_to_id("UD_R_RCX")] = SymbolicValue(64, regs.rcx);
-    variables[InstructionOperand::str_to_id("UD_R_RDX")] = SymbolicValue(64, regs.rdx);
-    variables[InstructionOperand::str_to_id("UD_R_RSI")] = SymbolicValue(64, regs.rsi);
-    variables[InstructionOperand::str_to_id("UD_R_RDI")] = SymbolicValue(64, regs.rdi);
-    variables[InstructionOperand::str_to_id("UD_R_R8")]  = SymbolicValue(64, regs.r8);
-    variables[InstructionOperand::str_to_id("UD_R_R9")]  = SymbolicValue(64, regs.r9);
-    variables[InstructionOperand::str_to_id("UD_R_R10")] = SymbolicValue(64, regs.r10);
-    variables[InstructionOperand::str_to_id("UD_R_R11")] = SymbolicValue(64, regs.r11);
-    variables[InstructionOperand::str_to_id("UD_R_R12")] = SymbolicValue(64, regs.r12);
-    variables[InstructionOperand::str_to_id("UD_R_R13")] = SymbolicValue(64, regs.r13);
-    variables[InstructionOperand::str_to_id("UD_R_R14")] = SymbolicValue(64, regs.r14);
-    variables[InstructionOperand::str_to_id("UD_R_R15")] = SymbolicValue(64, regs.r15);
-    variables[InstructionOperand::str_to_id("UD_R_RBP")] = SymbolicValue(64, regs.rbp);
-    variables[InstructionOperand::str_to_id("UD_R_XMM0")] = SymbolicValue(128, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM1")] = SymbolicValue(128, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM2")] = SymbolicValue(128, 0);
-    variables[InstructionOperand::str_to_id("UD_R_XMM3")] = SymbolicValue(128, 0);
-
-    variables[InstructionOperand::str_to_id("DF")] = SymbolicValue(1, 0);
+    RegisterFile registers;
+    registers[SLOT_RAX] = SymbolicValue(64, regs.rax);
+    registers[SLOT_RBX] = SymbolicValue(64, regs.rbx);
+    registers[SLOT_RCX] = SymbolicValue(64, regs.rcx);
+    registers[SLOT_RDX] = SymbolicValue(64, regs.rdx);
+    registers[SLOT_RSI] = SymbolicValue(64, regs.rsi);
+    registers[SLOT_RDI] = SymbolicValue(64, regs.rdi);
+    registers[SLOT_R8]  = SymbolicValue(64, regs.r8);
+    registers[SLOT_R9]  = SymbolicValue(64, regs.r9);
+    registers[SLOT_R10] = SymbolicValue(64, regs.r10);
+    registers[SLOT_R11] = SymbolicValue(64, regs.r11);
+    registers[SLOT_R12] = SymbolicValue(64, regs.r12);
+    registers[SLOT_R13] = SymbolicValue(64, regs.r13);
+    registers[SLOT_R14] = SymbolicValue(64, regs.r14);
+    registers[SLOT_R15] = SymbolicValue(64, regs.r15);
+    registers[SLOT_RBP] = SymbolicValue(64, regs.rbp);
+    registers[SLOT_XMM0] = SymbolicValue(128, 0);
+    registers[SLOT_XMM1] = SymbolicValue(128, 0);
+    registers[SLOT_XMM2] = SymbolicValue(128, 0);
+    registers[SLOT_XMM3] = SymbolicValue(128, 0);
+
+    registers[SLOT_DF] = SymbolicValue(1, 0);
     
-    variables[InstructionOperand::str_to_id("UD_R_FS")]  = SymbolicValue(64, regs.fs_base);
-    variables[InstructionOperand::str_to_id("UD_R_RSP")] = SymbolicValue(64, regs.rsp);
-    variables[InstructionOperand::str_to_id("UD_R_RIP")] = SymbolicValue(64, regs.rip);
+    registers[SLOT_FS]  = SymbolicValue(64, regs.fs_base);
+    registers[SLOT_RSP] = SymbolicValue(64, regs.rsp);
+    registers[SLOT_RIP] = SymbolicValue(64, regs.rip);
 
-    return variables;
-}
-
-uint64_t Lx86 :: g_ip_id ()
-{
-    return InstructionOperand::str_to_id("UD_R_RIP");
+    return registers;
 }
 
 std::string Lx86 :: func_symbol (uint64_t address)
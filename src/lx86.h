@@ -20,10 +20,9 @@ class Lx86 : public Loader {
 		Lx86  (std::string filename);
 		~Lx86 ();
 
-		std::string                        func_symbol (uint64_t address);
-		Memory                             g_memory    ();
-		std::map <uint64_t, SymbolicValue> g_variables ();
-		uint64_t                           g_ip_id     ();
+		std::string  func_symbol (uint64_t address);
+		Memory       g_memory    ();
+		RegisterFile g_registers ();
 
 		// these are special methods used for debugging
 		void step();
@@ -19,242 +19,586 @@
 
 #include "memory.h"
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
+#include <vector>
 
 //#define DEBUG
 #define DEBUGSYM
 
-void Memory :: destroy ()
+Memory :: Memory (const Memory & rhs)
+    : frames(rhs.frames)
+{
+    flush();
+    rhs.flush_writable();
+}
+
+
+Memory :: Memory (std::map <uint64_t, Page *> pages)
 {
+    flush();
+
     std::map <uint64_t, Page *> :: iterator it;
 
     for (it = pages.begin(); it != pages.end(); it++) {
-        #ifdef DEBUG
-        std::cerr << "Memory deleting page: " << std::hex << it->first << std::endl;
-        #endif
-        // if this is dirty, destroy it once for everytime in dirty_counter
-        if (dirty.count(it->first) > 0) {
-            for (int i = 0; i < dirty_counter[it->first]; i++) {
-                #ifdef DEBUG
-                std::cerr << "~Memory dirty page: " 
-                          << std::hex << it->first << std::endl;
-                #endif
-                pages[it->first] = pages[it->first]->destroy();
-            }
-        }
-        pages[it->first] = pages[it->first]->destroy();
+        size_t size = it->second->g_size();
+        map(it->first, size);
+        if (size > 0)
+            s_data(it->first, it->second->g_data(0), size);
+        it->second->destroy();
     }
 }
 
 
+Memory & Memory :: operator= (const Memory & rhs)
+{
+    frames = rhs.frames;
+    flush();
+    rhs.flush_writable();
+    return *this;
+}
+
+
+void Memory :: flush ()
+{
+    for (int i = 0; i < TLB_SIZE; i++)
+        tlb[i].page = NULL;
+}
+
+
+void Memory :: flush_writable () const
+{
+    for (int i = 0; i < TLB_SIZE; i++)
+        tlb[i].writable = false;
+}
+
+
+void Memory :: destroy ()
+{
+    frames = FrameTable ();
+    flush();
+}
+
+
 Memory Memory :: copy ()
 {
-    dirty.clear();
+    return Memory(*this);
+}
+
+
+// a byte differs if either side holds a symbolic value the other doesn't
+// share, or both are concrete and unequal
+static bool differs (Page * page, Page * rhs_page, size_t offset)
+{
+    const SymbolicValue * sym     = page->g_sym(offset);
+    const SymbolicValue * rhs_sym = rhs_page->g_sym(offset);
 
-    std::map <uint64_t, Page *> :: iterator it;
-    for (it = pages.begin(); it != pages.end(); it++) {
-        it->second->reference();
+    if ((sym != NULL) || (rhs_sym != NULL))
+        return (sym == NULL) || (rhs_sym == NULL) || (not sym->identical(*rhs_sym));
+    return page->g_byte(offset) != rhs_page->g_byte(offset);
+}
+
+
+size_t Memory :: differences (Memory & rhs, size_t limit)
+{
+    std::vector <uint64_t> keys;
+    std::vector <uint64_t> rhs_keys;
+    frames.keys(keys);
+    rhs.frames.keys(rhs_keys);
+    if (keys != rhs_keys)
+        return limit;
+
+    size_t count = 0;
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        Page * page     = frames.find(keys[i])->g_page();
+        Page * rhs_page = rhs.frames.find(keys[i])->g_page();
+        // frames neither side has written since they shared them
+        if (page == rhs_page)
+            continue;
+
+        for (size_t j = 0; j < FRAME_SIZE; j++) {
+            if (differs(page, rhs_page, j)) {
+                if (++count >= limit)
+                    return limit;
+            }
+        }
     }
 
-    return Memory(pages);
+    return count;
 }
 
 
-uint64_t Memory :: g_page_address (uint64_t address, int bits)
+void Memory :: merge (Memory & rhs, const SymbolicValue & cond)
 {
-    std::map <uint64_t, Page *> :: iterator it;
-    it = pages.upper_bound(address);
-    if (it != pages.begin()) {
-        it--;
-        if (it->first + it->second->g_size() >= address + bits)
-            return it->first;
+    std::map <uint64_t, SymbolicValue> merged;
+
+    std::vector <uint64_t> keys;
+    frames.keys(keys);
+    for (size_t i = 0; i < keys.size(); i++) {
+        Page * page = frames.find(keys[i])->g_page();
+        const FrameRef * rhs_frame = rhs.frames.find(keys[i]);
+        if ((rhs_frame == NULL) || (page == rhs_frame->g_page()))
+            continue;
+        Page * rhs_page = rhs_frame->g_page();
+        for (size_t j = 0; j < FRAME_SIZE; j++) {
+            if (differs(page, rhs_page, j))
+                merged[(keys[i] << FRAME_BITS) + j] = SymbolicValue();
+        }
     }
 
-    std::stringstream ss;
-    ss << "memory address dereferenced but not paged: 0x" << std::hex << address;
-    throw std::runtime_error(ss.str());
+    // read every byte before writing any
+    std::map <uint64_t, SymbolicValue> :: iterator sit;
+    for (sit = merged.begin(); sit != merged.end(); sit++)
+        sit->second = SymbolicValue::ite(cond, g_sym8(sit->first), rhs.g_sym8(sit->first));
+    for (sit = merged.begin(); sit != merged.end(); sit++)
+        s_sym8(sit->first, sit->second);
 }
 
 
-void Memory :: dirty_page (uint64_t address)
+static std::string fault_message (uint64_t address, int access)
 {
-    if (dirty.count(address) == 0) {
-        if (dirty_counter.count(address) == 0)
-            dirty_counter[address] = 1;
-        else
-            dirty_counter[address]++;
-        dirty.insert(address);
-        pages[address] = pages[address]->make_child();
+    std::stringstream ss;
+    ss << "memory address ";
+    switch (access) {
+    case FAULT_READ  : ss << "read";    break;
+    case FAULT_WRITE : ss << "written"; break;
+    case FAULT_FETCH : ss << "fetched"; break;
     }
+    ss << " but not paged: 0x" << std::hex << address;
+    return ss.str();
+}
+
+
+MemoryFault :: MemoryFault (uint64_t address, int access)
+    : std::runtime_error(fault_message(address, access)),
+      address(address), access(access) {}
+
+
+Page * Memory :: lookup (uint64_t address)
+{
+    uint64_t   frame = address >> FRAME_BITS;
+    TlbEntry & entry = tlb[frame & (TLB_SIZE - 1)];
+    if ((entry.page != NULL) && (entry.frame == frame))
+        return entry.page;
+
+    const FrameRef * ref = frames.find(frame);
+    if (ref == NULL)
+        return NULL;
+
+    entry.frame    = frame;
+    entry.page     = ref->g_page();
+    entry.writable = false;
+    return entry.page;
+}
+
+
+Page * Memory :: g_frame (uint64_t address)
+{
+    Page * page = lookup(address);
+    if (page == NULL)
+        throw MemoryFault(address, FAULT_READ);
+    return page;
+}
+
+
+Page * Memory :: dirty_frame (uint64_t address)
+{
+    uint64_t   frame = address >> FRAME_BITS;
+    TlbEntry & entry = tlb[frame & (TLB_SIZE - 1)];
+    if ((entry.page != NULL) && (entry.frame == frame) && entry.writable)
+        return entry.page;
+
+    FrameRef * ref = frames.writable(frame);
+    if (ref == NULL)
+        throw MemoryFault(address, FAULT_WRITE);
+
+    if (ref->g_page()->g_references() > 1)
+        *ref = FrameRef(ref->g_page()->copy());
+
+    entry.frame    = frame;
+    entry.page     = ref->g_page();
+    entry.writable = true;
+    return entry.page;
 }
 
 
 size_t Memory :: g_data_size (uint64_t address)
 {
-    uint64_t page_address = g_page_address(address, 0);
-    return this->pages[page_address]->g_size() - (address - page_address);
+    g_frame(address);
+    return FRAME_SIZE - (address & FRAME_MASK);
 }
 
 
 uint8_t * Memory :: g_data (uint64_t address)
 {
-    uint64_t page_address = g_page_address(address, g_data_size(address));
-    return this->pages[page_address]->g_data(address - page_address);
+    return g_frame(address)->g_data(address & FRAME_MASK);
+}
+
+
+size_t Memory :: g_data (uint64_t address, uint8_t * data, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        Page * frame = lookup(address + done);
+        if (frame == NULL)
+            break;
+
+        size_t offset = (address + done) & FRAME_MASK;
+        size_t bytes  = FRAME_SIZE - offset;
+        if (bytes > size - done)
+            bytes = size - done;
+        memcpy(&(data[done]), frame->g_data(offset), bytes);
+        done += bytes;
+    }
+
+    return done;
 }
 
 
 void Memory :: s_data (uint64_t address, const uint8_t * data, size_t size)
 {
-    uint64_t page_address = g_page_address(address, size);
-    this->pages[page_address]->s_data(address - page_address, data, size);
+    size_t done = 0;
+
+    while (done < size) {
+        size_t offset = (address + done) & FRAME_MASK;
+        size_t bytes  = FRAME_SIZE - offset;
+        if (bytes > size - done)
+            bytes = size - done;
+        Page * frame = dirty_frame(address + done);
+        frame->clear_sym(offset, bytes);
+        frame->s_data(offset, &(data[done]), bytes);
+        done += bytes;
+    }
 }
 
 
-SymbolicValue Memory :: g_sym8 (uint64_t address)
+void Memory :: map (uint64_t address, size_t size)
 {
-    if (symbolic_memory.count(address) > 0) {
-        #ifdef DEBUGSYM
-        std::cerr << "reading symbolic byte at " << std::hex << address << std::endl;
-        #endif
-        return symbolic_memory[address];
+    if (size == 0)
+        return;
+
+    uint64_t last = (address + size - 1) >> FRAME_BITS;
+    for (uint64_t frame = address >> FRAME_BITS; frame <= last; frame++) {
+        if (frames.find(frame) == NULL)
+            frames.set(frame, FrameRef(new Page(FRAME_SIZE)));
     }
-    return SymbolicValue(8, g_byte(address));
 }
 
-SymbolicValue Memory :: g_sym16 (uint64_t address)
+
+bool Memory :: mapped (uint64_t address, size_t size)
 {
-    return (g_sym8(address + 1).extend(16) << SymbolicValue(8, 8))
-           | g_sym8(address).extend(16);
+    if (size == 0)
+        return true;
+    if (address + size - 1 < address)
+        return false;
+
+    uint64_t last = (address + size - 1) >> FRAME_BITS;
+    for (uint64_t frame = address >> FRAME_BITS; frame <= last; frame++) {
+        if (lookup(frame << FRAME_BITS) == NULL)
+            return false;
+    }
+    return true;
 }
 
-SymbolicValue Memory :: g_sym32 (uint64_t address)
+
+bool Memory :: fill (uint64_t address, uint64_t pattern, size_t width, size_t size)
 {
-    return (g_sym16(address + 2).extend(32) << SymbolicValue(8, 16))
-           | g_sym16(address).extend(32);
+    if ((width == 0) || (width > 8) || (not mapped(address, size)))
+        return false;
+
+    // a frame's worth of the pattern, with a pattern's worth spare so a frame
+    // can start part way through one
+    uint8_t data[FRAME_SIZE + 8];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = pattern >> ((i % width) * 8);
+
+    size_t done = 0;
+    while (done < size) {
+        size_t offset = (address + done) & FRAME_MASK;
+        size_t bytes  = FRAME_SIZE - offset;
+        if (bytes > size - done)
+            bytes = size - done;
+        Page * frame = dirty_frame(address + done);
+        frame->clear_sym(offset, bytes);
+        frame->s_data(offset, &(data[done % width]), bytes);
+        done += bytes;
+    }
+
+    return true;
 }
 
-SymbolicValue Memory :: g_sym64 (uint64_t address)
+
+bool Memory :: move (uint64_t dst, uint64_t src, size_t size)
 {
-    return (g_sym32(address + 4).extend(64) << SymbolicValue(8, 32))
-           | g_sym32(address).extend(64);
+    if (size == 0)
+        return true;
+    if ((not mapped(dst, size)) || (not mapped(src, size)))
+        return false;
+
+    size_t done = 0;
+    while (done < size) {
+        size_t offset = (src + done) & FRAME_MASK;
+        size_t bytes  = FRAME_SIZE - offset;
+        if (bytes > size - done)
+            bytes = size - done;
+        if (not lookup(src + done)->concrete(offset, bytes))
+            return false;
+        done += bytes;
+    }
+
+    std::vector <uint8_t> data(size);
+    g_data(src, &(data[0]), size);
+    s_data(dst, &(data[0]), size);
+    return true;
 }
 
-void Memory :: s_sym8 (uint64_t address, SymbolicValue value)
+
+size_t Memory :: scan (uint64_t address, bool backwards, uint8_t value, size_t size)
 {
-    if (value.g_wild()) {
-        #ifdef DEBUGSYM
-        std::cerr << "setting symbolic value at " << std::hex << address << std::endl;
-        #endif
-        symbolic_memory[address] = value & SymbolicValue(8, 0xff);
+    size_t done = 0;
+
+    while (done < size) {
+        uint64_t at    = backwards ? address - done : address + done;
+        Page *   frame = lookup(at);
+        if (frame == NULL)
+            break;
+
+        size_t offset = at & FRAME_MASK;
+        size_t bytes  = backwards ? offset + 1 : FRAME_SIZE - offset;
+        if (bytes > size - done)
+            bytes = size - done;
+
+        const uint8_t * data = frame->g_data(0);
+        if ((not backwards) && (not frame->g_symbolic())) {
+            const uint8_t * found = (const uint8_t *) memchr(&(data[offset]), value, bytes);
+            if (found != NULL)
+                return done + (found - &(data[offset]));
+        }
+        else {
+            for (size_t i = 0; i < bytes; i++) {
+                size_t byte = backwards ? offset - i : offset + i;
+                if ((frame->g_sym(byte) != NULL) || (data[byte] == value))
+                    return done + i;
+            }
+        }
+        done += bytes;
     }
-    else
-        s_byte(address, value.g_uint64() & 0xff);
+
+    return done;
 }
 
-void Memory :: s_sym16 (uint64_t address, SymbolicValue value)
+
+bool Memory :: concrete (uint64_t address, size_t bytes)
 {
-    s_sym8(address + 1, value >> SymbolicValue(8, 8));
-    s_sym8(address, value);
+    size_t offset = address & FRAME_MASK;
+    if (offset + bytes <= FRAME_SIZE)
+        return g_frame(address)->concrete(offset, bytes);
+
+    size_t first = FRAME_SIZE - offset;
+    return    g_frame(address)->concrete(offset, first)
+           && g_frame(address + first)->concrete(0, bytes - first);
 }
 
-void Memory :: s_sym32 (uint64_t address, SymbolicValue value)
+
+// adds piece below the bits already in result
+static void append (SymbolicValue & result, bool & empty, const SymbolicValue & piece)
 {
-    s_sym16(address + 2, value >> SymbolicValue(8, 16));
-    s_sym16(address, value);
+    result = empty ? piece : SymbolicValue::concat(result, piece);
+    empty  = false;
 }
 
-void Memory :: s_sym64 (uint64_t address, SymbolicValue value)
+
+SymbolicValue Memory :: g_sym (uint64_t address, size_t bytes)
 {
-    s_sym32(address + 4, value >> SymbolicValue(8, 32));
-    s_sym32(address, value);
+    // concrete loads, by far the most common, are one read of the frames
+    if (concrete(address, bytes)) {
+        switch (bytes) {
+        case 2  : return SymbolicValue(16, g_word(address));
+        case 4  : return SymbolicValue(32, g_dword(address));
+        default : return SymbolicValue(64, g_qword(address));
+        }
+    }
+
+    // otherwise one concat of the bytes, highest first, with each run of
+    // concrete bytes folded into one constant
+    SymbolicValue result;
+    SymbolicValue run;
+    bool result_empty = true;
+    bool run_empty    = true;
+    for (size_t i = bytes; i > 0; i--) {
+        SymbolicValue byte = g_sym8(address + i - 1);
+        if (byte.g_wild()) {
+            if (not run_empty)
+                append(result, result_empty, run);
+            run_empty = true;
+            append(result, result_empty, byte);
+        }
+        else
+            append(run, run_empty, byte);
+    }
+    if (not run_empty)
+        append(result, result_empty, run);
+
+    return result;
 }
 
-void Memory :: s_page (uint64_t address, Page * page)
+
+void Memory :: s_sym (uint64_t address, const SymbolicValue & value, size_t bytes)
 {
-    this->pages[address] = page;
+    if (not value.g_wild()) {
+        switch (bytes) {
+        case 2  : s_word(address, value.g_uint64());  break;
+        case 4  : s_dword(address, value.g_uint64()); break;
+        default : s_qword(address, value.g_uint64()); break;
+        }
+        return;
+    }
+
+    s_sym8(address, value);
+    for (size_t i = 1; i < bytes; i++)
+        s_sym8(address + i, value >> SymbolicValue(8, i * 8));
+}
+
+
+SymbolicValue Memory :: g_sym8 (uint64_t address)
+{
+    Page * frame = g_frame(address);
+
+    const SymbolicValue * symbolic = frame->g_sym(address & FRAME_MASK);
+    if (symbolic != NULL) {
+        #ifdef DEBUGSYM
+        std::cerr << "reading symbolic byte at " << std::hex << address << std::endl;
+        #endif
+        return *symbolic;
+    }
+    return SymbolicValue(8, frame->g_byte(address & FRAME_MASK));
 }
 
+SymbolicValue Memory :: g_sym16 (uint64_t address) { return g_sym(address, 2); }
+SymbolicValue Memory :: g_sym32 (uint64_t address) { return g_sym(address, 4); }
+SymbolicValue Memory :: g_sym64 (uint64_t address) { return g_sym(address, 8); }
+
+// symbolic bytes are kept 8 bits wide, so they concat without extends
+void Memory :: s_sym8 (uint64_t address, SymbolicValue value)
+{
+    if (value.g_wild()) {
+        #ifdef DEBUGSYM
+        std::cerr << "setting symbolic value at " << std::hex << address << std::endl;
+        #endif
+        dirty_frame(address)->s_sym(address & FRAME_MASK, value.extend(8));
+    }
+    else
+        s_byte(address, value.g_uint64() & 0xff);
+}
+
+void Memory :: s_sym16 (uint64_t address, SymbolicValue value) { s_sym(address, value, 2); }
+void Memory :: s_sym32 (uint64_t address, SymbolicValue value) { s_sym(address, value, 4); }
+void Memory :: s_sym64 (uint64_t address, SymbolicValue value) { s_sym(address, value, 8); }
+
 
 uint8_t Memory :: g_byte (uint64_t address)
 {
-    uint64_t page_address = g_page_address(address, 1);
-    return this->pages[page_address]->g_byte(address - page_address);
+    return g_frame(address)->g_byte(address & FRAME_MASK);
 }
 
 
+// accesses which straddle two frames are split in two, as the frames are
+// not next to each other in our memory
 uint16_t Memory :: g_word (uint64_t address)
 {
-    uint64_t page_address = g_page_address(address, 2);
-    return this->pages[page_address]->g_word(address - page_address);
+    if ((address & FRAME_MASK) > FRAME_SIZE - 2)
+        return g_byte(address) | ((uint16_t) g_byte(address + 1) << 8);
+    return g_frame(address)->g_word(address & FRAME_MASK);
 }
 
 
 uint32_t Memory :: g_dword (uint64_t address)
 {
-    uint64_t page_address = g_page_address(address, 4);
-    return this->pages[page_address]->g_dword(address - page_address);
+    if ((address & FRAME_MASK) > FRAME_SIZE - 4)
+        return g_word(address) | ((uint32_t) g_word(address + 2) << 16);
+    return g_frame(address)->g_dword(address & FRAME_MASK);
 }
 
 
 uint64_t Memory :: g_qword (uint64_t address)
 {
-    try {
-        uint64_t page_address = g_page_address(address, 8);
-        return this->pages[page_address]->g_qword(address - page_address);
-    } catch (std::exception & e) {}
-    // attempt to build uint64_t one byte at a time in case
-    // it is split across multiple pages
-    uint64_t result = 0;
-    for (int i = 0; i < 8; i++) {
-        result |= ((uint64_t) g_byte(address + i)) << (i * 8);
-    }
-    return result;
+    if ((address & FRAME_MASK) > FRAME_SIZE - 8)
+        return g_dword(address) | ((uint64_t) g_dword(address + 4) << 32);
+    return g_frame(address)->g_qword(address & FRAME_MASK);
 }
 
 
 void Memory :: s_byte (uint64_t address, uint8_t value)
 {
-    uint64_t page_address = g_page_address(address, 1);
-    dirty_page(page_address);
-    this->pages[page_address]->s_byte(address - page_address, value);
+    Page * frame = dirty_frame(address);
+    frame->clear_sym(address & FRAME_MASK, 1);
+    frame->s_byte(address & FRAME_MASK, value);
 }
 
 
 void Memory :: s_word (uint64_t address, uint16_t value)
 {
-    uint64_t page_address = g_page_address(address, 2);
-    dirty_page(page_address);
-    this->pages[page_address]->s_word(address - page_address, value);
+    if ((address & FRAME_MASK) > FRAME_SIZE - 2) {
+        s_byte(address,     value);
+        s_byte(address + 1, value >> 8);
+    }
+    else {
+        Page * frame = dirty_frame(address);
+        frame->clear_sym(address & FRAME_MASK, 2);
+        frame->s_word(address & FRAME_MASK, value);
+    }
 }
 
 
 void Memory :: s_dword (uint64_t address, uint32_t value)
 {
-    uint64_t page_address = g_page_address(address, 4);
-    dirty_page(page_address);
-    this->pages[page_address]->s_dword(address - page_address, value);
+    if ((address & FRAME_MASK) > FRAME_SIZE - 4) {
+        s_word(address,     value);
+        s_word(address + 2, value >> 16);
+    }
+    else {
+        Page * frame = dirty_frame(address);
+        frame->clear_sym(address & FRAME_MASK, 4);
+        frame->s_dword(address & FRAME_MASK, value);
+    }
 }
 
 
 void Memory :: s_qword (uint64_t address, uint64_t value)
 {
-    uint64_t page_address = g_page_address(address, 8);
-    dirty_page(page_address);
-    this->pages[page_address]->s_qword(address - page_address, value);
+    if ((address & FRAME_MASK) > FRAME_SIZE - 8) {
+        s_dword(address,     value);
+        s_dword(address + 4, value >> 32);
+    }
+    else {
+        Page * frame = dirty_frame(address);
+        frame->clear_sym(address & FRAME_MASK, 8);
+        frame->s_qword(address & FRAME_MASK, value);
+    }
 }
 
 
+// contiguous frames are listed as one mapping
 std::string Memory :: memmap ()
 {
     std::stringstream ss;
-    std::map <uint64_t, Page *> :: iterator it;
 
-    for (it = pages.begin(); it != pages.end(); it++) {
-        ss << std::hex << it->first
-           << "\t" << "size=" << std::hex << it->second->g_size()
+    std::vector <uint64_t> keys;
+    frames.keys(keys);
+
+    size_t i = 0;
+    while (i < keys.size()) {
+        size_t j = i + 1;
+        while ((j < keys.size()) && (keys[j] == keys[j - 1] + 1))
+            j++;
+        ss << std::hex << (keys[i] << FRAME_BITS)
+           << "\t" << "size=" << std::hex << ((j - i) << FRAME_BITS)
            << std::endl;
+        i = j;
     }
 
     return ss.str();
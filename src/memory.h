@@ -25,39 +25,173 @@
 #include <cstddef>
 
 #include <map>
-#include <unordered_set>
+#include <stdexcept>
 #include <string>
 
 #include "page.h"
+#include "radixmap.h"
 #include "symbolicvalue.h"
 
+#define FRAME_BITS 12
+#define FRAME_SIZE (1 << FRAME_BITS)
+#define FRAME_MASK (FRAME_SIZE - 1)
+
+// frame numbers are looked up 9 bits a level, as in x86 page tables. we map
+// the stack and TLS above 2^48, so the 52 bit frame number takes 6 levels
+#define FRAME_TABLE_BITS 9
+
+// the number of translations kept in a Memory's TLB, a power of 2
+#define TLB_SIZE 64
+
+// a counted reference to a frame. frames are referenced and released along
+// with the RadixMap nodes holding them, so nodes copied for one Memory share
+// their frames with the Memory they were copied from
+class FrameRef {
+    private :
+        Page * page;
+    public :
+        FrameRef () : page(NULL) {}
+        // takes over the caller's reference to page
+        FrameRef (Page * page) : page(page) {}
+        FrameRef (const FrameRef & rhs) : page(rhs.page)
+        {
+            if (page != NULL)
+                page->reference();
+        }
+        FrameRef & operator= (const FrameRef & rhs)
+        {
+            if (rhs.page != NULL)
+                rhs.page->reference();
+            if (page != NULL)
+                page->destroy();
+            page = rhs.page;
+            return *this;
+        }
+        ~FrameRef ()
+        {
+            if (page != NULL)
+                page->destroy();
+        }
+
+        Page * g_page () const { return page; }
+};
+
+typedef RadixMap <FrameRef, FRAME_TABLE_BITS, 64 - FRAME_BITS> FrameTable;
+
+enum {
+    FAULT_READ,
+    FAULT_WRITE,
+    FAULT_FETCH
+};
+
+// a guest access to an address with no frame mapped. this is the only error
+// Memory throws while the guest runs, and the VM making the access is
+// terminated
+class MemoryFault : public std::runtime_error {
+    public :
+        uint64_t address;
+        int      access;
+
+        MemoryFault (uint64_t address, int access);
+};
+
+// a translation from a frame number to its frame. writable is set once the
+// frame and the table nodes leading to it are held by this Memory alone
+struct TlbEntry {
+    uint64_t frame;
+    Page *   page;
+    bool     writable;
+};
+
+/*
+ * The address space of a VM, held as FRAME_SIZE byte frames in a FrameTable
+ * keyed by frame number. Each frame keeps its own symbolic bytes over its
+ * concrete ones. Copying a Memory shares its table with the copy. A frame is
+ * copied, symbolic bytes and all, the first time it is written while shared,
+ * so a write after a fork copies one frame however large the mapping it
+ * falls in. Concrete writes make the bytes they write concrete.
+ *
+ * Recent translations are kept in a direct mapped TLB, so most accesses find
+ * their frame with one compare. A frame is only ever replaced by our own
+ * write, so translations for reading stay good until then. Translations for
+ * writing are dropped whenever the Memory is copied, as its frames are then
+ * shared.
+ *
+ * Mappings are made of whole frames, so the bytes around a mapping which
+ * share its first or last frame can be read and written too.
+ */
 class Memory {
     private :
+        FrameTable frames;
+
+        // copying a Memory changes whether the Memory copied may write its
+        // frames in place
+        mutable TlbEntry tlb[TLB_SIZE];
 
-        // a set is the right data structure to use here, but we keep getting
-        // weird errors at runtime
-        std::map <uint64_t, int> dirty_counter;
-        std::unordered_set <uint64_t> dirty;
-        std::map <uint64_t, Page *> pages;
+        void flush          ();
+        void flush_writable () const;
 
-        std::map <uint64_t, SymbolicValue> symbolic_memory;
+        // the frame holding address, or NULL if it is not mapped
+        Page * lookup      (uint64_t address);
+        // the same, raising a MemoryFault if it is not mapped
+        Page * g_frame     (uint64_t address);
+        // the same, held by this Memory alone so it may be written
+        Page * dirty_frame (uint64_t address);
 
-        uint64_t g_page_address (uint64_t address, int bits);
-        void     dirty_page     (uint64_t address);
+        // loads and stores of 2, 4 or 8 bytes
+        SymbolicValue g_sym (uint64_t address, size_t bytes);
+        void          s_sym (uint64_t address, const SymbolicValue & value, size_t bytes);
     public :
-        Memory () {};
-        Memory (std::map <uint64_t, Page *> pages) : pages(pages) {};
+        Memory () { flush(); };
+        Memory (const Memory & rhs);
+        // maps each page's bytes at its address, and destroys the pages
+        Memory (std::map <uint64_t, Page *> pages);
+
+        Memory & operator= (const Memory & rhs);
 
         void destroy ();
 
         Memory copy ();
 
-        Page *    g_page (uint64_t address) { return pages[address]; }
+        // the number of addresses at which this memory and rhs may hold
+        // different bytes, counting no further than limit. returns limit if
+        // the two are not mapped the same
+        size_t differences (Memory & rhs, size_t limit);
+        // makes every byte that differs from rhs an ite of our byte where the
+        // one bit cond holds and rhs's where it doesn't
+        void   merge       (Memory & rhs, const SymbolicValue & cond);
+
+        // the frame holding address, or NULL. this does not copy a shared
+        // frame, so is only for writing memory no copy has been made of
+        Page *    g_page (uint64_t address) { return lookup(address); }
 
+        // g_data points at address in its frame, with g_data_size bytes
+        // left to the end of the frame
         size_t    g_data_size (uint64_t address);
         uint8_t * g_data      (uint64_t address);
+        // copies up to size bytes at address into data, across frames, and
+        // returns how many were copied before reaching an unmapped frame
+        size_t    g_data      (uint64_t address, uint8_t * data, size_t size);
         void      s_data      (uint64_t address, const uint8_t * data, size_t size);
-        void      s_page      (uint64_t address, Page * page);
+        // maps the frames covering size bytes at address which aren't yet
+        // mapped, zeroed
+        void      map         (uint64_t address, size_t size);
+        // true if every frame covering size bytes at address is mapped
+        bool      mapped      (uint64_t address, size_t size);
+        // true if none of bytes bytes at address are symbolic. they must be
+        // mapped, and may straddle two frames
+        bool      concrete    (uint64_t address, size_t bytes);
+
+        // bulk operations for rep prefixed string instructions. fill writes
+        // the low width bytes of pattern over and over across size bytes at
+        // address. move copies size bytes from src to dst, which must not
+        // overlap. both return false, having changed nothing, if they would
+        // touch an unmapped byte or read a symbolic one
+        bool   fill (uint64_t address, uint64_t pattern, size_t width, size_t size);
+        bool   move (uint64_t dst, uint64_t src, size_t size);
+        // the number of bytes from address, going down if backwards, which
+        // are mapped, concrete and not value, counting no further than size
+        size_t scan (uint64_t address, bool backwards, uint8_t value, size_t size);
 
         SymbolicValue g_sym8  (uint64_t address);
         SymbolicValue g_sym16 (uint64_t address);
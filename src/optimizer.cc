@@ -0,0 +1,558 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "optimizer.h"
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "registers.h"
+#include "symbolicvalue.h"
+
+/*
+ * Every pass sees instructions through these three functions, so they are the
+ * only place that needs to know which operands each kind of instruction reads
+ * and writes.
+ */
+
+// fills src with the operands ins reads and returns how many there are
+static size_t sources (Instruction * ins, InstructionOperand src[3])
+{
+    switch (ins->g_opcode()) {
+    case IOP_ADD :
+    case IOP_AND :
+    case IOP_DIV :
+    case IOP_MOD :
+    case IOP_MUL :
+    case IOP_OR  :
+    case IOP_SHL :
+    case IOP_SHR :
+    case IOP_SUB :
+    case IOP_XOR : {
+        InstructionBinOp * binop = static_cast<InstructionBinOp *>(ins);
+        src[0] = binop->g_lhs();
+        src[1] = binop->g_rhs();
+        return 2;
+    }
+    case IOP_CMPEQ  :
+    case IOP_CMPLES :
+    case IOP_CMPLEU :
+    case IOP_CMPLTS :
+    case IOP_CMPLTU : {
+        InstructionCmpOp * cmpop = static_cast<InstructionCmpOp *>(ins);
+        src[0] = cmpop->g_lhs();
+        src[1] = cmpop->g_rhs();
+        return 2;
+    }
+    case IOP_ASSIGN :
+        src[0] = static_cast<InstructionAssign *>(ins)->g_src();
+        return 1;
+    case IOP_NOT :
+        src[0] = static_cast<InstructionNot *>(ins)->g_src();
+        return 1;
+    case IOP_SIGNEXTEND :
+        src[0] = static_cast<InstructionSignExtend *>(ins)->g_src();
+        return 1;
+    case IOP_LOAD :
+        src[0] = static_cast<InstructionLoad *>(ins)->g_src();
+        return 1;
+    case IOP_STORE :
+        src[0] = static_cast<InstructionStore *>(ins)->g_dst();
+        src[1] = static_cast<InstructionStore *>(ins)->g_src();
+        return 2;
+    case IOP_BRC :
+        src[0] = static_cast<InstructionBrc *>(ins)->g_cond();
+        src[1] = static_cast<InstructionBrc *>(ins)->g_dst();
+        return 2;
+    case IOP_FLAGS :
+        src[0] = static_cast<InstructionFlags *>(ins)->g_lhs();
+        src[1] = static_cast<InstructionFlags *>(ins)->g_rhs();
+        src[2] = static_cast<InstructionFlags *>(ins)->g_result();
+        return 3;
+    }
+    return 0;
+}
+
+
+// sets dst to the variable ins writes, returns false if it writes none. an
+// InstructionFlags writes the flags InstructionFlags::defines gives instead
+static bool destination (Instruction * ins, InstructionOperand & dst)
+{
+    switch (ins->g_opcode()) {
+    case IOP_ADD :
+    case IOP_AND :
+    case IOP_DIV :
+    case IOP_MOD :
+    case IOP_MUL :
+    case IOP_OR  :
+    case IOP_SHL :
+    case IOP_SHR :
+    case IOP_SUB :
+    case IOP_XOR :
+        dst = static_cast<InstructionBinOp *>(ins)->g_dst();
+        return true;
+    case IOP_CMPEQ  :
+    case IOP_CMPLES :
+    case IOP_CMPLEU :
+    case IOP_CMPLTS :
+    case IOP_CMPLTU :
+        dst = static_cast<InstructionCmpOp *>(ins)->g_dst();
+        return true;
+    case IOP_ASSIGN :
+        dst = static_cast<InstructionAssign *>(ins)->g_dst();
+        return true;
+    case IOP_NOT :
+        dst = static_cast<InstructionNot *>(ins)->g_dst();
+        return true;
+    case IOP_SIGNEXTEND :
+        dst = static_cast<InstructionSignExtend *>(ins)->g_dst();
+        return true;
+    case IOP_LOAD :
+        dst = static_cast<InstructionLoad *>(ins)->g_dst();
+        return true;
+    }
+    return false;
+}
+
+
+// a copy of ins reading src in place of its operands
+static Instruction * rebuild (Instruction * ins,
+                              InstructionOperand src[3],
+                              InstructionArena & arena)
+{
+    uint64_t address = ins->g_address();
+    uint32_t size    = ins->g_size();
+    InstructionOperand dst;
+    destination(ins, dst);
+
+    #define REBUILD2(OPCODE, XX) \
+        case OPCODE : return new (arena) XX(address, size, dst, src[0], src[1]);
+    #define REBUILD1(OPCODE, XX) \
+        case OPCODE : return new (arena) XX(address, size, dst, src[0]);
+
+    switch (ins->g_opcode()) {
+    REBUILD2(IOP_ADD,    InstructionAdd)
+    REBUILD2(IOP_AND,    InstructionAnd)
+    REBUILD2(IOP_DIV,    InstructionDiv)
+    REBUILD2(IOP_MOD,    InstructionMod)
+    REBUILD2(IOP_MUL,    InstructionMul)
+    REBUILD2(IOP_OR,     InstructionOr)
+    REBUILD2(IOP_SHL,    InstructionShl)
+    REBUILD2(IOP_SHR,    InstructionShr)
+    REBUILD2(IOP_SUB,    InstructionSub)
+    REBUILD2(IOP_XOR,    InstructionXor)
+    REBUILD2(IOP_CMPEQ,  InstructionCmpEq)
+    REBUILD2(IOP_CMPLES, InstructionCmpLes)
+    REBUILD2(IOP_CMPLEU, InstructionCmpLeu)
+    REBUILD2(IOP_CMPLTS, InstructionCmpLts)
+    REBUILD2(IOP_CMPLTU, InstructionCmpLtu)
+    REBUILD1(IOP_ASSIGN,     InstructionAssign)
+    REBUILD1(IOP_NOT,        InstructionNot)
+    REBUILD1(IOP_SIGNEXTEND, InstructionSignExtend)
+    case IOP_LOAD :
+        return new (arena) InstructionLoad(address, size,
+                                           static_cast<InstructionLoad *>(ins)->g_bits(),
+                                           dst, src[0]);
+    case IOP_STORE :
+        return new (arena) InstructionStore(address, size,
+                                            static_cast<InstructionStore *>(ins)->g_bits(),
+                                            src[0], src[1]);
+    case IOP_BRC :
+        return new (arena) InstructionBrc(address, size, src[0], src[1]);
+    case IOP_FLAGS :
+        return new (arena) InstructionFlags(address, size,
+                                            static_cast<InstructionFlags *>(ins)->g_kind(),
+                                            src[0], src[1], src[2]);
+    }
+
+    #undef REBUILD2
+    #undef REBUILD1
+
+    throw std::runtime_error("rebuild called on instruction without operands: " + ins->str());
+}
+
+
+// the value the VM reads for a constant operand
+static SymbolicValue constant (InstructionOperand & operand)
+{
+    return SymbolicValue(operand.g_bits(), operand.g_value());
+}
+
+
+// computes what ins writes when every operand it reads is a constant, the
+// same way the VM would. returns false if it can't be computed ahead of time
+static bool evaluate (Instruction * ins,
+                      InstructionOperand src[3],
+                      size_t count,
+                      int bits,
+                      SymbolicValue & result)
+{
+    try {
+        SymbolicValue lhs = constant(src[0]);
+        SymbolicValue rhs;
+        if (count == 2)
+            rhs = constant(src[1]);
+
+        switch (ins->g_opcode()) {
+        case IOP_ADD    : result = lhs + rhs; break;
+        case IOP_AND    : result = lhs & rhs; break;
+        case IOP_MUL    : result = lhs * rhs; break;
+        case IOP_OR     : result = lhs | rhs; break;
+        case IOP_SHL    : result = lhs << rhs; break;
+        case IOP_SHR    : result = lhs >> rhs; break;
+        case IOP_SUB    : result = lhs - rhs; break;
+        case IOP_XOR    : result = lhs ^ rhs; break;
+        case IOP_CMPEQ  : result = lhs == rhs; break;
+        case IOP_CMPLES : result = lhs.cmpLes(rhs); break;
+        case IOP_CMPLEU : result = lhs.cmpLeu(rhs); break;
+        case IOP_CMPLTS : result = lhs.cmpLts(rhs); break;
+        case IOP_CMPLTU : result = lhs.cmpLtu(rhs); break;
+        case IOP_NOT    : result = ~lhs; break;
+        // division by zero is left for the VM to run into
+        case IOP_DIV :
+            if (rhs.g_uint64() == 0)
+                return false;
+            result = lhs / rhs;
+            break;
+        case IOP_MOD :
+            if (rhs.g_uint64() == 0)
+                return false;
+            result = lhs % rhs;
+            break;
+        case IOP_SIGNEXTEND :
+            result = lhs.extend(src[0].g_bits()).signExtend(bits);
+            return true;
+        default :
+            return false;
+        }
+        result = result.extend(bits);
+    }
+    catch (std::exception & e) {
+        return false;
+    }
+    return true;
+}
+
+
+// drops what we know of variable id, and of whatever was copied from it
+static void forget (std::map <uint64_t, InstructionOperand> & known, uint64_t id)
+{
+    std::map <uint64_t, InstructionOperand> :: iterator it;
+
+    known.erase(id);
+    for (it = known.begin(); it != known.end(); ) {
+        if ((it->second.g_type() == OPTYPE_VAR) && (it->second.g_id() == id))
+            known.erase(it++);
+        else
+            it++;
+    }
+}
+
+
+/*
+ * Walks the block forwards remembering what each variable was last assigned,
+ * and rewrites reads of it to read that instead. With copies set these are
+ * other variables, otherwise they are constants, and instructions left with
+ * only constant operands are folded.
+ *
+ * A remembered operand may be read in place of a variable at up to its bits
+ * bits. Assigning truncates to the destination's bits, so reading it any
+ * wider would need the zero extension the assign did.
+ */
+static size_t propagate (std::list <Instruction *> & instructions,
+                         InstructionArena & arena,
+                         bool copies)
+{
+    std::map <uint64_t, InstructionOperand> known;
+    std::map <uint64_t, InstructionOperand> :: iterator kit;
+    size_t changes = 0;
+
+    std::list <Instruction *> :: iterator it;
+    for (it = instructions.begin(); it != instructions.end(); it++) {
+        Instruction * ins = *it;
+
+        // the kernel may change any register, and a rep string instruction
+        // changes the ones it works on
+        if ((ins->g_opcode() == IOP_SYSCALL) || (ins->g_opcode() == IOP_REP)) {
+            known.clear();
+            continue;
+        }
+
+        InstructionOperand src[3];
+        size_t count    = sources(ins, src);
+        bool   rewrite  = false;
+        bool   folds    = true;
+        for (size_t i = 0; i < count; i++) {
+            if (src[i].g_type() == OPTYPE_VAR) {
+                kit = known.find(src[i].g_id());
+                if (kit != known.end()) {
+                    InstructionOperand & value = kit->second;
+                    if (value.g_type() == OPTYPE_CONSTANT) {
+                        if (src[i].g_bits() <= 64) {
+                            SymbolicValue v(value.g_bits(), value.g_value());
+                            src[i] = InstructionOperand(OPTYPE_CONSTANT, src[i].g_bits(),
+                                                        v.extend(src[i].g_bits()).g_uint64());
+                            rewrite = true;
+                        }
+                    }
+                    else if (src[i].g_bits() <= value.g_bits()) {
+                        int bits = src[i].g_bits();
+                        src[i] = value;
+                        src[i].s_bits(bits);
+                        rewrite = true;
+                    }
+                }
+            }
+            if (src[i].g_type() != OPTYPE_CONSTANT)
+                folds = false;
+        }
+
+        InstructionOperand dst;
+        bool writes = destination(ins, dst);
+
+        SymbolicValue result;
+        if (    (not copies) && writes && folds
+             && (ins->g_opcode() != IOP_ASSIGN)
+             && (dst.g_bits() <= 64)
+             && evaluate(ins, src, count, dst.g_bits(), result)) {
+            InstructionOperand value(OPTYPE_CONSTANT, dst.g_bits(), result.g_uint64());
+            ins = new (arena) InstructionAssign(ins->g_address(), ins->g_size(), dst, value);
+            *it = ins;
+            changes++;
+        }
+        else if (rewrite) {
+            ins = rebuild(ins, src, arena);
+            *it = ins;
+            changes++;
+        }
+
+        if (ins->g_opcode() == IOP_FLAGS) {
+            int defines = InstructionFlags::defines(static_cast<InstructionFlags *>(ins)->g_kind());
+            for (int slot = SLOT_ZF; slot <= SLOT_OF; slot++) {
+                if (defines & (1 << (slot - SLOT_ZF)))
+                    forget(known, slot);
+            }
+        }
+
+        if (not writes)
+            continue;
+
+        forget(known, dst.g_id());
+
+        if (ins->g_opcode() != IOP_ASSIGN)
+            continue;
+
+        InstructionOperand value = static_cast<InstructionAssign *>(ins)->g_src();
+        if (    copies
+             && (value.g_type() == OPTYPE_VAR)
+             && (value.g_id() != dst.g_id())) {
+            if (value.g_bits() > dst.g_bits())
+                value.s_bits(dst.g_bits());
+            known[dst.g_id()] = value;
+        }
+        else if (    (not copies)
+                  && (value.g_type() == OPTYPE_CONSTANT)
+                  && (dst.g_bits() <= 64)) {
+            SymbolicValue v = constant(value).extend(dst.g_bits());
+            known[dst.g_id()] = InstructionOperand(OPTYPE_CONSTANT, dst.g_bits(),
+                                                   v.g_uint64());
+        }
+    }
+
+    return changes;
+}
+
+
+size_t ConstantFoldingPass :: run (std::list <Instruction *> & instructions,
+                                   InstructionArena & arena)
+{
+    return propagate(instructions, arena, false);
+}
+
+
+size_t CopyPropagationPass :: run (std::list <Instruction *> & instructions,
+                                   InstructionArena & arena)
+{
+    return propagate(instructions, arena, true);
+}
+
+
+size_t DeadStorePass :: run (std::list <Instruction *> & instructions,
+                             InstructionArena & arena)
+{
+    // indexed by variable id. temporaries past the end are dead
+    std::vector <bool> live(SLOT_COUNT, true);
+    size_t removed = 0;
+
+    std::list <Instruction *> :: iterator it = instructions.end();
+    while (it != instructions.begin()) {
+        it--;
+        Instruction * ins = *it;
+
+        // a rep string instruction run in bulk ends the block there
+        if (    (ins->g_opcode() == IOP_SYSCALL)
+             || (ins->g_opcode() == IOP_HLT)
+             || (ins->g_opcode() == IOP_REP)) {
+            for (int i = 0; i < SLOT_COUNT; i++)
+                live[i] = true;
+            continue;
+        }
+
+        // flags written again before they are read are dead, as for any
+        // other variable
+        if (ins->g_opcode() == IOP_FLAGS) {
+            int defines = InstructionFlags::defines(static_cast<InstructionFlags *>(ins)->g_kind());
+            bool needed = false;
+            for (int slot = SLOT_ZF; slot <= SLOT_OF; slot++) {
+                if (defines & (1 << (slot - SLOT_ZF))) {
+                    needed = needed || live[slot];
+                    live[slot] = false;
+                }
+            }
+            if (not needed) {
+                it = instructions.erase(it);
+                removed++;
+                continue;
+            }
+        }
+
+        InstructionOperand dst;
+        if (destination(ins, dst)) {
+            uint64_t id = dst.g_id();
+            if (id >= live.size())
+                live.resize(id + 1, false);
+
+            if (    (not live[id])
+                 && (ins->g_opcode() != IOP_LOAD)
+                 && (ins->g_opcode() != IOP_DIV)
+                 && (ins->g_opcode() != IOP_MOD)) {
+                it = instructions.erase(it);
+                removed++;
+                continue;
+            }
+            live[id] = false;
+        }
+
+        InstructionOperand src[3];
+        size_t count = sources(ins, src);
+        for (size_t i = 0; i < count; i++) {
+            if (src[i].g_type() == OPTYPE_CONSTANT)
+                continue;
+            uint64_t id = src[i].g_id();
+            if (id >= live.size())
+                live.resize(id + 1, false);
+            live[id] = true;
+        }
+    }
+
+    return removed;
+}
+
+
+bool temporaries_defined (const std::list <Instruction *> & instructions)
+{
+    std::vector <bool> written;
+
+    std::list <Instruction *> :: const_iterator it;
+    for (it = instructions.begin(); it != instructions.end(); it++) {
+        InstructionOperand src[3];
+        size_t n = sources(*it, src);
+        for (size_t i = 0; i < n; i++) {
+            if ((src[i].g_type() != OPTYPE_VAR) || (src[i].g_id() < SLOT_COUNT))
+                continue;
+            uint64_t tmp = src[i].g_id() - SLOT_COUNT;
+            if ((tmp >= written.size()) || (not written[tmp]))
+                return false;
+        }
+
+        InstructionOperand dst;
+        if (destination(*it, dst) && (dst.g_id() >= SLOT_COUNT)) {
+            uint64_t tmp = dst.g_id() - SLOT_COUNT;
+            if (tmp >= written.size())
+                written.resize(tmp + 1, false);
+            written[tmp] = true;
+        }
+    }
+    return true;
+}
+
+
+PassManager :: PassManager () : blocks(0), lifted(0), removed(0)
+{
+    add(new ConstantFoldingPass());
+    add(new CopyPropagationPass());
+    add(new DeadStorePass());
+}
+
+
+PassManager :: ~PassManager ()
+{
+    std::vector <Pass *> :: iterator it;
+    for (it = passes.begin(); it != passes.end(); it++)
+        delete *it;
+}
+
+
+void PassManager :: add (Pass * pass)
+{
+    passes.push_back(pass);
+    changes.push_back(0);
+}
+
+
+size_t PassManager :: run (std::list <Instruction *> & instructions,
+                           InstructionArena & arena)
+{
+    size_t before = instructions.size();
+
+    for (int round = 0; round < OPTIMIZER_MAX_ROUNDS; round++) {
+        size_t round_changes = 0;
+        for (size_t i = 0; i < passes.size(); i++) {
+            size_t c = passes[i]->run(instructions, arena);
+            changes[i]    += c;
+            round_changes += c;
+        }
+        if (round_changes == 0)
+            break;
+    }
+
+    blocks++;
+    lifted  += before;
+    removed += before - instructions.size();
+
+    return before - instructions.size();
+}
+
+
+std::string PassManager :: stats ()
+{
+    std::stringstream ss;
+
+    double rate      = lifted ? (100.0 * removed) / lifted : 0.0;
+    double per_block = blocks ? (double) removed / blocks : 0.0;
+
+    ss << "ir passes: " << std::dec << blocks << " blocks, removed "
+       << removed << " of " << lifted << " instructions ("
+       << rate << "%), " << per_block << " per block";
+    for (size_t i = 0; i < passes.size(); i++)
+        ss << ", " << passes[i]->g_name() << " " << changes[i];
+
+    return ss.str();
+}
@@ -0,0 +1,129 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef optimizer_HEADER
+#define optimizer_HEADER
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <inttypes.h>
+
+#include "instruction.h"
+
+// the most times a PassManager runs its passes over one block
+#define OPTIMIZER_MAX_ROUNDS 4
+
+/*
+ * A rewrite of the IR for one block. Passes may replace instructions with new
+ * ones allocated from the arena, or drop them from the list, but never change
+ * what the block does to registers or memory. Instructions taken out of the
+ * list stay in the arena.
+ *
+ * Registers are live when the block ends, temporaries are not.
+ */
+class Pass {
+    public :
+        virtual ~Pass () {}
+
+        virtual const char * g_name () = 0;
+
+        // returns the number of changes made
+        virtual size_t run (std::list <Instruction *> & instructions,
+                            InstructionArena & arena) = 0;
+};
+
+/*
+ * Replaces reads of a variable assigned a constant with the constant, and any
+ * instruction whose operands are all constant with an assign of its result.
+ * The translator's masks for 8 and 16 bit registers are computed like this.
+ */
+class ConstantFoldingPass : public Pass {
+    public :
+        const char * g_name () { return "constant folding"; }
+        size_t run (std::list <Instruction *> & instructions,
+                    InstructionArena & arena);
+};
+
+/*
+ * Replaces reads of a variable assigned from another variable with reads of
+ * that other variable, as long as neither has been written since.
+ */
+class CopyPropagationPass : public Pass {
+    public :
+        const char * g_name () { return "copy propagation"; }
+        size_t run (std::list <Instruction *> & instructions,
+                    InstructionArena & arena);
+};
+
+/*
+ * Removes instructions whose result is written again before it is read, or
+ * never read at all. This is mostly flags, which nearly every arithmetic
+ * instruction sets, and the assigns the other passes leave unused. Loads, divs
+ * and mods may fault, so they are always kept.
+ */
+class DeadStorePass : public Pass {
+    public :
+        const char * g_name () { return "dead stores"; }
+        size_t run (std::list <Instruction *> & instructions,
+                    InstructionArena & arena);
+};
+
+// true if every temporary the block reads is written earlier in the block.
+// the VM doesn't clear scratch between blocks, so reading a temporary before
+// writing it would silently see what an earlier block left there
+bool temporaries_defined (const std::list <Instruction *> & instructions);
+
+/*
+ * Runs a pipeline of passes over each block before it goes in the code cache,
+ * until a round changes nothing or OPTIMIZER_MAX_ROUNDS is reached, and keeps
+ * count of how much IR they took out.
+ */
+class PassManager {
+    private :
+        std::vector <Pass *>   passes;
+        std::vector <uint64_t> changes; // per pass
+
+        uint64_t blocks;
+        uint64_t lifted;  // IR instructions before optimizing
+        uint64_t removed; // IR instructions taken out
+
+        PassManager (PassManager &);
+        void operator = (PassManager &);
+    public :
+        // constant folding, copy propagation and dead stores, in that order
+        PassManager ();
+        ~PassManager ();
+
+        // appends pass to the pipeline, which takes ownership of it
+        void add (Pass * pass);
+
+        // returns the number of IR instructions removed from the block
+        size_t run (std::list <Instruction *> & instructions,
+                    InstructionArena & arena);
+
+        uint64_t g_blocks  () { return blocks;  }
+        uint64_t g_lifted  () { return lifted;  }
+        uint64_t g_removed () { return removed; }
+
+        std::string stats ();
+};
+
+#endif
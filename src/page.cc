@@ -26,11 +26,35 @@
 
 //#define DEBUG
 
+PageSymbols :: PageSymbols (size_t size)
+    : count(0),
+      present((size + PAGE_SYMBOL_CHUNK - 1) / PAGE_SYMBOL_CHUNK, 0),
+      chunks((size + PAGE_SYMBOL_CHUNK - 1) / PAGE_SYMBOL_CHUNK, NULL)
+{}
+
+PageSymbols :: PageSymbols (const PageSymbols & rhs)
+    : count(rhs.count), present(rhs.present), chunks(rhs.chunks.size(), NULL)
+{
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (rhs.chunks[i] == NULL)
+            continue;
+        chunks[i] = new SymbolicValue[PAGE_SYMBOL_CHUNK];
+        for (size_t j = 0; j < PAGE_SYMBOL_CHUNK; j++)
+            chunks[i][j] = rhs.chunks[i][j];
+    }
+}
+
+PageSymbols :: ~PageSymbols ()
+{
+    for (size_t i = 0; i < chunks.size(); i++)
+        delete[] chunks[i];
+}
+
 Page :: Page (size_t size)
 {
     this->size       = size;
     this->data       = new uint8_t [size];
-    this->parent     = NULL;
+    this->symbols    = NULL;
     this->references = 1;
 
     memset(this->data, 0, size);
@@ -40,12 +64,12 @@ Page :: Page (size_t size, uint8_t * data)
 {
     this->size       = size;
     this->data       = new uint8_t [size];
-    this->parent     = NULL;
+    this->symbols    = NULL;
     this->references = 1;
     memcpy(this->data, data, size);
 }
 
-Page * Page :: destroy ()
+void Page :: destroy ()
 {
     #ifdef DEBUG
     std::cerr << "Page::destroy()" << std::endl;
@@ -53,20 +77,17 @@ Page * Page :: destroy ()
 
     if (--references == 0) {
         delete[] data;
-        Page * result = this->parent;
+        delete symbols;
         delete this;
-        return result;
     }
-    else
-        return this->parent;
 }
 
-Page * Page :: make_child ()
+Page * Page :: copy ()
 {
-    Page * child = new Page(size, data);
-    child->set_parent(this);
-    reference();
-    return child;
+    Page * page = new Page(size, data);
+    if (symbols != NULL)
+        page->symbols = new PageSymbols(*symbols);
+    return page;
 }
 
 void Page :: reference ()
@@ -84,11 +105,6 @@ void Page :: check_offset (size_t offset, size_t bytes)
 }
 		
 
-void Page :: set_parent (Page * parent)
-{
-    this->parent = parent;
-}
-
 void Page :: resize (size_t new_size)
 {
     uint8_t * new_data = new uint8_t[new_size];
@@ -169,3 +185,43 @@ void Page :: s_qword (size_t offset, uint64_t value)
     check_offset(offset, 8);
     *((uint64_t *) &(this->data[offset])) = value;
 }
+
+
+void Page :: s_sym (size_t offset, const SymbolicValue & value)
+{
+    check_offset(offset, 1);
+    if (symbols == NULL)
+        symbols = new PageSymbols(size);
+
+    size_t   chunk = offset / PAGE_SYMBOL_CHUNK;
+    uint64_t bit   = 1ULL << (offset % PAGE_SYMBOL_CHUNK);
+    if (symbols->chunks[chunk] == NULL)
+        symbols->chunks[chunk] = new SymbolicValue[PAGE_SYMBOL_CHUNK];
+    if ((symbols->present[chunk] & bit) == 0) {
+        symbols->present[chunk] |= bit;
+        symbols->count++;
+    }
+    symbols->chunks[chunk][offset % PAGE_SYMBOL_CHUNK] = value;
+}
+
+void Page :: clear_sym (size_t offset, size_t bytes)
+{
+    if (symbols == NULL)
+        return;
+
+    for (size_t i = offset; i < offset + bytes; i++) {
+        size_t   chunk = i / PAGE_SYMBOL_CHUNK;
+        uint64_t bit   = 1ULL << (i % PAGE_SYMBOL_CHUNK);
+        if (symbols->present[chunk] & bit) {
+            symbols->present[chunk] &= ~bit;
+            symbols->chunks[chunk][i % PAGE_SYMBOL_CHUNK] = SymbolicValue();
+            symbols->count--;
+        }
+    }
+
+    // a page with no symbolic bytes left goes back to the concrete path
+    if (symbols->count == 0) {
+        delete symbols;
+        symbols = NULL;
+    }
+}
\ No newline at end of file
@@ -21,14 +21,38 @@
 #define page_HEADER
 
 #include <inttypes.h>
+
+#include <atomic>
 #include <cstddef>
+#include <vector>
+
+#include "symbolicvalue.h"
+
+// the bytes of a page holding symbolic values. present has a bit for each
+// byte, and the values of each PAGE_SYMBOL_CHUNK bytes its word covers are
+// kept in a chunk made when one of them first becomes symbolic
+#define PAGE_SYMBOL_CHUNK 64
+
+class PageSymbols {
+    public :
+        size_t count;
+        std::vector <uint64_t>        present;
+        std::vector <SymbolicValue *> chunks;
+
+        PageSymbols (size_t size);
+        PageSymbols (const PageSymbols & rhs);
+        ~PageSymbols ();
+};
 
 class Page {
     private :
         uint8_t * data;
         size_t size;
-        Page * parent;
-        int references;
+        // NULL while no byte of the page is symbolic
+        PageSymbols * symbols;
+        // pages are shared between forked VMs, which may run on different
+        // threads. a page referenced more than once must not be written
+        std::atomic <int> references;
         
         void check_offset (size_t offset, size_t bytes);
         
@@ -36,11 +60,12 @@ class Page {
         Page (size_t size);
         Page (size_t size, uint8_t * data);
         
-        Page * destroy    ();
-        Page * make_child ();
-        
-        void set_parent (Page * parent);
-        void reference  ();
+        void   destroy   ();
+        // a new page, referenced once, holding a copy of this page's data
+        Page * copy      ();
+
+        void reference      ();
+        int  g_references   () { return references; }
         
         void resize (size_t new_size);
 
@@ -62,6 +87,36 @@ class Page {
         void s_word  (size_t offset, uint16_t value);
         void s_dword (size_t offset, uint32_t value);
         void s_qword (size_t offset, uint64_t value);
+
+        // symbolic bytes sit over the page's concrete bytes, which are left
+        // as they were when the byte became symbolic
+        bool g_symbolic () { return symbols != NULL; }
+
+        // the symbolic value of the byte at offset, or NULL if it is concrete
+        const SymbolicValue * g_sym (size_t offset)
+        {
+            if (    (symbols == NULL)
+                 || ((symbols->present[offset / PAGE_SYMBOL_CHUNK]
+                      & (1ULL << (offset % PAGE_SYMBOL_CHUNK))) == 0))
+                return NULL;
+            return &(symbols->chunks[offset / PAGE_SYMBOL_CHUNK][offset % PAGE_SYMBOL_CHUNK]);
+        }
+
+        // true if none of bytes bytes at offset are symbolic
+        bool concrete (size_t offset, size_t bytes)
+        {
+            if (symbols == NULL)
+                return true;
+            for (size_t i = offset; i < offset + bytes; i++) {
+                if (symbols->present[i / PAGE_SYMBOL_CHUNK] & (1ULL << (i % PAGE_SYMBOL_CHUNK)))
+                    return false;
+            }
+            return true;
+        }
+
+        void s_sym     (size_t offset, const SymbolicValue & value);
+        // makes bytes bytes at offset concrete again
+        void clear_sym (size_t offset, size_t bytes);
 };
 
 #endif
@@ -0,0 +1,95 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "path.h"
+
+Path :: Path (const Path & rhs)
+{
+    last = rhs.last;
+    if (last != NULL)
+        last->references++;
+}
+
+Path & Path :: operator= (const Path & rhs)
+{
+    if (rhs.last != NULL)
+        rhs.last->references++;
+    release(last);
+    last = rhs.last;
+    return *this;
+}
+
+Path :: ~Path ()
+{
+    release(last);
+}
+
+// iterative, as paths can be far longer than the stack is deep
+void Path :: release (PathNode * node)
+{
+    while ((node != NULL) && (--node->references == 0)) {
+        PathNode * previous = node->previous;
+        delete node;
+        node = previous;
+    }
+}
+
+void Path :: push_back (const std::pair <SymbolicValue, SymbolicValue> & assertion)
+{
+    // the new node takes over our reference to last
+    last = new PathNode(assertion, last);
+}
+
+void Path :: truncate (size_t length)
+{
+    PathNode * node = last;
+    while ((node != NULL) && (node->length > length))
+        node = node->previous;
+
+    if (node != NULL)
+        node->references++;
+    release(last);
+    last = node;
+}
+
+size_t Path :: shared (const Path & rhs) const
+{
+    const PathNode * node     = last;
+    const PathNode * rhs_node = rhs.last;
+
+    while ((node != NULL) && (node->length > rhs.size()))
+        node = node->previous;
+    while ((rhs_node != NULL) && (rhs_node->length > size()))
+        rhs_node = rhs_node->previous;
+    while (node != rhs_node) {
+        node     = node->previous;
+        rhs_node = rhs_node->previous;
+    }
+
+    return node == NULL ? 0 : node->length;
+}
+
+std::vector <std::pair <SymbolicValue, SymbolicValue>> Path :: g_assertions (size_t from) const
+{
+    std::vector <std::pair <SymbolicValue, SymbolicValue>> result;
+
+    for (const PathNode * node = last; (node != NULL) && (node->length > from); node = node->previous)
+        result.push_back(node->assertion);
+
+    return std::vector <std::pair <SymbolicValue, SymbolicValue>> (result.rbegin(), result.rend());
+}
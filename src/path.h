@@ -0,0 +1,81 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef path_HEADER
+#define path_HEADER
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "symbolicvalue.h"
+
+// one assertion on a path, and the path before it. nodes never change once
+// made, so any number of paths, on any threads, may end in the same node
+class PathNode {
+    public :
+        const std::pair <SymbolicValue, SymbolicValue> assertion;
+        PathNode * const previous;
+        // the number of assertions on the path ending in this node
+        const size_t length;
+        std::atomic <int> references;
+
+        PathNode (const std::pair <SymbolicValue, SymbolicValue> & assertion,
+                  PathNode * previous)
+            : assertion(assertion), previous(previous),
+              length(previous == NULL ? 1 : previous->length + 1),
+              references(1) {}
+};
+
+/*
+ * The assertions a VM has made on its way to where it is, oldest first, each
+ * a value and the target it must equal. A Path is a persistent list: copying
+ * one copies a pointer, and a VM forked from another shares every assertion
+ * made before the fork with it.
+ */
+class Path {
+    private :
+        PathNode * last;
+
+        static void release (PathNode * node);
+
+    public :
+        Path () : last(NULL) {}
+        Path (const Path & rhs);
+        Path & operator= (const Path & rhs);
+        ~Path ();
+
+        size_t size  () const { return last == NULL ? 0 : last->length; }
+        bool   empty () const { return last == NULL; }
+
+        void push_back (const std::pair <SymbolicValue, SymbolicValue> & assertion);
+
+        // drops all but the first length assertions
+        void truncate (size_t length);
+
+        // the number of assertions at the start of this path which rhs shares
+        // with it, found by walking back to the last node both end in. paths
+        // made apart from each other share nothing, even if equal
+        size_t shared (const Path & rhs) const;
+
+        // the assertions from index from on, oldest first
+        std::vector <std::pair <SymbolicValue, SymbolicValue>> g_assertions (size_t from = 0) const;
+};
+
+#endif
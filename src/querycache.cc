@@ -0,0 +1,138 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "querycache.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <z3++.h>
+
+static bool expr_before (const SymbolicValue & a, const SymbolicValue & b)
+{
+    return a.g_expr() < b.g_expr();
+}
+
+static bool expr_same (const SymbolicValue & a, const SymbolicValue & b)
+{
+    return a.g_expr() == b.g_expr();
+}
+
+QueryCache :: QueryCache (SymbolicContext & sc)
+    : sc(sc), hits(0), model_hits(0), misses(0) {}
+
+QueryCache :: ~QueryCache ()
+{
+    std::list <Entry> :: iterator it;
+    for (it = entries.begin(); it != entries.end(); it++)
+        delete it->model;
+}
+
+void QueryCache :: sort (std::vector <SymbolicValue> & constraints)
+{
+    std::sort(constraints.begin(), constraints.end(), expr_before);
+    constraints.erase(std::unique(constraints.begin(), constraints.end(), expr_same),
+                      constraints.end());
+}
+
+bool QueryCache :: subset (const std::vector <SymbolicValue> & a,
+                           const std::vector <SymbolicValue> & b)
+{
+    if (a.size() > b.size())
+        return false;
+    return std::includes(b.begin(), b.end(), a.begin(), a.end(), expr_before);
+}
+
+bool QueryCache :: satisfies (z3::model * model,
+                              const std::vector <SymbolicValue> & constraints,
+                              const std::vector <SymbolicValue> & known)
+{
+    z3::context & c   = sc.g_context();
+    z3::expr      one = c.bv_val(1, 1);
+
+    std::vector <SymbolicValue> :: const_iterator it;
+    std::vector <SymbolicValue> :: const_iterator kt = known.begin();
+    for (it = constraints.begin(); it != constraints.end(); it++) {
+        while ((kt != known.end()) && expr_before(*kt, *it))
+            kt++;
+        if ((kt != known.end()) && expr_same(*kt, *it))
+            continue;
+
+        z3::expr holds = model->eval(it->context(sc) == one, true);
+        if (not eq(holds, c.bool_val(true)))
+            return false;
+    }
+    return true;
+}
+
+int QueryCache :: lookup (const std::vector <SymbolicValue> & constraints)
+{
+    std::list <Entry> :: iterator it;
+    for (it = entries.begin(); it != entries.end(); it++) {
+        if ((it->model == NULL) && subset(it->constraints, constraints)) {
+            hits++;
+            return QUERY_UNSAT;
+        }
+        if ((it->model != NULL) && subset(constraints, it->constraints)) {
+            hits++;
+            return QUERY_SAT;
+        }
+    }
+
+    for (it = entries.begin(); it != entries.end(); it++) {
+        if (it->model == NULL)
+            continue;
+        if (satisfies(it->model, constraints, it->constraints)) {
+            model_hits++;
+            z3::model model = *(it->model);
+            insert(constraints, &model);
+            return QUERY_SAT;
+        }
+    }
+
+    misses++;
+    return QUERY_UNKNOWN;
+}
+
+void QueryCache :: insert (const std::vector <SymbolicValue> & constraints,
+                           const z3::model * model)
+{
+    Entry entry;
+    entry.constraints = constraints;
+    entry.model       = model ? new z3::model(*model) : NULL;
+    entries.push_front(entry);
+
+    if (entries.size() > QUERY_CACHE_SIZE) {
+        delete entries.back().model;
+        entries.pop_back();
+    }
+}
+
+std::string QueryCache :: stats ()
+{
+    std::stringstream ss;
+
+    uint64_t lookups = hits + model_hits + misses;
+    double   rate    = lookups ? (100.0 * (hits + model_hits)) / lookups : 0.0;
+
+    ss << "query cache: " << entries.size() << " entries, "
+       << hits << " hits, " << model_hits << " model hits, "
+       << misses << " misses, " << rate << "% hit rate";
+
+    return ss.str();
+}
@@ -0,0 +1,102 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef querycache_HEADER
+#define querycache_HEADER
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <inttypes.h>
+
+#include "symbolicvalue.h"
+
+namespace z3 { class model; }
+
+// the most queries a QueryCache remembers
+#define QUERY_CACHE_SIZE 128
+
+enum {
+    QUERY_UNKNOWN,
+    QUERY_SAT,
+    QUERY_UNSAT
+};
+
+/*
+ * Remembers the answers to earlier solver queries, so forked VMs asking
+ * nearly the same question don't all go to z3.
+ *
+ * A query is a set of constraints, each a wild one bit SymbolicValue which
+ * must be 1, sorted with QueryCache::sort. A query is known unsat if it is a
+ * superset of an unsat query, and known sat if it is a subset of a sat query.
+ * Failing that, the models of earlier sat queries are tried against the
+ * constraints they were not found for, and the first one that satisfies them
+ * all answers the query.
+ *
+ * Models live in the SymbolicContext's z3 context, which must outlive the
+ * cache.
+ */
+class QueryCache {
+    private :
+        struct Entry {
+            std::vector <SymbolicValue> constraints;
+            z3::model *                 model; // NULL if unsat
+        };
+
+        SymbolicContext & sc;
+        std::list <Entry> entries; // most recent first
+
+        uint64_t hits;
+        uint64_t model_hits;
+        uint64_t misses;
+
+        // true if every constraint in a is in b
+        static bool subset (const std::vector <SymbolicValue> & a,
+                            const std::vector <SymbolicValue> & b);
+
+        // true if model makes every constraint not in known hold
+        bool satisfies (z3::model * model,
+                        const std::vector <SymbolicValue> & constraints,
+                        const std::vector <SymbolicValue> & known);
+
+        QueryCache (QueryCache &);
+        void operator = (QueryCache &);
+    public :
+        QueryCache (SymbolicContext & sc);
+        ~QueryCache ();
+
+        // puts constraints in the order lookup and insert expect, and drops
+        // duplicates
+        static void sort (std::vector <SymbolicValue> & constraints);
+
+        // returns QUERY_SAT, QUERY_UNSAT or QUERY_UNKNOWN
+        int  lookup (const std::vector <SymbolicValue> & constraints);
+        // model is the model z3 found for constraints, or NULL if unsat
+        void insert (const std::vector <SymbolicValue> & constraints,
+                     const z3::model * model);
+
+        uint64_t g_hits       () { return hits;       }
+        uint64_t g_model_hits () { return model_hits; }
+        uint64_t g_misses     () { return misses;     }
+        size_t   g_size       () { return entries.size(); }
+
+        std::string stats ();
+};
+
+#endif
@@ -0,0 +1,247 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef radixmap_HEADER
+#define radixmap_HEADER
+
+#include <inttypes.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// the default number of key bits taken a level
+#define RADIX_BITS 4
+
+/*
+ * A persistent map from keys of KEY_BITS bits to values, kept as a radix tree
+ * taking BITS bits of the key a level, the first level taking what is left
+ * over. Copying a RadixMap shares its whole tree. Nodes are reference
+ * counted, and a write copies only the nodes on the way to its key which
+ * some other map still holds, so a copy costs O(1) however large the map
+ * is, and each write after it O(LEVELS).
+ *
+ * Wider levels make for fewer of them to walk, but more to copy when a
+ * shared node is written.
+ *
+ * Maps sharing nodes may be read and written from different threads, as long
+ * as each map is only used by one thread at a time.
+ */
+template <typename T, int BITS = RADIX_BITS, int KEY_BITS = 64>
+class RadixMap {
+    private :
+        static const int FANOUT = 1 << BITS;
+        static const int MASK   = FANOUT - 1;
+        static const int LEVELS = (KEY_BITS + BITS - 1) / BITS;
+
+        struct Block {
+            std::atomic <int> references;
+            Block () : references(1) {}
+        };
+
+        // levels 0 to LEVELS - 2 hold nodes, the last level holds leaves
+        struct Node : Block {
+            Block * children[FANOUT];
+            Node () { for (int i = 0; i < FANOUT; i++) children[i] = NULL; }
+        };
+
+        struct Leaf : Block {
+            // bit i is set if values[i] is in the map
+            uint64_t present[(FANOUT + 63) / 64];
+            T        values[FANOUT];
+            Leaf () { for (int i = 0; i < (FANOUT + 63) / 64; i++) present[i] = 0; }
+
+            bool has   (int i) const { return present[i / 64] & (1ULL << (i % 64)); }
+            void mark  (int i) { present[i / 64] |=  (1ULL << (i % 64)); }
+            void clear (int i) { present[i / 64] &= ~(1ULL << (i % 64)); }
+        };
+
+        Block * root;
+        size_t  count;
+
+        static int index (uint64_t key, int level)
+        {
+            return (key >> (BITS * (LEVELS - 1 - level))) & MASK;
+        }
+
+        static void release (Block * block, int level)
+        {
+            if ((block == NULL) || (--block->references > 0))
+                return;
+            if (level == LEVELS - 1) {
+                delete (Leaf *) block;
+                return;
+            }
+            Node * node = (Node *) block;
+            for (int i = 0; i < FANOUT; i++)
+                release(node->children[i], level + 1);
+            delete node;
+        }
+
+        // makes sure the block in slot is held by this map alone, creating or
+        // copying it as needed, and returns it
+        static Block * unshare (Block ** slot, int level)
+        {
+            Block * block = *slot;
+
+            if (level == LEVELS - 1) {
+                if (block == NULL)
+                    *slot = new Leaf();
+                else if (block->references > 1) {
+                    Leaf * leaf = new Leaf();
+                    for (int i = 0; i < (FANOUT + 63) / 64; i++)
+                        leaf->present[i] = ((Leaf *) block)->present[i];
+                    for (int i = 0; i < FANOUT; i++)
+                        leaf->values[i] = ((Leaf *) block)->values[i];
+                    *slot = leaf;
+                    release(block, level);
+                }
+                return *slot;
+            }
+
+            if (block == NULL)
+                *slot = new Node();
+            else if (block->references > 1) {
+                Node * node = new Node();
+                for (int i = 0; i < FANOUT; i++) {
+                    node->children[i] = ((Node *) block)->children[i];
+                    if (node->children[i] != NULL)
+                        node->children[i]->references++;
+                }
+                *slot = node;
+                release(block, level);
+            }
+            return *slot;
+        }
+
+        // the leaf key belongs in, made writable, creating it if needed
+        Leaf * leaf (uint64_t key)
+        {
+            Block ** slot = &root;
+            for (int level = 0; level < LEVELS - 1; level++) {
+                Node * node = (Node *) unshare(slot, level);
+                slot = &(node->children[index(key, level)]);
+            }
+            return (Leaf *) unshare(slot, LEVELS - 1);
+        }
+
+        static void keys (const Block * block, int level, uint64_t prefix,
+                          std::vector <uint64_t> & result)
+        {
+            if (block == NULL)
+                return;
+            if (level == LEVELS - 1) {
+                const Leaf * leaf = (const Leaf *) block;
+                for (int i = 0; i < FANOUT; i++) {
+                    if (leaf->has(i))
+                        result.push_back(prefix | i);
+                }
+                return;
+            }
+            const Node * node = (const Node *) block;
+            int shift = BITS * (LEVELS - 1 - level);
+            for (int i = 0; i < FANOUT; i++)
+                keys(node->children[i], level + 1,
+                     prefix | ((uint64_t) i << shift), result);
+        }
+
+    public :
+        RadixMap () : root(NULL), count(0) {}
+
+        RadixMap (const RadixMap & rhs) : root(rhs.root), count(rhs.count)
+        {
+            if (root != NULL)
+                root->references++;
+        }
+
+        RadixMap & operator= (const RadixMap & rhs)
+        {
+            if (rhs.root != NULL)
+                rhs.root->references++;
+            release(root, 0);
+            root  = rhs.root;
+            count = rhs.count;
+            return *this;
+        }
+
+        ~RadixMap () { release(root, 0); }
+
+        size_t size  () const { return count; }
+        bool   empty () const { return count == 0; }
+
+        // the value at key, or NULL if key is not in the map. the pointer is
+        // good until the map is next written
+        const T * find (uint64_t key) const
+        {
+            const Block * block = root;
+            for (int level = 0; level < LEVELS - 1; level++) {
+                if (block == NULL)
+                    return NULL;
+                block = ((const Node *) block)->children[index(key, level)];
+            }
+            if (block == NULL)
+                return NULL;
+
+            const Leaf * leaf = (const Leaf *) block;
+            int i = index(key, LEVELS - 1);
+            if (not leaf->has(i))
+                return NULL;
+            return &(leaf->values[i]);
+        }
+
+        // the value at key, in nodes held by this map alone so it may be
+        // changed in place, or NULL if key is not in the map
+        T * writable (uint64_t key)
+        {
+            if (find(key) == NULL)
+                return NULL;
+            return &(leaf(key)->values[index(key, LEVELS - 1)]);
+        }
+
+        void set (uint64_t key, const T & value)
+        {
+            Leaf * l = leaf(key);
+            int i = index(key, LEVELS - 1);
+            if (not l->has(i)) {
+                l->mark(i);
+                count++;
+            }
+            l->values[i] = value;
+        }
+
+        // emptied nodes are left in the tree, and freed with it
+        void erase (uint64_t key)
+        {
+            if (find(key) == NULL)
+                return;
+            Leaf * l = leaf(key);
+            int i = index(key, LEVELS - 1);
+            l->clear(i);
+            l->values[i] = T();
+            count--;
+        }
+
+        // appends every key in the map to result, in order
+        void keys (std::vector <uint64_t> & result) const
+        {
+            keys(root, 0, 0, result);
+        }
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "registers.h"
+
+#include <unordered_map>
+
+static const char * register_names [SLOT_COUNT] = {
+    "UD_R_RAX",  "UD_R_RCX",  "UD_R_RDX",  "UD_R_RBX",
+    "UD_R_RSP",  "UD_R_RBP",  "UD_R_RSI",  "UD_R_RDI",
+    "UD_R_R8",   "UD_R_R9",   "UD_R_R10",  "UD_R_R11",
+    "UD_R_R12",  "UD_R_R13",  "UD_R_R14",  "UD_R_R15",
+    "UD_R_RIP",  "UD_R_FS",
+    "UD_R_XMM0", "UD_R_XMM1", "UD_R_XMM2",  "UD_R_XMM3",
+    "UD_R_XMM4", "UD_R_XMM5", "UD_R_XMM6",  "UD_R_XMM7",
+    "UD_R_XMM8", "UD_R_XMM9", "UD_R_XMM10", "UD_R_XMM11",
+    "UD_R_XMM12", "UD_R_XMM13", "UD_R_XMM14", "UD_R_XMM15",
+    "ZF", "SF", "CF", "OF", "DF"
+};
+
+
+static std::unordered_map <std::string, int> build_slots ()
+{
+    std::unordered_map <std::string, int> slots;
+    for (int i = 0; i < SLOT_COUNT; i++)
+        slots[register_names[i]] = i;
+    return slots;
+}
+
+
+int register_slot (const std::string & name)
+{
+    // built whole the first time through, which C++11 makes thread safe, and
+    // only ever read after that
+    static const std::unordered_map <std::string, int> slots = build_slots();
+
+    std::unordered_map <std::string, int> :: const_iterator it = slots.find(name);
+    if (it == slots.end())
+        return -1;
+    return it->second;
+}
+
+
+const char * register_name (int slot)
+{
+    if ((slot < 0) || (slot >= SLOT_COUNT))
+        return "";
+    return register_names[slot];
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef registers_HEADER
+#define registers_HEADER
+
+#include <string>
+
+#include <inttypes.h>
+
+#include "symbolicvalue.h"
+
+/*
+ * Architectural state lives in fixed slots so the VM can index it directly.
+ * The translator resolves register names to these slots when it creates an
+ * InstructionOperand, and temporaries are numbered from SLOT_COUNT upwards.
+ * Slots follow udis86's register order.
+ */
+
+#define SLOT_RAX    0
+#define SLOT_RCX    1
+#define SLOT_RDX    2
+#define SLOT_RBX    3
+#define SLOT_RSP    4
+#define SLOT_RBP    5
+#define SLOT_RSI    6
+#define SLOT_RDI    7
+#define SLOT_R8     8
+#define SLOT_R9     9
+#define SLOT_R10    10
+#define SLOT_R11    11
+#define SLOT_R12    12
+#define SLOT_R13    13
+#define SLOT_R14    14
+#define SLOT_R15    15
+#define SLOT_RIP    16
+#define SLOT_FS     17
+#define SLOT_XMM0   18
+#define SLOT_XMM1   19
+#define SLOT_XMM2   20
+#define SLOT_XMM3   21
+#define SLOT_XMM4   22
+#define SLOT_XMM5   23
+#define SLOT_XMM6   24
+#define SLOT_XMM7   25
+#define SLOT_XMM8   26
+#define SLOT_XMM9   27
+#define SLOT_XMM10  28
+#define SLOT_XMM11  29
+#define SLOT_XMM12  30
+#define SLOT_XMM13  31
+#define SLOT_XMM14  32
+#define SLOT_XMM15  33
+#define SLOT_ZF     34
+#define SLOT_SF     35
+#define SLOT_CF     36
+#define SLOT_OF     37
+#define SLOT_DF     38
+#define SLOT_COUNT  39
+
+// returns the slot for a register name as used by the translator (ex:
+// "UD_R_RAX", "ZF"), or -1 if the name is not an architectural register
+int register_slot (const std::string & name);
+const char * register_name (int slot);
+
+class RegisterFile {
+    private :
+        SymbolicValue registers[SLOT_COUNT];
+    public :
+        RegisterFile () {}
+        RegisterFile (const RegisterFile & rhs) { *this = rhs; }
+
+        RegisterFile & operator = (const RegisterFile & rhs)
+        {
+            for (int i = 0; i < SLOT_COUNT; i++)
+                registers[i] = rhs.registers[i];
+            return *this;
+        }
+
+        SymbolicValue & operator [] (int slot) { return registers[slot]; }
+};
+
+#endif
@@ -42,16 +42,47 @@ void help (std::string name)
     std::cout << "   Loader: You must specify a loader" << std::endl;
     std::cout << "   --elf    attempts to load the binary directly from the elf" << std::endl;
     std::cout << "   --lx86   forks the x86 linux process, breaks at entry, and loads" << std::endl;
+    std::cout << "   Options:" << std::endl;
+    std::cout << "   --block  translate and execute whole basic blocks at a time" << std::endl;
+    std::cout << "   --merge  merge paths which meet at the same instruction" << std::endl;
+    std::cout << "   --no-opt execute the IR exactly as translated, without passes" << std::endl;
+    std::cout << "   --no-concrete  keep every value symbolic, even when all inputs are concrete" << std::endl;
+    std::cout << "   --no-jit interpret every block, never compiling hot ones" << std::endl;
+    std::cout << "   --threads <n>  run every path to completion on n threads" << std::endl;
+    std::cout << "   --search <s>   how to pick the next path to run, one of" << std::endl;
+    std::cout << "                  rr (default), dfs, bfs, random, coverage" << std::endl;
+    std::cout << "   --slice <n>    run a path for n units before switching paths" << std::endl;
+    std::cout << "   --slice-by <u> the unit --slice counts, one of" << std::endl;
+    std::cout << "                  blocks (default), instructions, branches" << std::endl;
 }
 
 int main (int argc, char * argv[])
 {
     int loader_type = 0;
+    int block_mode = 0;
+    int merge_mode = 0;
+    int no_optimize = 0;
+    int no_concrete = 0;
+    int no_jit = 0;
+    int threads = 0;
+    std::string search = "rr";
+    int slice = 0;
+    std::string slice_by = "blocks";
     int option_index = 0;
 
     struct option options [] = {
-        {"lx86", no_argument, &loader_type, 1},
-        {"elf",  no_argument, &loader_type, 2}
+        {"lx86",  no_argument, &loader_type, 1},
+        {"elf",   no_argument, &loader_type, 2},
+        {"block", no_argument, &block_mode,  1},
+        {"merge", no_argument, &merge_mode,  1},
+        {"no-opt", no_argument, &no_optimize, 1},
+        {"no-concrete", no_argument, &no_concrete, 1},
+        {"no-jit", no_argument, &no_jit, 1},
+        {"threads", required_argument, NULL, 't'},
+        {"search",  required_argument, NULL, 's'},
+        {"slice",    required_argument, NULL, 'n'},
+        {"slice-by", required_argument, NULL, 'u'},
+        {0, 0, 0, 0}
     };
 
     while (true) {
@@ -59,6 +90,18 @@ int main (int argc, char * argv[])
         if (c == -1) break;
 
         switch(c) {
+            case 't' :
+                threads = atoi(optarg);
+                break;
+            case 's' :
+                search = optarg;
+                break;
+            case 'n' :
+                slice = atoi(optarg);
+                break;
+            case 'u' :
+                slice_by = optarg;
+                break;
             case '?' :
                 help(argv[0]);
                 return -1;
@@ -70,6 +113,26 @@ int main (int argc, char * argv[])
         return -1;
     }
 
+    Searcher * searcher;
+    if      (search == "rr")       searcher = new RoundRobinSearcher();
+    else if (search == "dfs")      searcher = new DepthFirstSearcher();
+    else if (search == "bfs")      searcher = new BreadthFirstSearcher();
+    else if (search == "random")   searcher = new RandomPathSearcher();
+    else if (search == "coverage") searcher = new CoverageSearcher();
+    else {
+        help(argv[0]);
+        return -1;
+    }
+
+    int slice_unit;
+    if      (slice_by == "blocks")       slice_unit = QUANTUM_BLOCKS;
+    else if (slice_by == "instructions") slice_unit = QUANTUM_INSTRUCTIONS;
+    else if (slice_by == "branches")     slice_unit = QUANTUM_BRANCHES;
+    else {
+        help(argv[0]);
+        return -1;
+    }
+
     Loader * loader;
 
     if (loader_type == 1)
@@ -78,10 +141,21 @@ int main (int argc, char * argv[])
         loader = Elf::Get(argv[optind]);
 
     Engine engine(loader);
+    engine.g_code_cache()->s_block_mode(block_mode == 1);
+    engine.g_code_cache()->s_optimize(no_optimize == 0);
+    engine.g_code_cache()->s_concrete(no_concrete == 0);
+    engine.g_code_cache()->s_jit(no_jit == 0);
+    engine.s_searcher(searcher);
+    engine.s_quantum(slice_unit, slice);
+    engine.s_merge_mode(merge_mode == 1);
 
     std::cout << std::endl;
 
-    while (true) {
+    if (threads > 0) {
+        engine.run(threads);
+    }
+
+    while (threads == 0) {
         int c = getc(stdin);
         if (c == 'a') { while (true) engine.step(); }
         if (c == 'd') { for (int i = 0; i < 8; i++) engine.step(); }
@@ -95,6 +169,10 @@ int main (int argc, char * argv[])
         //if (c == 'v') vm.debug_variables();
     }
 
+    std::cout << engine.stats() << std::endl;
+    std::cout << engine.g_code_cache()->stats() << std::endl;
+    std::cout << engine.solver_stats() << std::endl;
+
     delete loader;
 
     return 0;
@@ -0,0 +1,378 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "solver.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <z3++.h>
+
+// no constraint, at the end of a group's list
+#define NO_CONSTRAINT ((size_t) -1)
+
+uint64_t LeafGroups :: find (uint64_t leaf) const
+{
+    uint64_t parent = leaves.find(leaf)->second.parent;
+    while (parent != leaf) {
+        leaf   = parent;
+        parent = leaves.find(leaf)->second.parent;
+    }
+    return leaf;
+}
+
+void LeafGroups :: append (Leaf & root, size_t head, size_t tail)
+{
+    if (root.head == NO_CONSTRAINT)
+        root.head = head;
+    else
+        next[root.tail] = head;
+    root.tail = tail;
+}
+
+void LeafGroups :: cut (Leaf & root, size_t tail)
+{
+    if (tail == NO_CONSTRAINT)
+        root.head = NO_CONSTRAINT;
+    else
+        next[tail] = NO_CONSTRAINT;
+    root.tail = tail;
+}
+
+void LeafGroups :: push (const std::vector <uint64_t> & vars)
+{
+    size_t index = next.size();
+    marks.push_back(changes.size());
+    next.push_back(NO_CONSTRAINT);
+
+    if (vars.empty())
+        return;
+
+    uint64_t root = 0;
+    for (size_t i = 0; i < vars.size(); i++) {
+        if (leaves.count(vars[i]) == 0) {
+            Leaf leaf = {vars[i], 1, NO_CONSTRAINT, NO_CONSTRAINT};
+            leaves[vars[i]] = leaf;
+            Change change = {CHANGE_LEAF, vars[i], 0, 0};
+            changes.push_back(change);
+        }
+
+        uint64_t other = find(vars[i]);
+        if (i == 0) {
+            root = other;
+            continue;
+        }
+        if (other == root)
+            continue;
+
+        // the smaller group goes below the larger
+        Leaf * big   = &(leaves[root]);
+        Leaf * small = &(leaves[other]);
+        if (big->size < small->size) {
+            std::swap(big, small);
+            std::swap(root, other);
+        }
+        Change change = {CHANGE_LINK, other, root, big->tail};
+        changes.push_back(change);
+        small->parent = root;
+        big->size += small->size;
+        if (small->head != NO_CONSTRAINT)
+            append(*big, small->head, small->tail);
+    }
+
+    Leaf & group = leaves[root];
+    Change change = {CHANGE_MEMBER, root, 0, group.tail};
+    changes.push_back(change);
+    append(group, index, index);
+}
+
+void LeafGroups :: pop ()
+{
+    while (changes.size() > marks.back()) {
+        const Change & change = changes.back();
+        switch (change.kind) {
+        case CHANGE_LEAF :
+            leaves.erase(change.leaf);
+            break;
+        case CHANGE_LINK : {
+            // the linked group kept its own list, so only the root's is cut
+            Leaf & small = leaves[change.leaf];
+            Leaf & big   = leaves[change.other];
+            small.parent = change.leaf;
+            big.size -= small.size;
+            cut(big, change.tail);
+            break;
+        }
+        case CHANGE_MEMBER :
+            cut(leaves[change.leaf], change.tail);
+            break;
+        }
+        changes.pop_back();
+    }
+    marks.pop_back();
+    next.pop_back();
+}
+
+void LeafGroups :: members (const std::vector <uint64_t> & vars,
+                            std::vector <size_t> & result) const
+{
+    std::vector <uint64_t> roots;
+    for (size_t i = 0; i < vars.size(); i++) {
+        // a leaf no constraint depends on has no group
+        if (leaves.count(vars[i]) == 0)
+            continue;
+        uint64_t root = find(vars[i]);
+        if (std::find(roots.begin(), roots.end(), root) != roots.end())
+            continue;
+        roots.push_back(root);
+
+        size_t index = leaves.find(root)->second.head;
+        while (index != NO_CONSTRAINT) {
+            result.push_back(index);
+            index = next[index];
+        }
+    }
+}
+
+Solver :: Solver ()
+    : wild(0), falsified(0), checks(0), path_constraints(0), sliced_constraints(0)
+{
+    c      = new z3::context();
+    sc     = new SymbolicContext(*c);
+    solver = new z3::solver(*c);
+    cache  = new QueryCache(*sc);
+    guards = new std::vector <z3::expr>;
+}
+
+Solver :: ~Solver ()
+{
+    // every z3 object must be gone before its context
+    delete cache;
+    path = Path();
+    constraints.clear();
+    delete guards;
+    delete sc;
+    delete solver;
+    delete c;
+}
+
+SymbolicValue Solver :: constraint (const SymbolicValue & value,
+                                    const SymbolicValue & target)
+{
+    int bits = value.g_bits();
+    if (target.g_bits() > bits)
+        bits = target.g_bits();
+
+    return value.extend(bits) == target.extend(bits);
+}
+
+void Solver :: push (const std::pair <SymbolicValue, SymbolicValue> & assertion)
+{
+    SymbolicValue holds = constraint(assertion.first, assertion.second);
+    size_t        index = constraints.size();
+
+    constraints.push_back(holds);
+    solver->push();
+
+    std::stringstream name;
+    name << "path_" << index;
+    guards->push_back(c->bool_const(name.str().c_str()));
+
+    if (holds.g_wild()) {
+        std::vector <uint64_t> vars = holds.g_vars();
+        groups.push(vars);
+        if (vars.empty())
+            loose.push_back(index);
+        wild++;
+        solver->add(z3::implies(guards->back(), holds.context(*sc) == c->bv_val(1, 1)));
+    }
+    else {
+        groups.push(std::vector <uint64_t> ());
+        if (holds.g_uint64() == 0)
+            falsified++;
+    }
+}
+
+void Solver :: pop ()
+{
+    const SymbolicValue & holds = constraints.back();
+    if (holds.g_wild())
+        wild--;
+    else if (holds.g_uint64() == 0)
+        falsified--;
+    if ((not loose.empty()) && (loose.back() == constraints.size() - 1))
+        loose.pop_back();
+
+    groups.pop();
+    guards->pop_back();
+    solver->pop();
+    constraints.pop_back();
+}
+
+void Solver :: slice (const SymbolicValue & holds, std::vector <size_t> & query)
+{
+    path_constraints += wild;
+
+    // a query on the path alone needs all of it
+    if (not holds.g_wild()) {
+        for (size_t i = 0; i < constraints.size(); i++) {
+            if (constraints[i].g_wild())
+                query.push_back(i);
+        }
+        return;
+    }
+
+    groups.members(holds.g_vars(), query);
+    query.insert(query.end(), loose.begin(), loose.end());
+    sliced_constraints += wild - query.size();
+}
+
+void Solver :: sync (const Path & assertions)
+{
+    size_t shared = path.shared(assertions);
+
+    while (constraints.size() > shared)
+        pop();
+
+    std::vector <std::pair <SymbolicValue, SymbolicValue>> fresh = assertions.g_assertions(shared);
+    for (size_t i = 0; i < fresh.size(); i++)
+        push(fresh[i]);
+
+    path = assertions;
+}
+
+bool Solver :: check (const SymbolicValue & holds)
+{
+    if ((not holds.g_wild()) && (holds.g_uint64() == 0))
+        return false;
+    if (falsified > 0)
+        return false;
+
+    std::vector <size_t> slice_indexes;
+    slice(holds, slice_indexes);
+
+    std::vector <SymbolicValue> query;
+    for (size_t i = 0; i < slice_indexes.size(); i++)
+        query.push_back(constraints[slice_indexes[i]]);
+    if (holds.g_wild())
+        query.push_back(holds);
+    QueryCache::sort(query);
+
+    int cached = cache->lookup(query);
+    if (cached != QUERY_UNKNOWN)
+        return cached == QUERY_SAT;
+
+    z3::expr_vector assumptions(*c);
+    for (size_t i = 0; i < slice_indexes.size(); i++)
+        assumptions.push_back((*guards)[slice_indexes[i]]);
+    if (holds.g_wild())
+        assumptions.push_back(holds.context(*sc) == c->bv_val(1, 1));
+
+    checks++;
+    if (solver->check(assumptions) == z3::sat) {
+        z3::model model = solver->get_model();
+        cache->insert(query, &model);
+        return true;
+    }
+
+    cache->insert(query, NULL);
+    return false;
+}
+
+bool Solver :: satisfiable (const Path & assertions,
+                            const SymbolicValue & value,
+                            const SymbolicValue & target)
+{
+    sync(assertions);
+    return check(constraint(value, target));
+}
+
+void Solver :: branch (const Path & assertions,
+                       const SymbolicValue & condition,
+                       bool & can_true,
+                       bool & can_false)
+{
+    sync(assertions);
+
+    // these are the same constraints the VM asserts for each direction, so
+    // the query for the direction taken is the next path's own constraints,
+    // and its model is cached for that path's next branch
+    can_true  = check(constraint(condition, SymbolicValue(1, 1)));
+    can_false = check(constraint(condition, SymbolicValue(1, 0)));
+}
+
+std::string Solver :: stats ()
+{
+    return stats(std::vector <Solver *> (1, this));
+}
+
+std::string Solver :: stats (const std::vector <Solver *> & solvers)
+{
+    std::stringstream ss;
+
+    uint64_t checks             = 0;
+    uint64_t path_constraints   = 0;
+    uint64_t sliced_constraints = 0;
+
+    size_t   sc_size    = 0;
+    uint64_t sc_hits    = 0;
+    uint64_t sc_misses  = 0;
+    uint64_t sc_evicted = 0;
+
+    size_t   cache_size       = 0;
+    uint64_t cache_hits       = 0;
+    uint64_t cache_model_hits = 0;
+    uint64_t cache_misses     = 0;
+
+    std::vector <Solver *> :: const_iterator it;
+    for (it = solvers.begin(); it != solvers.end(); it++) {
+        checks             += (*it)->checks;
+        path_constraints   += (*it)->path_constraints;
+        sliced_constraints += (*it)->sliced_constraints;
+
+        sc_size    += (*it)->sc->g_size();
+        sc_hits    += (*it)->sc->g_hits();
+        sc_misses  += (*it)->sc->g_misses();
+        sc_evicted += (*it)->sc->g_evicted();
+
+        cache_size       += (*it)->cache->g_size();
+        cache_hits       += (*it)->cache->g_hits();
+        cache_model_hits += (*it)->cache->g_model_hits();
+        cache_misses     += (*it)->cache->g_misses();
+    }
+
+    ss << "solver: " << std::dec << checks << " checks, sliced away "
+       << sliced_constraints << " of " << path_constraints
+       << " path constraints" << std::endl;
+
+    uint64_t lookups = sc_hits + sc_misses;
+    double   rate    = lookups ? (100.0 * sc_hits) / lookups : 0.0;
+
+    ss << "z3 translation cache: " << sc_size << " entries, "
+       << sc_hits << " hits, " << sc_misses << " misses, "
+       << rate << "% hit rate, " << sc_evicted << " evicted" << std::endl;
+
+    lookups = cache_hits + cache_model_hits + cache_misses;
+    rate    = lookups ? (100.0 * (cache_hits + cache_model_hits)) / lookups : 0.0;
+
+    ss << "query cache: " << cache_size << " entries, "
+       << cache_hits << " hits, " << cache_model_hits << " model hits, "
+       << cache_misses << " misses, " << rate << "% hit rate";
+
+    return ss.str();
+}
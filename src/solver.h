@@ -0,0 +1,171 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef solver_HEADER
+#define solver_HEADER
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <inttypes.h>
+
+#include "path.h"
+#include "querycache.h"
+#include "symbolicvalue.h"
+
+namespace z3 { class expr; class solver; }
+
+/*
+ * Groups the constraints of a path by the wild leaves they share, kept up to
+ * date as constraints are pushed and popped, so finding the constraints which
+ * share a leaf with a query costs the size of their groups, not of the path.
+ *
+ * Leaves are held in a union-find without path compression, linked by size,
+ * so every change it makes can be logged and undone. pop rolls the log back to
+ * where the last push began. Each group's constraints are a list threaded
+ * through next, kept at the group's root.
+ */
+class LeafGroups {
+    private :
+        struct Leaf {
+            uint64_t parent;
+            size_t   size; // leaves in the group, at its root
+            size_t   head; // first and last constraint in the group, at its root
+            size_t   tail;
+        };
+
+        enum { CHANGE_LEAF, CHANGE_LINK, CHANGE_MEMBER };
+        struct Change {
+            int      kind;
+            uint64_t leaf;  // the leaf added, the root linked below other, or
+                            // the root a constraint joined
+            uint64_t other;
+            size_t   tail;  // the tail of the group being added to, before
+        };
+
+        std::unordered_map <uint64_t, Leaf> leaves;
+        std::vector <size_t> next;
+        std::vector <Change> changes;
+        std::vector <size_t> marks; // where each constraint's changes start
+
+        uint64_t find   (uint64_t leaf) const;
+        void     append (Leaf & root, size_t head, size_t tail);
+        void     cut    (Leaf & root, size_t tail);
+
+    public :
+        // adds constraint number next.size(), which depends on vars
+        void push (const std::vector <uint64_t> & vars);
+        void pop  ();
+
+        // appends to result every constraint sharing a group with one of vars
+        void members (const std::vector <uint64_t> & vars, std::vector <size_t> & result) const;
+};
+
+/*
+ * Answers satisfiability questions about a VM's path. One Solver is owned by
+ * the Engine and kept for the whole run, so its z3 context and solver live as
+ * long as every expression translated into them, and z3 keeps what it learns
+ * from one check for the next.
+ *
+ * The Solver holds the constraints of the last path it was asked about. When
+ * asked about a path, it drops back to the longest prefix it shares with the
+ * path it holds and builds constraints only for what is new. Paths forked
+ * from each other share their prefix, so finding it only walks back over
+ * what differs. Each constraint is added to z3 in a scope of its own, guarded
+ * by a literal, so z3 keeps what it learned about the shared prefix too.
+ *
+ * A query only sends z3 the slice of the path that can affect it: the path's
+ * constraints are grouped by the wild leaves they share, and only the guards
+ * of the groups sharing a leaf with the queried constraint are assumed. This
+ * assumes the path itself is satisfiable, which holds for every path a VM
+ * takes, since each branch direction was checked before it was taken.
+ *
+ * Every query goes through a QueryCache first, and only reaches z3 if the
+ * cache can't answer it from earlier results.
+ *
+ * Expressions are translated through one SymbolicContext, so each node is
+ * translated into z3 once for the life of the Solver.
+ */
+class Solver {
+    private :
+        z3::context     * c;
+        SymbolicContext * sc;
+        z3::solver      * solver;
+        QueryCache      * cache;
+
+        // the path we hold, the one bit constraint each of its assertions
+        // asserts, and the literal guarding each constraint in z3
+        Path                          path;
+        std::vector <SymbolicValue>   constraints;
+        std::vector <z3::expr>      * guards;
+        LeafGroups                    groups;
+        // wild constraints with no leaves, which can't be placed in a group
+        std::vector <size_t>          loose;
+        // wild constraints, and constraints which are concretely false
+        size_t                        wild;
+        size_t                        falsified;
+
+        uint64_t checks;
+        uint64_t path_constraints;
+        uint64_t sliced_constraints;
+
+        void push (const std::pair <SymbolicValue, SymbolicValue> & assertion);
+        void pop  ();
+        void sync (const Path & assertions);
+
+        // adds to query the indexes of the synced path's constraints which
+        // share a wild leaf with holds, directly or through other constraints
+        void slice (const SymbolicValue & holds, std::vector <size_t> & query);
+
+        // can the synced path and constraint hold together
+        bool check (const SymbolicValue & constraint);
+
+    public :
+        Solver ();
+        ~Solver ();
+
+        // the one bit value == target, with the narrower side zero extended
+        static SymbolicValue constraint (const SymbolicValue & value,
+                                         const SymbolicValue & target);
+
+        // can value == target hold under the given assertions
+        bool satisfiable (const Path & assertions,
+                          const SymbolicValue & value,
+                          const SymbolicValue & target);
+
+        // sets can_true/can_false to whether condition may be 1/0 under the
+        // given assertions
+        void branch (const Path & assertions,
+                     const SymbolicValue & condition,
+                     bool & can_true,
+                     bool & can_false);
+
+        uint64_t g_checks () { return checks;             }
+        uint64_t g_sliced () { return sliced_constraints; }
+
+        SymbolicContext * g_symbolic_context () { return sc;    }
+        QueryCache      * g_query_cache      () { return cache; }
+
+        std::string stats ();
+        // the totals of every solver in solvers, such as one per thread
+        static std::string stats (const std::vector <Solver *> & solvers);
+};
+
+#endif
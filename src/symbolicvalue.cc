@@ -25,128 +25,245 @@
 
 #include <z3++.h>
 
-SymbolicValue :: SymbolicValue ()
+/****************
+* SymbolicNode  *
+****************/
+
+SymbolicNode :: SymbolicNode (int type, int bits, const UInt & value, uint64_t var,
+                              SymbolicNode * lhs, SymbolicNode * rhs)
+    : type(type), bits(bits), value(value), var(var), lhs(lhs), rhs(rhs), references(1)
 {
-    lhs   = NULL;
-    rhs   = NULL;
-    type  = SVT_NONE;
-    wild  = false;
-    value = UInt(0);
-    ssa   = SymbolicValueSSA::get().next();
+    hash = type;
+    hash = (hash * 31) + bits;
+    hash = (hash * 31) + value.g_value64();
+    hash = (hash * 31) + (value >> UInt(8, 64)).g_value64();
+    hash = (hash * 31) + var;
+    hash = (hash * 31) + (size_t) lhs;
+    hash = (hash * 31) + (size_t) rhs;
 }
 
-SymbolicValue :: SymbolicValue (int bits, uint64_t value64)
+void SymbolicNode :: release ()
 {
-    lhs   = NULL;
-    rhs   = NULL;
-    type  = SVT_CONSTANT;
-    wild  = false;
-    value = UInt(bits, value64);
-    ssa   = SymbolicValueSSA::get().next();
+    // only the last reference needs its table shard's lock
+    int count = references.load();
+    while (count > 1) {
+        if (references.compare_exchange_weak(count, count - 1))
+            return;
+    }
+
+    if (not SymbolicNodeTable::get().release(this))
+        return;
+
+    if (lhs) lhs->release();
+    if (rhs) rhs->release();
+    delete this;
 }
 
-SymbolicValue :: SymbolicValue (int bits)
+bool SymbolicNodeTable :: NodeEqual :: operator () (const SymbolicNode * a,
+                                                   const SymbolicNode * b) const
+{
+    // children are interned, so comparing their pointers compares their
+    // whole subexpressions
+    return    (a->type  == b->type)
+           && (a->bits  == b->bits)
+           && (a->value.g_bits() == b->value.g_bits())
+           && (a->value == b->value)
+           && (a->var   == b->var)
+           && (a->lhs   == b->lhs)
+           && (a->rhs   == b->rhs);
+}
+
+SymbolicNode * SymbolicNodeTable :: intern (int type, int bits, const UInt & value,
+                                            uint64_t var,
+                                            SymbolicNode * lhs, SymbolicNode * rhs)
+{
+    SymbolicNode key(type, bits, value, var, lhs, rhs);
+    Shard & s = shard(key.hash);
+
+    std::lock_guard <std::mutex> guard(s.lock);
+
+    std::unordered_set <SymbolicNode *, NodeHash, NodeEqual> :: iterator it;
+    it = s.nodes.find(&key);
+    if (it != s.nodes.end()) {
+        (*it)->reference();
+        return *it;
+    }
+
+    if (lhs) lhs->reference();
+    if (rhs) rhs->reference();
+    SymbolicNode * node = new SymbolicNode(type, bits, value, var, lhs, rhs);
+    s.nodes.insert(node);
+    return node;
+}
+
+bool SymbolicNodeTable :: release (SymbolicNode * node)
+{
+    Shard & s = shard(node->hash);
+
+    std::lock_guard <std::mutex> guard(s.lock);
+
+    // intern may have picked the node up again since the caller looked
+    if (--(node->references) > 0)
+        return false;
+
+    s.nodes.erase(node);
+    return true;
+}
+
+size_t SymbolicNodeTable :: g_size ()
 {
-    lhs   = NULL;
-    rhs   = NULL;
-    type  = SVT_CONSTANT;
-    wild  = true;
-    value = UInt(bits);
-    ssa   = SymbolicValueSSA::get().next();
+    size_t size = 0;
+    for (size_t i = 0; i < SYMBOLIC_NODE_SHARDS; i++) {
+        std::lock_guard <std::mutex> guard(shards[i].lock);
+        size += shards[i].nodes.size();
+    }
+    return size;
 }
 
+/****************
+* SymbolicValue *
+****************/
+
+SymbolicValue :: SymbolicValue ()
+    : type(SVT_NONE), value(UInt(0)), node(NULL) {}
+
+SymbolicValue :: SymbolicValue (int bits, uint64_t value64)
+    : type(SVT_CONSTANT), value(UInt(bits, value64)), node(NULL) {}
+
 SymbolicValue :: SymbolicValue (const UInt & value)
+    : type(SVT_CONSTANT), value(value), node(NULL) {}
+
+SymbolicValue :: SymbolicValue (int bits)
+    : type(SVT_VAR), value(UInt(bits))
 {
-    lhs   = NULL;
-    rhs   = NULL;
-    type  = SVT_CONSTANT;
-    wild  = false;
-    this->value = value;
-    ssa   = SymbolicValueSSA::get().next();
+    node = SymbolicNodeTable::get().intern(SVT_VAR, bits, UInt(),
+                                           SymbolicValueSSA::get().next(),
+                                           NULL, NULL);
 }
 
+// takes over the caller's reference to node
+SymbolicValue :: SymbolicValue (SymbolicNode * node)
+    : type(node->type), value(UInt(node->bits)), node(node) {}
+
 SymbolicValue :: SymbolicValue (int type,
                                 const SymbolicValue & lhss,
                                 const SymbolicValue & rhss)
 {
+    int bits = lhss.g_bits();
+    switch (type) {
+    case SVT_CMPLES :
+    case SVT_CMPLEU :
+    case SVT_CMPLTS :
+    case SVT_CMPLTU :
+    case SVT_EQ     : bits = 1; break;
+    case SVT_CONCAT : bits = lhss.g_bits() + rhss.g_bits();
+    }
+
+    SymbolicNode * lhs = lhss.g_node();
+    SymbolicNode * rhs = rhss.g_node();
+
     this->type  = type;
-    wild  = true;
-    value = UInt(lhss.g_bits());
-    ssa   = SymbolicValueSSA::get().next();
-    this->lhs = new SymbolicValue();
-    this->rhs = new SymbolicValue();
-    *(this->lhs) = lhss;
-    *(this->rhs) = rhss;
+    this->value = UInt(bits);
+    this->node  = SymbolicNodeTable::get().intern(type, bits, UInt(), 0, lhs, rhs);
+
+    if (lhs) lhs->release();
+    if (rhs) rhs->release();
+}
+
+SymbolicValue :: SymbolicValue (const SymbolicValue & rhs)
+    : type(rhs.type), value(rhs.value), node(rhs.node)
+{
+    if (node)
+        node->reference();
 }
 
 SymbolicValue :: ~SymbolicValue ()
 {
-    //std::cerr << "destructor for " << str() << std::endl;
-    //if (lhs != NULL)
-        //delete lhs;
-    //if (rhs != NULL)
-        //delete rhs;
+    if (node)
+        node->release();
 }
 
 SymbolicValue & SymbolicValue :: operator = (const SymbolicValue & rhs)
 {
-    if (this == &rhs) {
-        std::cerr << "duplicate SymbolicValue" << std::endl;
-        return *this;
-    }
-
-    if (this->lhs)
-        delete this->lhs;
-    if (this->rhs)
-        delete this->rhs;
+    // reference first, in case rhs is or lives under this value
+    if (rhs.node)
+        rhs.node->reference();
+    if (node)
+        node->release();
 
     type  = rhs.type;
-    wild  = rhs.wild;
     value = rhs.value;
-    ssa   = rhs.ssa;
-    if (rhs.lhs) {
-        this->lhs = new SymbolicValue();
-        this->rhs = new SymbolicValue();
-        *(this->lhs) = (const SymbolicValue) *(rhs.lhs);
-        *(this->rhs) = (const SymbolicValue) *(rhs.rhs);
-    }
-    else {
-        this->lhs = NULL;
-        this->rhs = NULL;
-    }
+    node  = rhs.node;
     
     return *this;
 }
-/*
-SymbolicValue & SymbolicValue :: operator = (SymbolicValue & rhs)
+
+SymbolicNode * SymbolicValue :: g_node () const
 {
-    *this = (const SymbolicValue) rhs;
-    return *this;
+    if (node) {
+        node->reference();
+        return node;
+    }
+    if (type == SVT_NONE)
+        return NULL;
+    return SymbolicNodeTable::get().intern(SVT_CONSTANT, g_bits(), value, 0, NULL, NULL);
 }
-*/
-const std::string SymbolicValue :: str () const
+
+bool SymbolicValue :: identical (const SymbolicValue & rhs) const
 {
-    std::stringstream ss;
+    if (node || rhs.node)
+        return node == rhs.node;
+    return    (type == rhs.type)
+           && (g_bits() == rhs.g_bits())
+           && (value == rhs.value);
+}
 
-    if (type == SVT_NONE)
-        ss << "(NONE)";
-    else if (type == SVT_CONSTANT) {
-        ss << "(" << g_bits() << " {" << ssa << "} ";
-        if (wild) ss << "wild)";
-        else ss << value.str() << ")";
-    }
-    else if (type == SVT_NOT) {
-        ss << "~(" << lhs->str() << ")";
+std::vector <uint64_t> SymbolicValue :: g_vars () const
+{
+    std::vector <uint64_t> vars;
+    if (node == NULL)
+        return vars;
+
+    // the expression is a DAG, so visit each shared node once
+    std::unordered_set <const SymbolicNode *> seen;
+    std::vector <const SymbolicNode *> todo;
+    todo.push_back(node);
+    while (not todo.empty()) {
+        const SymbolicNode * next = todo.back();
+        todo.pop_back();
+        if (not seen.insert(next).second)
+            continue;
+        if (next->type == SVT_VAR)
+            vars.push_back(next->var);
+        if (next->lhs) todo.push_back(next->lhs);
+        if (next->rhs) todo.push_back(next->rhs);
     }
+
+    return vars;
+}
+
+const std::string SymbolicValue :: str (const SymbolicNode * node)
+{
+    std::stringstream ss;
+
+    if (node->type == SVT_CONSTANT)
+        ss << "(" << node->bits << " " << node->value.str() << ")";
+    else if (node->type == SVT_VAR)
+        ss << "(" << node->bits << " {" << node->var << "} wild)";
+    else if (node->type == SVT_NOT)
+        ss << "~(" << str(node->lhs) << ")";
+    else if (node->type == SVT_ZEXT)
+        ss << "(" << node->bits << " zext " << str(node->lhs) << ")";
     else {
-        ss << "(" << g_bits() << " " << lhs->str();
-        switch (type) {
+        ss << "(" << node->bits << " " << str(node->lhs);
+        switch (node->type) {
         case SVT_ADD    : ss << " + "; break;
         case SVT_AND    : ss << " & "; break;
         case SVT_CMPLES : ss << " <=S "; break;
         case SVT_CMPLEU : ss << " <=U "; break;
         case SVT_CMPLTS : ss << " <S "; break;
         case SVT_CMPLTU : ss << " <U "; break;
+        case SVT_CONCAT : ss << " ++ "; break;
         case SVT_DIV    : ss << " / "; break;
         case SVT_EQ     : ss << " == "; break;
         case SVT_MOD    : ss << " % "; break;
@@ -160,41 +277,103 @@ const std::string SymbolicValue :: str () const
         default :
             std::stringstream ss;
 
-            ss << "invalid type for SymbolicValue::str() => " << type;
+            ss << "invalid type for SymbolicValue::str() => " << node->type;
             throw std::runtime_error(ss.str());
         }
-        ss << rhs->str() << ")";
+        ss << str(node->rhs) << ")";
     }
     
     return ss.str();
 }
 
-const SymbolicValue SymbolicValue :: extend (int bits) const {
-    SymbolicValue result = *this;
-    result.ssa = SymbolicValueSSA::get().next();
-    result.value = result.value.extend(bits);
-    return result;
+const std::string SymbolicValue :: str () const
+{
+    if (type == SVT_NONE)
+        return "(NONE)";
+    else if (node == NULL) {
+        std::stringstream ss;
+        ss << "(" << g_bits() << " " << value.str() << ")";
+        return ss.str();
+    }
+    return str(node);
+}
+
+const SymbolicValue SymbolicValue :: extend (int bits) const
+{
+    if (node == NULL) {
+        SymbolicValue result = *this;
+        result.value = value.extend(bits);
+        return result;
+    }
+
+    if (bits == node->bits)
+        return *this;
+
+    // zext of a widening zext is just a zext of the original value
+    SymbolicNode * src = node;
+    if ((src->type == SVT_ZEXT) && (src->bits > src->lhs->bits))
+        src = src->lhs;
+    if (bits == src->bits) {
+        src->reference();
+        return SymbolicValue(src);
+    }
+
+    return SymbolicValue(SymbolicNodeTable::get().intern(SVT_ZEXT, bits, UInt(), 0, src, NULL));
 }
 
 const SymbolicValue SymbolicValue :: signExtend (int bits) const
 {
-    SymbolicValue result = *this;
-    result.ssa = SymbolicValueSSA::get().next();
-    result.value = result.value.sign_extend(bits);
-    return result;
+    if (node == NULL) {
+        SymbolicValue result = *this;
+        result.value = value.sign_extend(bits);
+        return result;
+    }
+
+    if (bits <= node->bits)
+        return extend(bits);
+
+    SymbolicNode * extra = SymbolicNodeTable::get().intern(SVT_CONSTANT, 32,
+                                                           UInt(32, bits - node->bits),
+                                                           0, NULL, NULL);
+    SymbolicNode * sext  = SymbolicNodeTable::get().intern(SVT_SEXT, bits, UInt(), 0,
+                                                           node, extra);
+    extra->release();
+    return SymbolicValue(sext);
 }
 
 
 SymbolicValue SymbolicValue :: operator~ () const
 {
-    if (not wild) return SymbolicValue(~value);
+    if (node == NULL) return SymbolicValue(~value);
     else return SymbolicValue(SVT_NOT, *this, SymbolicValue());
 }
 
+SymbolicValue SymbolicValue :: ite (const SymbolicValue & cond,
+                                    const SymbolicValue & t,
+                                    const SymbolicValue & f)
+{
+    if (not cond.g_wild())
+        return cond.g_uint64() ? t : f.extend(t.g_bits());
+    if (t.identical(f))
+        return t;
+
+    SymbolicValue mask = cond.signExtend(t.g_bits());
+    return (mask & t) | (~mask & f.extend(t.g_bits()));
+}
+
+SymbolicValue SymbolicValue :: concat (const SymbolicValue & high,
+                                       const SymbolicValue & low)
+{
+    int bits = high.g_bits() + low.g_bits();
+    if ((not high.g_wild()) && (not low.g_wild()))
+        return (high.extend(bits) << SymbolicValue(8, low.g_bits())) | low.extend(bits);
+    return SymbolicValue(SVT_CONCAT, high, low);
+}
+
 #define SVOPERATOR(OPER, ENUM) \
 SymbolicValue SymbolicValue :: operator OPER (const SymbolicValue & rhs) const \
 {                                                                                 \
-    if ((not this->wild) && (not rhs.wild))                                       \
+    if ((not this->g_wild()) && (not rhs.g_wild()))                               \
         return SymbolicValue(this->g_value() OPER rhs.g_value());                 \
     else                                                                          \
         return SymbolicValue(ENUM, *this, rhs);                                   \
@@ -214,19 +393,19 @@ SVOPERATOR(^,  SVT_XOR)
 
 SymbolicValue SymbolicValue :: operator == (const SymbolicValue & rhs) const
 {
-    if ((not this->wild) && (not rhs.wild)) {
+    if ((not this->g_wild()) && (not rhs.g_wild())) {
         if (this->g_value() == rhs.g_value())
             return SymbolicValue(1, 1);
         else
             return SymbolicValue(1, 0);
     }
     else
-        return SymbolicValue(SVT_EQ, *this, rhs);                                                    \
+        return SymbolicValue(SVT_EQ, *this, rhs);
 }
 
 SymbolicValue SymbolicValue :: cmpLes (const SymbolicValue & rhs) const
 {
-    if ((not this->wild) && (not rhs.wild)) {
+    if ((not this->g_wild()) && (not rhs.g_wild())) {
         if (value.cmpLes(rhs.g_value()))
             return SymbolicValue(1, 1);
         else
@@ -238,7 +417,7 @@ SymbolicValue SymbolicValue :: cmpLes (const SymbolicValue & rhs) const
 
 SymbolicValue SymbolicValue :: cmpLeu (const SymbolicValue & rhs) const
 {
-    if ((not this->wild) && (not rhs.wild)) {
+    if ((not this->g_wild()) && (not rhs.g_wild())) {
         if (value <= rhs.value)
             return SymbolicValue(1, 1);
         else
@@ -250,7 +429,7 @@ SymbolicValue SymbolicValue :: cmpLeu (const SymbolicValue & rhs) const
 
 SymbolicValue SymbolicValue :: cmpLts (const SymbolicValue & rhs) const
 {
-    if ((not this->wild) && (not rhs.wild)) {
+    if ((not this->g_wild()) && (not rhs.g_wild())) {
         if (value.cmpLts(rhs.g_value()))
             return SymbolicValue(1, 1);
         else
@@ -262,7 +441,7 @@ SymbolicValue SymbolicValue :: cmpLts (const SymbolicValue & rhs) const
 
 SymbolicValue SymbolicValue :: cmpLtu (const SymbolicValue & rhs) const
 {
-    if ((not this->wild) && (not rhs.wild)) {
+    if ((not this->g_wild()) && (not rhs.g_wild())) {
         if (value < rhs.value)
             return SymbolicValue(1, 1);
         else
@@ -310,125 +489,191 @@ z3::expr z3shr (z3::expr const & a, int b)
     return z3shr(a, a.ctx().num_val(b, a.get_sort()));
 }
 
-std::string SymbolicValue :: z3_name () const
+z3::expr SymbolicValue :: contextCmp (z3::context & c, const z3::expr & cond, int bits)
 {
-    std::stringstream ss;
-    ss << "symval_" << ssa;
-    return ss.str();
+    return z3::ite(cond, c.bv_val(1, bits), c.bv_val(0, bits));
 }
 
-z3::expr SymbolicValue :: contextCmp (z3::context & c, z3::expr && cond) const
+// zero extends or truncates expr to target_size bits
+z3::expr SymbolicValue :: extend (z3::expr expr, int target_size)
 {
-    z3::solver s(c);
+    int expr_size = expr.get_sort().bv_size();
 
-    s.add(cond);
+    if (expr_size < target_size)
+        return to_expr(expr.ctx(), Z3_mk_zero_ext(expr.ctx(), target_size - expr_size, expr));
+    else if (expr_size > target_size)
+        return expr.extract(target_size - 1, 0);
+    return expr;
+}
 
-    if (s.check() == z3::sat) return c.bv_val(1, g_bits());
-    else return c.bv_val(0, g_bits());
+SymbolicContext :: SymbolicContext (z3::context & c, size_t limit)
+    : c(c), limit(limit), hits(0), misses(0), evicted(0)
+{
+    exprs = new std::unordered_map <SymbolicNode *, z3::expr>;
 }
 
-z3::expr SymbolicValue :: extend (z3::expr expr, int target_size) const
+SymbolicContext :: ~SymbolicContext ()
 {
-    int expr_size = expr.get_sort().bv_size();
+    clear();
+    delete exprs;
+}
 
-    if (expr_size < target_size) {
-        return to_expr(expr.ctx(), Z3_mk_zero_ext(expr.ctx(), target_size - expr_size, expr));
+const z3::expr * SymbolicContext :: lookup (SymbolicNode * node)
+{
+    std::unordered_map <SymbolicNode *, z3::expr> :: iterator it;
+    it = exprs->find(node);
+    if (it == exprs->end()) {
+        misses++;
+        return NULL;
     }
-    else if (expr_size > target_size) {
+    hits++;
+    return &(it->second);
+}
 
+void SymbolicContext :: insert (SymbolicNode * node, const z3::expr & expr)
+{
+    if (exprs->size() >= limit) {
+        sweep();
+        if (exprs->size() >= limit / 2) {
+            evicted += exprs->size();
+            clear();
+        }
     }
-    return expr;
+
+    if (exprs->insert(std::pair <SymbolicNode *, z3::expr> (node, expr)).second)
+        node->reference();
 }
 
-z3::expr SymbolicValue :: context (z3::context & c) const
+void SymbolicContext :: sweep ()
 {
-    switch (type) {
-    case SVT_ADD    :
-        return extend(lhs->context(c) + rhs->context(c), g_bits());
-    case SVT_AND    :
-        return extend(lhs->context(c) & rhs->context(c), g_bits());
-    case SVT_CMPLES :
-        return extend(contextCmp(c, lhs->context(c) <= rhs->context(c)), g_bits());
-    case SVT_CMPLEU :
-        return extend(contextCmp(c, ule(lhs->context(c), rhs->context(c))), g_bits());
-    case SVT_CMPLTS :
-        return extend(contextCmp(c, lhs->context(c) < rhs->context(c)), g_bits());
-    case SVT_CMPLTU :
-        return extend(contextCmp(c, ult(lhs->context(c), rhs->context(c))), g_bits());
-    case SVT_DIV    :
-        return extend(lhs->context(c) / rhs->context(c), g_bits());
-    case SVT_EQ     :
-        return extend(contextCmp(c, lhs->context(c) == rhs->context(c)), g_bits());
-    case SVT_MOD    :
-        return extend(z3mod(lhs->context(c), rhs->context(c)), g_bits());
-    case SVT_MUL    :
-        return extend(lhs->context(c) * rhs->context(c), g_bits());
-    case SVT_NOT    :
-        return extend(~(lhs->context(c)), g_bits());
-    case SVT_OR     :
-        return extend(lhs->context(c) | rhs->context(c), g_bits());
-    case SVT_SEXT   :
-        if (rhs->g_wild())
-            throw std::runtime_error("tried to sign-extend by wild bits");
-        return z3sext(lhs->context(c), rhs->g_uint64());
-    case SVT_SHL    :
-        return extend(z3shl(lhs->context(c), rhs->context(c)), g_bits());
-    case SVT_SHR    :
-        return extend(z3shr(lhs->context(c), rhs->context(c)), g_bits());
-    case SVT_SUB    :
-        return extend(lhs->context(c) - rhs->context(c), g_bits());
-    case SVT_XOR    :
-        return extend(lhs->context(c) | rhs->context(c), g_bits());
+    std::vector <SymbolicNode *> dead;
+
+    std::unordered_map <SymbolicNode *, z3::expr> :: iterator it;
+    for (it = exprs->begin(); it != exprs->end(); it++) {
+        if (it->first->references == 1)
+            dead.push_back(it->first);
     }
 
-    if (not wild) {
-        if (g_bits() <= 64) {
-            return c.bv_val((__uint64) g_uint64(), g_bits());
-        }
-        else if (g_bits() == 128) {
-            z3::expr lower64 = c.bv_val((__uint64) g_uint64(), 64);
-            z3::expr upper64 = c.bv_val((__uint64) (value >> UInt(8, 64)).g_value64(), 64);
-            return (z3shl(upper64, 64) | lower64).simplify();
-        }
-        else
-            throw std::runtime_error("invalid bits for SymbolicValue::context");
+    // dropping a node releases its children, which may leave them held by
+    // this cache alone in turn. a node still in the cache is alive, because
+    // the cache references it
+    while (dead.size() > 0) {
+        SymbolicNode * node = dead.back();
+        dead.pop_back();
+        if (exprs->erase(node) == 0)
+            continue;
+        SymbolicNode * lhs = node->lhs;
+        SymbolicNode * rhs = node->rhs;
+        node->release();
+        evicted++;
+
+        if (lhs && exprs->count(lhs) && (lhs->references == 1))
+            dead.push_back(lhs);
+        if (rhs && (rhs != lhs) && exprs->count(rhs) && (rhs->references == 1))
+            dead.push_back(rhs);
     }
-    return c.bv_const(z3_name().c_str(), g_bits());
 }
 
+void SymbolicContext :: clear ()
+{
+    std::unordered_map <SymbolicNode *, z3::expr> :: iterator it;
+    for (it = exprs->begin(); it != exprs->end(); it++)
+        it->first->release();
+    exprs->clear();
+}
 
-bool SymbolicValue :: sv_assert (const SymbolicValue && value) const {
-    z3::context c;
-
-    z3::expr this_value   = context(c);
-    z3::expr target_value = value.context(c);
+size_t SymbolicContext :: g_size ()
+{
+    return exprs->size();
+}
 
-    z3::solver s(c);
-    s.add(this_value == target_value);
+z3::expr SymbolicValue :: context (SymbolicContext & sc, SymbolicNode * node)
+{
+    const z3::expr * cached = sc.lookup(node);
+    if (cached)
+        return *cached;
 
-    if (s.check() == z3::sat) return true;
-    return false;
+    z3::expr expr = translate(sc, node);
+    sc.insert(node, expr);
+    return expr;
 }
 
-// drunk coding leads to regrets, but FOSS so what the hell
-bool SymbolicValue :: sv_assert (const SymbolicValue && value,
-                                std::list <std::pair <SymbolicValue, SymbolicValue>> assertions)
-const
+z3::expr SymbolicValue :: translate (SymbolicContext & sc, SymbolicNode * node)
 {
-    z3::context c;
+    z3::context & c = sc.g_context();
+
+    if (node->type == SVT_CONSTANT) {
+        if (node->bits <= 64)
+            return c.bv_val((__uint64) node->value.g_value64(), node->bits);
+        else if (node->bits == 128) {
+            z3::expr lower64 = c.bv_val((__uint64) node->value.g_value64(), 64);
+            z3::expr upper64 = c.bv_val((__uint64) (node->value >> UInt(8, 64)).g_value64(), 64);
+            return (z3shl(extend(upper64, 128), 64) | extend(lower64, 128)).simplify();
+        }
+        else
+            throw std::runtime_error("invalid bits for SymbolicValue::context");
+    }
+    else if (node->type == SVT_VAR) {
+        std::stringstream ss;
+        ss << "symval_" << node->var;
+        return c.bv_const(ss.str().c_str(), node->bits);
+    }
+    else if (node->type == SVT_NOT)
+        return ~context(sc, node->lhs);
+    else if (node->type == SVT_ZEXT)
+        return extend(context(sc, node->lhs), node->bits);
+    else if (node->type == SVT_SEXT)
+        return z3sext(context(sc, node->lhs), node->rhs->value.g_value64());
+    else if (node->type == SVT_CONCAT)
+        return z3::concat(context(sc, node->lhs), context(sc, node->rhs));
+
+    // binary operators work on operands of the lhs's size
+    z3::expr lhs = context(sc, node->lhs);
+    z3::expr rhs = extend(context(sc, node->rhs), node->lhs->bits);
+
+    switch (node->type) {
+    case SVT_ADD    : return lhs + rhs;
+    case SVT_AND    : return lhs & rhs;
+    case SVT_CMPLES : return contextCmp(c, lhs <= rhs, node->bits);
+    case SVT_CMPLEU : return contextCmp(c, ule(lhs, rhs), node->bits);
+    case SVT_CMPLTS : return contextCmp(c, lhs < rhs, node->bits);
+    case SVT_CMPLTU : return contextCmp(c, ult(lhs, rhs), node->bits);
+    case SVT_DIV    : return lhs / rhs;
+    case SVT_EQ     : return contextCmp(c, lhs == rhs, node->bits);
+    case SVT_MOD    : return z3mod(lhs, rhs);
+    case SVT_MUL    : return lhs * rhs;
+    case SVT_OR     : return lhs | rhs;
+    case SVT_SHL    : return z3shl(lhs, rhs);
+    case SVT_SHR    : return z3shr(lhs, rhs);
+    case SVT_SUB    : return lhs - rhs;
+    case SVT_XOR    : return lhs ^ rhs;
+    }
 
-    z3::expr this_value   = context(c);
-    z3::expr target_value = value.context(c);
+    std::stringstream ss;
+    ss << "invalid type for SymbolicValue::context() => " << node->type;
+    throw std::runtime_error(ss.str());
+}
 
-    z3::solver s(c);
+z3::expr SymbolicValue :: context (z3::context & c) const
+{
+    SymbolicContext sc(c);
+    return context(sc);
+}
 
-    std::list <std::pair <SymbolicValue, SymbolicValue>> :: iterator it;
-    for (it = assertions.begin(); it != assertions.end(); it++) {
-        s.add(it->first.context(c) == it->second.context(c));
-    }
+z3::expr SymbolicValue :: context (SymbolicContext & sc) const
+{
+    if (node)
+        return context(sc, node);
 
-    s.add(this_value == target_value);
+    z3::context & c = sc.g_context();
 
-    if (s.check() == z3::sat) return true;
-    else return false;
-}
\ No newline at end of file
+    if (g_bits() <= 64)
+        return c.bv_val((__uint64) g_uint64(), g_bits());
+    else if (g_bits() == 128) {
+        z3::expr lower64 = c.bv_val((__uint64) g_uint64(), 64);
+        z3::expr upper64 = c.bv_val((__uint64) (value >> UInt(8, 64)).g_value64(), 64);
+        return (z3shl(extend(upper64, 128), 64) | extend(lower64, 128)).simplify();
+    }
+    else
+        throw std::runtime_error("invalid bits for SymbolicValue::context");
+}
@@ -22,12 +22,24 @@
 
 #include <inttypes.h>
 
+#include <atomic>
 #include <list>
+#include <mutex>
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "uint.h"
 
+// the most z3 translations a SymbolicContext keeps
+#define SYMBOLIC_CONTEXT_MAX 65536
+
+// SymbolicNodeTable is split into 2^SYMBOLIC_NODE_SHARD_BITS shards
+#define SYMBOLIC_NODE_SHARD_BITS 6
+#define SYMBOLIC_NODE_SHARDS     (1 << SYMBOLIC_NODE_SHARD_BITS)
+
 enum {
     SVT_NONE,
     SVT_CONSTANT,
@@ -37,6 +49,7 @@ enum {
     SVT_CMPLEU,
     SVT_CMPLTS,
     SVT_CMPLTU,
+    SVT_CONCAT, // lhs above rhs, this node's bits are both of theirs
     SVT_DIV,
     SVT_EQ,
     SVT_MOD,
@@ -47,11 +60,15 @@ enum {
     SVT_SHL,
     SVT_SHR,
     SVT_SUB,
-    SVT_XOR
+    SVT_XOR,
+    SVT_VAR,  // a wild leaf, all values possible
+    SVT_ZEXT  // zero extends or truncates lhs to this node's bits
 };
 
 namespace z3 { class expr; class context; }
 
+// hands out the identifiers for wild leaves. two leaves with the same
+// identifier are the same variable. safe to call from any thread
 class SymbolicValueSSA {
     public :
         static SymbolicValueSSA & get ()
@@ -61,22 +78,146 @@ class SymbolicValueSSA {
         }
         uint64_t next() { return next_id++; }
     private :
-        uint64_t next_id;
+        std::atomic <uint64_t> next_id;
         SymbolicValueSSA () : next_id(0) {}
         SymbolicValueSSA (SymbolicValueSSA &);
         void operator = (SymbolicValueSSA &);
 };
 
+/*
+ * An immutable node in a symbolic expression DAG. Nodes are hash-consed
+ * through SymbolicNodeTable, so two structurally identical expressions are
+ * always the same node, and are freed once the last reference dies.
+ *
+ * Nodes may be shared between threads. A node's count only drops to zero
+ * while holding the lock of the table shard it lives in, so the table never
+ * hands out a node which is being freed.
+ */
+class SymbolicNode {
+    public :
+        int            type;
+        int            bits;
+        UInt           value; // SVT_CONSTANT only
+        uint64_t       var;   // SVT_VAR only
+        SymbolicNode * lhs;
+        SymbolicNode * rhs;
+        size_t         hash;
+        std::atomic <int> references;
+
+        SymbolicNode (int type, int bits, const UInt & value, uint64_t var,
+                      SymbolicNode * lhs, SymbolicNode * rhs);
+
+        void reference () { references++; }
+        void release   ();
+};
+
+class SymbolicNodeTable {
+    private :
+        struct NodeHash {
+            size_t operator () (const SymbolicNode * node) const { return node->hash; }
+        };
+        struct NodeEqual {
+            bool operator () (const SymbolicNode * a, const SymbolicNode * b) const;
+        };
+
+        // a node lives in the shard its hash picks, so threads interning
+        // different nodes rarely wait on each other
+        struct Shard {
+            std::unordered_set <SymbolicNode *, NodeHash, NodeEqual> nodes;
+            std::mutex lock;
+        };
+        Shard shards [SYMBOLIC_NODE_SHARDS];
+
+        Shard & shard (size_t hash)
+        {
+            return shards[(hash * 0x9e3779b97f4a7c15ULL) >> (64 - SYMBOLIC_NODE_SHARD_BITS)];
+        }
+
+        SymbolicNodeTable () {}
+        SymbolicNodeTable (SymbolicNodeTable &);
+        void operator = (SymbolicNodeTable &);
+    public :
+        static SymbolicNodeTable & get ()
+        {
+            static SymbolicNodeTable instance;
+            return instance;
+        }
+
+        // returns the existing node with this structure, or creates it. the
+        // returned node carries a reference for the caller
+        SymbolicNode * intern (int type, int bits, const UInt & value, uint64_t var,
+                               SymbolicNode * lhs, SymbolicNode * rhs);
+        // drops a reference to node, removing it from the table if it was the
+        // last. returns true if the caller must delete node
+        bool           release (SymbolicNode * node);
+
+        size_t g_size ();
+};
+
+/*
+ * Memoizes the translation of SymbolicNodes into one z3 context, so a
+ * subexpression shared by many queries, like a byte of symbolic memory, is
+ * translated once per context instead of once per query. Every node in the
+ * cache is referenced by it, so a node's address can't be reused by another
+ * expression while its entry lives. The cache must be destroyed or cleared
+ * before its context.
+ *
+ * The cache is kept under limit entries, so the nodes it holds can still be
+ * freed. Once it fills, entries held by nothing but the cache are dropped, and
+ * if that doesn't free half of it, the whole cache is.
+ */
+class SymbolicContext {
+    private :
+        z3::context & c;
+        std::unordered_map <SymbolicNode *, z3::expr> * exprs;
+        size_t limit;
+
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evicted;
+
+        // drops entries for nodes nothing else references
+        void sweep ();
+
+        SymbolicContext (SymbolicContext &);
+        void operator = (SymbolicContext &);
+    public :
+        SymbolicContext (z3::context & c, size_t limit = SYMBOLIC_CONTEXT_MAX);
+        ~SymbolicContext ();
+
+        z3::context & g_context () { return c; }
+
+        // returns the translation of node, or NULL if we don't have one
+        const z3::expr * lookup (SymbolicNode * node);
+        void             insert (SymbolicNode * node, const z3::expr & expr);
+        void             clear  ();
+
+        uint64_t g_hits    () { return hits;    }
+        uint64_t g_misses  () { return misses;  }
+        uint64_t g_evicted () { return evicted; }
+        size_t   g_size    ();
+};
+
+/*
+ * A SymbolicValue is either concrete, in which case the value is held inline,
+ * or wild, in which case it holds a reference to a SymbolicNode. Copying a
+ * SymbolicValue never copies the expression it refers to.
+ */
 class SymbolicValue {
     protected :
-        int type;
-        uint64_t ssa;
-        UInt     value;
-        bool     wild; // all values possible
-        SymbolicValue * lhs;
-        SymbolicValue * rhs;
-
-        std::string z3_name () const;
+        int            type;
+        UInt           value;
+        SymbolicNode * node;
+
+        SymbolicValue (SymbolicNode * node);
+
+        // returns a new reference to a node for this value, creating a
+        // constant node if this value is concrete
+        SymbolicNode * g_node () const;
+
+        static const std::string str       (const SymbolicNode * node);
+        static z3::expr          context   (SymbolicContext & sc, SymbolicNode * node);
+        static z3::expr          translate (SymbolicContext & sc, SymbolicNode * node);
     
     public :
         SymbolicValue ();
@@ -86,12 +227,10 @@ class SymbolicValue {
         SymbolicValue (int type,
                        const SymbolicValue & lhs,
                        const SymbolicValue & rhs);
+        SymbolicValue (const SymbolicValue & rhs);
         ~SymbolicValue ();
 
         SymbolicValue & operator = (const SymbolicValue & rhs);
-        SymbolicValue & operator = (SymbolicValue & rhs);
-        SymbolicValue & operator = (const SymbolicValue & rhs) const;
-        SymbolicValue & operator = (SymbolicValue & rhs) const;
         
         const std::string str () const;
 
@@ -101,7 +240,19 @@ class SymbolicValue {
         UInt     g_value  () const { return value;             }
         uint64_t g_uint64 () const { return value.g_value64(); }
         int      g_bits   () const { return value.g_bits();    }
-        bool     g_wild   () const { return wild;              }
+        bool     g_wild   () const { return node != NULL;      }
+        int      g_type   () const { return type;              }
+
+        // the interned expression behind a wild value, NULL if concrete. two
+        // wild values with the same g_expr are the same expression
+        const SymbolicNode * g_expr () const { return node; }
+
+        // the identifiers of every wild leaf this value depends on
+        std::vector <uint64_t> g_vars () const;
+
+        // true if both values are the same concrete value, or the same
+        // expression. this is structural, not semantic, equality
+        bool identical (const SymbolicValue & rhs) const;
 
         SymbolicValue operator +  (const SymbolicValue & rhs) const;
         SymbolicValue operator -  (const SymbolicValue & rhs) const;
@@ -122,16 +273,24 @@ class SymbolicValue {
 
         SymbolicValue operator ~  () const;
 
+        // t where the one bit cond is 1, f where it is 0. built as a bit mask
+        // select, so needs no node type of its own
+        static SymbolicValue ite (const SymbolicValue & cond,
+                                  const SymbolicValue & t,
+                                  const SymbolicValue & f);
+
+        // high's bits above low's
+        static SymbolicValue concat (const SymbolicValue & high,
+                                     const SymbolicValue & low);
+
         // creates a z3 expression which evaluates this SymbolicValue in the
-        // given z3 context
-        z3::expr extend     (z3::expr expr, int target_size) const;
-        z3::expr context    (z3::context & c) const;
-        z3::expr contextCmp (z3::context & c, z3::expr && cond) const;
-
-        // asserts a wild symbolic value can equal the given value
-        bool sv_assert (const SymbolicValue && value) const;
-        bool sv_assert (const SymbolicValue && value,
-                        std::list <std::pair <SymbolicValue, SymbolicValue>>) const;
+        // given z3 context. the SymbolicContext form reuses and extends the
+        // translations already made in its context
+        static z3::expr extend     (z3::expr expr, int target_size);
+        z3::expr        context    (z3::context & c) const;
+        z3::expr        context    (SymbolicContext & sc) const;
+        // a bits wide 1 or 0 for whether cond holds
+        static z3::expr contextCmp (z3::context & c, const z3::expr & cond, int bits);
 };
 
 
@@ -0,0 +1,197 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Measures what it costs the VM to find the right execute() for an IR
+ * instruction. IR is lifted from the code following the entry point of the
+ * given binary (ex: test/0/test), and then dispatched repeatedly once with the
+ * old chain of dynamic_casts and once with a switch on the opcode tag.
+ *
+ * Usage: bench_dispatch <elf> [rounds]
+ */
+
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <vector>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../elf.h"
+#include "../instruction.h"
+#include "../memory.h"
+#include "../registers.h"
+#include "../translator.h"
+
+#define BENCH_IR_OPS 4096
+
+// stands in for VM::execute, so both dispatchers do the same work once they
+// have found the instruction type
+uint64_t counts[32];
+
+void __attribute__ ((noinline)) visit (int type) { counts[type]++; }
+
+double now ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+
+void dispatch_dynamic_cast (std::vector <Instruction *> & instructions)
+{
+    #define EXECUTE(XX, TYPE) if (dynamic_cast<XX *>(*it)) \
+                                  visit(TYPE);
+
+    std::vector <Instruction *> :: iterator it;
+    for (it = instructions.begin(); it != instructions.end(); it++) {
+             EXECUTE(InstructionAdd,        IOP_ADD)
+        else EXECUTE(InstructionAnd,        IOP_AND)
+        else EXECUTE(InstructionAssign,     IOP_ASSIGN)
+        else EXECUTE(InstructionBrc,        IOP_BRC)
+        else EXECUTE(InstructionCmpEq,      IOP_CMPEQ)
+        else EXECUTE(InstructionCmpLes,     IOP_CMPLES)
+        else EXECUTE(InstructionCmpLeu,     IOP_CMPLEU)
+        else EXECUTE(InstructionCmpLts,     IOP_CMPLTS)
+        else EXECUTE(InstructionCmpLtu,     IOP_CMPLTU)
+        else EXECUTE(InstructionDiv,        IOP_DIV)
+        else EXECUTE(InstructionHlt,        IOP_HLT)
+        else EXECUTE(InstructionLoad,       IOP_LOAD)
+        else EXECUTE(InstructionNot,        IOP_NOT)
+        else EXECUTE(InstructionMod,        IOP_MOD)
+        else EXECUTE(InstructionMul,        IOP_MUL)
+        else EXECUTE(InstructionOr,         IOP_OR)
+        else EXECUTE(InstructionShl,        IOP_SHL)
+        else EXECUTE(InstructionShr,        IOP_SHR)
+        else EXECUTE(InstructionSignExtend, IOP_SIGNEXTEND)
+        else EXECUTE(InstructionStore,      IOP_STORE)
+        else EXECUTE(InstructionSub,        IOP_SUB)
+        else EXECUTE(InstructionSyscall,    IOP_SYSCALL)
+        else EXECUTE(InstructionXor,        IOP_XOR)
+    }
+
+    #undef EXECUTE
+}
+
+
+void dispatch_opcode (std::vector <Instruction *> & instructions)
+{
+    #define EXECUTE(OPCODE) case OPCODE : visit(OPCODE); break;
+
+    std::vector <Instruction *> :: iterator it;
+    for (it = instructions.begin(); it != instructions.end(); it++) {
+        switch ((*it)->g_opcode()) {
+        EXECUTE(IOP_ADD)
+        EXECUTE(IOP_AND)
+        EXECUTE(IOP_ASSIGN)
+        EXECUTE(IOP_BRC)
+        EXECUTE(IOP_CMPEQ)
+        EXECUTE(IOP_CMPLES)
+        EXECUTE(IOP_CMPLEU)
+        EXECUTE(IOP_CMPLTS)
+        EXECUTE(IOP_CMPLTU)
+        EXECUTE(IOP_DIV)
+        EXECUTE(IOP_HLT)
+        EXECUTE(IOP_LOAD)
+        EXECUTE(IOP_NOT)
+        EXECUTE(IOP_MOD)
+        EXECUTE(IOP_MUL)
+        EXECUTE(IOP_OR)
+        EXECUTE(IOP_SHL)
+        EXECUTE(IOP_SHR)
+        EXECUTE(IOP_SIGNEXTEND)
+        EXECUTE(IOP_STORE)
+        EXECUTE(IOP_SUB)
+        EXECUTE(IOP_SYSCALL)
+        EXECUTE(IOP_XOR)
+        }
+    }
+
+    #undef EXECUTE
+}
+
+
+int main (int argc, char * argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <elf> [rounds]" << std::endl;
+        return -1;
+    }
+
+    int rounds = 2000;
+    if (argc > 2)
+        rounds = atoi(argv[2]);
+
+    Elf * elf = Elf::Get(argv[1]);
+    Memory memory = elf->g_memory();
+    RegisterFile registers = elf->g_registers();
+    uint64_t address = registers[SLOT_RIP].g_uint64();
+
+    // sweep linearly from the entry point, skipping anything we can't lift
+    Translator translator;
+    std::vector <Instruction *> instructions;
+    int failures = 0;
+    while ((instructions.size() < BENCH_IR_OPS) && (failures < 64)) {
+        try {
+            size_t block_size;
+            std::list <Instruction *> block;
+            block = translator.translate_block(address,
+                                               memory.g_data(address),
+                                               memory.g_data_size(address),
+                                               block_size);
+            instructions.insert(instructions.end(), block.begin(), block.end());
+            address += block_size;
+        }
+        catch (std::exception & e) {
+            failures++;
+            address++;
+        }
+    }
+
+    if (instructions.size() == 0) {
+        std::cerr << "could not lift any instructions from " << argv[1] << std::endl;
+        return -1;
+    }
+
+    std::cout << "lifted " << instructions.size() << " IR instructions from "
+              << argv[1] << std::endl;
+
+    double start = now();
+    for (int i = 0; i < rounds; i++)
+        dispatch_dynamic_cast(instructions);
+    double dynamic_cast_time = now() - start;
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+        dispatch_opcode(instructions);
+    double opcode_time = now() - start;
+
+    double ops = (double) instructions.size() * rounds;
+    std::cout << "dynamic_cast: " << (dynamic_cast_time * 1000000000.0) / ops
+              << " ns/op" << std::endl;
+    std::cout << "opcode:       " << (opcode_time * 1000000000.0) / ops
+              << " ns/op" << std::endl;
+
+    delete elf;
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+    Copyright 2012 Alex Eubanks (endeavor[at]rainbowsandpwnies.com)
+
+    This file is part of rnp_see ( http://github.com/endeav0r/rnp_see/ )
+
+    rnp_see is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Measures what a qword load and store costs over a 2 MiB mapping. Each
+ * access goes once through Memory, with its TLB in front of the 6-level
+ * FrameTable, and once straight through a walk of the same frames held in the
+ * 6-level table and in the 16-level, 4 bits a level table Memory used before.
+ * Addresses are walked in order, then in a pseudo random order which misses
+ * the TLB most of the time.
+ *
+ * Usage: bench_memory [rounds]
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../memory.h"
+#include "../page.h"
+#include "../radixmap.h"
+
+#define BENCH_BASE    0x7ff000000000ULL
+#define BENCH_SIZE    (2 << 20)
+#define BENCH_ACCESSES (BENCH_SIZE / 8)
+
+typedef RadixMap <FrameRef, 4, 64 - FRAME_BITS> OldFrameTable;
+
+double now ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+
+uint64_t bench_memory (Memory & memory, std::vector <uint64_t> & addresses, int rounds)
+{
+    uint64_t sum = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < addresses.size(); i++) {
+            memory.s_qword(addresses[i], sum + i);
+            sum += memory.g_qword(addresses[i]);
+        }
+    }
+    return sum;
+}
+
+
+template <class Table>
+uint64_t bench_table (Table & table, std::vector <uint64_t> & addresses, int rounds)
+{
+    uint64_t sum = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < addresses.size(); i++) {
+            uint64_t address = addresses[i];
+            Page * page = table.find(address >> FRAME_BITS)->g_page();
+            page->s_qword(address & FRAME_MASK, sum + i);
+            page = table.find(address >> FRAME_BITS)->g_page();
+            sum += page->g_qword(address & FRAME_MASK);
+        }
+    }
+    return sum;
+}
+
+
+void report (const char * name, double seconds, size_t accesses)
+{
+    std::cout << name << (seconds * 1000000000.0 / accesses) << " ns/access"
+              << std::endl;
+}
+
+
+void bench (const char * order, std::vector <uint64_t> & addresses, int rounds,
+            Memory & memory, FrameTable & table, OldFrameTable & old_table)
+{
+    // two accesses, a load and a store, for each address
+    size_t accesses = addresses.size() * rounds * 2;
+    uint64_t sum = 0;
+
+    std::cout << order << std::endl;
+
+    double start = now();
+    sum += bench_memory(memory, addresses, rounds);
+    report("  memory (tlb, 6 levels)  ", now() - start, accesses);
+
+    start = now();
+    sum += bench_table(table, addresses, rounds);
+    report("  6 level walk            ", now() - start, accesses);
+
+    start = now();
+    sum += bench_table(old_table, addresses, rounds);
+    report("  16 level walk           ", now() - start, accesses);
+
+    // keeps the loops from being optimized away
+    std::cout << "  checksum " << std::hex << sum << std::dec << std::endl;
+}
+
+
+int main (int argc, char * argv[])
+{
+    int rounds = 16;
+    if (argc > 1)
+        rounds = strtol(argv[1], NULL, 0);
+
+    Memory memory;
+    memory.map(BENCH_BASE, BENCH_SIZE);
+
+    FrameTable    table;
+    OldFrameTable old_table;
+    for (uint64_t address = BENCH_BASE;
+         address < BENCH_BASE + BENCH_SIZE;
+         address += FRAME_SIZE) {
+        FrameRef frame(new Page(FRAME_SIZE));
+        table.set(address >> FRAME_BITS, frame);
+        old_table.set(address >> FRAME_BITS, frame);
+    }
+
+    std::vector <uint64_t> addresses;
+    for (size_t i = 0; i < BENCH_ACCESSES; i++)
+        addresses.push_back(BENCH_BASE + i * 8);
+    bench("in order", addresses, rounds, memory, table, old_table);
+
+    // xorshift, so every run shuffles the same way
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (size_t i = addresses.size() - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::swap(addresses[i], addresses[state % (i + 1)]);
+    }
+    bench("random order", addresses, rounds, memory, table, old_table);
+
+    memory.destroy();
+
+    return 0;
+}
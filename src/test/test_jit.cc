@@ -0,0 +1,463 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <list>
+#include <map>
+
+#include "../instruction.h"
+#include "../jit.h"
+#include "../memory.h"
+#include "../page.h"
+#include "../registers.h"
+#include "../symbolicvalue.h"
+
+typedef std::map <uint64_t, SymbolicValue> Variables;
+
+const char * names[] = {"UD_R_RAX", "UD_R_RBX", "UD_R_RCX",
+                        "UD_R_RDX", "UD_R_RSI", "UD_R_RDI"};
+
+uint64_t state = 0x2545f4914f6cdd1dULL;
+
+uint64_t mask (int bits)
+{
+	return bits >= 64 ? 0xffffffffffffffffULL : (1ULL << bits) - 1;
+}
+
+uint64_t next ()
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+SymbolicValue value (Variables & variables, InstructionOperand operand)
+{
+	if (operand.g_type() == OPTYPE_CONSTANT)
+		return SymbolicValue(operand.g_bits(), operand.g_value());
+	return variables[operand.g_id()].extend(operand.g_bits());
+}
+
+// runs IR the way the VM does, up to where compiled code would hand the block
+// to the interpreter, and returns that index
+size_t run (std::list <Instruction *> & instructions, Variables & variables, Memory & memory)
+{
+	size_t index = 0;
+	std::list <Instruction *> :: iterator it;
+	for (it = instructions.begin(); it != instructions.end(); it++, index++) {
+		#define BINOP(OPCODE, XX, EXPR) \
+		case OPCODE : { \
+			XX * ins = static_cast<XX *>(*it); \
+			SymbolicValue lhs = value(variables, ins->g_lhs()); \
+			SymbolicValue rhs = value(variables, ins->g_rhs()); \
+			variables[ins->g_dst().g_id()] = (EXPR).extend(ins->g_dst().g_bits()); \
+			break; \
+		}
+		switch ((*it)->g_opcode()) {
+		BINOP(IOP_ADD,    InstructionAdd,    lhs + rhs)
+		BINOP(IOP_AND,    InstructionAnd,    lhs & rhs)
+		BINOP(IOP_MUL,    InstructionMul,    lhs * rhs)
+		BINOP(IOP_OR,     InstructionOr,     lhs | rhs)
+		BINOP(IOP_SUB,    InstructionSub,    lhs - rhs)
+		BINOP(IOP_XOR,    InstructionXor,    lhs ^ rhs)
+		BINOP(IOP_CMPEQ,  InstructionCmpEq,  lhs == rhs)
+		BINOP(IOP_CMPLES, InstructionCmpLes, lhs.cmpLes(rhs))
+		BINOP(IOP_CMPLEU, InstructionCmpLeu, lhs.cmpLeu(rhs))
+		BINOP(IOP_CMPLTS, InstructionCmpLts, lhs.cmpLts(rhs))
+		BINOP(IOP_CMPLTU, InstructionCmpLtu, lhs.cmpLtu(rhs))
+		case IOP_SHL :
+		case IOP_SHR : {
+			InstructionBinOp * ins = static_cast<InstructionBinOp *>(*it);
+			SymbolicValue lhs = value(variables, ins->g_lhs());
+			SymbolicValue rhs = value(variables, ins->g_rhs());
+			if (rhs.g_uint64() > 63)
+				return index;
+			SymbolicValue result = (*it)->g_opcode() == IOP_SHL ? lhs << rhs : lhs >> rhs;
+			variables[ins->g_dst().g_id()] = result.extend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_DIV :
+		case IOP_MOD : {
+			InstructionBinOp * ins = static_cast<InstructionBinOp *>(*it);
+			SymbolicValue lhs = value(variables, ins->g_lhs());
+			SymbolicValue rhs = value(variables, ins->g_rhs());
+			if (rhs.g_uint64() == 0)
+				return index;
+			SymbolicValue result = (*it)->g_opcode() == IOP_DIV ? lhs / rhs : lhs % rhs;
+			variables[ins->g_dst().g_id()] = result.extend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_ASSIGN : {
+			InstructionAssign * ins = static_cast<InstructionAssign *>(*it);
+			variables[ins->g_dst().g_id()] = value(variables, ins->g_src()).extend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_NOT : {
+			InstructionNot * ins = static_cast<InstructionNot *>(*it);
+			variables[ins->g_dst().g_id()] = (~ value(variables, ins->g_src())).extend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_SIGNEXTEND : {
+			InstructionSignExtend * ins = static_cast<InstructionSignExtend *>(*it);
+			SymbolicValue src = value(variables, ins->g_src()).extend(ins->g_src().g_bits());
+			variables[ins->g_dst().g_id()] = src.signExtend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_LOAD : {
+			InstructionLoad * ins = static_cast<InstructionLoad *>(*it);
+			uint64_t address = value(variables, ins->g_src()).g_uint64();
+			SymbolicValue loaded;
+			switch (ins->g_bits()) {
+			case 8  : loaded = memory.g_sym8(address);  break;
+			case 16 : loaded = memory.g_sym16(address); break;
+			case 32 : loaded = memory.g_sym32(address); break;
+			case 64 : loaded = memory.g_sym64(address); break;
+			}
+			if (loaded.g_wild())
+				return index;
+			variables[ins->g_dst().g_id()] = loaded;
+			break;
+		}
+		case IOP_STORE : {
+			InstructionStore * ins = static_cast<InstructionStore *>(*it);
+			uint64_t address = value(variables, ins->g_dst()).g_uint64();
+			SymbolicValue src = value(variables, ins->g_src());
+			try {
+				switch (ins->g_bits()) {
+				case 8  : memory.s_sym8(address, src);  break;
+				case 16 : memory.s_sym16(address, src); break;
+				case 32 : memory.s_sym32(address, src); break;
+				case 64 : memory.s_sym64(address, src); break;
+				}
+			}
+			catch (MemoryFault & fault) {
+				return index;
+			}
+			break;
+		}
+		case IOP_BRC : {
+			InstructionBrc * ins = static_cast<InstructionBrc *>(*it);
+			if (value(variables, ins->g_cond()).g_uint64())
+				variables[SLOT_RIP] = value(variables, ins->g_dst()).extend(64);
+			break;
+		}
+		case IOP_FLAGS : {
+			// the VM's settle_flag, all at once
+			InstructionFlags * ins = static_cast<InstructionFlags *>(*it);
+			SymbolicValue lhs    = value(variables, ins->g_lhs());
+			SymbolicValue rhs    = value(variables, ins->g_rhs());
+			SymbolicValue result = value(variables, ins->g_result());
+			SymbolicValue zero(result.g_bits(), 0);
+			SymbolicValue sf = result.cmpLts(zero);
+			int kind = ins->g_kind();
+
+			variables[SLOT_ZF] = (kind == FLAGS_CMP ? lhs == rhs : result == zero).extend(1);
+			variables[SLOT_SF] = sf.extend(1);
+			switch (kind) {
+			case FLAGS_ADD   : variables[SLOT_CF] = result.cmpLtu(lhs).extend(1); break;
+			case FLAGS_SUB   :
+			case FLAGS_SBB   : variables[SLOT_CF] = lhs.cmpLtu(result).extend(1); break;
+			case FLAGS_CMP   : variables[SLOT_CF] = lhs.cmpLtu(rhs).extend(1);    break;
+			case FLAGS_LOGIC : variables[SLOT_CF] = SymbolicValue(1, 0);          break;
+			}
+			switch (kind) {
+			case FLAGS_ADD    :
+			case FLAGS_CMP    : variables[SLOT_OF] = (lhs.cmpLts(rhs) ^ sf).extend(1);    break;
+			case FLAGS_SBB    : variables[SLOT_OF] = (result.cmpLts(rhs) ^ sf).extend(1); break;
+			case FLAGS_INCDEC : variables[SLOT_OF] = (result.cmpLts(lhs) ^ sf).extend(1); break;
+			case FLAGS_SUB    :
+				variables[SLOT_OF] = ((result ^ lhs).extend(lhs.g_bits())
+				                      >> SymbolicValue(lhs.g_bits(), lhs.g_bits() - 1)).extend(1);
+				break;
+			case FLAGS_LOGIC  : variables[SLOT_OF] = SymbolicValue(1, 0); break;
+			}
+			break;
+		}
+		case IOP_SYSCALL :
+		case IOP_HLT :
+			return index;
+		default :
+			assert(false);
+		}
+	}
+	return index;
+}
+
+// true if a and b hold the same first 256 bytes
+bool same (Memory & a, Memory & b)
+{
+	for (uint64_t address = 0; address < 256; address++) {
+		SymbolicValue x = a.g_sym8(address);
+		SymbolicValue y = b.g_sym8(address);
+		if (x.g_wild() != y.g_wild())
+			return false;
+		if ((not x.g_wild()) && (x.g_uint64() != y.g_uint64()))
+			return false;
+	}
+	return true;
+}
+
+// runs block compiled, decoded and interpreted from the same variables and
+// memory, and checks all three stop at the same place with the same results
+void check (std::list <Instruction *> & ir, Variables & variables, Memory & memory,
+            size_t expected_index)
+{
+	Variables interpreted = variables;
+	Memory interpreted_memory = memory;
+	size_t index = run(ir, interpreted, interpreted_memory);
+	assert(index == expected_index);
+
+	for (int tier = 0; tier < 2; tier++) {
+		JitBlock * block = tier ? JitBlock::compile(ir) : JitBlock::decode(ir);
+		assert(block != NULL);
+		assert(block->g_compiled() == (tier == 1));
+
+		std::vector <uint64_t> native(block->g_variable_count(), 0xdeadbeefdeadbeefULL);
+		for (size_t i = 0; i < block->g_inputs().size(); i++) {
+			uint64_t id = block->g_inputs()[i];
+			assert(variables.count(id));
+			native[id] = variables[id].g_uint64();
+		}
+
+		Memory block_memory = memory;
+		const JitExit & exit = block->run(&(native[0]), &block_memory);
+		assert(exit.index == index);
+		assert(same(block_memory, interpreted_memory));
+
+		Variables result = variables;
+		for (size_t i = 0; i < exit.writes.size(); i++)
+			result[exit.writes[i].first] = SymbolicValue(exit.writes[i].second,
+			                                             native[exit.writes[i].first]);
+
+		Variables :: iterator it;
+		for (it = interpreted.begin(); it != interpreted.end(); it++) {
+			// temporaries are only handed back when the interpreter carries on
+			if ((it->first >= SLOT_COUNT) && (index == ir.size()))
+				continue;
+			assert(result.count(it->first));
+			assert(result[it->first].g_bits() == it->second.g_bits());
+			assert(result[it->first].g_uint64() == it->second.g_uint64());
+		}
+
+		block_memory.destroy();
+		delete block;
+	}
+	interpreted_memory.destroy();
+}
+
+Variables seeded (uint64_t seed)
+{
+	Variables variables;
+	for (int i = 0; i < SLOT_COUNT; i++)
+		variables[i] = SymbolicValue(64, seed * (i + 0x9e3779b9));
+	for (int i = SLOT_ZF; i <= SLOT_DF; i++)
+		variables[i] = SymbolicValue(1, (seed >> i) & 1);
+	return variables;
+}
+
+InstructionOperand operand (int bits, std::vector <InstructionOperand> & temporaries)
+{
+	switch (next() % 4) {
+	case 0 :
+		return InstructionOperand(OPTYPE_CONSTANT, bits, next() >> (next() % 64));
+	case 1 :
+		if (temporaries.size()) {
+			InstructionOperand tmp = temporaries[next() % temporaries.size()];
+			tmp.s_bits(bits);
+			return tmp;
+		}
+	}
+	return InstructionOperand(OPTYPE_VAR, bits, names[next() % 6]);
+}
+
+// random arithmetic over registers and temporaries of every width
+void test_1 ()
+{
+	int widths[] = {1, 8, 16, 32, 64};
+	int odd[]    = {1, 5, 8, 13, 16, 31, 32, 40, 64};
+
+	for (int round = 0; round < 200; round++) {
+		InstructionArena arena;
+		std::list <Instruction *> ir;
+		std::vector <InstructionOperand> temporaries;
+		InstructionOperandTmpVar::get().reset();
+
+		for (int i = 0; i < 40; i++) {
+			int w = odd[next() % 9];
+			int s = widths[next() % 5];
+			InstructionOperand lhs = operand(w, temporaries);
+			InstructionOperand rhs = operand(w, temporaries);
+			InstructionOperand slhs = operand(s, temporaries);
+			InstructionOperand srhs = operand(s, temporaries);
+			InstructionOperand dst;
+			if (next() % 2) {
+				dst = InstructionOperand(OPTYPE_VAR, odd[next() % 9]);
+				temporaries.push_back(dst);
+			}
+			else
+				dst = InstructionOperand(OPTYPE_VAR, odd[next() % 9], names[next() % 6]);
+			InstructionOperand count(OPTYPE_CONSTANT, w, next() % 64);
+			InstructionOperand nonzero(OPTYPE_CONSTANT, w, (next() & mask(w)) | 1);
+
+			switch (next() % 16) {
+			case 0  : ir.push_back(new (arena) InstructionAdd(0, 1, dst, lhs, rhs)); break;
+			case 1  : ir.push_back(new (arena) InstructionSub(0, 1, dst, lhs, rhs)); break;
+			case 2  : ir.push_back(new (arena) InstructionAnd(0, 1, dst, lhs, rhs)); break;
+			case 3  : ir.push_back(new (arena) InstructionOr(0, 1, dst, lhs, rhs));  break;
+			case 4  : ir.push_back(new (arena) InstructionXor(0, 1, dst, lhs, rhs)); break;
+			case 5  : ir.push_back(new (arena) InstructionMul(0, 1, dst, lhs, rhs)); break;
+			case 6  : ir.push_back(new (arena) InstructionShl(0, 1, dst, lhs, count)); break;
+			case 7  : ir.push_back(new (arena) InstructionShr(0, 1, dst, lhs, count)); break;
+			case 8  : ir.push_back(new (arena) InstructionDiv(0, 1, dst, lhs, nonzero)); break;
+			case 9  : ir.push_back(new (arena) InstructionMod(0, 1, dst, lhs, nonzero)); break;
+			case 10 : ir.push_back(new (arena) InstructionNot(0, 1, dst, lhs));    break;
+			case 11 : ir.push_back(new (arena) InstructionAssign(0, 1, dst, lhs)); break;
+			case 12 : ir.push_back(new (arena) InstructionSignExtend(0, 1, dst, slhs)); break;
+			case 13 : ir.push_back(new (arena) InstructionCmpLts(0, 1, dst, slhs, srhs)); break;
+			case 14 : ir.push_back(new (arena) InstructionCmpLes(0, 1, dst, slhs, srhs)); break;
+			case 15 :
+				switch (next() % 3) {
+				case 0 : ir.push_back(new (arena) InstructionCmpEq(0, 1, dst, lhs, rhs));  break;
+				case 1 : ir.push_back(new (arena) InstructionCmpLtu(0, 1, dst, lhs, rhs)); break;
+				case 2 : ir.push_back(new (arena) InstructionCmpLeu(0, 1, dst, lhs, rhs)); break;
+				}
+				break;
+			}
+		}
+
+		std::map <uint64_t, Page *> pages;
+		pages[0] = new Page(4096);
+		Memory memory(pages);
+		Variables variables = seeded(next());
+		check(ir, variables, memory, ir.size());
+		memory.destroy();
+	}
+}
+
+// every kind of InstructionFlags, against the VM's flags
+void test_2 ()
+{
+	int kinds[]  = {FLAGS_ADD, FLAGS_SUB, FLAGS_SBB, FLAGS_CMP, FLAGS_LOGIC, FLAGS_INCDEC};
+	int widths[] = {8, 16, 32, 64};
+	uint64_t values[] = {0, 1, 0x7f, 0x80, 0xff, 0x7fffffff, 0x80000000ULL,
+	                     0x7fffffffffffffffULL, 0x8000000000000000ULL,
+	                     0xffffffffffffffffULL};
+	const size_t count = sizeof(values) / sizeof(uint64_t);
+
+	std::map <uint64_t, Page *> pages;
+	pages[0] = new Page(4096);
+	Memory memory(pages);
+
+	for (int k = 0; k < 6; k++) {
+		for (int w = 0; w < 4; w++) {
+			InstructionArena arena;
+			std::list <Instruction *> ir;
+			InstructionOperandTmpVar::get().reset();
+			InstructionOperand rax (OPTYPE_VAR, widths[w], "UD_R_RAX");
+			InstructionOperand rbx (OPTYPE_VAR, widths[w], "UD_R_RBX");
+			InstructionOperand tmp (OPTYPE_VAR, widths[w]);
+			ir.push_back(new (arena) InstructionSub(0, 1, tmp, rax, rbx));
+			ir.push_back(new (arena) InstructionFlags(0, 1, kinds[k], rax, rbx, tmp));
+
+			for (size_t a = 0; a < count; a++) {
+				for (size_t b = 0; b < count; b++) {
+					Variables variables = seeded(a * count + b);
+					variables[SLOT_RAX] = SymbolicValue(64, values[a]);
+					variables[SLOT_RBX] = SymbolicValue(64, values[b]);
+					check(ir, variables, memory, ir.size());
+				}
+			}
+		}
+	}
+	memory.destroy();
+}
+
+// loads and stores go through memory, and branches set RIP
+void test_3 ()
+{
+	InstructionArena arena;
+	std::list <Instruction *> ir;
+	InstructionOperandTmpVar::get().reset();
+	InstructionOperand rax (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand rbx (OPTYPE_VAR, 64, "UD_R_RBX");
+	InstructionOperand ecx (OPTYPE_VAR, 32, "UD_R_RCX");
+	InstructionOperand tmp (OPTYPE_VAR, 64);
+	InstructionOperand one (OPTYPE_VAR, 1);
+	InstructionOperand two (OPTYPE_CONSTANT, 64, 2);
+	InstructionOperand target (OPTYPE_CONSTANT, 64, 0x401000);
+
+	// [rax] += rbx, then ecx = [rax + 2] and branch on its low bit
+	ir.push_back(new (arena) InstructionLoad(0, 1, 64, tmp, rax));
+	ir.push_back(new (arena) InstructionAdd(0, 1, tmp, tmp, rbx));
+	ir.push_back(new (arena) InstructionStore(0, 1, 64, rax, tmp));
+	ir.push_back(new (arena) InstructionAdd(0, 1, tmp, rax, two));
+	ir.push_back(new (arena) InstructionLoad(0, 1, 32, ecx, tmp));
+	ir.push_back(new (arena) InstructionAssign(0, 1, one, ecx));
+	ir.push_back(new (arena) InstructionBrc(0, 1, one, target));
+
+	for (int round = 0; round < 16; round++) {
+		std::map <uint64_t, Page *> pages;
+		pages[0] = new Page(4096);
+		Memory memory(pages);
+		for (int i = 0; i < 64; i++)
+			memory.s_byte(i, next());
+
+		Variables variables = seeded(next());
+		variables[SLOT_RAX] = SymbolicValue(64, round * 3);
+		check(ir, variables, memory, ir.size());
+
+		memory.destroy();
+	}
+}
+
+// a wild byte, an unmapped address, a zero divisor and a syscall each hand
+// the block to the interpreter at that instruction
+void test_4 ()
+{
+	InstructionArena arena;
+	InstructionOperandTmpVar::get().reset();
+	InstructionOperand rax  (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand rbx  (OPTYPE_VAR, 64, "UD_R_RBX");
+	InstructionOperand rcx  (OPTYPE_VAR, 64, "UD_R_RCX");
+	InstructionOperand tmp  (OPTYPE_VAR, 64);
+	InstructionOperand zero (OPTYPE_CONSTANT, 64, 0);
+	InstructionOperand wild (OPTYPE_CONSTANT, 64, 0x10);
+	InstructionOperand far  (OPTYPE_CONSTANT, 64, 0x100000);
+	InstructionOperand big  (OPTYPE_CONSTANT, 64, 64);
+
+	std::map <uint64_t, Page *> pages;
+	pages[0] = new Page(4096);
+	Memory memory(pages);
+	memory.s_sym8(0x10, SymbolicValue(8));
+
+	Instruction * stops[] = {
+		new (arena) InstructionLoad(0, 1, 8, rcx, wild),
+		new (arena) InstructionStore(0, 1, 32, far, rax),
+		new (arena) InstructionDiv(0, 1, rcx, rax, zero),
+		new (arena) InstructionShl(0, 1, rcx, rax, big),
+		new (arena) InstructionSyscall(0, 1)
+	};
+
+	for (int i = 0; i < 5; i++) {
+		std::list <Instruction *> ir;
+		ir.push_back(new (arena) InstructionAdd(0, 1, tmp, rax, rbx));
+		ir.push_back(new (arena) InstructionAssign(0, 1, rax, tmp));
+		ir.push_back(stops[i]);
+		ir.push_back(new (arena) InstructionAssign(0, 1, rbx, tmp));
+
+		Variables variables = seeded(i + 1);
+		check(ir, variables, memory, 2);
+	}
+
+	memory.destroy();
+}
+
+int main (int argc, char * argv[])
+{
+	test_1(); std::cout << "test_1 pass" << std::endl;
+	test_2(); std::cout << "test_2 pass" << std::endl;
+	test_3(); std::cout << "test_3 pass" << std::endl;
+	test_4(); std::cout << "test_4 pass" << std::endl;
+
+	return 0;
+}
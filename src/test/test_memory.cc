@@ -82,12 +82,170 @@ void test_4 ()
 	memory.destroy();
 }
 
+void test_5 ()
+{
+	std::map <uint64_t, Page *> pages;
+
+	pages[0x1000] = new Page(0x1000);
+	pages[0x2000] = new Page(0x1000);
+	pages[0x3000] = new Page(0x1000);
+
+	Memory memory(pages);
+	memory.s_byte(0x1000, 1);
+	memory.s_sym8(0x2000, SymbolicValue(8));
+
+	// a copy sees what was written before it, and neither side sees what
+	// the other writes after
+	Memory child = memory.copy();
+	assert(child.g_byte(0x1000) == 1);
+	assert(child.g_sym8(0x2000).g_wild());
+
+	child.s_byte(0x1000, 2);
+	child.s_sym8(0x2000, SymbolicValue(8, 3));
+	memory.s_byte(0x2080, 4);
+	// the frame memory wrote before the copy is shared now
+	memory.s_byte(0x1001, 5);
+	assert(child.g_byte(0x1001) == 0);
+
+	assert(memory.g_byte(0x1000) == 1);
+	assert(memory.g_sym8(0x2000).g_wild());
+	assert(child.g_byte(0x1000) == 2);
+	assert(child.g_byte(0x2000) == 3);
+	assert(not child.g_sym8(0x2000).g_wild());
+	assert(child.g_byte(0x2080) == 0);
+	assert(memory.g_byte(0x2080) == 4);
+	// neither wrote this frame
+	assert(child.g_page(0x3000) == memory.g_page(0x3000));
+
+	child.destroy();
+	memory.destroy();
+}
+
+void test_6 ()
+{
+	std::map <uint64_t, Page *> pages;
+
+	pages[0x1000] = new Page(0x2000);
+
+	Memory memory(pages);
+
+	// accesses straddling two frames
+	memory.s_qword(0x1ffd, 0x0123456789abcdefULL);
+	assert(memory.g_qword(0x1ffd) == 0x0123456789abcdefULL);
+	assert(memory.g_dword(0x1fff) == 0x456789ab);
+	assert(memory.g_byte(0x2000) == 0x89);
+
+	uint8_t data[8];
+	assert(memory.g_data(0x1ffd, data, 8) == 8);
+	assert(data[7] == 0x01);
+
+	memory.destroy();
+}
+
+void test_7 ()
+{
+	std::map <uint64_t, Page *> pages;
+
+	pages[0x1000] = new Page(0x2000);
+
+	Memory memory(pages);
+	memory.s_dword(0x1100, 0x11223344);
+	assert(memory.g_sym32(0x1100).g_uint64() == 0x11223344);
+
+	// one symbolic byte makes the loads covering it symbolic
+	memory.s_sym8(0x1101, SymbolicValue(8));
+	assert(memory.g_page(0x1000)->g_symbolic());
+	assert(memory.g_sym32(0x1100).g_wild());
+	assert(not memory.g_sym8(0x1100).g_wild());
+
+	// and a concrete store over it makes the frame concrete again
+	memory.s_dword(0x1100, 0x55667788);
+	assert(not memory.g_page(0x1000)->g_symbolic());
+	assert(memory.g_sym32(0x1100).g_uint64() == 0x55667788);
+
+	// a symbolic store is read back as one concat of its bytes, across frames
+	SymbolicValue wild (32);
+	memory.s_sym32(0x1ffe, wild);
+	assert(memory.g_sym32(0x1ffe).g_wild());
+	assert(memory.g_sym16(0x1ffd).g_wild());
+	assert(memory.g_sym8(0x1ffc).g_uint64() == 0);
+
+	memory.destroy();
+}
+
+void test_8 ()
+{
+	std::map <uint64_t, Page *> pages;
+
+	pages[0x1000] = new Page(0x1000);
+
+	Memory memory(pages);
+
+	// lookups report a miss, and only accesses fault
+	assert(memory.g_page(0x2000) == NULL);
+	assert(memory.g_data(0x1ffc, NULL, 0) == 0);
+
+	bool faulted = false;
+	try {
+		memory.s_dword(0x1ffe, 0);
+	}
+	catch (MemoryFault & fault) {
+		faulted = (fault.address == 0x2000) && (fault.access == FAULT_WRITE);
+	}
+	assert(faulted);
+
+	memory.destroy();
+}
+
+// bulk string operations cross frames, and change nothing when they can't
+// finish
+void test_9 ()
+{
+	std::map <uint64_t, Page *> pages;
+
+	pages[0x1000] = new Page(0x1000);
+	pages[0x2000] = new Page(0x1000);
+
+	Memory memory(pages);
+
+	// a dword pattern across the frame boundary, starting mid dword
+	assert(memory.fill(0x1ffe, 0x44332211, 4, 8));
+	assert(memory.g_dword(0x1ffe) == 0x44332211);
+	assert(memory.g_dword(0x2002) == 0x44332211);
+	assert(memory.g_byte(0x2006) == 0);
+	assert(not memory.fill(0x2ffc, 0xffffffff, 4, 8));
+	assert(memory.g_byte(0x2ffc) == 0);
+
+	assert(memory.move(0x1100, 0x1ffe, 8));
+	assert(memory.g_qword(0x1100) == memory.g_qword(0x1ffe));
+
+	// scans stop at the value, at a symbolic byte or at an unmapped frame
+	assert(memory.scan(0x1ffe, false, 0x33, 0x100) == 2);
+	assert(memory.scan(0x2005, true, 0x11, 0x100) == 3);
+	assert(memory.scan(0x1ffe, false, 0x55, 4) == 4);
+	assert(memory.scan(0x2f00, false, 0x55, 0x200) == 0x100);
+	memory.s_sym8(0x2004, SymbolicValue(8));
+	assert(memory.scan(0x1ffe, false, 0x55, 0x100) == 6);
+	assert(memory.scan(0x2007, true, 0x55, 0x100) == 3);
+
+	// a copy reading a symbolic byte is left alone
+	assert(not memory.move(0x1100, 0x2000, 8));
+	assert(memory.g_qword(0x1100) == memory.g_qword(0x1ffe));
+
+	memory.destroy();
+}
+
 int main (int argc, char * argv[])
 {
 	test_1(); std::cout << "test_1 pass" << std::endl;
 	test_2(); std::cout << "test_2 pass" << std::endl;
 	test_3(); std::cout << "test_3 pass" << std::endl;
 	test_1(); std::cout << "test_4 pass" << std::endl;
+	test_5(); std::cout << "test_5 pass" << std::endl;
+	test_6(); std::cout << "test_6 pass" << std::endl;
+	test_7(); std::cout << "test_7 pass" << std::endl;
+	test_8(); std::cout << "test_8 pass" << std::endl;
+	test_9(); std::cout << "test_9 pass" << std::endl;
 
 	return 0;
 }
\ No newline at end of file
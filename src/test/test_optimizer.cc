@@ -0,0 +1,267 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <map>
+
+#include "../instruction.h"
+#include "../optimizer.h"
+#include "../registers.h"
+#include "../symbolicvalue.h"
+
+typedef std::map <uint64_t, SymbolicValue> Variables;
+
+// runs straight line IR the way the VM does
+SymbolicValue value (Variables & variables, InstructionOperand operand)
+{
+	if (operand.g_type() == OPTYPE_CONSTANT)
+		return SymbolicValue(operand.g_bits(), operand.g_value());
+	return variables[operand.g_id()].extend(operand.g_bits());
+}
+
+void run (std::list <Instruction *> & instructions, Variables & variables)
+{
+	std::list <Instruction *> :: iterator it;
+	for (it = instructions.begin(); it != instructions.end(); it++) {
+		#define BINOP(OPCODE, XX, EXPR) \
+		case OPCODE : { \
+			XX * ins = static_cast<XX *>(*it); \
+			SymbolicValue lhs = value(variables, ins->g_lhs()); \
+			SymbolicValue rhs = value(variables, ins->g_rhs()); \
+			variables[ins->g_dst().g_id()] = (EXPR).extend(ins->g_dst().g_bits()); \
+			break; \
+		}
+		switch ((*it)->g_opcode()) {
+		BINOP(IOP_ADD,    InstructionAdd,    lhs + rhs)
+		BINOP(IOP_AND,    InstructionAnd,    lhs & rhs)
+		BINOP(IOP_OR,     InstructionOr,     lhs | rhs)
+		BINOP(IOP_SHL,    InstructionShl,    lhs << rhs)
+		BINOP(IOP_SUB,    InstructionSub,    lhs - rhs)
+		BINOP(IOP_XOR,    InstructionXor,    lhs ^ rhs)
+		BINOP(IOP_CMPEQ,  InstructionCmpEq,  lhs == rhs)
+		BINOP(IOP_CMPLTS, InstructionCmpLts, lhs.cmpLts(rhs))
+		BINOP(IOP_CMPLTU, InstructionCmpLtu, lhs.cmpLtu(rhs))
+		case IOP_ASSIGN : {
+			InstructionAssign * ins = static_cast<InstructionAssign *>(*it);
+			variables[ins->g_dst().g_id()] = value(variables, ins->g_src()).extend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_NOT : {
+			InstructionNot * ins = static_cast<InstructionNot *>(*it);
+			variables[ins->g_dst().g_id()] = (~ value(variables, ins->g_src())).extend(ins->g_dst().g_bits());
+			break;
+		}
+		case IOP_SYSCALL :
+			variables[SLOT_RAX] = SymbolicValue(64, 60);
+			break;
+		default :
+			assert(false);
+		}
+	}
+}
+
+// true if ir and optimized leave every register the same, from a few
+// different starting points
+bool equivalent (std::list <Instruction *> & ir, std::list <Instruction *> & optimized)
+{
+	uint64_t seeds[] = {0, 1, 0x80, 0xff, 0x1234, 0xffffffffffffffffULL, 0x8000000000000000ULL};
+
+	for (size_t s = 0; s < sizeof(seeds) / sizeof(uint64_t); s++) {
+		Variables a;
+		Variables b;
+		for (int i = 0; i < SLOT_COUNT; i++) {
+			a[i] = SymbolicValue(64, seeds[s] * (i + 1));
+			b[i] = a[i];
+		}
+		run(ir, a);
+		run(optimized, b);
+		for (int i = 0; i < SLOT_COUNT; i++) {
+			if (a[i].g_uint64() != b[i].g_uint64())
+				return false;
+		}
+	}
+	return true;
+}
+
+// add rax, rbx, with its flags
+void add (std::list <Instruction *> & ir, InstructionArena & arena, const char * dst_name, const char * src_name)
+{
+	InstructionOperand dst (OPTYPE_VAR, 64, dst_name);
+	InstructionOperand src (OPTYPE_VAR, 64, src_name);
+	InstructionOperand tmp (OPTYPE_VAR, 64);
+	InstructionOperand CF  (OPTYPE_VAR, 1, "CF");
+	InstructionOperand ZF  (OPTYPE_VAR, 1, "ZF");
+	InstructionOperand SF  (OPTYPE_VAR, 1, "SF");
+	InstructionOperand zero (OPTYPE_CONSTANT, 64, 0);
+
+	ir.push_back(new (arena) InstructionAdd(0, 3, tmp, dst, src));
+	ir.push_back(new (arena) InstructionCmpLtu(0, 3, CF, tmp, dst));
+	ir.push_back(new (arena) InstructionCmpEq(0, 3, ZF, tmp, zero));
+	ir.push_back(new (arena) InstructionCmpLts(0, 3, SF, tmp, zero));
+	ir.push_back(new (arena) InstructionAssign(0, 3, dst, tmp));
+}
+
+// the translator's write of value to al
+void set_al (std::list <Instruction *> & ir, InstructionArena & arena, InstructionOperand value)
+{
+	InstructionOperand dst  (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand one  (OPTYPE_CONSTANT, 64, 1);
+	InstructionOperand bits (OPTYPE_CONSTANT, 64, 8);
+	InstructionOperand mask (OPTYPE_VAR, 64);
+	InstructionOperand tmp  (OPTYPE_VAR, 64);
+	ir.push_back(new (arena) InstructionShl(0, 2, mask, one, bits));
+	ir.push_back(new (arena) InstructionSub(0, 2, mask, mask, one));
+	ir.push_back(new (arena) InstructionNot(0, 2, mask, mask));
+	ir.push_back(new (arena) InstructionAnd(0, 2, tmp, dst, mask));
+	ir.push_back(new (arena) InstructionOr(0, 2, dst, tmp, value));
+}
+
+// constant masks fold, leaving one and and one or
+void test_1 ()
+{
+	InstructionArena arena;
+	PassManager passes;
+	std::list <Instruction *> ir;
+
+	InstructionOperandTmpVar::get().reset();
+	set_al(ir, arena, InstructionOperand(OPTYPE_VAR, 8, "UD_R_RBX"));
+
+	std::list <Instruction *> optimized = ir;
+	assert(passes.run(optimized, arena) == 3);
+	assert(optimized.size() == 2);
+	assert(optimized.front()->g_opcode() == IOP_AND);
+	assert(equivalent(ir, optimized));
+}
+
+// flags overwritten by the next add are dead, the last add's are not
+void test_2 ()
+{
+	InstructionArena arena;
+	PassManager passes;
+	std::list <Instruction *> ir;
+
+	InstructionOperandTmpVar::get().reset();
+	add(ir, arena, "UD_R_RAX", "UD_R_RBX");
+	add(ir, arena, "UD_R_RCX", "UD_R_RDX");
+
+	std::list <Instruction *> optimized = ir;
+	assert(passes.run(optimized, arena) == 3);
+	assert(optimized.size() == 7);
+	assert(equivalent(ir, optimized));
+}
+
+// copies are only read through at widths the copy kept
+void test_3 ()
+{
+	InstructionArena arena;
+	PassManager passes;
+	std::list <Instruction *> ir;
+
+	InstructionOperandTmpVar::get().reset();
+	InstructionOperand rax  (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand rbx  (OPTYPE_VAR, 64, "UD_R_RBX");
+	InstructionOperand rcx  (OPTYPE_VAR, 64, "UD_R_RCX");
+	InstructionOperand ebx  (OPTYPE_VAR, 32, "UD_R_RBX");
+	InstructionOperand t32  (OPTYPE_VAR, 32);
+	InstructionOperand t64  (OPTYPE_VAR, 64);
+	InstructionOperand r64  (OPTYPE_VAR, 64);
+	InstructionOperand r32  (OPTYPE_VAR, 32);
+
+	// t32 = rax truncates, so a 64 bit read of t32 must not become rax
+	ir.push_back(new (arena) InstructionAssign(0, 1, t32, rax));
+	InstructionOperand t32_64 = t32;
+	t32_64.s_bits(64);
+	ir.push_back(new (arena) InstructionAssign(0, 1, r64, t32_64));
+	ir.push_back(new (arena) InstructionAssign(0, 1, rcx, r64));
+	// t64 = rbx, then rbx changes, so t64 can't be read through
+	ir.push_back(new (arena) InstructionAssign(0, 1, t64, rbx));
+	ir.push_back(new (arena) InstructionXor(0, 1, rbx, rbx, rax));
+	ir.push_back(new (arena) InstructionAssign(0, 1, r32, t64));
+	ir.push_back(new (arena) InstructionAssign(0, 1, ebx, r32));
+
+	std::list <Instruction *> optimized = ir;
+	passes.run(optimized, arena);
+	assert(equivalent(ir, optimized));
+}
+
+// a syscall reads every register and may change any of them
+void test_4 ()
+{
+	InstructionArena arena;
+	PassManager passes;
+	std::list <Instruction *> ir;
+
+	InstructionOperandTmpVar::get().reset();
+	InstructionOperand rax   (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand rdi   (OPTYPE_VAR, 64, "UD_R_RDI");
+	InstructionOperand tmp   (OPTYPE_VAR, 64);
+	InstructionOperand sixty (OPTYPE_CONSTANT, 64, 60);
+	InstructionOperand one   (OPTYPE_CONSTANT, 64, 1);
+
+	ir.push_back(new (arena) InstructionAssign(0, 1, rax, sixty));
+	ir.push_back(new (arena) InstructionAssign(0, 1, rdi, one));
+	ir.push_back(new (arena) InstructionSyscall(0, 1));
+	ir.push_back(new (arena) InstructionAdd(0, 1, tmp, rax, one));
+	ir.push_back(new (arena) InstructionAssign(0, 1, rdi, tmp));
+	ir.push_back(new (arena) InstructionAssign(0, 1, rax, one));
+
+	std::list <Instruction *> optimized = ir;
+	assert(passes.run(optimized, arena) == 0);
+	std::list <Instruction *> :: iterator it = optimized.begin();
+	std::advance(it, 3);
+	assert((*it)->g_opcode() == IOP_ADD);
+	assert(equivalent(ir, optimized));
+}
+
+// a temporary read before the block writes it would see the last block's
+void test_5 ()
+{
+	InstructionArena arena;
+	std::list <Instruction *> ir;
+
+	InstructionOperandTmpVar::get().reset();
+	set_al(ir, arena, InstructionOperand(OPTYPE_VAR, 8, "UD_R_RBX"));
+	assert(temporaries_defined(ir));
+
+	InstructionOperand rax (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand tmp (OPTYPE_VAR, 64);
+	ir.push_back(new (arena) InstructionAssign(0, 1, rax, tmp));
+	ir.push_back(new (arena) InstructionAssign(0, 1, tmp, rax));
+	assert(not temporaries_defined(ir));
+}
+
+// flags are dead once another InstructionFlags sets them all, but inc and dec
+// leave CF to the one before
+void test_6 ()
+{
+	InstructionArena arena;
+	PassManager passes;
+	std::list <Instruction *> ir;
+
+	InstructionOperandTmpVar::get().reset();
+	InstructionOperand rax (OPTYPE_VAR, 64, "UD_R_RAX");
+	InstructionOperand rbx (OPTYPE_VAR, 64, "UD_R_RBX");
+	InstructionOperand one (OPTYPE_CONSTANT, 64, 1);
+
+	ir.push_back(new (arena) InstructionFlags(0, 1, FLAGS_ADD, rax, rbx, rax));
+	ir.push_back(new (arena) InstructionFlags(0, 1, FLAGS_SUB, rax, rbx, rax));
+	ir.push_back(new (arena) InstructionFlags(0, 1, FLAGS_INCDEC, rax, one, rbx));
+
+	std::list <Instruction *> optimized = ir;
+	assert(passes.run(optimized, arena) == 1);
+	assert(optimized.size() == 2);
+	assert(static_cast<InstructionFlags *>(optimized.front())->g_kind() == FLAGS_SUB);
+}
+
+int main (int argc, char * argv[])
+{
+	test_1(); std::cout << "test_1 pass" << std::endl;
+	test_2(); std::cout << "test_2 pass" << std::endl;
+	test_3(); std::cout << "test_3 pass" << std::endl;
+	test_4(); std::cout << "test_4 pass" << std::endl;
+	test_5(); std::cout << "test_5 pass" << std::endl;
+	test_6(); std::cout << "test_6 pass" << std::endl;
+
+	return 0;
+}
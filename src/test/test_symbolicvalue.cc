@@ -1,39 +1,220 @@
+#include "../solver.h"
 #include "../symbolicvalue.h"
 
+#include <algorithm>
 #include <iostream>
+#include <random>
+#include <set>
+
+#include <z3++.h>
+
+// every constraint sharing a leaf with vars, directly or through other
+// constraints, found by sweeping over all of them until nothing changes
+std::set <size_t> naive_members (const std::vector <std::vector <uint64_t>> & constraints,
+                                 const std::vector <uint64_t> & vars)
+{
+	std::set <uint64_t> leaves(vars.begin(), vars.end());
+	std::set <size_t>   result;
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t i = 0; i < constraints.size(); i++) {
+			if (result.count(i))
+				continue;
+			bool shares = false;
+			for (size_t j = 0; j < constraints[i].size(); j++) {
+				if (leaves.count(constraints[i][j]))
+					shares = true;
+			}
+			if (shares) {
+				result.insert(i);
+				leaves.insert(constraints[i].begin(), constraints[i].end());
+				changed = true;
+			}
+		}
+	}
+
+	return result;
+}
+
+// pushes, pops and queries LeafGroups at random, checking every query against
+// naive_members
+bool leaf_groups_match ()
+{
+	std::mt19937 random(1);
+	LeafGroups groups;
+	std::vector <std::vector <uint64_t>> constraints;
+
+	for (int i = 0; i < 20000; i++) {
+		int action = random() % 10;
+		if ((action < 4) && (not constraints.empty())) {
+			groups.pop();
+			constraints.pop_back();
+		}
+		else if (action < 8) {
+			std::vector <uint64_t> vars;
+			int count = random() % 4;
+			for (int j = 0; j < count; j++)
+				vars.push_back(random() % 30);
+			std::sort(vars.begin(), vars.end());
+			vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+			groups.push(vars);
+			constraints.push_back(vars);
+		}
+		else {
+			std::vector <uint64_t> vars;
+			int count = 1 + random() % 3;
+			for (int j = 0; j < count; j++)
+				vars.push_back(random() % 30);
+			std::vector <size_t> result;
+			groups.members(vars, result);
+			std::set <size_t> found(result.begin(), result.end());
+			if (    (found.size() != result.size())
+			     || (found != naive_members(constraints, vars)))
+				return false;
+		}
+	}
+
+	return true;
+}
 
 int main ()
 {
+	Solver solver;
+	Path none;
+
 	SymbolicValue wild (32);
 	SymbolicValue one  (32, 1);
 
-	if ((wild.svassert(one))) std::cout << "pass" << std::endl;
-	else                      std::cout << "fail" << std::endl;
+	if (solver.satisfiable(none, wild, one)) std::cout << "pass" << std::endl;
+	else                                       std::cout << "fail" << std::endl;
 
 
 	SymbolicValue wild2 = wild;
 
-	if (wild.svassert(wild2)) std::cout << "pass" << std::endl;
-	else                      std::cout << "fail" << std::endl;
+	if (solver.satisfiable(none, wild, wild2)) std::cout << "pass" << std::endl;
+	else                                       std::cout << "fail" << std::endl;
 
 
 	SymbolicValue notWild = ~wild;
 
-	if (wild.svassert(notWild)) std::cout << "fail" << std::endl;
-	else                        std::cout << "pass" << std::endl;
+	if (solver.satisfiable(none, wild, notWild)) std::cout << "fail" << std::endl;
+	else                                         std::cout << "pass" << std::endl;
 
 	SymbolicValue notWildPlusOne = notWild + one;
 
-	if (wild.svassert(notWildPlusOne)) std::cout << "pass" << std::endl;
-	else                               std::cout << "fail" << std::endl;
+	if (solver.satisfiable(none, wild, notWildPlusOne)) std::cout << "pass" << std::endl;
+	else                                                std::cout << "fail" << std::endl;
 
 	SymbolicValue two  (32, 2);
 	SymbolicValue lt2 = wild.cmpLtu(two);
 
-	if (lt2.svassert(one)) std::cout << "pass" << std::endl;
-	else                   std::cout << "fail" << std::endl;
-	if (lt2.svassert(two)) std::cout << "fail" << std::endl;
-	else                   std::cout << "pass" << std::endl;
+	if (solver.satisfiable(none, lt2, one)) std::cout << "pass" << std::endl;
+	else                                    std::cout << "fail" << std::endl;
+	if (solver.satisfiable(none, lt2, two)) std::cout << "fail" << std::endl;
+	else                                    std::cout << "pass" << std::endl;
+
+	// a new query over lt2 should find lt2 already translated
+	uint64_t hits = solver.g_symbolic_context()->g_hits();
+	solver.satisfiable(none, lt2 + one, one);
+	if (solver.g_symbolic_context()->g_hits() > hits) std::cout << "pass" << std::endl;
+	else                                              std::cout << "fail" << std::endl;
+
+	// asking the same question twice should not go back to z3
+	uint64_t checks = solver.g_checks();
+	solver.satisfiable(none, lt2, one);
+	if (solver.g_checks() == checks) std::cout << "pass" << std::endl;
+	else                             std::cout << "fail" << std::endl;
+
+	// a path through lt2 == 1 is satisfied by the model found for it, and a
+	// path through lt2 == 2 extends a known unsat query
+	Path path;
+	path.push_back(std::pair <SymbolicValue, SymbolicValue> (lt2, one));
+	checks = solver.g_checks();
+	bool can_true, can_false;
+	solver.branch(path, lt2, can_true, can_false);
+	if (can_true && (not can_false) && (solver.g_checks() == checks + 1))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
+
+	// lt2 shares nothing with other, so it should be left out of the query
+	SymbolicValue other (32);
+	uint64_t sliced = solver.g_sliced();
+	if (    solver.satisfiable(path, other, two)
+	     && (solver.g_sliced() == sliced + 1))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
+
+	// other == wild ties other to lt2's group, so lt2 < 2 holds other below
+	// 5. going back to path and on to other == 5 undoes the tie, and leaves
+	// lt2 out of the query again
+	SymbolicValue five32 (32, 5);
+	Path tied = path;
+	tied.push_back(std::pair <SymbolicValue, SymbolicValue> (other, wild));
+	bool tied_pass =    (not solver.satisfiable(tied, other, five32))
+	                 && solver.satisfiable(tied, other, one);
+	Path untied = path;
+	untied.push_back(std::pair <SymbolicValue, SymbolicValue> (other, five32));
+	sliced = solver.g_sliced();
+	if (    tied_pass && solver.satisfiable(untied, other, five32)
+	     && (solver.g_sliced() == sliced + 1))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
+
+	// a merged value follows the path it was merged under
+	SymbolicValue taken (1);
+	SymbolicValue five  (32, 5);
+	SymbolicValue seven (32, 7);
+	SymbolicValue merged = SymbolicValue::ite(taken, five, seven);
+	Path taken_path;
+	taken_path.push_back(std::pair <SymbolicValue, SymbolicValue> (taken, SymbolicValue(1, 1)));
+	if (    solver.satisfiable(taken_path, merged, five)
+	     && (not solver.satisfiable(taken_path, merged, seven)))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
+
+	// a concat puts its high value above its low one
+	SymbolicValue high (8);
+	SymbolicValue joined = SymbolicValue::concat(high, SymbolicValue(8, 0x34));
+	if (    solver.satisfiable(none, joined, SymbolicValue(16, 0x1234))
+	     && (not solver.satisfiable(none, joined, SymbolicValue(16, 0x1235))))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
+
+	// an xor of a wild value with 0xff is 0 only when the value is 0xff
+	SymbolicValue flipped (8);
+	SymbolicValue flipped_xor = flipped ^ SymbolicValue(8, 0xff);
+	Path flipped_path;
+	flipped_path.push_back(std::pair <SymbolicValue, SymbolicValue> (flipped, SymbolicValue(8, 0xfe)));
+	if (    solver.satisfiable(none, flipped_xor, SymbolicValue(8, 0))
+	     && (not solver.satisfiable(flipped_path, flipped_xor, SymbolicValue(8, 0)))
+	     && solver.satisfiable(flipped_path, flipped_xor, SymbolicValue(8, 1)))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
+
+	if (leaf_groups_match()) std::cout << "pass" << std::endl;
+	else                     std::cout << "fail" << std::endl;
+
+	// the translation cache lets go of nodes nothing else holds once it fills
+	z3::context c;
+	SymbolicContext sc (c, 16);
+	size_t nodes = SymbolicNodeTable::get().g_size();
+	for (int i = 0; i < 100; i++) {
+		SymbolicValue x (32);
+		(x + SymbolicValue(32, i)).context(sc);
+	}
+	if (    (sc.g_size() < 16) && (sc.g_evicted() > 0)
+	     && (SymbolicNodeTable::get().g_size() < nodes + 16))
+		std::cout << "pass" << std::endl;
+	else
+		std::cout << "fail" << std::endl;
 
 	return 0;
 }
\ No newline at end of file
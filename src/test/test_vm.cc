@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -9,33 +10,350 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <list>
 #include <stdexcept>
 #include <string>
 
 #include <udis86.h>
 
 #include "../vm.h"
+#include "../kernel.h"
 #include "../lx86.h"
+#include "../solver.h"
+
+// a loader for VMs made by hand. each VM gets the registers and memory the
+// loader holds when the VM is made
+class TestLoader : public Loader {
+    public :
+        Memory       memory;
+        RegisterFile registers;
+
+        TestLoader ()
+        {
+            memory.map(0x2000, 0x1000);
+            for (int i = 0; i < SLOT_COUNT; i++)
+                registers[i] = SymbolicValue(i >= SLOT_ZF ? 1 : 64, 0);
+            registers[SLOT_RIP] = SymbolicValue(64, 0x1000);
+            registers[SLOT_RSP] = SymbolicValue(64, 0x2800);
+        }
+        ~TestLoader () { memory.destroy(); }
+
+        std::string  func_symbol (uint64_t address) { return ""; }
+        Memory       g_memory    () { return memory.copy(); }
+        RegisterFile g_registers () { return registers; }
+};
+
+std::pair <SymbolicValue, SymbolicValue> assertion (const SymbolicValue & value, uint64_t target)
+{
+    return std::pair <SymbolicValue, SymbolicValue> (value, SymbolicValue(value.g_bits(), target));
+}
+
+// value can be target on path, and nothing else
+bool follows (Solver & solver, const Path & path, const SymbolicValue & value, uint64_t target)
+{
+    return    solver.satisfiable(path, value, SymbolicValue(value.g_bits(), target))
+           && (not solver.satisfiable(path, value, SymbolicValue(value.g_bits(), target ^ 0xff)));
+}
+
+// VMs forked on c, which differ in rax and a byte of memory, merge into one
+// VM whose rax and byte follow c
+void test_merge ()
+{
+    Solver     solver;
+    TestLoader loader;
+
+    SymbolicValue x (64);
+    SymbolicValue c (1);
+    Path prefix;
+    prefix.push_back(assertion(x.cmpLtu(SymbolicValue(64, 10)), 1));
+    Path path_a = prefix;
+    path_a.push_back(assertion(c, 1));
+    Path path_b = prefix;
+    path_b.push_back(assertion(c, 0));
+
+    loader.registers[SLOT_RAX] = SymbolicValue(64, 1);
+    loader.registers[SLOT_RBX] = SymbolicValue(64, 7);
+    loader.memory.s_byte(0x2000, 0x11);
+    loader.memory.s_byte(0x2001, 0x33);
+    VM a (&loader, path_a);
+
+    loader.registers[SLOT_RAX] = SymbolicValue(64, 2);
+    loader.memory.s_byte(0x2000, 0x22);
+    VM b (&loader, path_b);
+
+    // a VM in another stack frame isn't merged
+    loader.registers[SLOT_RSP] = SymbolicValue(64, 0x2900);
+    VM other (&loader, path_b);
+    assert(not a.merge(other));
+
+    assert(a.merge(b));
+    assert(a.g_assertions().size() == prefix.size() + 1);
+    assert(solver.satisfiable(a.g_assertions(), c, SymbolicValue(1, 1)));
+    assert(solver.satisfiable(a.g_assertions(), c, SymbolicValue(1, 0)));
+
+    SymbolicValue rax = a.g_variable(SLOT_RAX);
+    assert(follows(solver, path_a, rax, 1));
+    assert(follows(solver, path_b, rax, 2));
+    // what both had stays as it was
+    assert((not a.g_variable(SLOT_RBX).g_wild()) && (a.g_variable(SLOT_RBX).g_uint64() == 7));
+
+    SymbolicValue byte = a.g_memory().g_sym8(0x2000);
+    assert(follows(solver, path_a, byte, 0x11));
+    assert(follows(solver, path_b, byte, 0x22));
+    assert(not a.g_memory().g_sym8(0x2001).g_wild());
+}
+
+// kernels compare equal until one of them changes its state
+void test_kernel ()
+{
+    Kernel       kernel;
+    Kernel       copy = kernel;
+    RegisterFile registers;
+    Memory       memory;
+
+    assert(kernel == copy);
+
+    registers[SLOT_RDI] = SymbolicValue(64, 0);
+    registers[SLOT_RSI] = SymbolicValue(64, 0x1000);
+    registers[SLOT_RDX] = SymbolicValue(64, 3);
+    registers[SLOT_R10] = SymbolicValue(64, 0x22);
+    registers[SLOT_R8]  = SymbolicValue(64, -1);
+    registers[SLOT_R9]  = SymbolicValue(64, 0);
+    copy.sys_mmap(registers, memory);
+    assert(kernel != copy);
+
+    // a write out of the end of the mapping faults at the first unmapped
+    // byte, before any file is opened
+    uint64_t end = kernel.g_next_mmap() + FRAME_SIZE;
+    registers[SLOT_RDI] = SymbolicValue(64, 1);
+    registers[SLOT_RSI] = SymbolicValue(64, end - 2);
+    registers[SLOT_RDX] = SymbolicValue(64, 4);
+    bool faulted = false;
+    try {
+        copy.sys_write(registers, memory);
+    }
+    catch (MemoryFault & fault) {
+        faulted = (fault.address == end) && (fault.access == FAULT_READ);
+    }
+    assert(faulted);
+
+    memory.destroy();
+}
+
+// where the rep string instruction of each test is, and its length
+#define REP_ADDRESS 0x1000
+#define REP_SIZE    2
+
+// the IR the translator lifts for one iteration of rep stosd, rep movsq or
+// repne scasb, without the InstructionRep it puts ahead of it
+std::list <Instruction *> rep_iteration (InstructionArena & arena, int kind)
+{
+    std::list <Instruction *> ir;
+    uint64_t a = REP_ADDRESS;
+    size_t   n = REP_SIZE;
+
+    InstructionOperandTmpVar::get().reset();
+
+    InstructionOperand rax (OPTYPE_VAR, 64, "UD_R_RAX");
+    InstructionOperand rcx (OPTYPE_VAR, 64, "UD_R_RCX");
+    InstructionOperand rsi (OPTYPE_VAR, 64, "UD_R_RSI");
+    InstructionOperand rdi (OPTYPE_VAR, 64, "UD_R_RDI");
+    InstructionOperand ZF  (OPTYPE_VAR, 1, "ZF");
+    InstructionOperand DF  (OPTYPE_VAR, 1, "DF");
+
+    int width = 0;
+    switch (kind) {
+    case REP_STOS : {
+        InstructionOperand eax (OPTYPE_VAR, 32, "UD_R_RAX");
+        ir.push_back(new (arena) InstructionStore(a, n, 32, rdi, eax));
+        width = 4;
+        break;
+    }
+    case REP_MOVS : {
+        InstructionOperand tmp (OPTYPE_VAR, 64);
+        ir.push_back(new (arena) InstructionLoad(a, n, 64, tmp, rsi));
+        ir.push_back(new (arena) InstructionStore(a, n, 64, rdi, tmp));
+        width = 8;
+        break;
+    }
+    case REPNE_SCAS : {
+        InstructionOperand al      (OPTYPE_VAR, 8);
+        InstructionOperand cmpByte (OPTYPE_VAR, 8);
+        InstructionOperand CF      (OPTYPE_VAR, 1, "CF");
+        InstructionOperand SF      (OPTYPE_VAR, 1, "SF");
+        InstructionOperand OF      (OPTYPE_VAR, 1, "OF");
+        InstructionOperand SFxorOF (OPTYPE_VAR, 1);
+        InstructionOperand tmp0    (OPTYPE_VAR, 8);
+        InstructionOperand tmp0s   (OPTYPE_CONSTANT, 8, 0);
+        ir.push_back(new (arena) InstructionAssign(a, n, al, rax));
+        ir.push_back(new (arena) InstructionLoad  (a, n, 8, cmpByte, rdi));
+        ir.push_back(new (arena) InstructionCmpLtu(a, n, CF,      cmpByte, al));
+        ir.push_back(new (arena) InstructionCmpLts(a, n, SFxorOF, cmpByte, al));
+        ir.push_back(new (arena) InstructionCmpEq (a, n, ZF,      cmpByte, al));
+        ir.push_back(new (arena) InstructionSub   (a, n, tmp0,    cmpByte, al));
+        ir.push_back(new (arena) InstructionCmpLts(a, n, SF,      tmp0, tmp0s));
+        ir.push_back(new (arena) InstructionXor   (a, n, OF,      SFxorOF, SF));
+        width = 1;
+        break;
+    }
+    }
+
+    // rdi, and rsi for movs, go up a width, or down one when DF is set
+    InstructionOperand step    (OPTYPE_VAR, 64);
+    InstructionOperand stepTmp (OPTYPE_VAR, 64);
+    InstructionOperand w       (OPTYPE_CONSTANT, 64, width);
+    InstructionOperand neg2w   (OPTYPE_CONSTANT, 64, -2 * width);
+    ir.push_back(new (arena) InstructionAssign(a, n, step, w));
+    ir.push_back(new (arena) InstructionMul   (a, n, stepTmp, neg2w, DF));
+    ir.push_back(new (arena) InstructionAdd   (a, n, step, step, stepTmp));
+    ir.push_back(new (arena) InstructionAdd   (a, n, rdi, rdi, step));
+    if (kind == REP_MOVS)
+        ir.push_back(new (arena) InstructionAdd(a, n, rsi, rsi, step));
+
+    // decrement rcx, and go round again while it isn't zero, and for repne
+    // while ZF isn't set
+    InstructionOperand one  (OPTYPE_CONSTANT, 64, 1);
+    InstructionOperand zero (OPTYPE_CONSTANT, 64, 0);
+    InstructionOperand cond (OPTYPE_VAR, 1);
+    InstructionOperand dst  (OPTYPE_CONSTANT, 64, a);
+    ir.push_back(new (arena) InstructionSub  (a, n, rcx, rcx, one));
+    ir.push_back(new (arena) InstructionCmpEq(a, n, cond, rcx, zero));
+    ir.push_back(new (arena) InstructionNot  (a, n, cond, cond));
+    if (kind == REPNE_SCAS) {
+        InstructionOperand notZF (OPTYPE_VAR, 1);
+        ir.push_back(new (arena) InstructionNot(a, n, notZF, ZF));
+        ir.push_back(new (arena) InstructionAnd(a, n, cond, cond, notZF));
+    }
+    ir.push_back(new (arena) InstructionBrc(a, n, cond, dst));
+
+    return ir;
+}
+
+// runs ir as the block at REP_ADDRESS until the VM leaves it, and returns how
+// many times it ran
+int run_rep (VM & vm, const std::list <Instruction *> & ir, size_t tmp_count)
+{
+    int runs = 0;
+    do {
+        vm.run_ir(ir, REP_SIZE, tmp_count);
+        runs++;
+    } while ((vm.g_rip() == REP_ADDRESS) && (runs < 256));
+    assert(vm.g_rip() == REP_ADDRESS + REP_SIZE);
+    return runs;
+}
+
+bool same_value (const SymbolicValue & lhs, const SymbolicValue & rhs)
+{
+    if (lhs.g_wild() || rhs.g_wild())
+        return lhs.g_wild() && rhs.g_wild() && (lhs.str() == rhs.str());
+    return lhs.g_uint64() == rhs.g_uint64();
+}
+
+// the VM made from loader ends up the same running the rep instruction with
+// the InstructionRep ahead of its IR as it does single stepping the IR alone.
+// returns the number of runs the bulk VM took, which is 1 if every iteration
+// was done at once
+int compare_rep (TestLoader & loader, int kind, int bits)
+{
+    InstructionArena arena;
+    std::list <Instruction *> single = rep_iteration(arena, kind);
+    size_t tmp_count = InstructionOperandTmpVar::get().g_count();
+    std::list <Instruction *> bulk = single;
+    bulk.push_front(new (arena) InstructionRep(REP_ADDRESS, REP_SIZE, kind, bits));
+
+    VM a (&loader, Path());
+    VM b (&loader, Path());
+    int runs = run_rep(a, bulk, tmp_count);
+    run_rep(b, single, tmp_count);
+
+    assert(same_value(a.g_variable(SLOT_RCX), b.g_variable(SLOT_RCX)));
+    assert(same_value(a.g_variable(SLOT_RDI), b.g_variable(SLOT_RDI)));
+    assert(same_value(a.g_variable(SLOT_RSI), b.g_variable(SLOT_RSI)));
+    if (kind == REPNE_SCAS)
+        assert(same_value(a.g_variable(SLOT_ZF), b.g_variable(SLOT_ZF)));
+    for (uint64_t address = 0x2000; address < 0x3000; address++)
+        assert(same_value(a.g_memory().g_sym8(address), b.g_memory().g_sym8(address)));
+
+    return runs;
+}
+
+// rep stosd, rep movsq and repne scasb run in bulk end up where running them
+// an iteration at a time does, going either way, and fall back to the
+// per-iteration IR when some of their state is symbolic
+void test_rep ()
+{
+    TestLoader loader;
+    for (uint64_t i = 0; i < 0x40; i++)
+        loader.memory.s_byte(0x2300 + i, i * 7);
+    const char * text = "abcd";
+    for (uint64_t i = 0; i < 5; i++)
+        loader.memory.s_byte(0x2500 + i, text[i]);
+
+    for (int df = 0; df < 2; df++) {
+        loader.registers[SLOT_DF]  = SymbolicValue(1, df);
+
+        loader.registers[SLOT_RAX] = SymbolicValue(64, 0x11223344);
+        loader.registers[SLOT_RCX] = SymbolicValue(64, 5);
+        loader.registers[SLOT_RDI] = SymbolicValue(64, 0x2100);
+        assert(compare_rep(loader, REP_STOS, 32) == 1);
+
+        loader.registers[SLOT_RCX] = SymbolicValue(64, 4);
+        loader.registers[SLOT_RSI] = SymbolicValue(64, df ? 0x2338 : 0x2300);
+        loader.registers[SLOT_RDI] = SymbolicValue(64, df ? 0x2438 : 0x2400);
+        assert(compare_rep(loader, REP_MOVS, 64) == 1);
+    }
+
+    // repne scasb stops on the byte it finds, with ZF set, or when RCX runs
+    // out without it, with ZF clear
+    loader.registers[SLOT_DF]  = SymbolicValue(1, 0);
+    loader.registers[SLOT_RAX] = SymbolicValue(64, 0);
+    loader.registers[SLOT_RCX] = SymbolicValue(64, 16);
+    loader.registers[SLOT_RDI] = SymbolicValue(64, 0x2500);
+    assert(compare_rep(loader, REPNE_SCAS, 8) == 1);
+
+    loader.registers[SLOT_RAX] = SymbolicValue(64, 'z');
+    loader.registers[SLOT_RCX] = SymbolicValue(64, 5);
+    assert(compare_rep(loader, REPNE_SCAS, 8) == 1);
+
+    loader.registers[SLOT_DF]  = SymbolicValue(1, 1);
+    loader.registers[SLOT_RAX] = SymbolicValue(64, 'a');
+    loader.registers[SLOT_RCX] = SymbolicValue(64, 16);
+    loader.registers[SLOT_RDI] = SymbolicValue(64, 0x2503);
+    assert(compare_rep(loader, REPNE_SCAS, 8) == 1);
+
+    // a symbolic RAX, or a symbolic byte to copy, leaves it to the IR
+    loader.registers[SLOT_DF]  = SymbolicValue(1, 0);
+    loader.registers[SLOT_RAX] = SymbolicValue(64);
+    loader.registers[SLOT_RCX] = SymbolicValue(64, 3);
+    loader.registers[SLOT_RDI] = SymbolicValue(64, 0x2600);
+    assert(compare_rep(loader, REP_STOS, 32) > 1);
+
+    loader.memory.s_sym8(0x2302, SymbolicValue(8));
+    loader.registers[SLOT_RCX] = SymbolicValue(64, 4);
+    loader.registers[SLOT_RSI] = SymbolicValue(64, 0x2300);
+    loader.registers[SLOT_RDI] = SymbolicValue(64, 0x2700);
+    assert(compare_rep(loader, REP_MOVS, 64) > 1);
+}
 
 void dump_state (VM & vm, struct user_regs_struct * regs)
 {
-    uint64_t vm_rip = vm.g_variable(InstructionOperand::str_to_id("UD_R_RIP")).g_uint64();
-    uint64_t vm_rax = vm.g_variable(InstructionOperand::str_to_id("UD_R_RAX")).g_uint64();
-    uint64_t vm_rbx = vm.g_variable(InstructionOperand::str_to_id("UD_R_RBX")).g_uint64();
-    uint64_t vm_rcx = vm.g_variable(InstructionOperand::str_to_id("UD_R_RCX")).g_uint64();
-    uint64_t vm_rdx = vm.g_variable(InstructionOperand::str_to_id("UD_R_RDX")).g_uint64();
-    uint64_t vm_rsi = vm.g_variable(InstructionOperand::str_to_id("UD_R_RSI")).g_uint64();
-    uint64_t vm_rdi = vm.g_variable(InstructionOperand::str_to_id("UD_R_RDI")).g_uint64();
-    uint64_t vm_rsp = vm.g_variable(InstructionOperand::str_to_id("UD_R_RSP")).g_uint64();
-    uint64_t vm_rbp = vm.g_variable(InstructionOperand::str_to_id("UD_R_RBP")).g_uint64();
-    uint64_t vm_r8  = vm.g_variable(InstructionOperand::str_to_id("UD_R_R8")).g_uint64();
-    uint64_t vm_r9  = vm.g_variable(InstructionOperand::str_to_id("UD_R_R9")).g_uint64();
-    uint64_t vm_r10 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R10")).g_uint64();
-    uint64_t vm_r11 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R11")).g_uint64();
-    uint64_t vm_r12 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R12")).g_uint64();
-    uint64_t vm_r13 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R13")).g_uint64();
-    uint64_t vm_r14 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R14")).g_uint64();
-    uint64_t vm_r15 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R15")).g_uint64();
+    uint64_t vm_rip = vm.g_variable(SLOT_RIP).g_uint64();
+    uint64_t vm_rax = vm.g_variable(SLOT_RAX).g_uint64();
+    uint64_t vm_rbx = vm.g_variable(SLOT_RBX).g_uint64();
+    uint64_t vm_rcx = vm.g_variable(SLOT_RCX).g_uint64();
+    uint64_t vm_rdx = vm.g_variable(SLOT_RDX).g_uint64();
+    uint64_t vm_rsi = vm.g_variable(SLOT_RSI).g_uint64();
+    uint64_t vm_rdi = vm.g_variable(SLOT_RDI).g_uint64();
+    uint64_t vm_rsp = vm.g_variable(SLOT_RSP).g_uint64();
+    uint64_t vm_rbp = vm.g_variable(SLOT_RBP).g_uint64();
+    uint64_t vm_r8  = vm.g_variable(SLOT_R8).g_uint64();
+    uint64_t vm_r9  = vm.g_variable(SLOT_R9).g_uint64();
+    uint64_t vm_r10 = vm.g_variable(SLOT_R10).g_uint64();
+    uint64_t vm_r11 = vm.g_variable(SLOT_R11).g_uint64();
+    uint64_t vm_r12 = vm.g_variable(SLOT_R12).g_uint64();
+    uint64_t vm_r13 = vm.g_variable(SLOT_R13).g_uint64();
+    uint64_t vm_r14 = vm.g_variable(SLOT_R14).g_uint64();
+    uint64_t vm_r15 = vm.g_variable(SLOT_R15).g_uint64();
 
     std::cerr << std::hex;
     #define DEBUGOUTREG(RREG) if (vm_##RREG != regs->RREG) std::cerr << "-"; \
@@ -64,6 +382,14 @@ void dump_state (VM & vm, struct user_regs_struct * regs)
 
 int main (int argc, char * argv[])
 {
+    test_merge();  std::cout << "test_merge pass" << std::endl;
+    test_kernel(); std::cout << "test_kernel pass" << std::endl;
+    test_rep();    std::cout << "test_rep pass" << std::endl;
+
+    // stepping alongside a real process needs a binary to run
+    if (argc < 2)
+        return 0;
+
     struct user_regs_struct regs;
     
     Lx86 * lx86 = new Lx86(argv[1]);
@@ -72,7 +398,7 @@ int main (int argc, char * argv[])
     std::cout << "init complete";
 
     std::cout << "vm starts at "
-              << std::hex << vm.g_variable(InstructionOperand::str_to_id("UD_R_RIP")).g_uint64()
+              << std::hex << vm.g_variable(SLOT_RIP).g_uint64()
               << std::endl;
 
     lx86->g_regs(&regs);
@@ -92,30 +418,30 @@ int main (int argc, char * argv[])
 
         lx86->g_regs(&regs);
 
-        uint64_t vm_rip = vm.g_variable(InstructionOperand::str_to_id("UD_R_RIP")).g_uint64();
+        uint64_t vm_rip = vm.g_variable(SLOT_RIP).g_uint64();
 
         if (vm_rip != regs.rip) {
             step++;
             vm.step();
-            vm_rip = vm.g_variable(InstructionOperand::str_to_id("UD_R_RIP")).g_uint64();
+            vm_rip = vm.g_variable(SLOT_RIP).g_uint64();
         }
 
-        uint64_t vm_rax = vm.g_variable(InstructionOperand::str_to_id("UD_R_RAX")).g_uint64();
-        uint64_t vm_rbx = vm.g_variable(InstructionOperand::str_to_id("UD_R_RBX")).g_uint64();
-        uint64_t vm_rcx = vm.g_variable(InstructionOperand::str_to_id("UD_R_RCX")).g_uint64();
-        uint64_t vm_rdx = vm.g_variable(InstructionOperand::str_to_id("UD_R_RDX")).g_uint64();
-        uint64_t vm_rsi = vm.g_variable(InstructionOperand::str_to_id("UD_R_RSI")).g_uint64();
-        uint64_t vm_rdi = vm.g_variable(InstructionOperand::str_to_id("UD_R_RDI")).g_uint64();
-        uint64_t vm_rsp = vm.g_variable(InstructionOperand::str_to_id("UD_R_RSP")).g_uint64();
-        uint64_t vm_rbp = vm.g_variable(InstructionOperand::str_to_id("UD_R_RBP")).g_uint64();
-        uint64_t vm_r8  = vm.g_variable(InstructionOperand::str_to_id("UD_R_R8")).g_uint64();
-        uint64_t vm_r9  = vm.g_variable(InstructionOperand::str_to_id("UD_R_R9")).g_uint64();
-        uint64_t vm_r10 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R10")).g_uint64();
-        uint64_t vm_r11 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R11")).g_uint64();
-        uint64_t vm_r12 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R12")).g_uint64();
-        uint64_t vm_r13 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R13")).g_uint64();
-        uint64_t vm_r14 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R14")).g_uint64();
-        uint64_t vm_r15 = vm.g_variable(InstructionOperand::str_to_id("UD_R_R15")).g_uint64();
+        uint64_t vm_rax = vm.g_variable(SLOT_RAX).g_uint64();
+        uint64_t vm_rbx = vm.g_variable(SLOT_RBX).g_uint64();
+        uint64_t vm_rcx = vm.g_variable(SLOT_RCX).g_uint64();
+        uint64_t vm_rdx = vm.g_variable(SLOT_RDX).g_uint64();
+        uint64_t vm_rsi = vm.g_variable(SLOT_RSI).g_uint64();
+        uint64_t vm_rdi = vm.g_variable(SLOT_RDI).g_uint64();
+        uint64_t vm_rsp = vm.g_variable(SLOT_RSP).g_uint64();
+        uint64_t vm_rbp = vm.g_variable(SLOT_RBP).g_uint64();
+        uint64_t vm_r8  = vm.g_variable(SLOT_R8).g_uint64();
+        uint64_t vm_r9  = vm.g_variable(SLOT_R9).g_uint64();
+        uint64_t vm_r10 = vm.g_variable(SLOT_R10).g_uint64();
+        uint64_t vm_r11 = vm.g_variable(SLOT_R11).g_uint64();
+        uint64_t vm_r12 = vm.g_variable(SLOT_R12).g_uint64();
+        uint64_t vm_r13 = vm.g_variable(SLOT_R13).g_uint64();
+        uint64_t vm_r14 = vm.g_variable(SLOT_R14).g_uint64();
+        uint64_t vm_r15 = vm.g_variable(SLOT_R15).g_uint64();
 
         if (vm_rip != regs.rip) {
             std::cerr << std::endl;
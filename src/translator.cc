@@ -74,15 +74,21 @@ std::string Translator :: native_asm (uint8_t * data, int size)
     ud_set_syntax(&ud_obj, UD_SYN_INTEL);
     
     ud_set_input_buffer(&ud_obj, (unsigned char *) data, size);
-    ud_disassemble(&ud_obj);
 
-    return ud_insn_asm(&ud_obj);
+    std::string text;
+    while (ud_disassemble(&ud_obj) > 0) {
+        if (text != "")
+            text += "; ";
+        text += ud_insn_asm(&ud_obj);
+    }
+    return text;
 }
 
 
 std::list <Instruction *> Translator :: translate (uint64_t address, uint8_t * data, size_t size)
 {
     instructions.clear();
+    InstructionOperandTmpVar::get().reset();
     ud_t ud_obj;
     
     ud_init(&ud_obj);
@@ -91,122 +97,222 @@ std::list <Instruction *> Translator :: translate (uint64_t address, uint8_t * d
     
     ud_set_input_buffer(&ud_obj, (unsigned char *) data, size);
     
-    if (ud_disassemble(&ud_obj)) {
-        switch (ud_obj.mnemonic) {
-        case UD_Iadc       : adc       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iadd       : add       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iand       : And       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ibsf       : bsf       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ibt        : bt        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icall      : call      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icdqe      : cdqe      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmova     : cmova     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmovb     : cmovb     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmovbe    : cmovbe    (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmovnz    : cmovnz    (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmovs     : cmovs     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmovz     : cmovz     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmp       : cmp       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Icmpxchg   : cmpxchg   (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Idec       : dec       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Idiv       : div       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ihlt       : hlt       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iimul      : imul      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iinc       : inc       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ija        : ja        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijae       : jae       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijb        : jb        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijbe       : jbe       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijg        : jg        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijge       : jge       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijl        : jl        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijle       : jle       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijmp       : jmp       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijns       : jns       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijnz       : jnz       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijs        : js        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ijz        : jz        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ilea       : lea       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ileave     : leave     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imov       : mov       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovd      : movd      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovdqu    : movdqu    (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovq      : movq      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovqa     : movqa     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovsd     : movsd     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovsq     : movsq     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovsx     : movsx     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovsxd    : movsxd    (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imovzx     : movzx     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Imul       : mul       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Inop       : nop       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Inot       : Not       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ineg       : neg       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ior        : Or        (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipcmpeqb   : pcmpeqb   (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipmovmskb  : pmovmskb  (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipop       : pop       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipshufd    : pshufd    (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipunpcklbw : punpcklbw (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipush      : push      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ipxor      : pxor      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iret       : ret       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Irol       : rol       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iror       : ror       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isar       : sar       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isbb       : sbb       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iscasb     : scasb     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Iseta      : seta      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isetg      : setg      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isetl      : setl      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isetle     : setle     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isetnb     : setnb     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isetnz     : setnz     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isetz      : setz      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ishl       : shl       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ishld      : shl       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ishr       : shr       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Istd       : std       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Istosd     : stosd     (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isub       : sub       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Isyscall   : syscall   (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Itest      : test      (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        case UD_Ixor       : Xor       (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-        default :
-            std::stringstream ss;
-            ss << "unhandled instruction [" << ud_insn_hex(&ud_obj) << " => "
-            <<  ud_insn_asm(&ud_obj) << "]" << " " << ins_debug_str(&ud_obj);
-            std::cerr << ss.str() << std::endl;
-            throw std::runtime_error(ss.str());
+    if (ud_disassemble(&ud_obj))
+        translate_instruction(&ud_obj, address + ud_insn_off(&ud_obj));
+    else throw std::runtime_error("unable to disassemble instruction");
+    guest_count = 1;
+    
+    return instructions;
+}
+
+
+// udis86 doesn't always set pfx_rep for repne scasb, so we look at the
+// prefix byte ourselves
+static bool repne_scasb (ud_t * ud_obj)
+{
+    return    (ud_obj->mnemonic == UD_Iscasb)
+           && (    (ud_obj->pfx_rep == UD_Irepne)
+                || ((ud_insn_ptr(ud_obj)[0] == 0xf2) && (ud_obj->pfx_rep == 0)));
+}
+
+
+bool Translator :: ends_block (ud_t * ud_obj)
+{
+    if (ud_obj->pfx_rep || repne_scasb(ud_obj))
+        return true;
+
+    switch (ud_obj->mnemonic) {
+    case UD_Icall    :
+    case UD_Ihlt     :
+    case UD_Ija      :
+    case UD_Ijae     :
+    case UD_Ijb      :
+    case UD_Ijbe     :
+    case UD_Ijg      :
+    case UD_Ijge     :
+    case UD_Ijl      :
+    case UD_Ijle     :
+    case UD_Ijmp     :
+    case UD_Ijns     :
+    case UD_Ijnz     :
+    case UD_Ijs      :
+    case UD_Ijz      :
+    case UD_Iret     :
+    case UD_Isyscall :
+        return true;
+    default :
+        return false;
+    }
+}
+
+
+std::list <Instruction *> Translator :: translate_block (uint64_t address,
+                                                        uint8_t * data,
+                                                        size_t    size,
+                                                        size_t &  block_size)
+{
+    instructions.clear();
+    InstructionOperandTmpVar::get().reset();
+    ud_t ud_obj;
+    
+    ud_init(&ud_obj);
+    ud_set_mode(&ud_obj, 64);
+    ud_set_syntax(&ud_obj, UD_SYN_INTEL);
+    
+    ud_set_input_buffer(&ud_obj, (unsigned char *) data, size);
+
+    block_size  = 0;
+    guest_count = 0;
+    for (size_t i = 0; i < MAX_BLOCK_INSTRUCTIONS; i++) {
+        if (ud_disassemble(&ud_obj) == 0) {
+            if (i == 0)
+                throw std::runtime_error("unable to disassemble instruction");
+            break;
         }
 
-        if (ud_obj.pfx_rep) {
-            std::cout << "pfx_rep" << std::endl;
-            if (ud_obj.pfx_rep == UD_Irep) {
-                switch (ud_obj.mnemonic) {
-                case UD_Istosd :
-                case UD_Imovsq : rep (&ud_obj, address + ud_insn_off(&ud_obj)); break;
-                case UD_Iret   : break; // stupid amd branch predictor bug workaround
-                default :
-                    throw std::runtime_error("unhandled rep prefix");
-                }
+        // the first instruction must translate. if a later one fails we end
+        // the block in front of it, and the error is raised when (and if)
+        // execution actually reaches it
+        if (i == 0)
+            translate_instruction(&ud_obj, address + ud_insn_off(&ud_obj));
+        else {
+            size_t mark = instructions.size();
+            try {
+                translate_instruction(&ud_obj, address + ud_insn_off(&ud_obj));
             }
-            else if (ud_obj.pfx_rep == UD_Irepne) {
-                std::cout << "repne" << std::endl;
-                switch (ud_obj.mnemonic) {
-                    case UD_Iscasb : repne(&ud_obj, address + ud_insn_off(&ud_obj)); break;
-                default :
-                    throw std::runtime_error("unhandled repne prefix");
-                }
+            catch (std::exception & e) {
+                // the partial IR stays in the arena until we are destroyed
+                while (instructions.size() > mark)
+                    instructions.pop_back();
+                break;
             }
-        } 
+        }
+
+        block_size = ud_insn_off(&ud_obj) + ud_insn_len(&ud_obj);
+        guest_count++;
+
+        if (ends_block(&ud_obj))
+            break;
     }
-    else throw std::runtime_error("unable to disassemble instruction");
-    
+
     return instructions;
 }
 
 
+void Translator :: translate_instruction (ud_t * ud_obj, uint64_t address)
+{
+    rep_bulk(ud_obj, address);
+
+    switch (ud_obj->mnemonic) {
+    case UD_Iadc       : adc       (ud_obj, address); break;
+    case UD_Iadd       : add       (ud_obj, address); break;
+    case UD_Iand       : And       (ud_obj, address); break;
+    case UD_Ibsf       : bsf       (ud_obj, address); break;
+    case UD_Ibt        : bt        (ud_obj, address); break;
+    case UD_Icall      : call      (ud_obj, address); break;
+    case UD_Icdqe      : cdqe      (ud_obj, address); break;
+    case UD_Icmova     : cmova     (ud_obj, address); break;
+    case UD_Icmovb     : cmovb     (ud_obj, address); break;
+    case UD_Icmovbe    : cmovbe    (ud_obj, address); break;
+    case UD_Icmovnz    : cmovnz    (ud_obj, address); break;
+    case UD_Icmovs     : cmovs     (ud_obj, address); break;
+    case UD_Icmovz     : cmovz     (ud_obj, address); break;
+    case UD_Icmp       : cmp       (ud_obj, address); break;
+    case UD_Icmpxchg   : cmpxchg   (ud_obj, address); break;
+    case UD_Idec       : dec       (ud_obj, address); break;
+    case UD_Idiv       : div       (ud_obj, address); break;
+    case UD_Ihlt       : hlt       (ud_obj, address); break;
+    case UD_Iimul      : imul      (ud_obj, address); break;
+    case UD_Iinc       : inc       (ud_obj, address); break;
+    case UD_Ija        : ja        (ud_obj, address); break;
+    case UD_Ijae       : jae       (ud_obj, address); break;
+    case UD_Ijb        : jb        (ud_obj, address); break;
+    case UD_Ijbe       : jbe       (ud_obj, address); break;
+    case UD_Ijg        : jg        (ud_obj, address); break;
+    case UD_Ijge       : jge       (ud_obj, address); break;
+    case UD_Ijl        : jl        (ud_obj, address); break;
+    case UD_Ijle       : jle       (ud_obj, address); break;
+    case UD_Ijmp       : jmp       (ud_obj, address); break;
+    case UD_Ijns       : jns       (ud_obj, address); break;
+    case UD_Ijnz       : jnz       (ud_obj, address); break;
+    case UD_Ijs        : js        (ud_obj, address); break;
+    case UD_Ijz        : jz        (ud_obj, address); break;
+    case UD_Ilea       : lea       (ud_obj, address); break;
+    case UD_Ileave     : leave     (ud_obj, address); break;
+    case UD_Imov       : mov       (ud_obj, address); break;
+    case UD_Imovd      : movd      (ud_obj, address); break;
+    case UD_Imovdqu    : movdqu    (ud_obj, address); break;
+    case UD_Imovq      : movq      (ud_obj, address); break;
+    case UD_Imovqa     : movqa     (ud_obj, address); break;
+    case UD_Imovsd     : movsd     (ud_obj, address); break;
+    case UD_Imovsq     : movsq     (ud_obj, address); break;
+    case UD_Imovsx     : movsx     (ud_obj, address); break;
+    case UD_Imovsxd    : movsxd    (ud_obj, address); break;
+    case UD_Imovzx     : movzx     (ud_obj, address); break;
+    case UD_Imul       : mul       (ud_obj, address); break;
+    case UD_Inop       : nop       (ud_obj, address); break;
+    case UD_Inot       : Not       (ud_obj, address); break;
+    case UD_Ineg       : neg       (ud_obj, address); break;
+    case UD_Ior        : Or        (ud_obj, address); break;
+    case UD_Ipcmpeqb   : pcmpeqb   (ud_obj, address); break;
+    case UD_Ipmovmskb  : pmovmskb  (ud_obj, address); break;
+    case UD_Ipop       : pop       (ud_obj, address); break;
+    case UD_Ipshufd    : pshufd    (ud_obj, address); break;
+    case UD_Ipunpcklbw : punpcklbw (ud_obj, address); break;
+    case UD_Ipush      : push      (ud_obj, address); break;
+    case UD_Ipxor      : pxor      (ud_obj, address); break;
+    case UD_Iret       : ret       (ud_obj, address); break;
+    case UD_Irol       : rol       (ud_obj, address); break;
+    case UD_Iror       : ror       (ud_obj, address); break;
+    case UD_Isar       : sar       (ud_obj, address); break;
+    case UD_Isbb       : sbb       (ud_obj, address); break;
+    case UD_Iscasb     : scasb     (ud_obj, address); break;
+    case UD_Iseta      : seta      (ud_obj, address); break;
+    case UD_Isetg      : setg      (ud_obj, address); break;
+    case UD_Isetl      : setl      (ud_obj, address); break;
+    case UD_Isetle     : setle     (ud_obj, address); break;
+    case UD_Isetnb     : setnb     (ud_obj, address); break;
+    case UD_Isetnz     : setnz     (ud_obj, address); break;
+    case UD_Isetz      : setz      (ud_obj, address); break;
+    case UD_Ishl       : shl       (ud_obj, address); break;
+    case UD_Ishld      : shl       (ud_obj, address); break;
+    case UD_Ishr       : shr       (ud_obj, address); break;
+    case UD_Istd       : std       (ud_obj, address); break;
+    case UD_Istosd     : stosd     (ud_obj, address); break;
+    case UD_Isub       : sub       (ud_obj, address); break;
+    case UD_Isyscall   : syscall   (ud_obj, address); break;
+    case UD_Itest      : test      (ud_obj, address); break;
+    case UD_Ixor       : Xor       (ud_obj, address); break;
+    default :
+        std::stringstream ss;
+        ss << "unhandled instruction [" << ud_insn_hex(ud_obj) << " => "
+        <<  ud_insn_asm(ud_obj) << "]" << " " << ins_debug_str(ud_obj);
+        throw std::runtime_error(ss.str());
+    }
+
+    if (ud_obj->pfx_rep) {
+        std::cout << "pfx_rep" << std::endl;
+        if (ud_obj->pfx_rep == UD_Irep) {
+            switch (ud_obj->mnemonic) {
+            case UD_Istosd :
+            case UD_Imovsq : rep (ud_obj, address); break;
+            case UD_Iret   : break; // stupid amd branch predictor bug workaround
+            default :
+                throw std::runtime_error("unhandled rep prefix");
+            }
+        }
+        else if (ud_obj->pfx_rep == UD_Irepne) {
+            std::cout << "repne" << std::endl;
+            switch (ud_obj->mnemonic) {
+                case UD_Iscasb : repne(ud_obj, address); break;
+            default :
+                throw std::runtime_error("unhandled repne prefix");
+            }
+        }
+    } 
+}
+
+
 int Translator :: register_bits (int reg)
 {
     if ((reg >= UD_R_AL)  && (reg <= UD_R_R15B))    return 8;
@@ -280,7 +386,7 @@ void Translator :: operand_set (ud_t * ud_obj, int operand_i, uint64_t address,
 
     if (ud_obj->operand[operand_i].type == UD_OP_MEM) {
         InstructionOperand lhs = operand(ud_obj, operand_i, address);
-        instructions.push_back(new InstructionStore(address,
+        instructions.push_back(new (arena) InstructionStore(address,
                                                     ud_insn_len(ud_obj),
                                                     ud_obj->operand[operand_i].size,
                                                     lhs,
@@ -303,13 +409,13 @@ void Translator :: operand_set (ud_t * ud_obj, int operand_i, uint64_t address,
             // move value into appropriate place
             InstructionOperand tmpValue (OPTYPE_VAR, 64);
             InstructionOperand eight    (OPTYPE_CONSTANT, 8, 8);
-            instructions.push_back(new InstructionAssign(address, size, tmpValue, value));
-            instructions.push_back(new InstructionShl(address, size, tmpValue, tmpValue, eight));
+            instructions.push_back(new (arena) InstructionAssign(address, size, tmpValue, value));
+            instructions.push_back(new (arena) InstructionShl(address, size, tmpValue, tmpValue, eight));
             // zero out appropriate spot in destination register
             InstructionOperand ff00    (OPTYPE_CONSTANT, 64, 0xffffffffffff00ffULL);
-            instructions.push_back(new InstructionAnd(address, size, fullreg, fullreg, ff00));
+            instructions.push_back(new (arena) InstructionAnd(address, size, fullreg, fullreg, ff00));
             // or value with rax
-            instructions.push_back(new InstructionOr(address, size, fullreg, fullreg, tmpValue));
+            instructions.push_back(new (arena) InstructionOr(address, size, fullreg, fullreg, tmpValue));
             return;
         }
 
@@ -324,18 +430,18 @@ void Translator :: operand_set (ud_t * ud_obj, int operand_i, uint64_t address,
             InstructionOperand bits (OPTYPE_CONSTANT, 64, value_bits);
             InstructionOperand mask (OPTYPE_VAR, register_bits(base));
             InstructionOperand tmp  (OPTYPE_VAR, dst.g_bits());
-            instructions.push_back(new InstructionShl(address, size, mask, one, bits));
-            instructions.push_back(new InstructionSub(address, size, mask, mask, one));
-            instructions.push_back(new InstructionNot(address, size, mask, mask));
-            instructions.push_back(new InstructionAnd(address, size, tmp, dst, mask));
-            instructions.push_back(new InstructionOr(address, size, dst, tmp, value));
+            instructions.push_back(new (arena) InstructionShl(address, size, mask, one, bits));
+            instructions.push_back(new (arena) InstructionSub(address, size, mask, mask, one));
+            instructions.push_back(new (arena) InstructionNot(address, size, mask, mask));
+            instructions.push_back(new (arena) InstructionAnd(address, size, tmp, dst, mask));
+            instructions.push_back(new (arena) InstructionOr(address, size, dst, tmp, value));
             return;
         }
 
         InstructionOperand dst (OPTYPE_VAR,
                                 register_bits(ud_obj->operand[operand_i].base),
                                 ud_type_DEBUG[register_to64(ud_obj->operand[operand_i].base)]);
-        instructions.push_back(new InstructionAssign(address, size, dst, value));
+        instructions.push_back(new (arena) InstructionAssign(address, size, dst, value));
     }
 }
 
@@ -349,21 +455,21 @@ InstructionOperand Translator :: operand_load (ud_t * ud_obj,    int operand_i,
     InstructionOperand loadResult (OPTYPE_VAR, bits);
     if (bits == 128) {
         // load least-significant 64-bits
-        instructions.push_back(new InstructionLoad(address, size, 64, loadResult, addr));
+        instructions.push_back(new (arena) InstructionLoad(address, size, 64, loadResult, addr));
         // load most-significant 64-bits
         InstructionOperand tmp     (OPTYPE_VAR, 128);
         InstructionOperand tmpAddr (OPTYPE_VAR, 64);
         InstructionOperand eight   (OPTYPE_CONSTANT, 8, 8);
-        instructions.push_back(new InstructionAdd(address, size, tmpAddr, addr, eight));
-        instructions.push_back(new InstructionLoad(address, size, 64, tmp, tmpAddr));
+        instructions.push_back(new (arena) InstructionAdd(address, size, tmpAddr, addr, eight));
+        instructions.push_back(new (arena) InstructionLoad(address, size, 64, tmp, tmpAddr));
         // shift msbytes into place
         InstructionOperand shift   (OPTYPE_CONSTANT, 8, 64);
-        instructions.push_back(new InstructionShl(address, size, tmp, tmp, shift));
+        instructions.push_back(new (arena) InstructionShl(address, size, tmp, tmp, shift));
         // or LSBytes and MSBytes into dst
-        instructions.push_back(new InstructionOr(address, size, loadResult, loadResult, tmp));
+        instructions.push_back(new (arena) InstructionOr(address, size, loadResult, loadResult, tmp));
     }
     else
-        instructions.push_back(new InstructionLoad(address, size, bits, loadResult, addr));
+        instructions.push_back(new (arena) InstructionLoad(address, size, bits, loadResult, addr));
     return loadResult;
 }
 
@@ -380,6 +486,15 @@ InstructionOperand Translator :: operand_get (ud_t * ud_obj, int operand_i, uint
 }
 
 
+// RIP is never read from the VM's variables. Instructions that use it get the
+// address of the following instruction as a constant, which stays correct
+// when several instructions are lifted into one block
+InstructionOperand Translator :: next_rip (ud_t * ud_obj, uint64_t address)
+{
+    return InstructionOperand(OPTYPE_CONSTANT, 64, address + ud_insn_len(ud_obj));
+}
+
+
 uint64_t Translator :: operand_lval (int bits, struct ud_operand operand)
 {
     switch (bits) {
@@ -417,7 +532,7 @@ InstructionOperand Translator :: operand (ud_t * ud_obj, int operand_i, uint64_t
                 fullreg = InstructionOperand(OPTYPE_VAR, 64, "UD_R_RDX");
             InstructionOperand rh    (OPTYPE_VAR, 8);
             InstructionOperand eight (OPTYPE_CONSTANT, 8, 8);
-            instructions.push_back(new InstructionShr(address, size, rh, fullreg, eight));
+            instructions.push_back(new (arena) InstructionShr(address, size, rh, fullreg, eight));
             return rh;
         }
         // get the register's name
@@ -436,7 +551,7 @@ InstructionOperand Translator :: operand (ud_t * ud_obj, int operand_i, uint64_t
                                       operand_lval(operand.offset, operand));
 
             InstructionOperand result(OPTYPE_VAR, 64);
-            instructions.push_back(new InstructionAdd(address, size, result, seg, offset));
+            instructions.push_back(new (arena) InstructionAdd(address, size, result, seg, offset));
             return result;
         }
         else if (operand.base) {
@@ -445,7 +560,7 @@ InstructionOperand Translator :: operand (ud_t * ud_obj, int operand_i, uint64_t
             InstructionOperand base(OPTYPE_VAR, register_bits(operand.base), name);
 
             InstructionOperand result(OPTYPE_VAR, 64);
-            instructions.push_back(new InstructionAdd(address, size, result, seg, base));
+            instructions.push_back(new (arena) InstructionAdd(address, size, result, seg, base));
             return result;
         }
         return seg;
@@ -457,7 +572,9 @@ InstructionOperand Translator :: operand (ud_t * ud_obj, int operand_i, uint64_t
         InstructionOperand displ;
         size_t size = ud_insn_len(ud_obj);
 
-        if (operand.base) {
+        if (operand.base == UD_R_RIP)
+            base = next_rip(ud_obj, address);
+        else if (operand.base) {
             std::string name = ud_type_DEBUG[register_to64(operand.base)];
             base = InstructionOperand(OPTYPE_VAR, register_bits(operand.base), name);
         }
@@ -476,15 +593,15 @@ InstructionOperand Translator :: operand (ud_t * ud_obj, int operand_i, uint64_t
         InstructionOperand index_scale = index;
         if (operand.index && operand.scale) {
             index_scale = InstructionOperand(OPTYPE_VAR, 64);
-            instructions.push_back(new InstructionMul(address, size, index_scale, index, scale));
+            instructions.push_back(new (arena) InstructionMul(address, size, index_scale, index, scale));
         }
         
         InstructionOperand base_displacement = base;
         if (operand.base && operand.offset) {
             base_displacement = InstructionOperand(OPTYPE_VAR, register_bits(operand.base));
-            instructions.push_back(new InstructionSignExtend(address,           size,
+            instructions.push_back(new (arena) InstructionSignExtend(address,           size,
                                                              base_displacement, displ));
-            instructions.push_back(new InstructionAdd(address, size, base_displacement,
+            instructions.push_back(new (arena) InstructionAdd(address, size, base_displacement,
                                                       base,    base_displacement));
         }
         else if ((! operand.base) && (operand.offset))
@@ -492,7 +609,7 @@ InstructionOperand Translator :: operand (ud_t * ud_obj, int operand_i, uint64_t
         
         if (operand.index) {
             InstructionOperand result = InstructionOperand(OPTYPE_VAR, 64);
-            instructions.push_back(new InstructionAdd(address, size, result, 
+            instructions.push_back(new (arena) InstructionAdd(address, size, result, 
                                                       index_scale, base_displacement));
             return result;
         }
@@ -522,10 +639,10 @@ void Translator :: cmovcc (ud_t * ud_obj, uint64_t address, InstructionOperand c
     InstructionOperand tmp (OPTYPE_VAR, dst.g_bits());
     InstructionOperand notCond (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, size, notCond, cond));
-    instructions.push_back(new InstructionMul(address, size, dst, dst, notCond));
-    instructions.push_back(new InstructionMul(address, size, tmp, src, cond));
-    instructions.push_back(new InstructionOr(address, size, dst, dst, tmp));
+    instructions.push_back(new (arena) InstructionNot(address, size, notCond, cond));
+    instructions.push_back(new (arena) InstructionMul(address, size, dst, dst, notCond));
+    instructions.push_back(new (arena) InstructionMul(address, size, tmp, src, cond));
+    instructions.push_back(new (arena) InstructionOr(address, size, dst, dst, tmp));
 
     operand_set(ud_obj, 0, address, dst);
 }
@@ -537,13 +654,13 @@ void Translator :: jcc (ud_t * ud_obj, uint64_t address, InstructionOperand cond
     InstructionOperand dst = operand_get(ud_obj, 0, address);
 
     if (ud_obj->operand[0].type == UD_OP_JIMM) {
-        InstructionOperand rip(OPTYPE_VAR, 64, "UD_R_RIP");
+        InstructionOperand rip = next_rip(ud_obj, address);
         InstructionOperand tmp(OPTYPE_VAR, 64);
-        instructions.push_back(new InstructionSignExtend(address, size, tmp, dst));
-        instructions.push_back(new InstructionAdd(address, size, tmp, rip, tmp));
-        instructions.push_back(new InstructionBrc(address, size, cond, tmp));
+        instructions.push_back(new (arena) InstructionSignExtend(address, size, tmp, dst));
+        instructions.push_back(new (arena) InstructionAdd(address, size, tmp, rip, tmp));
+        instructions.push_back(new (arena) InstructionBrc(address, size, cond, tmp));
     }
-    else instructions.push_back(new InstructionBrc(address, size, cond, dst));
+    else instructions.push_back(new (arena) InstructionBrc(address, size, cond, dst));
 }
 
 
@@ -554,26 +671,11 @@ void Translator :: adc (ud_t * ud_obj, uint64_t address)
     InstructionOperand lhs = operand_get(ud_obj, 0, address);
     InstructionOperand rhs = operand_get(ud_obj, 1, address);
     InstructionOperand tmp (OPTYPE_VAR, lhs.g_bits());
-        
-    InstructionOperand OFTmp    (OPTYPE_VAR, lhs.g_bits());
-    InstructionOperand OFTmpShl (OPTYPE_CONSTANT, lhs.g_bits(), lhs.g_bits() - 1);
-    InstructionOperand OF       (OPTYPE_VAR, 1, "OF"); // signed overflow
-    InstructionOperand CF       (OPTYPE_VAR, 1, "CF"); // unsigned overflow
-    InstructionOperand ZF       (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF       (OPTYPE_VAR, 1, "SF"); // "negative" flag
-    InstructionOperand zero     (OPTYPE_CONSTANT, tmp.g_bits(), 0);
-    
-    instructions.push_back(new InstructionAdd(address, size, tmp, lhs, rhs));
-    instructions.push_back(new InstructionAdd(address, size, tmp, tmp, CF));
+    InstructionOperand CF  (OPTYPE_VAR, 1, "CF"); // unsigned overflow
     
-    instructions.push_back(new InstructionCmpLtu(address, size, CF, tmp, lhs));
-    instructions.push_back(new InstructionCmpEq (address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
-    // OF is calculated based on the RREIL paper
-    // http://www2.in.tum.de/bib/files/sepp11precise.pdf
-    InstructionOperand SFxorOF(OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF, lhs, rhs));
-    instructions.push_back(new InstructionXor(address, size, OF, SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionAdd(address, size, tmp, lhs, rhs));
+    instructions.push_back(new (arena) InstructionAdd(address, size, tmp, tmp, CF));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_ADD, lhs, rhs, tmp));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -586,23 +688,9 @@ void Translator :: add (ud_t * ud_obj, uint64_t address)
     InstructionOperand lhs = operand_get(ud_obj, 0, address);
     InstructionOperand rhs = operand_get(ud_obj, 1, address);
     InstructionOperand tmp (OPTYPE_VAR, lhs.g_bits());
-        
-    InstructionOperand OF       (OPTYPE_VAR, 1, "OF"); // signed overflow
-    InstructionOperand CF       (OPTYPE_VAR, 1, "CF"); // unsigned overflow
-    InstructionOperand ZF       (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF       (OPTYPE_VAR, 1, "SF"); // "negative" flag
-    InstructionOperand zero     (OPTYPE_CONSTANT, tmp.g_bits(), 0);
     
-    instructions.push_back(new InstructionAdd(address, ud_insn_len(ud_obj), tmp, lhs, rhs));
-    
-    instructions.push_back(new InstructionCmpLtu(address, size, CF, tmp, lhs));
-    instructions.push_back(new InstructionCmpEq (address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
-    // OF is calculated based on the RREIL paper
-    // http://www2.in.tum.de/bib/files/sepp11precise.pdf
-    InstructionOperand SFxorOF(OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF, lhs, rhs));
-    instructions.push_back(new InstructionXor(address, size, OF, SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionAdd(address, ud_insn_len(ud_obj), tmp, lhs, rhs));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_ADD, lhs, rhs, tmp));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -614,26 +702,16 @@ void Translator :: And (ud_t * ud_obj, uint64_t address)
     InstructionOperand lhs  = operand_get(ud_obj, 0, address);
     InstructionOperand rhs  = operand_get(ud_obj, 1, address);
     InstructionOperand tmp (OPTYPE_VAR, lhs.g_bits());
-    
-    InstructionOperand OF   (OPTYPE_VAR, 1, "OF"); // signed overflow
-    InstructionOperand CF   (OPTYPE_VAR, 1, "CF"); // unsigned overflow
-    InstructionOperand ZF   (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF   (OPTYPE_VAR, 1, "SF"); // "negative" flag
-    InstructionOperand zero (OPTYPE_CONSTANT, tmp.g_bits(), 0);
 
     // 8-bit immediates are always sign extended
     if ((ud_obj->operand[1].type == UD_OP_IMM) && (rhs.g_bits() == 8)) {
         InstructionOperand rhs_old = rhs;
         rhs = InstructionOperand(OPTYPE_VAR, 64);
-        instructions.push_back(new InstructionSignExtend(address, size, rhs, rhs_old));
+        instructions.push_back(new (arena) InstructionSignExtend(address, size, rhs, rhs_old));
     }
     
-    instructions.push_back(new InstructionAnd(address, size, tmp, lhs, rhs));
-    
-    instructions.push_back(new InstructionAssign(address, size, OF, zero));
-    instructions.push_back(new InstructionAssign(address, size, CF, zero));
-    instructions.push_back(new InstructionCmpEq (address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
+    instructions.push_back(new (arena) InstructionAnd(address, size, tmp, lhs, rhs));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_LOGIC, lhs, rhs, tmp));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -654,25 +732,25 @@ void Translator :: bsf (ud_t * ud_obj, uint64_t address)
     InstructionOperand bit        (OPTYPE_VAR, 1);
     InstructionOperand bitLocMul  (OPTYPE_VAR, 8);
 
-    instructions.push_back(new InstructionAssign(address, size, result, zero));
-    instructions.push_back(new InstructionAssign(address, size, result_set, zero));
+    instructions.push_back(new (arena) InstructionAssign(address, size, result, zero));
+    instructions.push_back(new (arena) InstructionAssign(address, size, result_set, zero));
     for (int i = 0; i < src.g_bits(); i++) {
         // get bit for this location
         InstructionOperand bitLoc (OPTYPE_CONSTANT, 8, i);
-        instructions.push_back(new InstructionShr(address, size, bit, src, bitLoc));
-        instructions.push_back(new InstructionAnd(address, size, bit, bit, one));
+        instructions.push_back(new (arena) InstructionShr(address, size, bit, src, bitLoc));
+        instructions.push_back(new (arena) InstructionAnd(address, size, bit, bit, one));
         // multiply location by bit, setting bitLocMul to 0 if bit not set
-        instructions.push_back(new InstructionMul(address, size, bitLocMul, bitLoc, bit));
+        instructions.push_back(new (arena) InstructionMul(address, size, bitLocMul, bitLoc, bit));
         // if result_set is not set, set result to the multiplied location
-        instructions.push_back(new InstructionNot(address, size, result_set_inverse, result_set));
-        instructions.push_back(new InstructionMul(address,   size, bitLocMul,
+        instructions.push_back(new (arena) InstructionNot(address, size, result_set_inverse, result_set));
+        instructions.push_back(new (arena) InstructionMul(address,   size, bitLocMul,
                                                   bitLocMul, result_set_inverse));
-        instructions.push_back(new InstructionOr(address, size, result, result, bitLocMul));
+        instructions.push_back(new (arena) InstructionOr(address, size, result, result, bitLocMul));
         // set result_set if not set yet
-        instructions.push_back(new InstructionOr(address, size, result_set, result_set, bit));
+        instructions.push_back(new (arena) InstructionOr(address, size, result_set, result_set, bit));
     }
 
-    instructions.push_back(new InstructionAssign(address, size, dst, result));
+    instructions.push_back(new (arena) InstructionAssign(address, size, dst, result));
 }
 
 void Translator :: bt (ud_t * ud_obj, uint64_t address)
@@ -690,15 +768,15 @@ void Translator :: bt (ud_t * ud_obj, uint64_t address)
     if (ud_obj->operand[0].type == UD_OP_REG) {
         InstructionOperand mask (OPTYPE_CONSTANT, 8, register_bits(ud_obj->operand[0].base) - 1);
         InstructionOperand needleTmp (OPTYPE_VAR, 8);
-        instructions.push_back(new InstructionAnd(address, size, needleTmp, needle, mask));
-        instructions.push_back(new InstructionShr(address, size, CF, haystack, needleTmp));
+        instructions.push_back(new (arena) InstructionAnd(address, size, needleTmp, needle, mask));
+        instructions.push_back(new (arena) InstructionShr(address, size, CF, haystack, needleTmp));
     }
 }
 
 void Translator :: call (ud_t * ud_obj, uint64_t address)
 {
     
-    InstructionOperand rip     = InstructionOperand(OPTYPE_VAR, 64, "UD_R_RIP");
+    InstructionOperand rip     = next_rip(ud_obj, address);
     InstructionOperand rsp     = InstructionOperand(OPTYPE_VAR, 64, "UD_R_RSP");
     InstructionOperand subsize = InstructionOperand(OPTYPE_CONSTANT, 8, STACK_ELEMENT_SIZE);
 
@@ -706,20 +784,20 @@ void Translator :: call (ud_t * ud_obj, uint64_t address)
     InstructionOperand dst = operand_get(ud_obj, 0, address);
     
     // push RIP
-    instructions.push_back(new InstructionSub(address, ud_insn_len(ud_obj), rsp, rsp, subsize));
-    instructions.push_back(new InstructionStore(address, ud_insn_len(ud_obj), 64, rsp, rip));
+    instructions.push_back(new (arena) InstructionSub(address, ud_insn_len(ud_obj), rsp, rsp, subsize));
+    instructions.push_back(new (arena) InstructionStore(address, ud_insn_len(ud_obj), 64, rsp, rip));
 
     // set RIP += offset
     InstructionOperand off = InstructionOperand(OPTYPE_VAR, 64);
     InstructionOperand one = InstructionOperand(OPTYPE_CONSTANT, 1, 1);
 
     if (ud_obj->operand[0].type == UD_OP_JIMM) {
-        instructions.push_back(new InstructionSignExtend(address, ud_insn_len(ud_obj), off, dst));
-        instructions.push_back(new InstructionAdd(address, ud_insn_len(ud_obj), off, rip, off));
-        instructions.push_back(new InstructionBrc(address, ud_insn_len(ud_obj), one, off));
+        instructions.push_back(new (arena) InstructionSignExtend(address, ud_insn_len(ud_obj), off, dst));
+        instructions.push_back(new (arena) InstructionAdd(address, ud_insn_len(ud_obj), off, rip, off));
+        instructions.push_back(new (arena) InstructionBrc(address, ud_insn_len(ud_obj), one, off));
     }
     else {
-        instructions.push_back(new InstructionBrc(address, ud_insn_len(ud_obj), one, dst));
+        instructions.push_back(new (arena) InstructionBrc(address, ud_insn_len(ud_obj), one, dst));
     }
 }
 
@@ -728,7 +806,7 @@ void Translator :: cdqe (ud_t * ud_obj, uint64_t address)
     InstructionOperand rax (OPTYPE_VAR, 64, "UD_R_RAX");
     InstructionOperand eax (OPTYPE_VAR, 32, "UD_R_RAX");
 
-    instructions.push_back(new InstructionSignExtend(address, ud_insn_len(ud_obj), rax, eax));
+    instructions.push_back(new (arena) InstructionSignExtend(address, ud_insn_len(ud_obj), rax, eax));
 }
 
 
@@ -742,9 +820,9 @@ void Translator :: cmova (ud_t * ud_obj, uint64_t address)
     InstructionOperand notCF      (OPTYPE_VAR, 1);
     InstructionOperand notCFandnotZF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, size, notZF, ZF));
-    instructions.push_back(new InstructionNot(address, size, notCF, CF));
-    instructions.push_back(new InstructionAnd(address, size, notCFandnotZF, notZF, notCF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notCF, CF));
+    instructions.push_back(new (arena) InstructionAnd(address, size, notCFandnotZF, notZF, notCF));
 
     cmovcc(ud_obj, address, notCFandnotZF);
 }
@@ -766,7 +844,7 @@ void Translator :: cmovbe (ud_t * ud_obj, uint64_t address)
     InstructionOperand CF        (OPTYPE_VAR, 1, "CF");
     InstructionOperand CForZF    (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionOr(address, size, CForZF, CF, ZF));
+    instructions.push_back(new (arena) InstructionOr(address, size, CForZF, CF, ZF));
 
     cmovcc(ud_obj, address, CForZF);
 }
@@ -779,7 +857,7 @@ void Translator :: cmovnz (ud_t * ud_obj, uint64_t address)
     InstructionOperand ZF    (OPTYPE_VAR, 1, "ZF");
     InstructionOperand notZF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notZF, ZF));
 
     cmovcc(ud_obj, address, notZF);
 }
@@ -807,27 +885,12 @@ void Translator :: cmp (ud_t * ud_obj, uint64_t address)
     InstructionOperand lhs = operand_get(ud_obj, 0, address);
     InstructionOperand rhs = operand_get(ud_obj, 1, address);
     
-    InstructionOperand CF          (OPTYPE_VAR, 1, "CF");
-    InstructionOperand CForZF      (OPTYPE_VAR, 1, "CForZF");
-    InstructionOperand SFxorOF     (OPTYPE_VAR, 1, "SFxorOF");
-    InstructionOperand SFxorOForZF (OPTYPE_VAR, 1, "SFxorOForZF");
-    InstructionOperand ZF          (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand OF          (OPTYPE_VAR, 1, "OF");
-    InstructionOperand SF          (OPTYPE_VAR, 1, "SF");
-    InstructionOperand tmp0        (OPTYPE_VAR, lhs.g_bits());
-    InstructionOperand tmp0s       (OPTYPE_CONSTANT, tmp0.g_bits(), 0);
-
+    InstructionOperand tmp0 (OPTYPE_VAR, lhs.g_bits());
     InstructionOperand sext (OPTYPE_VAR, lhs.g_bits());
-    instructions.push_back(new InstructionSignExtend(address, size, sext, rhs));
-    
-    instructions.push_back(new InstructionCmpLtu(address, size, CF,          lhs, sext));
-    instructions.push_back(new InstructionCmpLeu(address, size, CForZF,      lhs, sext));
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF,     lhs, sext));
-    instructions.push_back(new InstructionCmpLes(address, size, SFxorOForZF, lhs, sext));
-    instructions.push_back(new InstructionCmpEq (address, size, ZF,          lhs, sext));
-    instructions.push_back(new InstructionSub   (address, size, tmp0,        lhs, sext));
-    instructions.push_back(new InstructionCmpLts(address, size, SF,          tmp0, tmp0s));
-    instructions.push_back(new InstructionXor   (address, size, OF,          SFxorOF, SF));
+
+    instructions.push_back(new (arena) InstructionSignExtend(address, size, sext, rhs));
+    instructions.push_back(new (arena) InstructionSub       (address, size, tmp0, lhs, sext));
+    instructions.push_back(new (arena) InstructionFlags     (address, size, FLAGS_CMP, lhs, sext, tmp0));
 }
 
 
@@ -845,31 +908,31 @@ void Translator :: cmpxchg (ud_t * ud_obj, uint64_t address)
     if (dst.g_bits() < 64) {
         uint64_t rax_mask_ = (1 << dst.g_bits()) - 1;
         InstructionOperand raxMask (OPTYPE_CONSTANT, 64, rax_mask_);
-        instructions.push_back(new InstructionAnd(address, size, raxTmp, rax, raxMask));
-        instructions.push_back(new InstructionCmpEq(address, size, raxCmp, raxTmp, dst));
+        instructions.push_back(new (arena) InstructionAnd(address, size, raxTmp, rax, raxMask));
+        instructions.push_back(new (arena) InstructionCmpEq(address, size, raxCmp, raxTmp, dst));
     }
     else
-        instructions.push_back(new InstructionCmpEq(address, size, raxCmp, rax, dst));
+        instructions.push_back(new (arena) InstructionCmpEq(address, size, raxCmp, rax, dst));
 
     InstructionOperand notRaxCmp (OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionNot(address, size, notRaxCmp, raxCmp));
+    instructions.push_back(new (arena) InstructionNot(address, size, notRaxCmp, raxCmp));
 
     // set future value of dst
     InstructionOperand futureDst (OPTYPE_VAR, dst.g_bits());
     InstructionOperand futureDstTmp (OPTYPE_VAR, dst.g_bits());
-    instructions.push_back(new InstructionMul(address, size, futureDstTmp, src, raxCmp));
-    instructions.push_back(new InstructionMul(address, size, futureDst, dst, notRaxCmp));
-    instructions.push_back(new InstructionOr(address, size, futureDst, futureDst, futureDstTmp));
+    instructions.push_back(new (arena) InstructionMul(address, size, futureDstTmp, src, raxCmp));
+    instructions.push_back(new (arena) InstructionMul(address, size, futureDst, dst, notRaxCmp));
+    instructions.push_back(new (arena) InstructionOr(address, size, futureDst, futureDst, futureDstTmp));
 
     // set future value of rax and then set rax
     InstructionOperand futureRax (OPTYPE_VAR, 64);
     InstructionOperand futureRaxTmp (OPTYPE_VAR, 64);
-    instructions.push_back(new InstructionMul(address, size, futureRax, rax, raxCmp));
-    instructions.push_back(new InstructionMul(address, size, futureRaxTmp, src, notRaxCmp));
-    instructions.push_back(new InstructionOr(address, size, rax, futureRax, futureRaxTmp));
+    instructions.push_back(new (arena) InstructionMul(address, size, futureRax, rax, raxCmp));
+    instructions.push_back(new (arena) InstructionMul(address, size, futureRaxTmp, src, notRaxCmp));
+    instructions.push_back(new (arena) InstructionOr(address, size, rax, futureRax, futureRaxTmp));
 
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionAssign(address, size, ZF, raxCmp));
+    instructions.push_back(new (arena) InstructionAssign(address, size, ZF, raxCmp));
 
     // set dst
     operand_set(ud_obj, 0, address, futureDst);
@@ -884,18 +947,8 @@ void Translator :: dec (ud_t * ud_obj, uint64_t address)
     InstructionOperand one (OPTYPE_CONSTANT, dst.g_bits(), 1);
     InstructionOperand tmp (OPTYPE_VAR, dst.g_bits());
 
-    instructions.push_back(new InstructionSub(address, size, tmp, dst, one));
-        
-    InstructionOperand OF (OPTYPE_VAR, 1, "OF");
-    InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    InstructionOperand SFxorOF (OPTYPE_VAR, 1);
-    InstructionOperand zero (OPTYPE_CONSTANT, dst.g_bits(), 0);
-
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF, tmp, dst));
-    instructions.push_back(new InstructionXor(address, size, OF, SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionSub(address, size, tmp, dst, one));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_INCDEC, dst, one, tmp));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -914,14 +967,14 @@ void Translator :: div (ud_t * ud_obj, uint64_t address)
         InstructionOperand quotient  (OPTYPE_VAR, 64);
         InstructionOperand remainder (OPTYPE_VAR, 64);
 
-        instructions.push_back(new InstructionShl(address, size, dividend, rdx, sixfour));
-        instructions.push_back(new InstructionOr (address, size, dividend, dividend, rax));
+        instructions.push_back(new (arena) InstructionShl(address, size, dividend, rdx, sixfour));
+        instructions.push_back(new (arena) InstructionOr (address, size, dividend, dividend, rax));
 
-        instructions.push_back(new InstructionDiv(address, size, quotient, dividend, divisor));
-        instructions.push_back(new InstructionMod(address, size, remainder, dividend, divisor));
+        instructions.push_back(new (arena) InstructionDiv(address, size, quotient, dividend, divisor));
+        instructions.push_back(new (arena) InstructionMod(address, size, remainder, dividend, divisor));
 
-        instructions.push_back(new InstructionAssign(address, size, rax, quotient));
-        instructions.push_back(new InstructionAssign(address, size, rdx, remainder));
+        instructions.push_back(new (arena) InstructionAssign(address, size, rax, quotient));
+        instructions.push_back(new (arena) InstructionAssign(address, size, rdx, remainder));
     }
     else
         throw std::runtime_error("unsupported div bits");
@@ -930,7 +983,7 @@ void Translator :: div (ud_t * ud_obj, uint64_t address)
 
 void Translator :: hlt (ud_t * ud_obj, uint64_t address)
 {
-    instructions.push_back(new InstructionHlt(address, ud_insn_len(ud_obj)));
+    instructions.push_back(new (arena) InstructionHlt(address, ud_insn_len(ud_obj)));
 }
 
 
@@ -963,29 +1016,29 @@ void Translator :: imul (ud_t * ud_obj, uint64_t address)
     InstructionOperand srcaSext (OPTYPE_VAR, dst.g_bits());
     InstructionOperand srcbSext (OPTYPE_VAR, dst.g_bits());
 
-    instructions.push_back(new InstructionSignExtend(address, size, srcaSext, srca));
-    instructions.push_back(new InstructionSignExtend(address, size, srcbSext, srcb));
+    instructions.push_back(new (arena) InstructionSignExtend(address, size, srcaSext, srca));
+    instructions.push_back(new (arena) InstructionSignExtend(address, size, srcbSext, srcb));
 
     InstructionOperand tmp (OPTYPE_VAR, 128);
-    instructions.push_back(new InstructionMul(address, size, tmp, srca, srcb));
-    instructions.push_back(new InstructionMul(address, size, dst, srca, srcb));
+    instructions.push_back(new (arena) InstructionMul(address, size, tmp, srca, srcb));
+    instructions.push_back(new (arena) InstructionMul(address, size, dst, srca, srcb));
 
     InstructionOperand sixfour(OPTYPE_CONSTANT, 8, 64);
     InstructionOperand highBits(OPTYPE_VAR, 64);
-    instructions.push_back(new InstructionShr(address, size, highBits, tmp, sixfour));
+    instructions.push_back(new (arena) InstructionShr(address, size, highBits, tmp, sixfour));
 
     InstructionOperand OF (OPTYPE_VAR, 1, "OF");
     InstructionOperand CF (OPTYPE_VAR, 1, "CF");
     InstructionOperand zero (OPTYPE_CONSTANT, 64, 0);
-    instructions.push_back(new InstructionCmpEq(address, size, OF, highBits, zero));
-    instructions.push_back(new InstructionNot(address, size, OF, OF));
-    instructions.push_back(new InstructionAssign(address, size, CF, OF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, OF, highBits, zero));
+    instructions.push_back(new (arena) InstructionNot(address, size, OF, OF));
+    instructions.push_back(new (arena) InstructionAssign(address, size, CF, OF));
 
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    instructions.push_back(new InstructionCmpLts(address, size, SF, dst, zero));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF, dst, zero));
 
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, dst, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, ZF, dst, zero));
 }
 
 
@@ -997,18 +1050,8 @@ void Translator :: inc (ud_t * ud_obj, uint64_t address)
     InstructionOperand tmp (OPTYPE_VAR, dst.g_bits());
     InstructionOperand one (OPTYPE_CONSTANT, dst.g_bits(), 1);
 
-    instructions.push_back(new InstructionAdd(address, size, tmp, dst, one));
-
-    InstructionOperand OF (OPTYPE_VAR, 1, "OF");
-    InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    InstructionOperand SFxorOF (OPTYPE_VAR, 1);
-    InstructionOperand zero (OPTYPE_CONSTANT, dst.g_bits(), 0);
-
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF, tmp, dst));
-    instructions.push_back(new InstructionXor(address, size, OF, SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionAdd(address, size, tmp, dst, one));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_INCDEC, dst, one, tmp));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1023,8 +1066,8 @@ void Translator :: ja (ud_t * ud_obj, uint64_t address)
     InstructionOperand CForZF    (OPTYPE_VAR, 1);
     InstructionOperand notCForZF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionOr(address, size, CForZF, CF, ZF));
-    instructions.push_back(new InstructionNot(address, size, notCForZF, CForZF));
+    instructions.push_back(new (arena) InstructionOr(address, size, CForZF, CF, ZF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notCForZF, CForZF));
 
     jcc(ud_obj, address, notCForZF);
 }
@@ -1037,7 +1080,7 @@ void Translator :: jae (ud_t * ud_obj, uint64_t address)
     InstructionOperand CF    (OPTYPE_VAR, 1, "CF");
     InstructionOperand notCF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, size, notCF, CF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notCF, CF));
 
     jcc(ud_obj, address, notCF);
 }
@@ -1059,7 +1102,7 @@ void Translator :: jbe (ud_t * ud_obj, uint64_t address)
     InstructionOperand ZF        (OPTYPE_VAR, 1, "ZF");
     InstructionOperand CForZF    (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionOr(address, size, CForZF, CF, ZF));
+    instructions.push_back(new (arena) InstructionOr(address, size, CForZF, CF, ZF));
 
     jcc(ud_obj, address, CForZF);
 }
@@ -1073,12 +1116,12 @@ void Translator :: jg (ud_t * ud_obj, uint64_t address)
     InstructionOperand OF     (OPTYPE_VAR, 1, "OF");
     InstructionOperand SFeqOF (OPTYPE_VAR, 1);
     InstructionOperand ZF     (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand notZF  (OPTYPE_VAR, 1, "notZF");
+    InstructionOperand notZF  (OPTYPE_VAR, 1);
     InstructionOperand notZFandSFeqOF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionCmpEq(address, size, SFeqOF, SF, OF));
-    instructions.push_back(new InstructionNot  (address, size, notZF, ZF));
-    instructions.push_back(new InstructionAnd  (address, size, notZFandSFeqOF, notZF, SFeqOF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, SFeqOF, SF, OF));
+    instructions.push_back(new (arena) InstructionNot  (address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionAnd  (address, size, notZFandSFeqOF, notZF, SFeqOF));
 
     jcc(ud_obj, address, notZFandSFeqOF);
 }
@@ -1092,7 +1135,7 @@ void Translator :: jge (ud_t * ud_obj, uint64_t address)
     InstructionOperand OF     (OPTYPE_VAR, 1, "OF");
     InstructionOperand SFeqOF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionCmpEq(address, size, SFeqOF, SF, OF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, SFeqOF, SF, OF));
 
     jcc(ud_obj, address, SFeqOF);
 }
@@ -1105,7 +1148,7 @@ void Translator :: jl (ud_t * ud_obj, uint64_t address)
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
     InstructionOperand OF (OPTYPE_VAR, 1, "OF");
 
-    instructions.push_back(new InstructionXor(address, size, SFxorOF, SF, OF));
+    instructions.push_back(new (arena) InstructionXor(address, size, SFxorOF, SF, OF));
 
     jcc(ud_obj, address, SFxorOF);
 }
@@ -1119,8 +1162,8 @@ void Translator :: jle (ud_t * ud_obj, uint64_t address)
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
     InstructionOperand OF (OPTYPE_VAR, 1, "OF");
 
-    instructions.push_back(new InstructionXor(address, size, ZForSFxorOF, SF, OF));
-    instructions.push_back(new InstructionOr(address, size, ZForSFxorOF, ZForSFxorOF, ZF));
+    instructions.push_back(new (arena) InstructionXor(address, size, ZForSFxorOF, SF, OF));
+    instructions.push_back(new (arena) InstructionOr(address, size, ZForSFxorOF, ZForSFxorOF, ZF));
 
     jcc(ud_obj, address, ZForSFxorOF);
 }
@@ -1141,9 +1184,9 @@ void Translator :: jns (ud_t * ud_obj, uint64_t address)
     size_t size = ud_insn_len(ud_obj);
     
     InstructionOperand SF    (OPTYPE_VAR,   1, "SF");
-    InstructionOperand notSF (OPTYPE_VAR,   1, "notSF");
+    InstructionOperand notSF (OPTYPE_VAR,   1);
 
-    instructions.push_back(new InstructionNot(address, size, notSF, SF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notSF, SF));
 
     jcc(ud_obj, address, notSF);
 }
@@ -1154,9 +1197,9 @@ void Translator :: jnz (ud_t * ud_obj, uint64_t address)
     size_t size = ud_insn_len(ud_obj);
     
     InstructionOperand ZF    (OPTYPE_VAR,   1, "ZF");
-    InstructionOperand notZF (OPTYPE_VAR,   1, "notZF");
+    InstructionOperand notZF (OPTYPE_VAR,   1);
 
-    instructions.push_back(new InstructionNot(address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notZF, ZF));
 
     jcc(ud_obj, address, notZF);
 }
@@ -1183,7 +1226,7 @@ void Translator :: lea (ud_t * ud_obj, uint64_t address)
     InstructionOperand dst = operand(ud_obj, 0, address);
     InstructionOperand src = operand(ud_obj, 1, address);
     
-    instructions.push_back(new InstructionAssign(address, ud_insn_len(ud_obj), dst, src));
+    instructions.push_back(new (arena) InstructionAssign(address, ud_insn_len(ud_obj), dst, src));
 }
 
 
@@ -1193,9 +1236,9 @@ void Translator :: leave (ud_t * ud_obj, uint64_t address)
     InstructionOperand rbp   (OPTYPE_VAR, 64, "UD_R_RBP");
     InstructionOperand eight (OPTYPE_CONSTANT, 8, 8);
     
-    instructions.push_back(new InstructionAssign(address, ud_insn_len(ud_obj), rsp, rbp));
-    instructions.push_back(new InstructionLoad  (address, ud_insn_len(ud_obj), 64, rbp, rsp));
-    instructions.push_back(new InstructionAdd   (address, ud_insn_len(ud_obj), rsp, rsp, eight));
+    instructions.push_back(new (arena) InstructionAssign(address, ud_insn_len(ud_obj), rsp, rbp));
+    instructions.push_back(new (arena) InstructionLoad  (address, ud_insn_len(ud_obj), 64, rbp, rsp));
+    instructions.push_back(new (arena) InstructionAdd   (address, ud_insn_len(ud_obj), rsp, rsp, eight));
 }
 
 
@@ -1209,7 +1252,7 @@ void Translator :: mov (ud_t * ud_obj, uint64_t address)
     if (ud_obj->pfx_rex) {
         if (ud_insn_ptr(ud_obj)[1] == 0xc7) {
             InstructionOperand sext (OPTYPE_VAR, 64);
-            instructions.push_back(new InstructionSignExtend(address, size, sext, src));
+            instructions.push_back(new (arena) InstructionSignExtend(address, size, sext, src));
             operand_set(ud_obj, 0, address, sext);
             return;
         }
@@ -1244,12 +1287,12 @@ void Translator :: movdqu (ud_t * ud_obj, uint64_t address)
     if (ud_obj->operand[1].type == UD_OP_MEM) {
         InstructionOperand dst = operand(ud_obj, 0, address);
         InstructionOperand src = operand_load(ud_obj, 1, address, 128);
-        instructions.push_back(new InstructionAssign(address, size, dst, src));
+        instructions.push_back(new (arena) InstructionAssign(address, size, dst, src));
     }
     else {
         InstructionOperand dst = operand(ud_obj, 0, address);
         InstructionOperand src = operand(ud_obj, 1, address);
-        instructions.push_back(new InstructionAssign(address, size, dst, src));
+        instructions.push_back(new (arena) InstructionAssign(address, size, dst, src));
     }
 }
 
@@ -1264,7 +1307,7 @@ void Translator :: movsd (ud_t * ud_obj, uint64_t address)
     InstructionOperand dst = operand_get(ud_obj, 0, address);
     InstructionOperand src = operand_get(ud_obj, 1, address);
 
-    instructions.push_back(new InstructionAssign(size, address, dst, src));
+    instructions.push_back(new (arena) InstructionAssign(size, address, dst, src));
 }
 
 
@@ -1274,19 +1317,21 @@ void Translator :: movsq (ud_t * ud_obj, uint64_t address)
 
     InstructionOperand rsi (OPTYPE_VAR, 64, "UD_R_RSI");
     InstructionOperand rdi (OPTYPE_VAR, 64, "UD_R_RDI");
+    InstructionOperand tmp (OPTYPE_VAR, 64);
 
-    instructions.push_back(new InstructionStore(address, size, 64, rdi, rsi));
+    instructions.push_back(new (arena) InstructionLoad(address, size, 64, tmp, rsi));
+    instructions.push_back(new (arena) InstructionStore(address, size, 64, rdi, tmp));
 
     InstructionOperand DF     (OPTYPE_VAR, 1, "DF");
     InstructionOperand neg16  (OPTYPE_CONSTANT, 64, -16);
     InstructionOperand eight  (OPTYPE_CONSTANT, 64, 8);
     InstructionOperand add    (OPTYPE_VAR, 64);
     InstructionOperand addTmp (OPTYPE_VAR, 64);
-    instructions.push_back(new InstructionAssign(address, size, add, eight));
-    instructions.push_back(new InstructionMul(address, size, addTmp, neg16, DF));
-    instructions.push_back(new InstructionAdd(address, size, add, add, addTmp));
-    instructions.push_back(new InstructionAdd(address, size, rdi, rdi, add));
-    instructions.push_back(new InstructionAdd(address, size, rsi, rsi, add));
+    instructions.push_back(new (arena) InstructionAssign(address, size, add, eight));
+    instructions.push_back(new (arena) InstructionMul(address, size, addTmp, neg16, DF));
+    instructions.push_back(new (arena) InstructionAdd(address, size, add, add, addTmp));
+    instructions.push_back(new (arena) InstructionAdd(address, size, rdi, rdi, add));
+    instructions.push_back(new (arena) InstructionAdd(address, size, rsi, rsi, add));
 }
 
 
@@ -1295,7 +1340,7 @@ void Translator :: movsx (ud_t * ud_obj, uint64_t address)
     InstructionOperand dst = operand_get(ud_obj, 0, address);
     InstructionOperand src = operand_get(ud_obj, 1, address);
 
-    instructions.push_back(new InstructionSignExtend(address, ud_insn_len(ud_obj), dst, src));
+    instructions.push_back(new (arena) InstructionSignExtend(address, ud_insn_len(ud_obj), dst, src));
 
     operand_set(ud_obj, 0, address, dst);
 }
@@ -1316,13 +1361,13 @@ void Translator :: movq (ud_t * ud_obj, uint64_t address)
     InstructionOperand src = operand(ud_obj, 1, address);
 
     if (ud_obj->operand[0].type == UD_OP_MEM)
-        instructions.push_back(new InstructionStore(address, size, 64, dst, src));
+        instructions.push_back(new (arena) InstructionStore(address, size, 64, dst, src));
     else if (ud_obj->operand[1].type == UD_OP_MEM) {
         src = operand_load(ud_obj, 1, address, 128);
-        instructions.push_back(new InstructionAssign(address, size, dst, src));
+        instructions.push_back(new (arena) InstructionAssign(address, size, dst, src));
     }
     else
-        instructions.push_back(new InstructionAssign(address, size, dst, src));
+        instructions.push_back(new (arena) InstructionAssign(address, size, dst, src));
 }
 
 
@@ -1379,49 +1424,49 @@ void Translator :: mul (ud_t * ud_obj, uint64_t address)
         InstructionOperand rax(OPTYPE_VAR, 64, "UD_R_RAX");
         InstructionOperand rdx(OPTYPE_VAR, 64, "UD_R_RDX");
 
-        instructions.push_back(new InstructionShr(address, size, A, src, S32));
-        instructions.push_back(new InstructionAnd(address, size, B, src, A32));
-        instructions.push_back(new InstructionShr(address, size, C, rax, S32));
-        instructions.push_back(new InstructionAnd(address, size, D, rax, A32));
+        instructions.push_back(new (arena) InstructionShr(address, size, A, src, S32));
+        instructions.push_back(new (arena) InstructionAnd(address, size, B, src, A32));
+        instructions.push_back(new (arena) InstructionShr(address, size, C, rax, S32));
+        instructions.push_back(new (arena) InstructionAnd(address, size, D, rax, A32));
 
         // D * B
-        instructions.push_back(new InstructionMul(address, size, tmp, B, D));
-        instructions.push_back(new InstructionAnd(address, size, G, tmp, A32));
-        instructions.push_back(new InstructionShr(address, size, carry, tmp, S32));
+        instructions.push_back(new (arena) InstructionMul(address, size, tmp, B, D));
+        instructions.push_back(new (arena) InstructionAnd(address, size, G, tmp, A32));
+        instructions.push_back(new (arena) InstructionShr(address, size, carry, tmp, S32));
 
         // D * A
-        instructions.push_back(new InstructionMul(address, size, tmp, D, A));
-        instructions.push_back(new InstructionAdd(address, size, tmp, tmp, carry));
-        instructions.push_back(new InstructionAnd(address, size, F, tmp, A32));
-        instructions.push_back(new InstructionShr(address, size, E, tmp, S32));
+        instructions.push_back(new (arena) InstructionMul(address, size, tmp, D, A));
+        instructions.push_back(new (arena) InstructionAdd(address, size, tmp, tmp, carry));
+        instructions.push_back(new (arena) InstructionAnd(address, size, F, tmp, A32));
+        instructions.push_back(new (arena) InstructionShr(address, size, E, tmp, S32));
 
         // C * B
-        instructions.push_back(new InstructionMul(address, size, tmp, C, B));
-        instructions.push_back(new InstructionAnd(address, size, J, tmp, A32));
-        instructions.push_back(new InstructionShr(address, size, carry, tmp, S32));
+        instructions.push_back(new (arena) InstructionMul(address, size, tmp, C, B));
+        instructions.push_back(new (arena) InstructionAnd(address, size, J, tmp, A32));
+        instructions.push_back(new (arena) InstructionShr(address, size, carry, tmp, S32));
 
         // C * A
-        instructions.push_back(new InstructionMul(address, size, tmp, C, A));
-        instructions.push_back(new InstructionAdd(address, size, tmp, tmp, carry));
-        instructions.push_back(new InstructionAnd(address, size, I, tmp, A32));
-        instructions.push_back(new InstructionShr(address, size, H, tmp, S32));
+        instructions.push_back(new (arena) InstructionMul(address, size, tmp, C, A));
+        instructions.push_back(new (arena) InstructionAdd(address, size, tmp, tmp, carry));
+        instructions.push_back(new (arena) InstructionAnd(address, size, I, tmp, A32));
+        instructions.push_back(new (arena) InstructionShr(address, size, H, tmp, S32));
 
-        instructions.push_back(new InstructionAdd(address, size, rax, F, J));
-        instructions.push_back(new InstructionShr(address, size, carry, rax, S32));
-        instructions.push_back(new InstructionShl(address, size, rax, rax, S32));
-        instructions.push_back(new InstructionAdd(address, size, rax, rax, G));
+        instructions.push_back(new (arena) InstructionAdd(address, size, rax, F, J));
+        instructions.push_back(new (arena) InstructionShr(address, size, carry, rax, S32));
+        instructions.push_back(new (arena) InstructionShl(address, size, rax, rax, S32));
+        instructions.push_back(new (arena) InstructionAdd(address, size, rax, rax, G));
 
-        instructions.push_back(new InstructionShl(address, size, rdx, H, S32));
-        instructions.push_back(new InstructionAdd(address, size, rdx, rdx, E));
-        instructions.push_back(new InstructionAdd(address, size, rdx, rdx, I));
-        instructions.push_back(new InstructionAdd(address, size, rdx, rdx, carry));
+        instructions.push_back(new (arena) InstructionShl(address, size, rdx, H, S32));
+        instructions.push_back(new (arena) InstructionAdd(address, size, rdx, rdx, E));
+        instructions.push_back(new (arena) InstructionAdd(address, size, rdx, rdx, I));
+        instructions.push_back(new (arena) InstructionAdd(address, size, rdx, rdx, carry));
 
         InstructionOperand OF (OPTYPE_VAR, 1, "OF");
         InstructionOperand CF (OPTYPE_VAR, 1, "CF");
         InstructionOperand zero64 (OPTYPE_CONSTANT, 64, 0);
-        instructions.push_back(new InstructionCmpEq(address, size, OF, rdx, zero64));
-        instructions.push_back(new InstructionNot(address, size, OF, OF));
-        instructions.push_back(new InstructionAssign(address, size, CF, OF));
+        instructions.push_back(new (arena) InstructionCmpEq(address, size, OF, rdx, zero64));
+        instructions.push_back(new (arena) InstructionNot(address, size, OF, OF));
+        instructions.push_back(new (arena) InstructionAssign(address, size, CF, OF));
     }
     else {
         throw std::runtime_error("mul on unsupported operand size");
@@ -1437,20 +1482,20 @@ void Translator :: neg (ud_t * ud_obj, uint64_t address)
     InstructionOperand zero (OPTYPE_CONSTANT, src.g_bits(), 0);
     InstructionOperand tmp  (OPTYPE_VAR, src.g_bits());
 
-    instructions.push_back(new InstructionSub(address, size, tmp, zero, src));
+    instructions.push_back(new (arena) InstructionSub(address, size, tmp, zero, src));
 
     InstructionOperand CF (OPTYPE_VAR, 1, "CF");
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
 
-    instructions.push_back(new InstructionCmpEq(address, size, CF, src, zero));
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, CF, src, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, ZF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF, tmp, zero));
 
     InstructionOperand SFxorOF    (OPTYPE_VAR, 1);
     InstructionOperand OF (OPTYPE_VAR, 1, "OF");
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF, tmp, src));
-    instructions.push_back(new InstructionXor(address, size, OF, SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SFxorOF, tmp, src));
+    instructions.push_back(new (arena) InstructionXor(address, size, OF, SFxorOF, SF));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1458,16 +1503,16 @@ void Translator :: neg (ud_t * ud_obj, uint64_t address)
 
 void Translator :: nop (ud_t * ud_obj, uint64_t address)
 {
-    InstructionOperand noperand(OPTYPE_VAR, 1, "NOP");
+    InstructionOperand noperand(OPTYPE_VAR, 1);
     InstructionOperand zero(OPTYPE_CONSTANT, 1, 0);
-    instructions.push_back(new InstructionAssign(address, ud_insn_len(ud_obj), noperand, zero));
+    instructions.push_back(new (arena) InstructionAssign(address, ud_insn_len(ud_obj), noperand, zero));
 }
 
 
 void Translator :: Not (ud_t * ud_obj, uint64_t address)
 {
     InstructionOperand dst = operand_get(ud_obj, 0, address);
-    instructions.push_back(new InstructionNot(address, ud_insn_len(ud_obj), dst, dst));
+    instructions.push_back(new (arena) InstructionNot(address, ud_insn_len(ud_obj), dst, dst));
     operand_set(ud_obj, 0, address, dst);
 }
 
@@ -1481,8 +1526,8 @@ void Translator :: Or (ud_t * ud_obj, uint64_t address)
     InstructionOperand tmp (OPTYPE_VAR, dst.g_bits());
 
     // src is always sign-extended to length of dst
-    instructions.push_back(new InstructionSignExtend(address, size, tmp, src));
-    instructions.push_back(new InstructionOr(address, size, tmp, dst, tmp));
+    instructions.push_back(new (arena) InstructionSignExtend(address, size, tmp, src));
+    instructions.push_back(new (arena) InstructionOr(address, size, tmp, dst, tmp));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1503,7 +1548,7 @@ void Translator :: pcmpeqb (ud_t * ud_obj, uint64_t address)
 
     InstructionOperand result (OPTYPE_VAR, src.g_bits());
     InstructionOperand zero   (OPTYPE_CONSTANT, src.g_bits(), 0);
-    instructions.push_back(new InstructionAssign(address, size, result, zero));
+    instructions.push_back(new (arena) InstructionAssign(address, size, result, zero));
 
     InstructionOperand byte_mask (OPTYPE_CONSTANT, src.g_bits(), 0xff);
     InstructionOperand src_byte  (OPTYPE_VAR, src.g_bits());
@@ -1516,18 +1561,18 @@ void Translator :: pcmpeqb (ud_t * ud_obj, uint64_t address)
     for (int i = 0; i < src.g_bits() / 8; i++) {
         InstructionOperand shift (OPTYPE_CONSTANT, 8, i * 8);
         // isolate bytes
-        instructions.push_back(new InstructionShr(address, size, src_byte, src, shift));
-        instructions.push_back(new InstructionShr(address, size, dst_byte, dst, shift));
-        instructions.push_back(new InstructionAnd(address, size, src_byte, src_byte, byte_mask));
-        instructions.push_back(new InstructionAnd(address, size, dst_byte, dst_byte, byte_mask));
+        instructions.push_back(new (arena) InstructionShr(address, size, src_byte, src, shift));
+        instructions.push_back(new (arena) InstructionShr(address, size, dst_byte, dst, shift));
+        instructions.push_back(new (arena) InstructionAnd(address, size, src_byte, src_byte, byte_mask));
+        instructions.push_back(new (arena) InstructionAnd(address, size, dst_byte, dst_byte, byte_mask));
         // compare bytes
-        instructions.push_back(new InstructionCmpEq(address, size, byte_cmp, src_byte, dst_byte));
+        instructions.push_back(new (arena) InstructionCmpEq(address, size, byte_cmp, src_byte, dst_byte));
         // create mask
-        instructions.push_back(new InstructionMul(address, size, mask, byte_mask, byte_cmp));
+        instructions.push_back(new (arena) InstructionMul(address, size, mask, byte_mask, byte_cmp));
         // move mask into proper location
-        instructions.push_back(new InstructionShl(address, size, mask, mask, shift));
+        instructions.push_back(new (arena) InstructionShl(address, size, mask, mask, shift));
         // set mask in result
-        instructions.push_back(new InstructionOr(address, size, result, result, mask));
+        instructions.push_back(new (arena) InstructionOr(address, size, result, result, mask));
     }
 
     operand_set(ud_obj, 0, address, result);
@@ -1543,20 +1588,20 @@ void Translator :: pmovmskb (ud_t * ud_obj, uint64_t address)
 
     InstructionOperand result (OPTYPE_VAR, dst.g_bits());
     InstructionOperand zero   (OPTYPE_CONSTANT, dst.g_bits(), 0);
-    instructions.push_back(new InstructionAssign(address, size, result, zero));
+    instructions.push_back(new (arena) InstructionAssign(address, size, result, zero));
 
     InstructionOperand tmp (OPTYPE_VAR, src.g_bits());
     for (int i = 0; i < src.g_bits() / 8; i++) {
         InstructionOperand isolateShift(OPTYPE_CONSTANT, 8, 7 + (i * 8));
         InstructionOperand one (OPTYPE_CONSTANT, src.g_bits(), 1);
         // isolate proper bit
-        instructions.push_back(new InstructionShr(address, size, tmp, src, isolateShift));
-        instructions.push_back(new InstructionAnd(address, size, tmp, tmp, one));
+        instructions.push_back(new (arena) InstructionShr(address, size, tmp, src, isolateShift));
+        instructions.push_back(new (arena) InstructionAnd(address, size, tmp, tmp, one));
         // move bit to final location
         InstructionOperand finalShift(OPTYPE_CONSTANT, 8, i);
-        instructions.push_back(new InstructionShl(address, size, tmp, tmp, finalShift));
+        instructions.push_back(new (arena) InstructionShl(address, size, tmp, tmp, finalShift));
         // or with result
-        instructions.push_back(new InstructionOr(address, size, result, result, tmp));
+        instructions.push_back(new (arena) InstructionOr(address, size, result, result, tmp));
     }
 
     operand_set(ud_obj, 0, address, result);
@@ -1576,8 +1621,8 @@ void Translator :: pop (ud_t * ud_obj, uint64_t address)
     if (ud_obj->operand[0].type == UD_OP_REG) size = register_bits(ud_obj->operand[0].base);
     else size = ud_obj->operand[0].size;
     
-    instructions.push_back(new InstructionLoad(address, ud_insn_len(ud_obj), size, dst, rsp));
-    instructions.push_back(new InstructionAdd(address, ud_insn_len(ud_obj), rsp, rsp, addsize));
+    instructions.push_back(new (arena) InstructionLoad(address, ud_insn_len(ud_obj), size, dst, rsp));
+    instructions.push_back(new (arena) InstructionAdd(address, ud_insn_len(ud_obj), rsp, rsp, addsize));
 }
 
 
@@ -1593,7 +1638,7 @@ void Translator :: pshufd (ud_t * ud_obj, uint64_t address)
     InstructionOperand tmp    (OPTYPE_VAR, 128);
     InstructionOperand result (OPTYPE_VAR, 128);
     InstructionOperand zero   (OPTYPE_CONSTANT, 128, 0);
-    instructions.push_back(new InstructionAssign(address, size, result, zero));
+    instructions.push_back(new (arena) InstructionAssign(address, size, result, zero));
 
     InstructionOperand selector (OPTYPE_VAR, 32);
     InstructionOperand three    (OPTYPE_CONSTANT, 8, 0x3);
@@ -1602,17 +1647,17 @@ void Translator :: pshufd (ud_t * ud_obj, uint64_t address)
         InstructionOperand shiftr (OPTYPE_CONSTANT, 8, i * 2);
         InstructionOperand shiftl (OPTYPE_CONSTANT, 8, i * 32);
         // shift the order and mask it to find 2-bit index of dword in src
-        instructions.push_back(new InstructionShr(address, size, selector, order, shiftr));
-        instructions.push_back(new InstructionAnd(address, size, selector, selector, three));
+        instructions.push_back(new (arena) InstructionShr(address, size, selector, order, shiftr));
+        instructions.push_back(new (arena) InstructionAnd(address, size, selector, selector, three));
         // multiply dword index by 32 and shift src right so target dword is lower 32-bits
-        instructions.push_back(new InstructionMul(address, size, selector, selector, threetwo));
-        instructions.push_back(new InstructionShr(address, size, tmp, src, selector));
+        instructions.push_back(new (arena) InstructionMul(address, size, selector, selector, threetwo));
+        instructions.push_back(new (arena) InstructionShr(address, size, tmp, src, selector));
         // mask lower 32-bits
-        instructions.push_back(new InstructionAnd(address, size, tmp, tmp, mask));
+        instructions.push_back(new (arena) InstructionAnd(address, size, tmp, tmp, mask));
         // move these bits to their correct location where they will reside in result
-        instructions.push_back(new InstructionShl(address, size, tmp, tmp, shiftl));
+        instructions.push_back(new (arena) InstructionShl(address, size, tmp, tmp, shiftl));
         // or these bits to result
-        instructions.push_back(new InstructionOr (address, size, result, result, tmp));
+        instructions.push_back(new (arena) InstructionOr (address, size, result, result, tmp));
     }
 
     operand_set(ud_obj, 0, address, result);
@@ -1630,7 +1675,7 @@ void Translator :: punpcklbw (ud_t * ud_obj, uint64_t address)
         InstructionOperand tmpsrc   (OPTYPE_VAR, 128, 0);
         InstructionOperand tmpdst   (OPTYPE_VAR, 128, 0);
         InstructionOperand result_zero (OPTYPE_CONSTANT, 128, 0);
-        instructions.push_back(new InstructionAssign(address, size, result, result_zero));
+        instructions.push_back(new (arena) InstructionAssign(address, size, result, result_zero));
         for (int i = 0; i < 8; i++) {
             InstructionOperand mask_src (OPTYPE_CONSTANT, 64, 0xFFULL << (8 * i));
             InstructionOperand mask_dst (OPTYPE_CONSTANT, 64, 0xFFULL << (8 * i));
@@ -1639,14 +1684,14 @@ void Translator :: punpcklbw (ud_t * ud_obj, uint64_t address)
 
             // mask the appropriate bits and move them so the src bits are one byte
             // left of the dst bits
-            instructions.push_back(new InstructionAnd(address, size, tmpsrc, src,    mask_src));
-            instructions.push_back(new InstructionAnd(address, size, tmpdst, dst,    mask_dst));
-            instructions.push_back(new InstructionShl(address, size, tmpsrc, tmpsrc, shift8));
+            instructions.push_back(new (arena) InstructionAnd(address, size, tmpsrc, src,    mask_src));
+            instructions.push_back(new (arena) InstructionAnd(address, size, tmpdst, dst,    mask_dst));
+            instructions.push_back(new (arena) InstructionShl(address, size, tmpsrc, tmpsrc, shift8));
             // or the tmpsrc and tmpdst together into one variable
-            instructions.push_back(new InstructionOr (address, size, tmpdst, tmpdst, tmpsrc));
+            instructions.push_back(new (arena) InstructionOr (address, size, tmpdst, tmpdst, tmpsrc));
             // shift left and or with result
-            instructions.push_back(new InstructionShl(address, size, tmpdst, tmpdst, shift));
-            instructions.push_back(new InstructionOr (address, size, result, result, tmpdst));
+            instructions.push_back(new (arena) InstructionShl(address, size, tmpdst, tmpdst, shift));
+            instructions.push_back(new (arena) InstructionOr (address, size, result, result, tmpdst));
         }
     }
     else {
@@ -1665,9 +1710,9 @@ void Translator :: push (ud_t * ud_obj, uint64_t address)
     InstructionOperand subsize = InstructionOperand(OPTYPE_CONSTANT, 8, STACK_ELEMENT_SIZE);
     InstructionOperand sext      (OPTYPE_VAR, 64);
     
-    instructions.push_back(new InstructionSub(address, size, rsp, rsp, subsize));
-    instructions.push_back(new InstructionSignExtend(address, size, sext, src));
-    instructions.push_back(new InstructionStore(address, ud_insn_len(ud_obj), 64, rsp, sext));
+    instructions.push_back(new (arena) InstructionSub(address, size, rsp, rsp, subsize));
+    instructions.push_back(new (arena) InstructionSignExtend(address, size, sext, src));
+    instructions.push_back(new (arena) InstructionStore(address, ud_insn_len(ud_obj), 64, rsp, sext));
 }
 
 
@@ -1678,7 +1723,7 @@ void Translator :: pxor (ud_t * ud_obj, uint64_t address)
     InstructionOperand dst = operand_get(ud_obj, 1, address);
     InstructionOperand tmp (OPTYPE_VAR, 128, 0);
 
-    instructions.push_back(new InstructionOr(address, ud_insn_len(ud_obj), tmp, dst, src));
+    instructions.push_back(new (arena) InstructionOr(address, ud_insn_len(ud_obj), tmp, dst, src));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1691,21 +1736,37 @@ void Translator :: rep (ud_t * ud_obj, uint64_t address)
     // decrement rcx
     InstructionOperand rcx (OPTYPE_VAR, 64, "UD_R_RCX");
     InstructionOperand one (OPTYPE_CONSTANT, 64, 1);
-    instructions.push_back(new InstructionSub(address, size, rcx, rcx, one));
+    instructions.push_back(new (arena) InstructionSub(address, size, rcx, rcx, one));
 
     // if rcx != 0, jmp negative this instruction size
     // calculate condition
     InstructionOperand zero (OPTYPE_CONSTANT, 64, 0);
     InstructionOperand cond (OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionCmpEq(address, size, cond, rcx, zero));
-    instructions.push_back(new InstructionNot(address, size, cond, cond));
-    // find rip - instruction_size
-    InstructionOperand rip     (OPTYPE_VAR, 64, "UD_R_RIP");
-    InstructionOperand jmpDst  (OPTYPE_VAR, 64);
-    InstructionOperand insSize (OPTYPE_CONSTANT, 64, size);
-    instructions.push_back(new InstructionSub(address, size, jmpDst, rip, insSize));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, cond, rcx, zero));
+    instructions.push_back(new (arena) InstructionNot(address, size, cond, cond));
+    // jump back to this instruction
+    InstructionOperand jmpDst  (OPTYPE_CONSTANT, 64, address);
     // do conditional branch
-    instructions.push_back(new InstructionBrc(address, size, cond, jmpDst));
+    instructions.push_back(new (arena) InstructionBrc(address, size, cond, jmpDst));
+}
+
+
+void Translator :: rep_bulk (ud_t * ud_obj, uint64_t address)
+{
+    size_t size = ud_insn_len(ud_obj);
+
+    if (repne_scasb(ud_obj))
+        instructions.push_back(new (arena) InstructionRep(address, size, REPNE_SCAS, 8));
+    else if (ud_obj->pfx_rep == UD_Irep) {
+        switch (ud_obj->mnemonic) {
+        case UD_Istosd :
+            instructions.push_back(new (arena) InstructionRep(address, size, REP_STOS, 32));
+            break;
+        case UD_Imovsq :
+            instructions.push_back(new (arena) InstructionRep(address, size, REP_MOVS, 64));
+            break;
+        }
+    }
 }
 
 
@@ -1716,7 +1777,7 @@ void Translator :: repe (ud_t * ud_obj, uint64_t address)
     // decrement rcx
     InstructionOperand rcx (OPTYPE_VAR, 64, "UD_R_RCX");
     InstructionOperand one (OPTYPE_CONSTANT, 64, 1);
-    instructions.push_back(new InstructionSub(address, size, rcx, rcx, one));
+    instructions.push_back(new (arena) InstructionSub(address, size, rcx, rcx, one));
 
     // if rcx != 0 AND ZF==0, jmp negative this instruction size
     // calculate condition
@@ -1724,17 +1785,14 @@ void Translator :: repe (ud_t * ud_obj, uint64_t address)
     InstructionOperand notZF (OPTYPE_VAR, 1);
     InstructionOperand zero (OPTYPE_CONSTANT, 64, 0);
     InstructionOperand cond (OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionCmpEq(address, size, cond, rcx, zero));
-    instructions.push_back(new InstructionNot(address, size, notZF, ZF));
-    instructions.push_back(new InstructionAnd(address, size, cond, cond, notZF));
-    instructions.push_back(new InstructionNot(address, size, cond, cond));
-    // find rip - instruction_size
-    InstructionOperand rip     (OPTYPE_VAR, 64, "UD_R_RIP");
-    InstructionOperand jmpDst  (OPTYPE_VAR, 64);
-    InstructionOperand insSize (OPTYPE_CONSTANT, 64, size);
-    instructions.push_back(new InstructionSub(address, size, jmpDst, rip, insSize));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, cond, rcx, zero));
+    instructions.push_back(new (arena) InstructionNot(address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionAnd(address, size, cond, cond, notZF));
+    instructions.push_back(new (arena) InstructionNot(address, size, cond, cond));
+    // jump back to this instruction
+    InstructionOperand jmpDst  (OPTYPE_CONSTANT, 64, address);
     // do conditional branch
-    instructions.push_back(new InstructionBrc(address, size, cond, jmpDst));
+    instructions.push_back(new (arena) InstructionBrc(address, size, cond, jmpDst));
 }
 
 
@@ -1745,7 +1803,7 @@ void Translator :: repne (ud_t * ud_obj, uint64_t address)
     // decrement rcx
     InstructionOperand rcx (OPTYPE_VAR, 64, "UD_R_RCX");
     InstructionOperand one (OPTYPE_CONSTANT, 64, 1);
-    instructions.push_back(new InstructionSub(address, size, rcx, rcx, one));
+    instructions.push_back(new (arena) InstructionSub(address, size, rcx, rcx, one));
 
     // if rcx != 0 AND ZF==0, jmp negative this instruction size
     // calculate condition
@@ -1753,17 +1811,14 @@ void Translator :: repne (ud_t * ud_obj, uint64_t address)
     InstructionOperand notZF (OPTYPE_VAR, 1);
     InstructionOperand zero  (OPTYPE_CONSTANT, 64, 0);
     InstructionOperand cond  (OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionCmpEq(address, size, cond, rcx, zero));
-    instructions.push_back(new InstructionNot(address, size, cond, cond));
-    instructions.push_back(new InstructionNot(address, size, notZF, ZF));
-    instructions.push_back(new InstructionAnd(address, size, cond, cond, notZF));
-    // find rip - instruction_size
-    InstructionOperand rip     (OPTYPE_VAR, 64, "UD_R_RIP");
-    InstructionOperand jmpDst  (OPTYPE_VAR, 64);
-    InstructionOperand insSize (OPTYPE_CONSTANT, 64, size);
-    instructions.push_back(new InstructionSub(address, size, jmpDst, rip, insSize));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, cond, rcx, zero));
+    instructions.push_back(new (arena) InstructionNot(address, size, cond, cond));
+    instructions.push_back(new (arena) InstructionNot(address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionAnd(address, size, cond, cond, notZF));
+    // jump back to this instruction
+    InstructionOperand jmpDst  (OPTYPE_CONSTANT, 64, address);
     // do conditional branch
-    instructions.push_back(new InstructionBrc(address, size, cond, jmpDst));
+    instructions.push_back(new (arena) InstructionBrc(address, size, cond, jmpDst));
 }
 
 
@@ -1776,9 +1831,9 @@ void Translator :: ret (ud_t * ud_obj, uint64_t address)
     InstructionOperand rsp     = InstructionOperand(OPTYPE_VAR, 64, "UD_R_RSP");
     InstructionOperand addsize = InstructionOperand(OPTYPE_CONSTANT, 8, STACK_ELEMENT_SIZE);
 
-    instructions.push_back(new InstructionLoad(address, size, 64, dst, rsp));
-    instructions.push_back(new InstructionAdd(address, size, rsp, rsp, addsize));
-    instructions.push_back(new InstructionBrc(address, size, one, dst));
+    instructions.push_back(new (arena) InstructionLoad(address, size, 64, dst, rsp));
+    instructions.push_back(new (arena) InstructionAdd(address, size, rsp, rsp, addsize));
+    instructions.push_back(new (arena) InstructionBrc(address, size, one, dst));
 }
 
 
@@ -1793,21 +1848,21 @@ void Translator :: rol (ud_t * ud_obj, uint64_t address)
     InstructionOperand tmp     (OPTYPE_VAR, src.g_bits());
     InstructionOperand U64     (OPTYPE_CONSTANT, 8, 64);
 
-    instructions.push_back(new InstructionShl(address, size, tmpl,   src,  count));
-    instructions.push_back(new InstructionSub(address, size, countr, U64,  count));
-    instructions.push_back(new InstructionShr(address, size, tmpr,   src,  countr));
-    instructions.push_back(new InstructionOr (address, size, tmp,    tmpl, tmpr));
+    instructions.push_back(new (arena) InstructionShl(address, size, tmpl,   src,  count));
+    instructions.push_back(new (arena) InstructionSub(address, size, countr, U64,  count));
+    instructions.push_back(new (arena) InstructionShr(address, size, tmpr,   src,  countr));
+    instructions.push_back(new (arena) InstructionOr (address, size, tmp,    tmpl, tmpr));
 
     // is the LSB of the result
     InstructionOperand CF       (OPTYPE_VAR, 1, "CF");
     InstructionOperand one      (OPTYPE_CONSTANT, 8, 1);
-    instructions.push_back(new InstructionAnd(address, size, CF, tmp, one));
+    instructions.push_back(new (arena) InstructionAnd(address, size, CF, tmp, one));
 
     // MSB of the result XOR with CF
     InstructionOperand OF      (OPTYPE_VAR, 1, "OF");
     InstructionOperand OFShift (OPTYPE_CONSTANT, 8, src.g_bits() - 1);
-    instructions.push_back(new InstructionShr(address, size, OF, tmp, OFShift));
-    instructions.push_back(new InstructionXor(address, size, OF, OF, CF));
+    instructions.push_back(new (arena) InstructionShr(address, size, OF, tmp, OFShift));
+    instructions.push_back(new (arena) InstructionXor(address, size, OF, OF, CF));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1825,21 +1880,21 @@ void Translator :: ror (ud_t * ud_obj, uint64_t address)
     InstructionOperand tmp     (OPTYPE_VAR, src.g_bits());
     InstructionOperand U64     (OPTYPE_CONSTANT, 8, 64);
 
-    instructions.push_back(new InstructionShr(address, size, tmpr,   src,  count));
-    instructions.push_back(new InstructionSub(address, size, countl, U64,  count));
-    instructions.push_back(new InstructionShl(address, size, tmpl,   src,  countl));
-    instructions.push_back(new InstructionOr (address, size, tmp,    tmpr, tmpl));
+    instructions.push_back(new (arena) InstructionShr(address, size, tmpr,   src,  count));
+    instructions.push_back(new (arena) InstructionSub(address, size, countl, U64,  count));
+    instructions.push_back(new (arena) InstructionShl(address, size, tmpl,   src,  countl));
+    instructions.push_back(new (arena) InstructionOr (address, size, tmp,    tmpr, tmpl));
 
     // is the MSB of the result
     InstructionOperand CF       (OPTYPE_VAR, 1, "CF");
     InstructionOperand CFShift  (OPTYPE_CONSTANT, 8, src.g_bits() - 1);
-    instructions.push_back(new InstructionShr(address, size, CF, tmp, CFShift));
+    instructions.push_back(new (arena) InstructionShr(address, size, CF, tmp, CFShift));
 
     // XOR of two most significant bits
     InstructionOperand OF       (OPTYPE_VAR, 1, "OF");
     InstructionOperand OFShift (OPTYPE_CONSTANT, 8, src.g_bits() - 2);
-    instructions.push_back(new InstructionShr(address, size, OF, tmp, OFShift));
-    instructions.push_back(new InstructionXor(address, size, OF, OF, CF));
+    instructions.push_back(new (arena) InstructionShr(address, size, OF, tmp, OFShift));
+    instructions.push_back(new (arena) InstructionXor(address, size, OF, OF, CF));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1864,7 +1919,7 @@ void Translator :: sar (ud_t * ud_obj, uint64_t address)
                 CLMask = InstructionOperand(OPTYPE_CONSTANT, 8, 0x3f);
             else
                 CLMask = InstructionOperand(OPTYPE_CONSTANT, 8, 0x1f);
-            instructions.push_back(new InstructionAnd(address, size, bits, CL, CLMask));
+            instructions.push_back(new (arena) InstructionAnd(address, size, bits, CL, CLMask));
         }
         else
             bits = operand_get(ud_obj, 1, address);
@@ -1875,7 +1930,7 @@ void Translator :: sar (ud_t * ud_obj, uint64_t address)
     InstructionOperand one          (OPTYPE_CONSTANT, dst.g_bits(), 1);
     InstructionOperand zero         (OPTYPE_CONSTANT, dst.g_bits(), 0);
     
-    instructions.push_back(new InstructionShr(address, size, tmp, dst, bits));
+    instructions.push_back(new (arena) InstructionShr(address, size, tmp, dst, bits));
 
     // to calculate the sign, we isolate the sign bit, use it to set or zero
     // a variable of all 1s, shift that variable left (64 - bits), and or it
@@ -1887,31 +1942,31 @@ void Translator :: sar (ud_t * ud_obj, uint64_t address)
     InstructionOperand sixFour  (OPTYPE_CONSTANT, 8, dst.g_bits());
     InstructionOperand signShift (OPTYPE_VAR, 8);
 
-    instructions.push_back(new InstructionShr(address, size, signBit, dst, sixThree));
-    instructions.push_back(new InstructionMul(address, size, signMask, all1s, signBit));
-    instructions.push_back(new InstructionSub(address, size, signShift, sixFour, bits));
-    instructions.push_back(new InstructionShl(address, size, signMask, signMask, signShift));
-    instructions.push_back(new InstructionOr(address, size, tmp, tmp, signMask));
+    instructions.push_back(new (arena) InstructionShr(address, size, signBit, dst, sixThree));
+    instructions.push_back(new (arena) InstructionMul(address, size, signMask, all1s, signBit));
+    instructions.push_back(new (arena) InstructionSub(address, size, signShift, sixFour, bits));
+    instructions.push_back(new (arena) InstructionShl(address, size, signMask, signMask, signShift));
+    instructions.push_back(new (arena) InstructionOr(address, size, tmp, tmp, signMask));
 
     
     // CF takes last bit shifted out of dst
     InstructionOperand CF           (OPTYPE_VAR, 1, "CF");
     InstructionOperand bitsMinusOne (OPTYPE_VAR,   dst.g_bits());
-    instructions.push_back(new InstructionSub(address, size, bitsMinusOne, bits, one));
-    instructions.push_back(new InstructionShr(address, size, CF, dst, bitsMinusOne));
+    instructions.push_back(new (arena) InstructionSub(address, size, bitsMinusOne, bits, one));
+    instructions.push_back(new (arena) InstructionShr(address, size, CF, dst, bitsMinusOne));
     
     // OF is cleared on 1-bit shifts, otherwise it's undefined
     InstructionOperand OF     (OPTYPE_VAR, 1, "OF");
     InstructionOperand OFMask (OPTYPE_VAR, 1);
-    instructions.push_back(new InstructionCmpEq(address, size, OFMask, bits, one));
-    instructions.push_back(new InstructionNot  (address, size, OFMask, OFMask));
-    instructions.push_back(new InstructionAnd  (address, size, OF, OF, OFMask));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, OFMask, bits, one));
+    instructions.push_back(new (arena) InstructionNot  (address, size, OFMask, OFMask));
+    instructions.push_back(new (arena) InstructionAnd  (address, size, OF, OF, OFMask));
     
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF, tmp, zero));
     
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, ZF, tmp, zero));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1924,23 +1979,11 @@ void Translator :: sbb (ud_t * ud_obj, uint64_t address)
     InstructionOperand lhs = operand_get(ud_obj, 0, address);
     InstructionOperand rhs = operand_get(ud_obj, 1, address);
     InstructionOperand tmp (OPTYPE_VAR, lhs.g_bits());
-
-    InstructionOperand CF       (OPTYPE_VAR, 1, "CF"); // unsigned overflow
-    InstructionOperand ZF       (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF       (OPTYPE_VAR, 1, "SF"); // "negative" flag
-    InstructionOperand zero     (OPTYPE_CONSTANT, tmp.g_bits(), 0);
-    
-    instructions.push_back(new InstructionAdd(address, size, tmp, rhs, CF));
-    instructions.push_back(new InstructionSub(address, size, tmp, lhs, tmp));
+    InstructionOperand CF  (OPTYPE_VAR, 1, "CF"); // unsigned overflow
     
-    instructions.push_back(new InstructionCmpLtu(address, size, CF, lhs, tmp));
-    instructions.push_back(new InstructionCmpEq (address, size, ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
-
-    InstructionOperand SFxorOF    (OPTYPE_VAR, 1);
-    InstructionOperand OF (OPTYPE_VAR, 1, "OF");
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF, tmp, rhs));
-    instructions.push_back(new InstructionXor(address, size, OF, SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionAdd(address, size, tmp, rhs, CF));
+    instructions.push_back(new (arena) InstructionSub(address, size, tmp, lhs, tmp));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_SBB, lhs, rhs, tmp));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -1953,12 +1996,12 @@ void Translator :: scasb (ud_t * ud_obj, uint64_t address)
     // isolate lsbyte of rax
     InstructionOperand al (OPTYPE_VAR, 8);
     InstructionOperand rax (OPTYPE_VAR, 64, "UD_R_RAX");
-    instructions.push_back(new InstructionAssign(address, size, al, rax));
+    instructions.push_back(new (arena) InstructionAssign(address, size, al, rax));
 
     // get value to compare against
     InstructionOperand rdi (OPTYPE_VAR, 64, "UD_R_RDI");
     InstructionOperand cmpByte (OPTYPE_VAR, 8);
-    instructions.push_back(new InstructionLoad(address, size, 8, cmpByte, rdi));
+    instructions.push_back(new (arena) InstructionLoad(address, size, 8, cmpByte, rdi));
 
     // taken from Translator :: cmp
     InstructionOperand CF          (OPTYPE_VAR, 1, "CF");
@@ -1970,14 +2013,14 @@ void Translator :: scasb (ud_t * ud_obj, uint64_t address)
     InstructionOperand SF          (OPTYPE_VAR, 1, "SF");
     InstructionOperand tmp0        (OPTYPE_VAR, 8);
     InstructionOperand tmp0s       (OPTYPE_CONSTANT, 8, 0);
-    instructions.push_back(new InstructionCmpLtu(address, size, CF,          cmpByte, al));
-    instructions.push_back(new InstructionCmpLeu(address, size, CForZF,      cmpByte, al));
-    instructions.push_back(new InstructionCmpLts(address, size, SFxorOF,     cmpByte, al));
-    instructions.push_back(new InstructionCmpLes(address, size, SFxorOForZF, cmpByte, al));
-    instructions.push_back(new InstructionCmpEq (address, size, ZF,          cmpByte, al));
-    instructions.push_back(new InstructionSub   (address, size, tmp0,        cmpByte, al));
-    instructions.push_back(new InstructionCmpLts(address, size, SF,          tmp0, tmp0s));
-    instructions.push_back(new InstructionXor   (address, size, OF,          SFxorOF, SF));
+    instructions.push_back(new (arena) InstructionCmpLtu(address, size, CF,          cmpByte, al));
+    instructions.push_back(new (arena) InstructionCmpLeu(address, size, CForZF,      cmpByte, al));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SFxorOF,     cmpByte, al));
+    instructions.push_back(new (arena) InstructionCmpLes(address, size, SFxorOForZF, cmpByte, al));
+    instructions.push_back(new (arena) InstructionCmpEq (address, size, ZF,          cmpByte, al));
+    instructions.push_back(new (arena) InstructionSub   (address, size, tmp0,        cmpByte, al));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF,          tmp0, tmp0s));
+    instructions.push_back(new (arena) InstructionXor   (address, size, OF,          SFxorOF, SF));
 
     // if DF==0 then RDI += 1; if DF == 1 then RDI -= 1
     InstructionOperand DF     (OPTYPE_VAR, 1, "DF");
@@ -1985,10 +2028,10 @@ void Translator :: scasb (ud_t * ud_obj, uint64_t address)
     InstructionOperand one    (OPTYPE_CONSTANT, 64, 1);
     InstructionOperand add    (OPTYPE_VAR, 64);
     InstructionOperand addTmp (OPTYPE_VAR, 64);
-    instructions.push_back(new InstructionAssign(address, size, add, one));
-    instructions.push_back(new InstructionMul(address, size, addTmp, neg2, DF));
-    instructions.push_back(new InstructionAdd(address, size, add, add, addTmp));
-    instructions.push_back(new InstructionAdd(address, size, rdi, rdi, add));
+    instructions.push_back(new (arena) InstructionAssign(address, size, add, one));
+    instructions.push_back(new (arena) InstructionMul(address, size, addTmp, neg2, DF));
+    instructions.push_back(new (arena) InstructionAdd(address, size, add, add, addTmp));
+    instructions.push_back(new (arena) InstructionAdd(address, size, rdi, rdi, add));
 
     // suck it udis86 (doesn't correctly ret prefix for this instruction)
     if ((ud_insn_ptr(ud_obj)[0] == 0xf2) && (ud_obj->pfx_rep == 0))
@@ -2005,8 +2048,8 @@ void Translator :: seta (ud_t * ud_obj, uint64_t address)
     InstructionOperand CFandZF    (OPTYPE_VAR, 1);
     InstructionOperand notCFandZF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionAnd(address, size, CFandZF, CF, ZF));
-    instructions.push_back(new InstructionNot(address, size, notCFandZF, CFandZF));
+    instructions.push_back(new (arena) InstructionAnd(address, size, CFandZF, CF, ZF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notCFandZF, CFandZF));
 
     operand_set(ud_obj, 0, address, notCFandZF);
 }
@@ -2023,9 +2066,9 @@ void Translator :: setg (ud_t * ud_obj, uint64_t address)
     InstructionOperand notZF  (OPTYPE_VAR, 1);
     InstructionOperand notZFandSFeqOF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, size, notZF, ZF));
-    instructions.push_back(new InstructionCmpEq(address, size, SFeqOF, SF, OF));
-    instructions.push_back(new InstructionAnd(address, size, notZFandSFeqOF, notZF, SFeqOF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notZF, ZF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, SFeqOF, SF, OF));
+    instructions.push_back(new (arena) InstructionAnd(address, size, notZFandSFeqOF, notZF, SFeqOF));
 
     operand_set(ud_obj, 0, address, notZFandSFeqOF);
 }
@@ -2040,8 +2083,8 @@ void Translator :: setl (ud_t * ud_obj, uint64_t address)
     InstructionOperand SFeqOF (OPTYPE_VAR, 1);
     InstructionOperand notSFeqOF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionCmpEq(address, size, SFeqOF, SF, OF));
-    instructions.push_back(new InstructionNot(address, size, notSFeqOF, SFeqOF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, SFeqOF, SF, OF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notSFeqOF, SFeqOF));
 
     operand_set(ud_obj, 0, address, notSFeqOF);
 }
@@ -2058,9 +2101,9 @@ void Translator :: setle (ud_t * ud_obj, uint64_t address)
     InstructionOperand notSFeqOF     (OPTYPE_VAR, 1);
     InstructionOperand ZFornotSFeqOF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionCmpEq(address, size, SFeqOF, SF, OF));
-    instructions.push_back(new InstructionNot(address, size, notSFeqOF, SFeqOF));
-    instructions.push_back(new InstructionOr(address, size, ZFornotSFeqOF, ZF, notSFeqOF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, SFeqOF, SF, OF));
+    instructions.push_back(new (arena) InstructionNot(address, size, notSFeqOF, SFeqOF));
+    instructions.push_back(new (arena) InstructionOr(address, size, ZFornotSFeqOF, ZF, notSFeqOF));
 
     operand_set(ud_obj, 0, address, ZFornotSFeqOF);
 }
@@ -2071,7 +2114,7 @@ void Translator :: setnb (ud_t * ud_obj, uint64_t address)
     InstructionOperand CF    (OPTYPE_VAR, 1, "CF");
     InstructionOperand notCF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, ud_insn_len(ud_obj), notCF, CF));
+    instructions.push_back(new (arena) InstructionNot(address, ud_insn_len(ud_obj), notCF, CF));
 
     operand_set(ud_obj, 0, address, notCF);
 }
@@ -2082,7 +2125,7 @@ void Translator :: setnz (ud_t * ud_obj, uint64_t address)
     InstructionOperand ZF    (OPTYPE_VAR, 1, "ZF");
     InstructionOperand notZF (OPTYPE_VAR, 1);
 
-    instructions.push_back(new InstructionNot(address, ud_insn_len(ud_obj), notZF, ZF));
+    instructions.push_back(new (arena) InstructionNot(address, ud_insn_len(ud_obj), notZF, ZF));
 
     operand_set(ud_obj, 0, address, notZF);
 }
@@ -2117,23 +2160,23 @@ void Translator :: shl (ud_t * ud_obj, uint64_t address)
     InstructionOperand CF           (OPTYPE_VAR, 1, "CF");
     InstructionOperand bitsMinusOne (OPTYPE_VAR,   dst.g_bits());
     InstructionOperand dstBitsMinusOne (OPTYPE_CONSTANT, dst.g_bits(), dst.g_bits() - 1);
-    instructions.push_back(new InstructionSub(address, size, bitsMinusOne, bits, one));
-    instructions.push_back(new InstructionShl(address, size, tmp, dst, bitsMinusOne));
-    instructions.push_back(new InstructionShr(address, size, CF, tmp, dstBitsMinusOne));
+    instructions.push_back(new (arena) InstructionSub(address, size, bitsMinusOne, bits, one));
+    instructions.push_back(new (arena) InstructionShl(address, size, tmp, dst, bitsMinusOne));
+    instructions.push_back(new (arena) InstructionShr(address, size, CF, tmp, dstBitsMinusOne));
     
     // OF is set to 1 if MSB of original dst is same of final dst
     InstructionOperand OF      (OPTYPE_VAR, 1, "OF");
-    instructions.push_back(new InstructionShl(address, size, tmp, dst, bitsMinusOne));
-    instructions.push_back(new InstructionAnd(address, size, tmp, tmp, dst));
-    instructions.push_back(new InstructionShr(address, size, OF, tmp, dstBitsMinusOne));
+    instructions.push_back(new (arena) InstructionShl(address, size, tmp, dst, bitsMinusOne));
+    instructions.push_back(new (arena) InstructionAnd(address, size, tmp, tmp, dst));
+    instructions.push_back(new (arena) InstructionShr(address, size, OF, tmp, dstBitsMinusOne));
     
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF, tmp, zero));
     
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, ZF, tmp, zero));
     
-    instructions.push_back(new InstructionShl(address, size, tmp, dst, bits));
+    instructions.push_back(new (arena) InstructionShl(address, size, tmp, dst, bits));
     operand_set(ud_obj, 0, address, tmp);
 }
 
@@ -2154,30 +2197,30 @@ void Translator :: shld (ud_t * ud_obj, uint64_t address)
     InstructionOperand srcTmp   (OPTYPE_VAR, dst.g_bits());
     InstructionOperand sixThree (OPTYPE_CONSTANT, 8, 63);
 
-    instructions.push_back(new InstructionAnd(address, size, shift, bits, sixThree));
-    instructions.push_back(new InstructionShl(address, size, tmp, src, shift));
-    instructions.push_back(new InstructionSub(address, size, srcShift, srcBits, shift));
-    instructions.push_back(new InstructionShr(address, size, srcTmp, src, srcShift));
+    instructions.push_back(new (arena) InstructionAnd(address, size, shift, bits, sixThree));
+    instructions.push_back(new (arena) InstructionShl(address, size, tmp, src, shift));
+    instructions.push_back(new (arena) InstructionSub(address, size, srcShift, srcBits, shift));
+    instructions.push_back(new (arena) InstructionShr(address, size, srcTmp, src, srcShift));
 
     InstructionOperand CF (OPTYPE_VAR, 1, "CF");
     InstructionOperand dstBitsMinusOne (OPTYPE_CONSTANT, 8, dst.g_bits() - 1);
-    instructions.push_back(new InstructionShr(address, size, CF, dst, dstBitsMinusOne));
+    instructions.push_back(new (arena) InstructionShr(address, size, CF, dst, dstBitsMinusOne));
 
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
     InstructionOperand zero (OPTYPE_CONSTANT, dst.g_bits(), 0);
-    instructions.push_back(new InstructionCmpLts(address, size, SF, zero, tmp));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF, zero, tmp));
 
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, ZF, tmp, zero));
 
     InstructionOperand OF    (OPTYPE_VAR, 1, "OF");
     InstructionOperand one   (OPTYPE_CONSTANT, dst.g_bits(), 1);
     InstructionOperand setOF (OPTYPE_VAR, 1);
     InstructionOperand OFTmp (OPTYPE_VAR, dst.g_bits());
-    instructions.push_back(new InstructionCmpEq(address, size, setOF, tmp, one));
-    instructions.push_back(new InstructionXor(address, size, OFTmp, tmp, dst));
-    instructions.push_back(new InstructionShr(address, size, OFTmp, OFTmp, dstBitsMinusOne));
-    instructions.push_back(new InstructionAnd(address, size, OF, OFTmp, setOF));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, setOF, tmp, one));
+    instructions.push_back(new (arena) InstructionXor(address, size, OFTmp, tmp, dst));
+    instructions.push_back(new (arena) InstructionShr(address, size, OFTmp, OFTmp, dstBitsMinusOne));
+    instructions.push_back(new (arena) InstructionAnd(address, size, OF, OFTmp, setOF));
 
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -2202,7 +2245,7 @@ void Translator :: shr (ud_t * ud_obj, uint64_t address)
                 CLMask = InstructionOperand(OPTYPE_CONSTANT, 8, 0x3f);
             else
                 CLMask = InstructionOperand(OPTYPE_CONSTANT, 8, 0x1f);
-            instructions.push_back(new InstructionAnd(address, size, bits, CL, CLMask));
+            instructions.push_back(new (arena) InstructionAnd(address, size, bits, CL, CLMask));
         }
         else
             bits = operand_get(ud_obj, 1, address);
@@ -2213,24 +2256,24 @@ void Translator :: shr (ud_t * ud_obj, uint64_t address)
     InstructionOperand one          (OPTYPE_CONSTANT, dst.g_bits(), 1);
     InstructionOperand zero         (OPTYPE_CONSTANT, dst.g_bits(), 0);
     
-    instructions.push_back(new InstructionShr(address, size, tmp, dst, bits));
+    instructions.push_back(new (arena) InstructionShr(address, size, tmp, dst, bits));
     
     // CF takes last bit shifted out of dst
     InstructionOperand CF           (OPTYPE_VAR, 1, "CF");
     InstructionOperand bitsMinusOne (OPTYPE_VAR,   dst.g_bits());
-    instructions.push_back(new InstructionSub(address, size, bitsMinusOne, bits, one));
-    instructions.push_back(new InstructionShr(address, size, CF, dst, bitsMinusOne));
+    instructions.push_back(new (arena) InstructionSub(address, size, bitsMinusOne, bits, one));
+    instructions.push_back(new (arena) InstructionShr(address, size, CF, dst, bitsMinusOne));
     
     // OF is set to the MSB of the original operand
     InstructionOperand OF      (OPTYPE_VAR, 1, "OF");
     InstructionOperand OFShift (OPTYPE_CONSTANT, 8, dst.g_bits() - 1);
-    instructions.push_back(new InstructionShr  (address, size, OF, dst, OFShift));
+    instructions.push_back(new (arena) InstructionShr  (address, size, OF, dst, OFShift));
     
     InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    instructions.push_back(new InstructionCmpLts(address, size, SF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpLts(address, size, SF, tmp, zero));
     
     InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, tmp, zero));
+    instructions.push_back(new (arena) InstructionCmpEq(address, size, ZF, tmp, zero));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -2241,7 +2284,7 @@ void Translator :: std (ud_t * ud_obj, uint64_t address)
     InstructionOperand DF (OPTYPE_VAR, 1, "DF");
     InstructionOperand one (OPTYPE_CONSTANT, 1, 1);
 
-    instructions.push_back(new InstructionAssign(address, ud_insn_len(ud_obj), DF, one));
+    instructions.push_back(new (arena) InstructionAssign(address, ud_insn_len(ud_obj), DF, one));
 }
 
 
@@ -2253,7 +2296,7 @@ void Translator :: stosd (ud_t * ud_obj, uint64_t address)
     InstructionOperand eax (OPTYPE_VAR, 32, "UD_R_RAX");
     // store at location rdi
     InstructionOperand rdi (OPTYPE_VAR, 64, "UD_R_RDI");
-    instructions.push_back(new InstructionStore(address, size, 32, rdi, eax));
+    instructions.push_back(new (arena) InstructionStore(address, size, 32, rdi, eax));
 
     // if DF == 0 then rdi += 4, if DF == 1 then rdi -= 4
     InstructionOperand DF     (OPTYPE_VAR, 1, "DF");
@@ -2261,10 +2304,10 @@ void Translator :: stosd (ud_t * ud_obj, uint64_t address)
     InstructionOperand one    (OPTYPE_CONSTANT, 64, 4);
     InstructionOperand add    (OPTYPE_VAR, 64);
     InstructionOperand addTmp (OPTYPE_VAR, 64);
-    instructions.push_back(new InstructionAssign(address, size, add, one));
-    instructions.push_back(new InstructionMul(address, size, addTmp, neg2, DF));
-    instructions.push_back(new InstructionAdd(address, size, add, add, addTmp));
-    instructions.push_back(new InstructionAdd(address, size, rdi, rdi, add));
+    instructions.push_back(new (arena) InstructionAssign(address, size, add, one));
+    instructions.push_back(new (arena) InstructionMul(address, size, addTmp, neg2, DF));
+    instructions.push_back(new (arena) InstructionAdd(address, size, add, add, addTmp));
+    instructions.push_back(new (arena) InstructionAdd(address, size, rdi, rdi, add));
 }
 
 
@@ -2274,23 +2317,9 @@ void Translator :: sub (ud_t * ud_obj, uint64_t address)
     InstructionOperand lhs = operand_get(ud_obj, 0, address);
     InstructionOperand rhs = operand_get(ud_obj, 1, address);
     InstructionOperand tmp (OPTYPE_VAR, lhs.g_bits());
-        
-    InstructionOperand OFTmp    (OPTYPE_VAR, lhs.g_bits());
-    InstructionOperand OFTmpShl (OPTYPE_CONSTANT, lhs.g_bits(), lhs.g_bits() - 1);
-    InstructionOperand OF       (OPTYPE_VAR, 1, "OF"); // signed overflow
-    InstructionOperand CF       (OPTYPE_VAR, 1, "CF"); // unsigned overflow
-    InstructionOperand ZF       (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF       (OPTYPE_VAR, 1, "SF"); // "negative" flag
-    InstructionOperand zero     (OPTYPE_CONSTANT, tmp.g_bits(), 0);
-    
-    instructions.push_back(new InstructionSub(address, ud_insn_len(ud_obj), tmp, lhs, rhs));
-    
-    instructions.push_back(new InstructionXor(address, ud_insn_len(ud_obj), OFTmp, tmp,   lhs));
-    instructions.push_back(new InstructionShr(address, ud_insn_len(ud_obj), OF,    OFTmp, OFTmpShl));
     
-    instructions.push_back(new InstructionCmpLtu(address, ud_insn_len(ud_obj), CF, lhs, tmp));
-    instructions.push_back(new InstructionCmpEq (address, ud_insn_len(ud_obj), ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, ud_insn_len(ud_obj), SF, tmp, zero));
+    instructions.push_back(new (arena) InstructionSub(address, ud_insn_len(ud_obj), tmp, lhs, rhs));
+    instructions.push_back(new (arena) InstructionFlags(address, ud_insn_len(ud_obj), FLAGS_SUB, lhs, rhs, tmp));
     
     operand_set(ud_obj, 0, address, tmp);
 }
@@ -2298,7 +2327,7 @@ void Translator :: sub (ud_t * ud_obj, uint64_t address)
 
 void Translator :: syscall (ud_t * ud_obj, uint64_t address)
 {
-    instructions.push_back(new InstructionSyscall(address, ud_insn_len(ud_obj)));
+    instructions.push_back(new (arena) InstructionSyscall(address, ud_insn_len(ud_obj)));
 }
 
 
@@ -2308,18 +2337,8 @@ void Translator :: test (ud_t * ud_obj, uint64_t address)
     InstructionOperand rhs = operand_get(ud_obj, 1, address);
     InstructionOperand tmp   (OPTYPE_VAR, lhs.g_bits());
     
-    InstructionOperand OF       (OPTYPE_VAR, 1, "OF"); // signed overflow
-    InstructionOperand CF       (OPTYPE_VAR, 1, "CF"); // unsigned overflow
-    InstructionOperand ZF       (OPTYPE_VAR, 1, "ZF");
-    InstructionOperand SF       (OPTYPE_VAR, 1, "SF"); // "negative" flag
-    InstructionOperand zero     (OPTYPE_CONSTANT, tmp.g_bits(), 0);
-    
-    instructions.push_back(new InstructionAnd(address, ud_insn_len(ud_obj), tmp, lhs, rhs));
-    
-    instructions.push_back(new InstructionCmpEq(address, ud_insn_len(ud_obj), ZF, tmp, zero));
-    instructions.push_back(new InstructionCmpLts(address, ud_insn_len(ud_obj), SF, tmp, zero));
-    instructions.push_back(new InstructionAssign(address, ud_insn_len(ud_obj), OF, zero));
-    instructions.push_back(new InstructionAssign(address, ud_insn_len(ud_obj), CF, zero));
+    instructions.push_back(new (arena) InstructionAnd(address, ud_insn_len(ud_obj), tmp, lhs, rhs));
+    instructions.push_back(new (arena) InstructionFlags(address, ud_insn_len(ud_obj), FLAGS_LOGIC, lhs, rhs, tmp));
 }
 
 
@@ -2330,18 +2349,8 @@ void Translator :: Xor (ud_t * ud_obj, uint64_t address)
     InstructionOperand dst(operand_get(ud_obj, 0, address));
     InstructionOperand src(operand_get(ud_obj, 1, address));
 
-    instructions.push_back(new InstructionXor(address, size, dst, dst, src));
-
-    InstructionOperand OF (OPTYPE_VAR, 1, "OF");
-    InstructionOperand CF (OPTYPE_VAR, 1, "CF");
-    InstructionOperand zero (OPTYPE_CONSTANT, dst.g_bits(), 0);
-    instructions.push_back(new InstructionAssign(address, size, OF, zero));
-    instructions.push_back(new InstructionAssign(address, size, CF, zero));
-
-    InstructionOperand SF (OPTYPE_VAR, 1, "SF");
-    InstructionOperand ZF (OPTYPE_VAR, 1, "ZF");
-    instructions.push_back(new InstructionCmpEq(address, size, ZF, dst, zero));
-    instructions.push_back(new InstructionCmpLts(address, size, SF, dst, zero));
+    instructions.push_back(new (arena) InstructionXor(address, size, dst, dst, src));
+    instructions.push_back(new (arena) InstructionFlags(address, size, FLAGS_LOGIC, dst, src, dst));
 
     operand_set(ud_obj, 0, address, dst);
 }
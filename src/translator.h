@@ -30,10 +30,22 @@
 
 #define STACK_ELEMENT_SIZE 8
 
+// the most x86 instructions translate_block will lift into one block
+#define MAX_BLOCK_INSTRUCTIONS 32
+
+/*
+ * Lifts x86-64 into IR. The IR is allocated from the Translator's arena and
+ * stays valid until the Translator is destroyed, callers must not delete it.
+ */
 class Translator {
     private :
+        InstructionArena          arena;
         std::list <Instruction *> instructions;
+        size_t                    guest_count;
         
+        void translate_instruction (ud_t * ud_obj, uint64_t address);
+        bool ends_block            (ud_t * ud_obj);
+
         int register_bits    (int reg);
         int register_to64    (int reg);
         
@@ -42,9 +54,13 @@ class Translator {
         InstructionOperand operand_load (ud_t * ud_obj, int operand_i, uint64_t address, int bits);
         InstructionOperand operand_get  (ud_t * ud_obj, int operand_i, uint64_t address);
         InstructionOperand operand      (ud_t * ud_obj, int operand_i, uint64_t address);
+        InstructionOperand next_rip     (ud_t * ud_obj, uint64_t address);
 
         void cmovcc    (ud_t * ud_obj, uint64_t address, InstructionOperand cond);
         void jcc       (ud_t * ud_obj, uint64_t address, InstructionOperand cond);
+        // emits an InstructionRep ahead of a rep string instruction the VM
+        // can run in bulk
+        void rep_bulk  (ud_t * ud_obj, uint64_t address);
         
         void adc       (ud_t * ud_obj, uint64_t address);
         void add       (ud_t * ud_obj, uint64_t address);
@@ -131,8 +147,27 @@ class Translator {
         void Xor       (ud_t * ud_obj, uint64_t address);
     
     public :
+        Translator () : guest_count(0) {}
+
+        // every instruction in size bytes at data, separated by "; "
         std::string native_asm (uint8_t * data, int size);
+
+        // where the IR is allocated, for passes that rewrite it
+        InstructionArena & g_arena () { return arena; }
+
+        // the number of temporaries used by the last translation
+        size_t g_tmp_count () { return InstructionOperandTmpVar::get().g_count(); }
+        // the number of x86 instructions lifted by the last translation
+        size_t g_guest_count () { return guest_count; }
         std::list <Instruction *> translate (uint64_t address, uint8_t * data, size_t size);
+
+        // lifts instructions starting at address up to and including the next
+        // control transfer (jcc, jmp, call, ret, rep prefix, syscall, hlt).
+        // block_size is set to the number of bytes translated.
+        std::list <Instruction *> translate_block (uint64_t address,
+                                                   uint8_t * data,
+                                                   size_t    size,
+                                                   size_t &  block_size);
 };
 
 #endif
@@ -20,6 +20,7 @@
 #include "vm.h"
 
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <stdexcept>
 
@@ -31,7 +32,9 @@ void VM :: debug_x86_registers ()
 {
     std::stringstream ss;
 
-    #define GVALUE(XX) variables[InstructionOperand::str_to_id(XX)].str()
+    settle_flags();
+
+    #define GVALUE(XX) registers[register_slot(XX)].str()
     #define PRINTREG(XX) << XX << "=" \
                          << std::hex << GVALUE(XX) << std::endl
     
@@ -55,18 +58,19 @@ void VM :: debug_variables ()
 {
     std::stringstream ss;
 
-    std::map <uint64_t, SymbolicValue> :: iterator it;
-    for (it = variables.begin(); it != variables.end(); it++) {
-        ss << std::hex << it->first << "=" 
-           << it->second.str() << std::endl;
-    }
+    settle_flags();
+
+    for (int i = 0; i < SLOT_COUNT; i++)
+        ss << register_name(i) << "=" << registers[i].str() << std::endl;
+    for (size_t i = 0; i < scratch.size(); i++)
+        ss << std::hex << (i + SLOT_COUNT) << "=" << scratch[i].str() << std::endl;
 
     std::cout << ss.str();
 }
 
 SymbolicValue VM :: g_variable (uint64_t identifier)
 {
-    return variables[identifier];
+    return variable(identifier);
 }
 
 const SymbolicValue VM :: g_value (InstructionOperand operand)
@@ -74,22 +78,33 @@ const SymbolicValue VM :: g_value (InstructionOperand operand)
     if (operand.g_type() == OPTYPE_CONSTANT)
         return SymbolicValue(operand.g_bits(), operand.g_value());
 
-    if (variables.count(operand.g_id()) == 0) {
+    const SymbolicValue & value = variable(operand.g_id());
+    if (value.g_type() == SVT_NONE) {
         std::stringstream ss;
         ss << "operand not found, id: " << std::hex << operand.g_id();
         throw std::runtime_error(ss.str());
     }
     
-    return variables[operand.g_id()].extend(operand.g_bits());
+    return value.extend(operand.g_bits());
 }
 
 
 void VM :: init ()
 {
-    #ifdef DEBUG
-    std::cerr << "loading translator" << std::endl;
-    #endif    
-    translator = Translator();
+    depth             = 0;
+    instructions      = 0;
+    symbolic_branches = 0;
+    faulted           = false;
+
+    // VMs without an engine get a code cache of their own
+    if (engine == NULL) {
+        code_cache        = new CodeCache();
+        delete_code_cache = true;
+    }
+    else {
+        code_cache        = engine->g_code_cache();
+        delete_code_cache = false;
+    }
 
     #ifdef DEBUG
     std::cerr << "getting memory" << std::endl;
@@ -97,14 +112,9 @@ void VM :: init ()
     memory     = loader->g_memory();
 
     #ifdef DEBUG
-    std::cerr << "getting variables" << std::endl;
+    std::cerr << "getting registers" << std::endl;
     #endif
-    variables  = loader->g_variables();
-
-    #ifdef DEBUG
-    std::cerr << "getting instruction pointer id" << std::endl;
-    #endif
-    ip_id      = loader->g_ip_id();
+    registers  = loader->g_registers();
 
     //std::cout << "Memory mmap: " << std::endl << memory.memmap() << std::endl;
 }
@@ -140,8 +150,7 @@ VM :: VM (Loader * loader, bool delete_loader)
 }
 
 
-VM :: VM (Loader * loader,
-          std::list <std::pair<SymbolicValue, SymbolicValue>> assertions)
+VM :: VM (Loader * loader, const Path & assertions)
 {
     this->engine = NULL;
     this->loader = loader;
@@ -157,20 +166,27 @@ VM :: ~VM ()
     if (delete_loader == true) {
         //delete loader;
     }
+    if (delete_code_cache == true)
+        delete code_cache;
     memory.destroy();
 }
 
 
 void VM :: copy (VM & rhs)
 {
-    ip_id         = rhs.ip_id;
     loader        = rhs.loader;
     kernel        = rhs.kernel;
-    translator    = rhs.translator;
     delete_loader = false;
-    variables     = rhs.variables;
+    code_cache    = rhs.code_cache;
+    delete_code_cache = false;
+    registers     = rhs.registers;
+    flags         = rhs.flags;
     memory        = rhs.memory.copy();
+    assertions    = rhs.assertions;
     engine        = rhs.engine;
+    depth         = rhs.depth;
+    instructions  = rhs.instructions;
+    symbolic_branches = rhs.symbolic_branches;
 }
 
 
@@ -178,23 +194,104 @@ VM * VM :: new_copy ()
 {
     VM * child = new VM();
 
-    child->ip_id         = ip_id;
     child->loader        = loader;
     child->kernel        = kernel;
-    child->translator    = translator;
     child->delete_loader = false;
-    child->variables     = variables;
+    child->code_cache    = code_cache;
+    child->delete_code_cache = false;
+    child->registers     = registers;
+    child->flags         = flags;
     child->memory        = memory.copy();
+    child->assertions    = assertions;
     child->engine        = engine;
+    child->depth         = depth;
+    child->instructions  = instructions;
+    child->symbolic_branches = symbolic_branches;
 
     return child;   
 }
 
 
+bool VM :: merge (VM & rhs)
+{
+    // the same instruction in the same stack frame. kernel state can't be
+    // merged, so it must be the same too
+    if (    registers[SLOT_RIP].g_wild() || rhs.registers[SLOT_RIP].g_wild()
+         || registers[SLOT_RSP].g_wild() || rhs.registers[SLOT_RSP].g_wild()
+         || (g_rip() != rhs.g_rip())
+         || (registers[SLOT_RSP].g_uint64() != rhs.registers[SLOT_RSP].g_uint64())
+         || (kernel != rhs.kernel))
+        return false;
+
+    // split each path into the prefix both share and what is left of each.
+    // if either path is a prefix of the other there is no condition telling
+    // the two apart
+    size_t shared     = assertions.shared(rhs.assertions);
+    size_t suffix     = assertions.size() - shared;
+    size_t rhs_suffix = rhs.assertions.size() - shared;
+    if (    (suffix == 0) || (suffix > MERGE_MAX_SUFFIX)
+         || (rhs_suffix == 0) || (rhs_suffix > MERGE_MAX_SUFFIX))
+        return false;
+
+    // registers are compared and merged as they are, so flags can't be pending
+    settle_flags();
+    rhs.settle_flags();
+
+    size_t differences = 0;
+    for (int i = 0; i < SLOT_COUNT; i++) {
+        if (not registers[i].identical(rhs.registers[i]))
+            differences++;
+    }
+    if (differences >= MERGE_MAX_DIFFERENCES)
+        return false;
+    differences += memory.differences(rhs.memory, MERGE_MAX_DIFFERENCES - differences);
+    if (differences >= MERGE_MAX_DIFFERENCES)
+        return false;
+
+    // cond holds on our path, rhs_cond on rhs's
+    std::vector <std::pair <SymbolicValue, SymbolicValue>> rest = assertions.g_assertions(shared);
+    SymbolicValue cond = Solver::constraint(rest[0].first, rest[0].second);
+    for (size_t i = 1; i < rest.size(); i++)
+        cond = cond & Solver::constraint(rest[i].first, rest[i].second);
+    rest = rhs.assertions.g_assertions(shared);
+    SymbolicValue rhs_cond = Solver::constraint(rest[0].first, rest[0].second);
+    for (size_t i = 1; i < rest.size(); i++)
+        rhs_cond = rhs_cond & Solver::constraint(rest[i].first, rest[i].second);
+
+    for (int i = 0; i < SLOT_COUNT; i++)
+        registers[i] = SymbolicValue::ite(cond, registers[i], rhs.registers[i]);
+    memory.merge(rhs.memory, cond);
+
+    assertions.truncate(shared);
+    assertions.push_back(std::pair <SymbolicValue, SymbolicValue>
+                             (cond | rhs_cond, SymbolicValue(1, 1)));
+
+    if (rhs.depth < depth)
+        depth = rhs.depth;
+
+    return true;
+}
+
+
 void VM :: step ()
 {
-    uint64_t ip_addr = variables[ip_id].g_uint64();
-    std::list <Instruction *> instructions;
+    try {
+        run_block();
+    }
+    catch (MemoryFault & fault) {
+        // a guest fault ends this VM's path, not the run
+        faulted = true;
+        std::cerr << "vm faulted at 0x" << std::hex << g_rip()
+                  << ": " << fault.what() << std::endl;
+        if ((engine == NULL) || (not engine->remove_vm(this)))
+            throw;
+    }
+}
+
+
+void VM :: run_block ()
+{
+    uint64_t ip_addr = registers[SLOT_RIP].g_uint64();
 
     // if there is a symbol name for this location, print it out
     // this code is very slow
@@ -203,78 +300,190 @@ void VM :: step ()
         std::cout << std::hex << ip_addr 
                   << "SYMBOL: " << symbol_name << " :" << std::endl;
 
-    instructions = translator.translate(ip_addr,
-                                        memory.g_data(ip_addr),
-                                        memory.g_data_size(ip_addr));
-
-    size_t instruction_size = instructions.front()->g_size();
+    // the code cache owns these instructions, we must not modify or delete them
+    const CodeBlock & block = code_cache->translate(ip_addr, memory);
 
     #ifdef DEBUG
+        // the block may run on into the next frame, so copy it out as
+        // translate does
+        uint8_t fetch[CODE_FETCH_SIZE];
+        size_t  fetched = memory.g_data(ip_addr, fetch, block.size);
         std::cout << "step IP=" << std::hex << ip_addr
-                 << " " << translator.native_asm((uint8_t *) memory.g_data(ip_addr), instruction_size);
-        for (size_t i = 0; i < instruction_size; i++) {
-            std::cout << " " << std::hex << (int) memory.g_byte(ip_addr + i);
+                 << " " << code_cache->g_translator().native_asm(fetch, fetched);
+        for (size_t i = 0; i < fetched; i++) {
+            std::cout << " " << std::hex << (int) fetch[i];
         }
         std::cout << std::endl;
     #endif
 
-    variables[ip_id] = variables[ip_id] + SymbolicValue(64, instruction_size);
+    this->instructions += block.guest_count;
 
-    #define EXECUTE(XX) if (dynamic_cast<XX *>(*it)) \
-                            execute(dynamic_cast<XX *>(*it));
+    const JitBlock * native_block = block.native;
+    if (native_block == NULL)
+        native_block = block.concrete;
+    run(block.instructions, block.size, block.tmp_count, native_block);
+}
 
-    std::list <Instruction *> :: iterator it;
-    for (it = instructions.begin(); it != instructions.end(); it++) {
-        #ifdef DEBUG
-            //std::cout << (*it)->str() << std::endl;
-        #endif
-             EXECUTE(InstructionAdd)
-        else EXECUTE(InstructionAnd)
-        else EXECUTE(InstructionAssign)
-        else EXECUTE(InstructionBrc)
-        else EXECUTE(InstructionCmpEq)
-        else EXECUTE(InstructionCmpLes)
-        else EXECUTE(InstructionCmpLeu)
-        else EXECUTE(InstructionCmpLts)
-        else EXECUTE(InstructionCmpLtu)
-        else EXECUTE(InstructionDiv)
-        else EXECUTE(InstructionHlt)
-        else EXECUTE(InstructionLoad)
-        else EXECUTE(InstructionNot)
-        else EXECUTE(InstructionMod)
-        else EXECUTE(InstructionMul)
-        else EXECUTE(InstructionOr)
-        else EXECUTE(InstructionShl)
-        else EXECUTE(InstructionShr)
-        else EXECUTE(InstructionSignExtend)
-        else EXECUTE(InstructionStore)
-        else EXECUTE(InstructionSub)
-        else EXECUTE(InstructionSyscall)
-        else EXECUTE(InstructionXor)
-        else throw std::runtime_error("unimplemented vm instruction: " + (*it)->str());
-
-        delete *it;
+
+void VM :: run_ir (const std::list <Instruction *> & instructions, size_t size, size_t tmp_count)
+{
+    run(instructions, size, tmp_count, NULL);
+}
+
+
+void VM :: run (const std::list <Instruction *> & instructions, size_t size,
+                size_t tmp_count, const JitBlock * native_block)
+{
+    // temporaries are always written before they are read within a block,
+    // which translate checks, so whatever a previous block left in scratch
+    // is never observed
+    if (scratch.size() < tmp_count)
+        scratch.resize(tmp_count);
+
+    // RIP is only written by branches, which always end a block, and once
+    // the block is done
+    next_rip = registers[SLOT_RIP].g_uint64() + size;
+    branched = false;
+
+    std::list <Instruction *> :: const_iterator it = instructions.begin();
+    if (native_block != NULL)
+        std::advance(it, run_native(native_block));
+
+    try {
+        for (; it != instructions.end(); it++) {
+            #ifdef DEBUG
+                //std::cout << (*it)->str() << std::endl;
+            #endif
+            if (execute_one(*it))
+                break;
+        }
     }
+    catch (MemoryFault & fault) {
+        // the guest instruction the faulting IR was lifted from
+        registers[SLOT_RIP] = SymbolicValue(64, (*it)->g_address());
+        throw;
+    }
+
+    if (not branched)
+        registers[SLOT_RIP] = SymbolicValue(64, next_rip);
+}
+
+
+bool VM :: execute_one (Instruction * ins)
+{
+    #define EXECUTE(OPCODE, XX) case OPCODE : execute(static_cast<XX *>(ins)); break;
+
+    switch (ins->g_opcode()) {
+    EXECUTE(IOP_ADD,        InstructionAdd)
+    EXECUTE(IOP_AND,        InstructionAnd)
+    EXECUTE(IOP_ASSIGN,     InstructionAssign)
+    EXECUTE(IOP_BRC,        InstructionBrc)
+    EXECUTE(IOP_CMPEQ,      InstructionCmpEq)
+    EXECUTE(IOP_CMPLES,     InstructionCmpLes)
+    EXECUTE(IOP_CMPLEU,     InstructionCmpLeu)
+    EXECUTE(IOP_CMPLTS,     InstructionCmpLts)
+    EXECUTE(IOP_CMPLTU,     InstructionCmpLtu)
+    EXECUTE(IOP_DIV,        InstructionDiv)
+    EXECUTE(IOP_FLAGS,      InstructionFlags)
+    EXECUTE(IOP_HLT,        InstructionHlt)
+    EXECUTE(IOP_LOAD,       InstructionLoad)
+    EXECUTE(IOP_NOT,        InstructionNot)
+    EXECUTE(IOP_MOD,        InstructionMod)
+    EXECUTE(IOP_MUL,        InstructionMul)
+    EXECUTE(IOP_OR,         InstructionOr)
+    case IOP_REP :
+        // a rep string instruction ends its block
+        return execute(static_cast<InstructionRep *>(ins));
+    EXECUTE(IOP_SHL,        InstructionShl)
+    EXECUTE(IOP_SHR,        InstructionShr)
+    EXECUTE(IOP_SIGNEXTEND, InstructionSignExtend)
+    EXECUTE(IOP_STORE,      InstructionStore)
+    EXECUTE(IOP_SUB,        InstructionSub)
+    EXECUTE(IOP_SYSCALL,    InstructionSyscall)
+    EXECUTE(IOP_XOR,        InstructionXor)
+    default :
+        throw std::runtime_error("unimplemented vm instruction: " + ins->str());
+    }
+
+    #undef EXECUTE
+
+    return false;
+}
+
+
+// sets value and returns true if v is concrete
+static bool concrete_value (const SymbolicValue & v, uint64_t & value)
+{
+    if (v.g_wild() || (v.g_type() == SVT_NONE))
+        return false;
+    value = v.g_uint64();
+    return true;
+}
+
+
+size_t VM :: run_native (const JitBlock * block)
+{
+    if (native.size() < block->g_variable_count())
+        native.resize(block->g_variable_count());
+
+    // a wild input leaves the whole block to the interpreter
+    const std::vector <uint64_t> & inputs = block->g_inputs();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const SymbolicValue & value = variable(inputs[i]);
+        if (value.g_wild() || (value.g_type() == SVT_NONE))
+            return 0;
+        native[inputs[i]] = value.g_uint64();
+    }
+    // a branch that isn't taken passes RIP through, and RIP falls through
+    native[SLOT_RIP] = next_rip;
+
+    const JitExit & exit = block->run(&(native[0]), &memory);
+
+    // a slot the block left as it was is not wrapped up again. writes are
+    // mostly registers saved and restored, and flags set to what they were
+    for (size_t i = 0; i < exit.writes.size(); i++) {
+        uint64_t id   = exit.writes[i].first;
+        int      bits = exit.writes[i].second;
+        if (id == SLOT_RIP)
+            branched = true;
+        // compiled code worked the flag out itself
+        else if (    (id >= SLOT_ZF) && (id <= SLOT_OF)
+                  && (flags.pending & (1 << (id - SLOT_ZF)))) {
+            flags.pending &= ~(1 << (id - SLOT_ZF));
+            registers[id] = SymbolicValue(bits, native[id]);
+            continue;
+        }
+
+        SymbolicValue & slot = id < SLOT_COUNT ? registers[id]
+                                               : scratch[id - SLOT_COUNT];
+        uint64_t value;
+        if (    (not concrete_value(slot, value))
+             || (value != native[id])
+             || (slot.g_bits() != bits))
+            slot = SymbolicValue(bits, native[id]);
+    }
+
+    return exit.index;
 }
 
 
 void VM :: execute (InstructionAdd * add)
 {
-    variables[add->g_dst().g_id()] = (g_value(add->g_lhs())
-                                      + g_value(add->g_rhs())).extend(add->g_dst().g_bits());
+    define(add->g_dst().g_id(), (g_value(add->g_lhs())
+                                  + g_value(add->g_rhs())).extend(add->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionAnd * And)
 {
-    variables[And->g_dst().g_id()] = (g_value(And->g_lhs())
-                                      & g_value(And->g_rhs())).extend(And->g_dst().g_bits());
+    define(And->g_dst().g_id(), (g_value(And->g_lhs())
+                                  & g_value(And->g_rhs())).extend(And->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionAssign * assign)
 {
-    variables[assign->g_dst().g_id()] = g_value(assign->g_src()).extend(assign->g_dst().g_bits());
+    define(assign->g_dst().g_id(), g_value(assign->g_src()).extend(assign->g_dst().g_bits()));
 }
 
 
@@ -290,20 +499,22 @@ void VM :: execute (InstructionBrc * brc)
             std::cerr << "wild condition: " << condition.str() << std::endl;
         #endif
 
-        bool condition_true  = false;
-        bool condition_false = false;
+        symbolic_branches++;
+
+        bool condition_true;
+        bool condition_false;
         
-        if (condition.sv_assert(SymbolicValue(1, 1), assertions))
-            condition_true  = true;
-        if (condition.sv_assert(SymbolicValue(1, 0), assertions))
-            condition_false = true;
+        engine->g_solver()->branch(assertions, condition, condition_true, condition_false);
 
 
         // if both conditions possible, we'll make a copy for the false branch
         // and set the assertion for the true branch for this VM
         if (condition_true && condition_false) {
             std::cout << "condition_true && condition_false" << std::endl;
+            depth++;
             VM * newvm = new_copy();
+            // the false branch falls through
+            newvm->registers[SLOT_RIP] = SymbolicValue(64, next_rip);
             std::pair <SymbolicValue, SymbolicValue>
                 assert_false(condition, SymbolicValue(1, 0));
             newvm->assertions.push_back(assert_false);
@@ -321,11 +532,13 @@ void VM :: execute (InstructionBrc * brc)
             std::pair <SymbolicValue, SymbolicValue>
                 assert_true(condition, SymbolicValue(1, 1));
             assertions.push_back(assert_true);
-            variables[ip_id] = g_value(brc->g_dst()).extend(variables[ip_id].g_bits());
+            registers[SLOT_RIP] = g_value(brc->g_dst()).extend(64);
+            branched = true;
         }
     }
     else if (condition.g_uint64()) {
-        variables[ip_id] = g_value(brc->g_dst()).extend(variables[ip_id].g_bits());
+        registers[SLOT_RIP] = g_value(brc->g_dst()).extend(64);
+        branched = true;
     }
 }
 
@@ -333,42 +546,118 @@ void VM :: execute (InstructionBrc * brc)
 void VM :: execute (InstructionCmpEq * cmpeq)
 {
     SymbolicValue cmp = g_value(cmpeq->g_lhs()) == g_value(cmpeq->g_rhs());
-    variables[cmpeq->g_dst().g_id()] = cmp.extend(cmpeq->g_dst().g_bits());
+    define(cmpeq->g_dst().g_id(), cmp.extend(cmpeq->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionCmpLes * cmples)
 {
     SymbolicValue cmp = g_value(cmples->g_lhs()).cmpLes(g_value(cmples->g_rhs()));
-    variables[cmples->g_dst().g_id()] = cmp.extend(cmples->g_dst().g_bits());
+    define(cmples->g_dst().g_id(), cmp.extend(cmples->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionCmpLeu * cmpleu)
 {
     SymbolicValue cmp = g_value(cmpleu->g_lhs()).cmpLeu(g_value(cmpleu->g_rhs()));
-    variables[cmpleu->g_dst().g_id()] = cmp.extend(cmpleu->g_dst().g_bits());
+    define(cmpleu->g_dst().g_id(), cmp.extend(cmpleu->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionCmpLts * cmplts)
 {
     SymbolicValue cmp = g_value(cmplts->g_lhs()).cmpLts(g_value(cmplts->g_rhs()));
-    variables[cmplts->g_dst().g_id()] = cmp.extend(cmplts->g_dst().g_bits());
+    define(cmplts->g_dst().g_id(), cmp.extend(cmplts->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionCmpLtu * cmpltu)
 {
     SymbolicValue cmp = g_value(cmpltu->g_lhs()).cmpLtu(g_value(cmpltu->g_rhs()));
-    variables[cmpltu->g_dst().g_id()] = cmp.extend(cmpltu->g_dst().g_bits());
+    define(cmpltu->g_dst().g_id(), cmp.extend(cmpltu->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionDiv * div)
 {
-    variables[div->g_dst().g_id()] = (g_value(div->g_lhs())
-                                      / g_value(div->g_rhs())).extend(div->g_dst().g_bits());
+    define(div->g_dst().g_id(), (g_value(div->g_lhs())
+                                  / g_value(div->g_rhs())).extend(div->g_dst().g_bits()));
+}
+
+
+void VM :: execute (InstructionFlags * ins)
+{
+    int defines = InstructionFlags::defines(ins->g_kind());
+
+    // flags this kind leaves alone still need the record they came from
+    if (flags.pending & ~defines)
+        settle_flags();
+
+    flags.kind    = ins->g_kind();
+    flags.pending = defines;
+    flags.lhs     = g_value(ins->g_lhs());
+    flags.rhs     = g_value(ins->g_rhs());
+    flags.result  = g_value(ins->g_result());
+}
+
+
+void VM :: settle_flag (uint64_t slot)
+{
+    int bit = 1 << (slot - SLOT_ZF);
+    if (not (flags.pending & bit))
+        return;
+    flags.pending &= ~bit;
+
+    // these follow what the translator used to emit for each instruction
+    const SymbolicValue & lhs    = flags.lhs;
+    const SymbolicValue & rhs    = flags.rhs;
+    const SymbolicValue & result = flags.result;
+    SymbolicValue zero(result.g_bits(), 0);
+    SymbolicValue value;
+
+    switch (slot) {
+    case SLOT_ZF :
+        if (flags.kind == FLAGS_CMP)
+            value = lhs == rhs;
+        else
+            value = result == zero;
+        break;
+    case SLOT_SF :
+        value = result.cmpLts(zero);
+        break;
+    case SLOT_CF :
+        switch (flags.kind) {
+        case FLAGS_ADD   : value = result.cmpLtu(lhs); break;
+        case FLAGS_SUB   :
+        case FLAGS_SBB   : value = lhs.cmpLtu(result); break;
+        case FLAGS_CMP   : value = lhs.cmpLtu(rhs);    break;
+        case FLAGS_LOGIC : value = SymbolicValue(1, 0); break;
+        }
+        break;
+    case SLOT_OF :
+        switch (flags.kind) {
+        // the RREIL paper's OF, http://www2.in.tum.de/bib/files/sepp11precise.pdf
+        case FLAGS_ADD    :
+        case FLAGS_CMP    : value = lhs.cmpLts(rhs) ^ result.cmpLts(zero); break;
+        case FLAGS_SBB    : value = result.cmpLts(rhs) ^ result.cmpLts(zero); break;
+        case FLAGS_INCDEC : value = result.cmpLts(lhs) ^ result.cmpLts(zero); break;
+        case FLAGS_SUB    :
+            value = (result ^ lhs).extend(lhs.g_bits())
+                    >> SymbolicValue(lhs.g_bits(), lhs.g_bits() - 1);
+            break;
+        case FLAGS_LOGIC  : value = SymbolicValue(1, 0); break;
+        }
+        break;
+    }
+
+    registers[slot] = value.extend(1);
+}
+
+
+void VM :: settle_flags ()
+{
+    for (uint64_t slot = SLOT_ZF; slot <= SLOT_OF; slot++)
+        settle_flag(slot);
 }
 
 
@@ -385,13 +674,13 @@ void VM :: execute (InstructionLoad * load)
 
     switch (load->g_bits()) {
     case 8 :
-        variables[dst.g_id()] = memory.g_sym8(src.g_uint64()); break;
+        define(dst.g_id(), memory.g_sym8(src.g_uint64())); break;
     case 16 :
-        variables[dst.g_id()] = memory.g_sym16(src.g_uint64()); break;
+        define(dst.g_id(), memory.g_sym16(src.g_uint64())); break;
     case 32 :
-        variables[dst.g_id()] = memory.g_sym32(src.g_uint64()); break;
+        define(dst.g_id(), memory.g_sym32(src.g_uint64())); break;
     case 64 :
-        variables[dst.g_id()] = memory.g_sym64(src.g_uint64()); break;
+        define(dst.g_id(), memory.g_sym64(src.g_uint64())); break;
     default :
         std::stringstream ss;
         ss << "Tried to load invalid bit size: " << load->g_bits();
@@ -400,49 +689,137 @@ void VM :: execute (InstructionLoad * load)
 
     #ifdef DEBUG
     std::cout << "loadloc [" << std::hex << src.g_uint64() << "] = "
-              << variables[dst.g_id()].str() << std::endl;
+              << variable(dst.g_id()).str() << std::endl;
     #endif
 }
 
 
 void VM :: execute (InstructionMod * mod)
 {
-    variables[mod->g_dst().g_id()] = (g_value(mod->g_lhs())
-                                      % g_value(mod->g_rhs())).extend(mod->g_dst().g_bits());
+    define(mod->g_dst().g_id(), (g_value(mod->g_lhs())
+                                  % g_value(mod->g_rhs())).extend(mod->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionMul * mul)
 {
-    variables[mul->g_dst().g_id()] = (g_value(mul->g_lhs()) 
-                                      * g_value(mul->g_rhs())).extend(mul->g_dst().g_bits());
+    define(mul->g_dst().g_id(), (g_value(mul->g_lhs()) 
+                                  * g_value(mul->g_rhs())).extend(mul->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionNot * Not)
 {
-    variables[Not->g_dst().g_id()] = (~ g_value(Not->g_src())).extend(Not->g_dst().g_bits());
+    define(Not->g_dst().g_id(), (~ g_value(Not->g_src())).extend(Not->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionOr * Or)
 {
-    variables[Or->g_dst().g_id()] = (g_value(Or->g_lhs()) 
-                                     | g_value(Or->g_rhs())).extend(Or->g_dst().g_bits());
+    define(Or->g_dst().g_id(), (g_value(Or->g_lhs()) 
+                                 | g_value(Or->g_rhs())).extend(Or->g_dst().g_bits()));
+}
+
+
+bool VM :: execute (InstructionRep * rep)
+{
+    uint64_t count;
+    uint64_t rdi;
+    uint64_t df;
+    uint64_t rax = 0;
+    uint64_t rsi = 0;
+    if (    (not concrete_value(variable(SLOT_RCX), count))
+         || (not concrete_value(variable(SLOT_RDI), rdi))
+         || (not concrete_value(variable(SLOT_DF), df)))
+        return false;
+    if (    (rep->g_kind() == REP_MOVS)
+         && (not concrete_value(variable(SLOT_RSI), rsi)))
+        return false;
+    if (    (rep->g_kind() != REP_MOVS)
+         && (not concrete_value(variable(SLOT_RAX), rax)))
+        return false;
+
+    // a rep with RCX of zero doesn't run the instruction at all
+    if (count == 0)
+        return true;
+
+    uint64_t width = rep->g_bits() / 8;
+    if (count > (uint64_t) -1 / width)
+        return false;
+    uint64_t bytes = count * width;
+    // elements go up from rdi, or down from it when DF is set, and we work on
+    // the bytes from the lowest of them
+    uint64_t span = bytes - width;
+    uint64_t step = df ? -bytes : bytes;
+    if (df && ((span > rdi) || ((rep->g_kind() == REP_MOVS) && (span > rsi))))
+        return false;
+
+    switch (rep->g_kind()) {
+    case REP_STOS :
+        if (not memory.fill(df ? rdi - span : rdi, rax, width, bytes))
+            return false;
+        break;
+    case REP_MOVS : {
+        uint64_t dst = df ? rdi - span : rdi;
+        uint64_t src = df ? rsi - span : rsi;
+        // an overlapping copy depends on the order of the iterations
+        if ((dst < src + bytes) && (src < dst + bytes))
+            return false;
+        if (not memory.move(dst, src, bytes))
+            return false;
+        registers[SLOT_RSI] = SymbolicValue(64, rsi + step);
+        break;
+    }
+    case REPNE_SCAS : {
+        uint8_t al = rax;
+        // every byte scan looked at was a finished iteration
+        uint64_t done = memory.scan(rdi, df, al, count);
+        bool     found = false;
+        uint64_t at    = df ? rdi - done : rdi + done;
+        if ((done < count) && (memory.g_page(at) != NULL)) {
+            const SymbolicValue byte = memory.g_sym8(at);
+            found = (not byte.g_wild()) && (byte.g_uint64() == al);
+            if (found)
+                done++;
+        }
+        if (done == 0)
+            return false;
+
+        // the flags scasb sets for the last byte it compared. it sets all
+        // four, so none is left pending
+        uint8_t last = memory.g_byte(df ? rdi - (done - 1) : rdi + (done - 1));
+        uint8_t sf   = (uint8_t) (last - al) >> 7;
+        flags.pending = 0;
+        registers[SLOT_CF] = SymbolicValue(1, last < al);
+        registers[SLOT_ZF] = SymbolicValue(1, last == al);
+        registers[SLOT_SF] = SymbolicValue(1, sf);
+        registers[SLOT_OF] = SymbolicValue(1, ((int8_t) last < (int8_t) al) ^ sf);
+        registers[SLOT_RDI] = SymbolicValue(64, df ? rdi - done : rdi + done);
+        registers[SLOT_RCX] = SymbolicValue(64, count - done);
+        // a symbolic or unmapped byte is left to the per-iteration IR
+        return found || (done == count);
+    }
+    default :
+        return false;
+    }
+
+    registers[SLOT_RDI] = SymbolicValue(64, rdi + step);
+    registers[SLOT_RCX] = SymbolicValue(64, 0);
+    return true;
 }
 
 
 void VM :: execute (InstructionShl * shl)
 {
-    variables[shl->g_dst().g_id()] = (g_value(shl->g_lhs())
-                                      << g_value(shl->g_rhs())).extend(shl->g_dst().g_bits());
+    define(shl->g_dst().g_id(), (g_value(shl->g_lhs())
+                                  << g_value(shl->g_rhs())).extend(shl->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionShr * shr)
 {
-    variables[shr->g_dst().g_id()] = (g_value(shr->g_lhs())
-                                      >> g_value(shr->g_rhs())).extend(shr->g_dst().g_bits());
+    define(shr->g_dst().g_id(), (g_value(shr->g_lhs())
+                                  >> g_value(shr->g_rhs())).extend(shr->g_dst().g_bits()));
 }
 
 
@@ -452,7 +829,7 @@ void VM :: execute (InstructionSignExtend * sext)
     SymbolicValue src = g_value(sext->g_src()).extend(sext->g_src().g_bits());
     // now sign extend this value to the dst's size
     const SymbolicValue dst = src.signExtend(sext->g_dst().g_bits());
-    variables[sext->g_dst().g_id()] = dst;
+    define(sext->g_dst().g_id(), dst);
 }
 
 
@@ -468,7 +845,7 @@ void VM :: execute (InstructionStore * store)
 
     switch (store->g_bits()) {
     case 8  : memory.s_sym8(dst.g_uint64(), src); break;
-    case 16 : memory.s_word(dst.g_uint64(), src.g_uint64()); break;
+    case 16 : memory.s_sym16(dst.g_uint64(), src); break;
     case 32 : memory.s_sym32(dst.g_uint64(), src); break;
     case 64 : memory.s_sym64(dst.g_uint64(), src); break;
     default :
@@ -481,21 +858,21 @@ void VM :: execute (InstructionStore * store)
 
 void VM :: execute (InstructionSub * sub)
 {
-    variables[sub->g_dst().g_id()] = (g_value(sub->g_lhs())
-                                      - g_value(sub->g_rhs())).extend(sub->g_dst().g_bits());
+    define(sub->g_dst().g_id(), (g_value(sub->g_lhs())
+                                  - g_value(sub->g_rhs())).extend(sub->g_dst().g_bits()));
 }
 
 
 void VM :: execute (InstructionSyscall * syscall)
 {
-    kernel.syscall(variables, memory);
+    kernel.syscall(registers, memory);
 }
 
 
 void VM :: execute (InstructionXor * Xor)
 {
-    variables[Xor->g_dst().g_id()] = (g_value(Xor->g_lhs())
-                                      ^ g_value(Xor->g_rhs())).extend(Xor->g_dst().g_bits());
+    define(Xor->g_dst().g_id(), (g_value(Xor->g_lhs())
+                                  ^ g_value(Xor->g_rhs())).extend(Xor->g_dst().g_bits()));
 }
 
 void VM :: execute (Instruction * ins) {}
\ No newline at end of file
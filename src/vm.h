@@ -22,33 +22,119 @@
 
 class VM;
 
+#include "codecache.h"
 #include "elf.h"
 #include "engine.h"
 #include "kernel.h"
 #include "memory.h"
+#include "path.h"
+#include "registers.h"
 #include "symbolicvalue.h"
 #include "translator.h"
 
-#include <list>
-#include <map>
+#include <vector>
+
+// merging two VMs is only worth it when their paths split recently, and they
+// differ in few registers and bytes. each difference becomes an ite the
+// solver has to reason through on every later query
+#define MERGE_MAX_SUFFIX      8
+#define MERGE_MAX_DIFFERENCES 64
+
+/*
+ * The last InstructionFlags run, with the values of its operands. A flag
+ * whose bit is set in pending has not been worked out yet, and its register
+ * is out of date.
+ */
+struct LazyFlags {
+    int           kind;
+    int           pending; // bit i for slot SLOT_ZF + i
+    SymbolicValue lhs;
+    SymbolicValue rhs;
+    SymbolicValue result;
+
+    LazyFlags () : kind(FLAGS_ADD), pending(0) {}
+};
 
 class VM {
     private :
-        uint64_t   ip_id;
-
         Engine *   engine; // who's your daddy
 
         Loader *   loader;
         Kernel     kernel;
         Memory     memory;
-        Translator translator;
         bool       delete_loader;
 
-        std::list <std::pair<SymbolicValue, SymbolicValue>> assertions;
-        std::map <uint64_t, SymbolicValue> variables;
+        CodeCache * code_cache;
+        bool        delete_code_cache;
+
+        Path       assertions;
+        // the number of forks on the path to this VM
+        size_t     depth;
+        // guest instructions run, and wild branches met, on the path to
+        // this VM
+        uint64_t   instructions;
+        uint64_t   symbolic_branches;
+        // set once an access to unmapped memory has terminated this VM
+        bool       faulted;
+        // architectural registers, and temporaries for the current block.
+        // temporaries never live past the end of a block, and we only fork
+        // on a block's final branch, so scratch is not copied to children
+        RegisterFile                 registers;
+        std::vector <SymbolicValue> scratch;
+        LazyFlags                   flags;
+        // where the current block falls through to, and whether a branch in
+        // it has written RIP already. RIP holds the block's address until
+        // the block is done, so an error part way through reports it
+        uint64_t                    next_rip;
+        bool                        branched;
+        // concrete copies of variables, for JitBlocks to work on
+        std::vector <uint64_t>      native;
+
+        // a pending flag is worked out before it is read
+        SymbolicValue & variable (uint64_t id)
+        {
+            if (id < SLOT_COUNT) {
+                if (flags.pending && (id >= SLOT_ZF) && (id <= SLOT_OF))
+                    settle_flag(id);
+                return registers[id];
+            }
+            return scratch[id - SLOT_COUNT];
+        }
+
+        // a pending flag that is overwritten is never worked out. value is
+        // evaluated before the call, so it may read the flag it replaces
+        void define (uint64_t id, const SymbolicValue & value)
+        {
+            if (id < SLOT_COUNT) {
+                if ((id >= SLOT_ZF) && (id <= SLOT_OF))
+                    flags.pending &= ~(1 << (id - SLOT_ZF));
+                registers[id] = value;
+            }
+            else
+                scratch[id - SLOT_COUNT] = value;
+        }
+
+        // writes the flag in slot to its register if it is pending
+        void settle_flag  (uint64_t slot);
+        // writes every pending flag to its register
+        void settle_flags ();
 
         const SymbolicValue g_value (InstructionOperand operand);
 
+        void run_block ();
+        // runs the IR of a block size guest bytes long at RIP, from
+        // native_block where it can be, and moves RIP past the block unless
+        // it branched
+        void run (const std::list <Instruction *> & instructions, size_t size,
+                  size_t tmp_count, const JitBlock * native_block);
+        // runs one IR instruction in the interpreter, and returns true if the
+        // rest of the block should be skipped
+        bool execute_one (Instruction * ins);
+        // runs block, compiled or in the concrete interpreter, if its inputs
+        // are concrete, and returns the index of the IR instruction the
+        // interpreter picks up from
+        size_t run_native (const JitBlock * block);
+
         void init ();
 
         void execute (InstructionAdd        *);
@@ -61,12 +147,16 @@ class VM {
         void execute (InstructionCmpLts     *);
         void execute (InstructionCmpLtu     *);
         void execute (InstructionDiv        *);
+        void execute (InstructionFlags      *);
         void execute (InstructionHlt        *);
         void execute (InstructionLoad       *);
         void execute (InstructionMod        *);
         void execute (InstructionMul        *);
         void execute (InstructionNot        *);
         void execute (InstructionOr         *);
+        // returns true if every iteration was run, and the per-iteration IR
+        // after it should be skipped
+        bool execute (InstructionRep        *);
         void execute (InstructionShl        *);
         void execute (InstructionShr        *);
         void execute (InstructionSignExtend *);
@@ -80,18 +170,45 @@ class VM {
         VM (Loader * loader);
         VM (Loader * loader, Engine * engine);
         VM (Loader * loader, bool delete_loader);
-        VM (Loader * loader,
-            std::list <std::pair<SymbolicValue, SymbolicValue>> assertions);
-        VM () : loader(NULL), delete_loader(false) { delete_loader = false; }
+        VM (Loader * loader, const Path & assertions);
+        VM () : loader(NULL), delete_loader(false), code_cache(NULL), delete_code_cache(false),
+                depth(0), instructions(0), symbolic_branches(0), faulted(false)
+            { delete_loader = false; }
         ~VM ();
 
+        // copies share every page, symbolic byte and assertion with the VM
+        // they were copied from, so copying takes the same time however much
+        // memory or how long a path the VM has
         void copy (VM & rhs);
         VM * new_copy ();
 
+        // folds rhs into this VM, so this VM covers both paths, and returns
+        // true. returns false, changing nothing, if the two aren't at the
+        // same place in the same stack frame, or merging isn't worth it
+        bool merge (VM & rhs);
+
+        // runs the next block. a MemoryFault terminates the VM through its
+        // Engine, and is only rethrown if there is no Engine to do so
         void step ();
 
         SymbolicValue g_variable (uint64_t identifier);
 
+        uint64_t g_rip   () { return registers[SLOT_RIP].g_uint64(); }
+        size_t   g_depth () { return depth; }
+
+        Memory &     g_memory     () { return memory;     }
+        const Path & g_assertions () { return assertions; }
+
+        uint64_t g_instructions      () { return instructions;      }
+        uint64_t g_symbolic_branches () { return symbolic_branches; }
+        bool     g_faulted           () { return faulted;           }
+
+        // runs instructions in the interpreter as the block at RIP, for tests
+        // which lift IR by hand. tmp_count is the number of temporaries
+        // they use
+        void run_ir (const std::list <Instruction *> & instructions, size_t size,
+                     size_t tmp_count);
+
         // special functions for debugging
         void debug_x86_registers ();
         void debug_variables     ();